@@ -1,4 +1,5 @@
 #version 330 core
+#include "include/material_atlas.glsl"
 out vec4 FragColor;
 
 in vec2 TexCoords;
@@ -18,56 +19,13 @@ uniform sampler2D texture_height1;
 uniform sampler2D texture_detail1;
 uniform sampler2D texture_scatter1;
 
-// Light properties
-struct DirLight {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-    float constant;
-    float linear;
-    float quadratic;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-    float constant;
-    float linear;
-    float quadratic;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-// Light uniforms
-uniform DirLight dirLight;
-uniform PointLight pointLight; // Main point light
-uniform SpotLight spotLight;
-uniform bool useDirLight;
-uniform bool usePointLight;
-uniform bool useSpotLight;
-
-// Multiple point lights
-#define MAX_POINT_LIGHTS 20
-uniform PointLight randomPointLights[MAX_POINT_LIGHTS];
-uniform int numRandomPointLights;
-uniform bool useRandomPointLights;
-
-// Light brightness adjustment uniforms
-uniform float pointLightBrightness = 0.2; // Default: 20% of original (80% reduction)
-uniform float dirLightBrightness = 1.4;   // Default: 140% of original (40% increase)
-uniform float spotLightBrightness = 1.8;  // Default: 180% of original (80% increase)
-uniform bool useCelShading;
+#include "include/light_block.glsl"
+#include "include/frame_constants.glsl"
+#include "include/features.glsl"
+#include "include/clustered_lights.glsl"
+#include "include/normal_map.glsl"
+
+FEATURE_TOGGLE(useCelShading, USE_CEL_SHADING);
 
 // NEW: Blinn-Phong toggle and direct color support
 uniform bool useBlinnPhong = true;         // Toggle between Phong and Blinn-Phong
@@ -76,20 +34,19 @@ uniform vec3 directDiffuseColor = vec3(0.8, 0.8, 0.8);  // Direct diffuse color
 uniform vec3 directSpecularColor = vec3(1.0, 1.0, 1.0); // Direct specular color
 
 // Other uniforms
-uniform vec3 viewPos;
-uniform bool useNormalMap;
-uniform bool useSpecularMap;
+FEATURE_TOGGLE(useNormalMap, USE_NORMAL_MAP);
+FEATURE_TOGGLE(useSpecularMap, USE_SPECULAR_MAP);
 uniform bool useDetailMap;
 uniform bool useScatterMap;
 uniform float shininess;
 
 // Reflection uniforms
 uniform samplerCube skybox;
-uniform bool useReflection = false;  // Disabled by default
+FEATURE_TOGGLE(useReflection, USE_REFLECTION);  // Disabled by default
 uniform float reflectivity = 0.3;    // Default reflection intensity
 
 // Refraction uniforms
-uniform bool useRefraction = false;  // Disabled by default
+FEATURE_TOGGLE(useRefraction, USE_REFRACTION);  // Disabled by default
 uniform float refractionRatio = 0.66; // Default refraction ratio (glass-like)
 
 // Dynamic environment mapping uniforms
@@ -102,8 +59,6 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
 float CalculateSpecular(vec3 lightDir, vec3 normal, vec3 viewDir, float shininessValue);
 
-float near = 0.1;
-float far  = 100.0;
 uniform vec3 fogColor = vec3(0.7, 0.7, 0.7); // light gray fog
 uniform float fogStart = 3.0;               // fog starts here
 uniform float fogEnd = 35.0;                 // fully fogged here
@@ -141,8 +96,8 @@ float LinearizeDepth(float d)
 {
     // d = depth in non-linear space
     float z_ndc = d * 2.0 - 1.0;
-    return (2.0 * near * far)
-            / (far + near - z_ndc * (far - near));
+    return (2.0 * nearPlane * farPlane)
+            / (farPlane + nearPlane - z_ndc * (farPlane - nearPlane));
 }
 
 vec3 ApplyFog(vec3 color, float depth)
@@ -155,7 +110,7 @@ void depthTest()
 {
     // get eye-space Z, then normalize to [0,1] for visualization
     float linearZ = LinearizeDepth(gl_FragCoord.z);
-    float normalized = linearZ / far;
+    float normalized = linearZ / farPlane;
     // output normalized Z to the fragment shader
     FragColor = vec4(vec3(normalized), 1.0);
 }
@@ -207,7 +162,7 @@ void main()
         specularColor = directSpecularColor;
     } else {
         // Sample the diffuse texture
-        vec4 texColor = texture(texture_diffuse1, TexCoords);
+        vec4 texColor = MATERIAL_TEXTURE(texture_diffuse1, MATERIAL_DIFFUSE, TexCoords);
 
         // If the texture is completely transparent, discard the fragment
         if(texColor.a < 0.1)
@@ -225,15 +180,14 @@ void main()
         // Get specular color
         specularColor = vec3(0.5);
         if(useSpecularMap) {
-            specularColor = texture(texture_specular1, TexCoords).rgb;
+            specularColor = MATERIAL_TEXTURE(texture_specular1, MATERIAL_SPECULAR, TexCoords).rgb;
         }
     }
 
     // Get normal from normal map, use checkerboard for ground, or use the interpolated normal
     vec3 norm;
     if(useNormalMap) {
-        norm = texture(texture_normal1, TexCoords).rgb;
-        norm = normalize(norm * 2.0 - 1.0); // Transform from [0,1] to [-1,1]
+        norm = normalize(DecodeNormalMap(MATERIAL_TEXTURE(texture_normal1, MATERIAL_NORMAL, TexCoords)));
     } else {
         // Check if this is the ground plane (y-coordinate close to 0)
         if (abs(FragPos.y) < 0.1) {
@@ -273,10 +227,11 @@ void main()
         result += CalcPointLight(pointLight, norm, FragPos, viewDir, diffuseColor, specularColor);
     }
 
-    // Random point lights
+    // Random point lights, only those whose range reaches this fragment's cluster
     if(useRandomPointLights) {
-        for(int i = 0; i < numRandomPointLights && i < MAX_POINT_LIGHTS; i++) {
-            result += CalcPointLight(randomPointLights[i], norm, FragPos, viewDir, diffuseColor, specularColor);
+        uvec2 lightRange = ClusterLightRange(FragPos);
+        for(uint i = 0u; i < lightRange.y; i++) {
+            result += CalcPointLight(ClusterPointLight(lightRange.x + i), norm, FragPos, viewDir, diffuseColor, specularColor);
         }
     }
 
@@ -341,7 +296,7 @@ void main()
     //}
 
     // Use texture alpha if available, otherwise full opacity
-    float alpha = useDirectColor ? 1.0 : texture(texture_diffuse1, TexCoords).a;
+    float alpha = useDirectColor ? 1.0 : MATERIAL_TEXTURE(texture_diffuse1, MATERIAL_DIFFUSE, TexCoords).a;
     //FragColor = vec4(result, alpha);
     FragColor = vec4(result, 1.0);
 }
@@ -1,9 +1,10 @@
 #version 330 core
+#define MATERIAL_ATLAS_VERTEX
+#include "include/material_atlas.glsl"
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+layout (location = 3) in vec4 aTangent;    // w: bitangent handedness
 
 out vec2 TexCoords;
 out vec3 Normal;
@@ -14,31 +15,32 @@ out vec3 TangentFragPos;
 out vec3 TangentSpotLightPos;
 out vec3 TangentSpotLightDir;
 
+#ifndef MATERIAL_ATLAS
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+#include "include/frame_constants.glsl"
+#include "include/features.glsl"
 
 // Light positions for tangent space calculations
 uniform vec3 lightPos; // Point light position
-uniform vec3 viewPos;  // Camera position
-uniform bool useNormalMap;
-
-// Add these uniforms
-uniform vec3 spotLightPos;  // Spotlight position
-uniform vec3 spotLightDir;  // Spotlight direction
+FEATURE_TOGGLE(useNormalMap, USE_NORMAL_MAP);
 
 void main() {
+#ifdef MATERIAL_ATLAS
+    mat4 model = MaterialDrawSetup();
+#endif
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
     TexCoords = aTexCoords;
     
     // Calculate TBN matrix for normal mapping
-    if (useNormalMap && length(aTangent) > 0.0) {
-        vec3 T = normalize(mat3(model) * aTangent);
+    if (useNormalMap && length(aTangent.xyz) > 0.0) {
+        vec3 T = normalize(mat3(model) * aTangent.xyz);
         vec3 N = normalize(mat3(model) * aNormal);
         // Re-orthogonalize T with respect to N
         T = normalize(T - dot(T, N) * N);
-        vec3 B = cross(N, T);
+        vec3 B = cross(N, T) * aTangent.w;
         
         mat3 TBN = transpose(mat3(T, B, N));
         TangentLightPos = TBN * lightPos;
@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+#include "include/frame_constants.glsl"
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+}
@@ -0,0 +1,132 @@
+#version 330 core
+// Lighting pass of the deferred path: one full-screen triangle that shades
+// every covered pixel once from the G-buffer. The light math matches 3d.fs in
+// world space; random point lights come from the same clusters as forward.
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gEnvironment;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+uniform bool useCelShading;
+uniform bool useBlinnPhong = true;
+
+#include "include/light_block.glsl"
+#include "include/frame_constants.glsl"
+#include "include/clustered_lights.glsl"
+#include "include/gbuffer.glsl"
+
+float shininess;
+
+vec3 ApplyCelShading(float diffuseIntensity, float specularIntensity) {
+    float stepSize = 1.0 / 3.0;
+    float quantizedDiffuse = clamp(floor(diffuseIntensity / stepSize) * stepSize, 0.0, 1.0);
+    float spec = specularIntensity > 0.5 ? 1.0 : 0.0;
+    return vec3(quantizedDiffuse, spec, 0.0);
+}
+
+float CalculateSpecular(vec3 lightDir, vec3 normal, vec3 viewDir, float shininessValue) {
+    if (useBlinnPhong) {
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        return pow(max(dot(normal, halfwayDir), 0.0), shininessValue);
+    }
+    vec3 reflectDir = reflect(-lightDir, normal);
+    return pow(max(dot(viewDir, reflectDir), 0.0), shininessValue);
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor) {
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    diff = diff * diff;
+    float spec = CalculateSpecular(lightDir, normal, viewDir, useBlinnPhong ? shininess * 2.5 : shininess);
+    spec = spec * spec;
+
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 lighting = useCelShading ? ApplyCelShading(diff, spec)
+                                  : light.diffuse * diff * diffuseColor + light.specular * spec * specularColor;
+    return lighting * dirLightBrightness + ambient;
+}
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor) {
+    vec3 toLight = light.position - fragPos;
+    float distance = length(toLight);
+    vec3 lightDir = toLight / max(distance, 1e-4);
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = CalculateSpecular(lightDir, normal, viewDir, useBlinnPhong ? shininess * 2.5 : shininess);
+
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    attenuation *= 1.0 - smoothstep(20.0, 40.0, distance);
+
+    vec3 ambient = light.ambient * diffuseColor * attenuation;
+    vec3 lighting = useCelShading ? ApplyCelShading(diff, spec)
+                                  : light.diffuse * diff * diffuseColor + light.specular * spec * specularColor;
+    return lighting * attenuation * pointLightBrightness + ambient;
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor) {
+    vec3 toLight = light.position - fragPos;
+    float distance = length(toLight);
+    vec3 lightDir = toLight / max(distance, 1e-4);
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = CalculateSpecular(lightDir, normal, viewDir, useBlinnPhong ? shininess * 2.5 : shininess);
+
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    attenuation *= 1.0 - smoothstep(15.0, 30.0, distance);
+
+    float theta = dot(lightDir, -normalize(light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = smoothstep(0.0, 1.0, clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0));
+
+    vec3 factors = useCelShading ? ApplyCelShading(diff, spec) : vec3(diff, spec, 0.0);
+    vec3 lighting = light.diffuse * factors.x * diffuseColor + light.specular * factors.y * specularColor;
+    vec3 ambient = light.ambient * diffuseColor * attenuation * intensity;
+    return lighting * attenuation * intensity * spotLightBrightness + ambient;
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    // nothing was drawn here; keep the target's clear colour
+    if (depth >= 1.0)
+        discard;
+
+    vec4 clip = inverseViewProjection * vec4(TexCoords * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec3 fragPos = clip.xyz / clip.w;
+
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec4 normalData = texelFetch(gNormal, pixel, 0);
+    vec4 environment = texelFetch(gEnvironment, pixel, 0);
+    vec3 diffuseColor = albedoSpec.rgb;
+    vec3 specularColor = vec3(albedoSpec.a);
+    vec3 norm = DecodeOctahedral(normalData.xy);
+    shininess = normalData.w;
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    vec3 result = vec3(0.0);
+    if (useDirLight) {
+        result += CalcDirLight(dirLight, norm, viewDir, diffuseColor, specularColor);
+    }
+    if (usePointLight) {
+        result += CalcPointLight(pointLight, norm, fragPos, viewDir, diffuseColor, specularColor);
+    }
+    if (useRandomPointLights) {
+        uvec2 lightRange = ClusterLightRange(fragPos);
+        for (uint i = 0u; i < lightRange.y; i++) {
+            result += CalcPointLight(ClusterPointLight(lightRange.x + i), norm, fragPos, viewDir, diffuseColor, specularColor);
+        }
+    }
+    if (useSpotLight) {
+        result += CalcSpotLight(spotLight, norm, fragPos, viewDir, diffuseColor, specularColor);
+    }
+    result += diffuseColor * normalData.z * 0.5;
+    if (!useDirLight && !usePointLight && !useSpotLight && !useRandomPointLights) {
+        result = diffuseColor * 0.3;
+    }
+
+    FragColor = vec4(mix(result, environment.rgb, environment.a), 1.0);
+}
@@ -0,0 +1,108 @@
+#version 330 core
+#include "include/material_atlas.glsl"
+// Geometry pass of the deferred path: the material inputs of 3d.fs, written
+// to the G-buffer instead of being lit here
+layout (location = 0) out vec4 gAlbedoSpec;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gEnvironment;
+
+in vec2 TexCoords;
+in vec3 FragPos;
+in mat3 TBN;
+
+// Material maps
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+uniform sampler2D texture_normal1;
+uniform sampler2D texture_detail1;
+uniform sampler2D texture_scatter1;
+
+#include "include/frame_constants.glsl"
+#include "include/gbuffer.glsl"
+#include "include/normal_map.glsl"
+
+uniform bool useDirectColor = false;
+uniform vec3 directDiffuseColor = vec3(0.8, 0.8, 0.8);
+uniform vec3 directSpecularColor = vec3(1.0, 1.0, 1.0);
+
+uniform bool useNormalMap;
+uniform bool useSpecularMap;
+uniform bool useDetailMap;
+uniform bool useScatterMap;
+uniform float shininess;
+
+uniform samplerCube skybox;
+uniform bool useReflection;
+uniform float reflectivity = 0.3;
+uniform bool useRefraction;
+uniform float refractionRatio = 0.66;
+uniform samplerCube dynamicEnvironmentMap;
+uniform bool useDynamicEnvironmentMap = false;
+
+// Same bumps as calculateCheckerboardNormal in 3d.fs
+vec3 calculateCheckerboardNormal(vec2 position, float scale, float height) {
+    float x = floor(position.x * scale);
+    float z = floor(position.y * scale);
+    vec3 normal = vec3(0.0, 1.0, 0.0);
+    if (mod(x + z, 2.0) >= 1.0) {
+        float dx = 0.5 - fract(position.x * scale);
+        float dz = 0.5 - fract(position.y * scale);
+        if (sqrt(dx * dx + dz * dz) < 0.4) {
+            normal = normalize(vec3(dx * height, 0.5, dz * height));
+        }
+    }
+    return normalize(normal);
+}
+
+vec3 SampleEnvironment(vec3 direction) {
+    return useDynamicEnvironmentMap ? texture(dynamicEnvironmentMap, direction).rgb : texture(skybox, direction).rgb;
+}
+
+void main()
+{
+    vec3 diffuseColor;
+    vec3 specularColor;
+    if (useDirectColor) {
+        diffuseColor = directDiffuseColor;
+        specularColor = directSpecularColor;
+    } else {
+        vec4 texColor = MATERIAL_TEXTURE(texture_diffuse1, MATERIAL_DIFFUSE, TexCoords);
+        if (texColor.a < 0.1)
+            discard;
+        diffuseColor = texColor.rgb;
+        if (useDetailMap) {
+            diffuseColor = mix(diffuseColor, texture(texture_detail1, TexCoords * 5.0).rgb, 0.3);
+        }
+        specularColor = useSpecularMap ? MATERIAL_TEXTURE(texture_specular1, MATERIAL_SPECULAR, TexCoords).rgb : vec3(0.5);
+    }
+
+    vec3 geometricNormal = normalize(TBN[2]);
+    vec3 norm;
+    if (useNormalMap) {
+        // the forward path lights in tangent space; here the map goes to world space
+        norm = normalize(TBN * DecodeNormalMap(MATERIAL_TEXTURE(texture_normal1, MATERIAL_NORMAL, TexCoords)));
+    } else if (abs(FragPos.y) < 0.1) {
+        norm = calculateCheckerboardNormal(FragPos.xz, 1.0, 0.255);
+    } else {
+        norm = geometricNormal;
+    }
+
+    float scatter = 0.0;
+    if (useScatterMap && !useDirectColor) {
+        scatter = texture(texture_scatter1, TexCoords).r;
+    }
+
+    // Environment terms need the surface's own normal and are cheap, so they are resolved here
+    vec4 environment = vec4(0.0);
+    vec3 I = normalize(FragPos - viewPos);
+    if (useReflection && reflectivity > 0.0) {
+        environment = vec4(SampleEnvironment(reflect(I, geometricNormal)), reflectivity);
+    }
+    if (useRefraction && refractionRatio > 0.0) {
+        environment = vec4(SampleEnvironment(refract(I, geometricNormal, refractionRatio)), 1.0);
+    }
+
+    gAlbedoSpec = vec4(diffuseColor, dot(specularColor, vec3(1.0 / 3.0)));
+    gNormal = vec4(EncodeOctahedral(norm), scatter, shininess);
+    gEnvironment = environment;
+}
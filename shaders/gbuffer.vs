@@ -0,0 +1,37 @@
+#version 330 core
+#define MATERIAL_ATLAS_VERTEX
+#include "include/material_atlas.glsl"
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aTangent;    // w: bitangent handedness
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out mat3 TBN; // world space; the last column is the geometric normal
+
+#ifndef MATERIAL_ATLAS
+uniform mat4 model;
+#endif
+
+#include "include/frame_constants.glsl"
+
+void main() {
+#ifdef MATERIAL_ATLAS
+    mat4 model = MaterialDrawSetup();
+#endif
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords;
+
+    vec3 N = normalize(mat3(transpose(inverse(model))) * aNormal);
+    vec3 T = mat3(model) * aTangent.xyz;
+    if (length(T) > 0.0) {
+        // Re-orthogonalize T with respect to N
+        T = normalize(T - dot(T, N) * N);
+    } else {
+        T = normalize(abs(N.y) < 0.99 ? cross(vec3(0.0, 1.0, 0.0), N) : cross(vec3(1.0, 0.0, 0.0), N));
+    }
+    TBN = mat3(T, cross(N, T) * aTangent.w, N);
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
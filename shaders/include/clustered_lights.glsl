@@ -0,0 +1,40 @@
+// Random point lights, clustered per view by LightClusterGrid on the CPU.
+// Needs light_block.glsl and frame_constants.glsl; the texture units are set
+// by Renderer3D (CLUSTER_RANGES_UNIT etc. in UniformBuffer.h).
+uniform usamplerBuffer clusterRanges;  // per cluster: first index, light count
+uniform usamplerBuffer clusterIndices; // light indices, grouped by cluster
+uniform samplerBuffer lightData;       // four texels per light
+
+// Cluster of a world-space position; must match LightClusterGrid's numbering
+int ClusterIndex(vec3 worldPos) {
+    vec4 viewSpace = view * vec4(worldPos, 1.0);
+    vec4 clip = projection * viewSpace;
+    ivec2 tile = ivec2((clip.xy / clip.w * 0.5 + 0.5) * vec2(clusterGrid.xy));
+    tile = clamp(tile, ivec2(0), clusterGrid.xy - 1);
+    int slice = int(floor(log(max(-viewSpace.z, 1e-4)) * clusterDepth.x + clusterDepth.y));
+    slice = clamp(slice, 0, clusterGrid.z - 1);
+    return (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+}
+
+// Light range (first index, count) in clusterIndices
+uvec2 ClusterLightRange(vec3 worldPos) {
+    return texelFetch(clusterRanges, ClusterIndex(worldPos)).xy;
+}
+
+PointLight ClusterPointLight(uint slot) {
+    int base = int(texelFetch(clusterIndices, int(slot)).r) * 4;
+    vec4 positionConstant = texelFetch(lightData, base);
+    vec4 ambientLinear = texelFetch(lightData, base + 1);
+    vec4 diffuseQuadratic = texelFetch(lightData, base + 2);
+    vec4 specularRadius = texelFetch(lightData, base + 3);
+
+    PointLight light;
+    light.position = positionConstant.xyz;
+    light.constant = positionConstant.w;
+    light.linear = ambientLinear.w;
+    light.quadratic = diffuseQuadratic.w;
+    light.ambient = ambientLinear.xyz;
+    light.diffuse = diffuseQuadratic.xyz;
+    light.specular = specularRadius.xyz;
+    return light;
+}
@@ -0,0 +1,8 @@
+// Runtime toggles that ShaderPermutations can bake into a variant.
+// The uber-shader (no SHADER_VARIANT) reads them from uniforms; a variant
+// gets every feature define as 0 or 1 and the branches fold away.
+#ifdef SHADER_VARIANT
+#define FEATURE_TOGGLE(name, define) const bool name = (define != 0)
+#else
+#define FEATURE_TOGGLE(name, define) uniform bool name
+#endif
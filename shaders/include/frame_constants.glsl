@@ -0,0 +1,11 @@
+// Shared per-frame constants (binding 0, see UniformBuffer.h)
+layout (std140) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;       // Camera position
+    float time;
+    vec3 spotLightPos;  // Spotlight position (follows the camera)
+    float nearPlane;
+    vec3 spotLightDir;  // Spotlight direction
+    float farPlane;
+};
@@ -0,0 +1,20 @@
+// G-buffer of the deferred path (Renderer3D::RenderPath::Deferred)
+//   0 RGBA8    albedo rgb, specular intensity
+//   1 RGBA16F  octahedral world normal xy, scatter, shininess
+//   2 RGBA8    environment (reflection / refraction) rgb, blend weight
+//   depth      GL_DEPTH24_STENCIL8, positions are rebuilt from it
+
+// Unit vector to [-1, 1]^2 by folding the octahedron onto the plane
+vec2 EncodeOctahedral(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : folded;
+}
+
+vec3 DecodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
@@ -0,0 +1,47 @@
+// Light properties
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+    float constant;
+    float linear;
+    float quadratic;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float constant;
+    float linear;
+    float quadratic;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// Shared light data (binding 1, see UniformBuffer.h)
+layout (std140) uniform LightBlock {
+    DirLight dirLight;
+    PointLight pointLight; // Main point light
+    SpotLight spotLight;
+    bool useDirLight;
+    bool usePointLight;
+    bool useSpotLight;
+    bool useRandomPointLights;
+    int numRandomPointLights;
+    float pointLightBrightness;
+    float dirLightBrightness;
+    float spotLightBrightness;
+    ivec4 clusterGrid;   // tiles x, tiles y, depth slices (see clustered_lights.glsl)
+    vec4 clusterDepth;   // slice = log(depth) * x + y
+};
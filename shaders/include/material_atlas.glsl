@@ -0,0 +1,66 @@
+// Material atlas mode (see src/render/MaterialAtlas.h): one
+// glMultiDrawElementsBaseVertex draws many meshes, each reading its model
+// matrix and material from the MaterialDraws buffer at gl_DrawIDARB. The
+// material textures are layers of sampler2DArrays, or bindless handles.
+//
+// Included right after #version, so the #extension lines come first; a
+// vertex shader defines MATERIAL_ATLAS_VERTEX before including it. Without
+// MATERIAL_ATLAS only MATERIAL_TEXTURE is defined, as a plain texture().
+#ifdef MATERIAL_ATLAS
+#extension GL_ARB_shader_storage_buffer_object : require
+#ifdef MATERIAL_ATLAS_VERTEX
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+#ifdef MATERIAL_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+#endif
+
+// material texture slots, as MaterialAtlas::Slot numbers them
+#define MATERIAL_DIFFUSE 0
+#define MATERIAL_SPECULAR 1
+#define MATERIAL_NORMAL 2
+#define MATERIAL_HEIGHT 3
+
+#ifdef MATERIAL_ATLAS
+
+#ifdef MATERIAL_ATLAS_VERTEX
+struct MaterialDraw {
+    mat4 model;
+    ivec4 layers;      // per slot; -1 without a texture
+    uvec4 handles[2];  // bindless: per slot, the low and high half of the handle
+};
+
+layout(std430) readonly buffer MaterialDraws {
+    MaterialDraw draws[];
+};
+
+flat out ivec4 MaterialLayers;
+flat out uvec4 MaterialHandles[2];
+
+// the model matrix of this draw; passes its textures on to the fragment shader
+mat4 MaterialDrawSetup() {
+    MaterialLayers = draws[gl_DrawIDARB].layers;
+    MaterialHandles[0] = draws[gl_DrawIDARB].handles[0];
+    MaterialHandles[1] = draws[gl_DrawIDARB].handles[1];
+    return draws[gl_DrawIDARB].model;
+}
+#else
+flat in ivec4 MaterialLayers;
+flat in uvec4 MaterialHandles[2];
+
+#ifdef MATERIAL_BINDLESS
+uvec2 MaterialHandle(int slot) {
+    uvec4 pair = MaterialHandles[slot / 2];
+    return (slot % 2 == 0) ? pair.xy : pair.zw;
+}
+#define MATERIAL_TEXTURE(name, slot, uv) texture(sampler2D(MaterialHandle(slot)), uv)
+#else
+uniform sampler2DArray materialArrays[4];
+#define MATERIAL_TEXTURE(name, slot, uv) texture(materialArrays[slot], vec3(uv, float(MaterialLayers[slot])))
+#endif
+#endif
+
+#else
+#define MATERIAL_TEXTURE(name, slot, uv) texture(name, uv)
+#endif
@@ -0,0 +1,7 @@
+// Tangent space normal from a normal map texel. Only x and y are read and z
+// is rebuilt, so two channel (BC5) maps baked by TextureBaker and plain RGB
+// maps sample the same.
+vec3 DecodeNormalMap(vec4 texel) {
+    vec2 xy = texel.rg * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
@@ -5,62 +5,18 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec3 LocalPos;
 
-// Planet properties
-uniform vec3 baseColor1;      // Primary color
-uniform vec3 baseColor2;      // Secondary color for gradient
-uniform vec3 highlightColor;  // Highlight/specular color
-uniform float shininess;      // Controls the sharpness of the highlight
-uniform float gradientFactor; // Controls the gradient blend (0.0 to 1.0)
+// Planet properties, from uniforms (planet.vs) or instance attributes (planet_instanced.vs)
+flat in vec3 SurfaceColor1;    // Primary color
+flat in vec3 SurfaceColor2;    // Secondary color for gradient
+flat in vec3 SurfaceHighlight; // Highlight/specular color
+flat in vec3 SurfaceParams;    // shininess, gradient factor, emission
+
 
 // NEW: Blinn-Phong toggle
 uniform bool useBlinnPhong = true; // Toggle between Phong and Blinn-Phong
 
-// Light properties
-struct DirLight {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-    float constant;
-    float linear;
-    float quadratic;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-    float constant;
-    float linear;
-    float quadratic;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-// Light uniforms
-uniform DirLight dirLight;
-uniform PointLight pointLight; // Main point light
-uniform SpotLight spotLight;
-uniform bool useDirLight;
-uniform bool usePointLight;
-uniform bool useSpotLight;
-
-// Light brightness adjustment uniforms
-uniform float pointLightBrightness = 1.0;
-uniform float dirLightBrightness = 1.0;
-uniform float spotLightBrightness = 1.0;
-
-// Other uniforms
-uniform vec3 viewPos;
+#include "include/light_block.glsl"
+#include "include/frame_constants.glsl"
 
 // Function to create a simple noise for surface variation
 float random(vec3 pos) {
@@ -135,8 +91,8 @@ void main() {
     gradient = clamp(gradient + noiseValue, 0.0, 1.0);
     
     // Blend between the two base colors based on the gradient
-    vec3 diffuseColor = mix(baseColor1, baseColor2, gradient * gradientFactor);
-    vec3 specularColor = highlightColor;
+    vec3 diffuseColor = mix(SurfaceColor1, SurfaceColor2, gradient * SurfaceParams.y);
+    vec3 specularColor = SurfaceHighlight;
 
     // Calculate lighting
     vec3 result = vec3(0.0);
@@ -161,6 +117,9 @@ void main() {
         result = diffuseColor * 0.3; // Basic ambient
     }
     
+    // Self luminous bodies (distant stars) ignore the lighting
+    result = mix(result, diffuseColor, SurfaceParams.z);
+
     FragColor = vec4(result, 1.0);
 }
 
@@ -172,7 +131,7 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor,
     float diff = max(dot(normal, lightDir), 0.0);
 
     // Specular shading - use the new unified function
-    float effectiveShininess = useBlinnPhong ? shininess * 2.5 : shininess; // Blinn-Phong needs higher exponent
+    float effectiveShininess = useBlinnPhong ? SurfaceParams.x * 2.5 : SurfaceParams.x; // Blinn-Phong needs higher exponent
     float spec = CalculateSpecular(lightDir, normal, viewDir, effectiveShininess);
 
     // Combine results
@@ -192,7 +151,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     float diff = max(dot(normal, lightDir), 0.0);
 
     // Specular shading - use the new unified function
-    float effectiveShininess = useBlinnPhong ? shininess * 2.5 : shininess;
+    float effectiveShininess = useBlinnPhong ? SurfaceParams.x * 2.5 : SurfaceParams.x;
     float spec = CalculateSpecular(lightDir, normal, viewDir, effectiveShininess);
 
     // Attenuation
@@ -219,7 +178,7 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec
     float diff = max(dot(normal, lightDir), 0.0);
 
     // Specular shading - use the new unified function
-    float effectiveShininess = useBlinnPhong ? shininess * 2.5 : shininess;
+    float effectiveShininess = useBlinnPhong ? SurfaceParams.x * 2.5 : SurfaceParams.x;
     float spec = CalculateSpecular(lightDir, normal, viewDir, effectiveShininess);
 
     // Attenuation
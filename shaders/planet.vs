@@ -5,14 +5,31 @@ layout (location = 1) in vec3 aNormal;
 out vec3 FragPos;
 out vec3 Normal;
 out vec3 LocalPos;
+// Surface material, per draw here and per instance in planet_instanced.vs
+flat out vec3 SurfaceColor1;
+flat out vec3 SurfaceColor2;
+flat out vec3 SurfaceHighlight;
+flat out vec3 SurfaceParams; // shininess, gradient factor, emission
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Planet properties
+uniform vec3 baseColor1;      // Primary color
+uniform vec3 baseColor2;      // Secondary color for gradient
+uniform vec3 highlightColor;  // Highlight/specular color
+uniform float shininess;      // Controls the sharpness of the highlight
+uniform float gradientFactor; // Controls the gradient blend (0.0 to 1.0)
+uniform float emission;       // 1.0 outputs the surface colour unlit
+
+#include "include/frame_constants.glsl"
 
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
     LocalPos = aPos;  // Pass local position for gradient calculation
+    SurfaceColor1 = baseColor1;
+    SurfaceColor2 = baseColor2;
+    SurfaceHighlight = highlightColor;
+    SurfaceParams = vec3(shininess, gradientFactor, emission);
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
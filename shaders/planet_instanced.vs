@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+// Per instance attributes (see CelestialInstanceBatch.h)
+layout (location = 7) in mat4 instanceModel;
+layout (location = 11) in vec4 instanceColor;    // rgb: base colour, a: emission
+layout (location = 12) in vec4 instanceMaterial; // shininess, gradient factor, specular, secondary colour scale
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 LocalPos;
+flat out vec3 SurfaceColor1;
+flat out vec3 SurfaceColor2;
+flat out vec3 SurfaceHighlight;
+flat out vec3 SurfaceParams; // shininess, gradient factor, emission
+
+#include "include/frame_constants.glsl"
+
+void main() {
+    vec4 worldPos = instanceModel * vec4(aPos, 1.0);
+    FragPos = vec3(worldPos);
+    // Rotation and uniform scale only, so the model matrix transforms normals too
+    Normal = mat3(instanceModel) * aNormal;
+    LocalPos = aPos;
+    SurfaceColor1 = instanceColor.rgb;
+    SurfaceColor2 = instanceColor.rgb * instanceMaterial.w;
+    SurfaceHighlight = vec3(instanceMaterial.z);
+    SurfaceParams = vec3(instanceMaterial.x, instanceMaterial.y, instanceColor.a);
+    gl_Position = projection * view * worldPos;
+}
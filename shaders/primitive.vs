@@ -8,8 +8,8 @@ out vec3 Normal;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "include/frame_constants.glsl"
 
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
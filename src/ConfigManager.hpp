@@ -441,6 +441,37 @@ public:
     bool GetUseRefraction() const { return Get<bool>("Rendering.UseRefraction", false); }
     float GetReflectionIntensity() const { return Get<float>("Rendering.ReflectionIntensity", 0.3f); }
     float GetRefractionRatio() const { return Get<float>("Rendering.RefractionRatio", 0.66f); }
+    // RenderStats budgets, e.g. "draws<=2000; main.triangles<=5000000"
+    std::string GetRenderBudgets() const { return Get<std::string>("Rendering.RenderBudgets", ""); }
+    // per-frame RenderStats CSV, empty to disable
+    std::string GetRenderStatsCsv() const { return Get<std::string>("Rendering.RenderStatsCsv", ""); }
+    // program binaries, relative to the resource root
+    bool GetUseShaderCache() const { return Get<bool>("Rendering.UseShaderCache", true); }
+    std::string GetShaderCacheDirectory() const { return Get<std::string>("Rendering.ShaderCacheDirectory", "shader_cache"); }
+    // imported models cooked into mapped binary files under bin/models/cooked
+    bool GetUseMeshCache() const { return Get<bool>("Rendering.UseMeshCache", true); }
+    // GL uploads of models loading in the background, per frame
+    double GetUploadBudgetMs() const { return Get<double>("Rendering.UploadBudgetMs", 4.0); }
+    int GetUploadBudgetMB() const { return Get<int>("Rendering.UploadBudgetMB", 32); }
+    // textures decoded in the background and uploaded through a PBO ring, behind a 1x1 placeholder
+    bool GetUseTextureStreaming() const { return Get<bool>("Rendering.TextureStreaming", true); }
+    int GetTextureStreamBudgetMB() const { return Get<int>("Rendering.TextureStreamBudgetMB", 16); }
+    // uploads from a hidden window's context sharing objects with the main one
+    bool GetTextureStreamSharedContext() const { return Get<bool>("Rendering.TextureStreamSharedContext", false); }
+    // block-compressed (BC1/BC3/BC5) copies of texture files, baked next to them on first use
+    bool GetUseTextureBaking() const { return Get<bool>("Rendering.TextureBaking", true); }
+    // specialised "model" shader variants instead of the uniform-branching uber-shader
+    bool GetUseShaderVariants() const { return Get<bool>("Rendering.UseShaderVariants", true); }
+    // random point lights scattered over the models scene ground, clustered by Renderer3D
+    int GetRandomPointLights() const { return Get<int>("Rendering.RandomPointLights", 0); }
+    // G-buffer and one lighting pass instead of lighting every model fragment as it is drawn
+    bool GetUseDeferredShading() const { return Get<bool>("Rendering.DeferredShading", false); }
+    // simplified mesh levels chosen by screen size, and the error in pixels they may show
+    bool GetUseMeshLod() const { return Get<bool>("Rendering.MeshLod", true); }
+    float GetLodPixelError() const { return Get<float>("Rendering.LodPixelError", 1.0f); }
+    // scene draws merged into multi-draws, their textures in texture arrays or bindless handles (GL 4.3)
+    bool GetUseMaterialAtlas() const { return Get<bool>("Rendering.MaterialAtlas", false); }
+    bool GetMaterialAtlasBindless() const { return Get<bool>("Rendering.MaterialAtlasBindless", true); }
     
     void SetUseReflection(bool value) { Set<bool>("Rendering.UseReflection", value); }
     void SetUseRefraction(bool value) { Set<bool>("Rendering.UseRefraction", value); }
@@ -5,12 +5,21 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "render/Shader.h"
 
 #include <iostream>
 #include <string>
 #include <vector>
+#include <type_traits>
+#include "render/GLStateCache.h"
+#include "render/GeometryPool.h"
+#include "render/Material.h"
+#include "render/Frustum.h"
+#include "render/RenderStats.h"
+#include "render/MeshLod.h"
+#include "render/MeshOptimizer.h"
 using namespace std;
 
 #define MAX_BONE_INFLUENCE 4
@@ -33,126 +42,353 @@ namespace m3D {
         float m_Weights[MAX_BONE_INFLUENCE];
     };
 
+    // What the GPU gets instead of Vertex (88 bytes): position as floats, normal
+    // and tangent as 10:10:10:2 snorm with the bitangent's handedness in the
+    // tangent's w (shaders rebuild it as cross(N, T) * w), UVs as two halfs.
+    // 24 bytes; no bone data, that goes in a SkinVertex stream when present.
+    struct PackedVertex {
+        glm::vec3 Position;
+        GLuint Normal;
+        GLuint Tangent;
+        GLuint TexCoords;
+    };
+
+    // PackedVertex for meshes whose UVs tile too far for half precision; 28 bytes
+    struct PackedVertexWideUV {
+        glm::vec3 Position;
+        GLuint Normal;
+        GLuint Tangent;
+        glm::vec2 TexCoords;
+    };
+
+    // the second stream of skinned meshes: up to 256 bones, weights in 1/255ths
+    struct SkinVertex {
+        uint8_t BoneIDs[MAX_BONE_INFLUENCE];
+        uint8_t Weights[MAX_BONE_INFLUENCE];
+    };
+
+    // half UVs are used while their spacing (2^-10 between 1 and 2) stays under a texel of a 1K texture
+    const float HALF_UV_LIMIT = 2.0f;
+
+    // declares the PackedVertex (or PackedVertexWideUV) attributes on the bound VAO and GL_ARRAY_BUFFER
+    template <typename V>
+    inline void SetupPackedAttributes()
+    {
+        const bool halfUV = std::is_same<V, PackedVertex>::value;
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, Position));
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(V), (void*)offsetof(V, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, halfUV ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, TexCoords));
+        // vertex tangent and bitangent sign
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(V), (void*)offsetof(V, Tangent));
+    }
+
+    // declares the SkinVertex attributes on the bound VAO and GL_ARRAY_BUFFER
+    inline void SetupSkinAttributes()
+    {
+        // ids
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, BoneIDs));
+        // weights
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, Weights));
+    }
+
+    // Meshes of the same layout share GeometryPool pages
+    inline const VertexLayout PackedVertexLayout = { sizeof(PackedVertex), SetupPackedAttributes<PackedVertex> };
+    inline const VertexLayout PackedVertexWideUVLayout = { sizeof(PackedVertexWideUV), SetupPackedAttributes<PackedVertexWideUV> };
+    inline const VertexLayout SkinnedVertexLayout = { sizeof(PackedVertex), SetupPackedAttributes<PackedVertex>,
+                                                      sizeof(SkinVertex), SetupSkinAttributes };
+    inline const VertexLayout SkinnedVertexWideUVLayout = { sizeof(PackedVertexWideUV), SetupPackedAttributes<PackedVertexWideUV>,
+                                                            sizeof(SkinVertex), SetupSkinAttributes };
+
+    inline GLuint PackTangentFrame(const glm::vec3& direction, float w)
+    {
+        float length = glm::length(direction);
+        glm::vec3 unit = length > 0.0f ? direction / length : glm::vec3(0.0f);
+        return glm::packSnorm3x10_1x2(glm::vec4(unit, w));
+    }
+
+    template <typename V>
+    inline void PackVertex(const Vertex& vertex, V& packed)
+    {
+        packed.Position = vertex.Position;
+        packed.Normal = PackTangentFrame(vertex.Normal, 0.0f);
+        // the sign that turns cross(N, T) into the imported bitangent
+        float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        packed.Tangent = PackTangentFrame(vertex.Tangent, handedness);
+        if constexpr (std::is_same<V, PackedVertex>::value)
+            packed.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+        else
+            packed.TexCoords = vertex.TexCoords;
+    }
+
+    inline SkinVertex PackSkin(const Vertex& vertex)
+    {
+        SkinVertex skin = {};
+        int largest = 0, sum = 0;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+            skin.BoneIDs[i] = static_cast<uint8_t>(glm::clamp(vertex.m_BoneIDs[i], 0, 255));
+            skin.Weights[i] = static_cast<uint8_t>(glm::clamp(vertex.m_Weights[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+            sum += skin.Weights[i];
+            if (skin.Weights[i] > skin.Weights[largest])
+                largest = i;
+        }
+        // rounding must not make the weights stop summing to one
+        if (sum > 0)
+            skin.Weights[largest] = static_cast<uint8_t>(glm::clamp(skin.Weights[largest] + 255 - sum, 0, 255));
+        return skin;
+    }
+
+    // Packs vertices into the smallest layout that holds them: half UVs while
+    // they stay within HALF_UV_LIMIT, a skinning stream only if some vertex
+    // has a bone weight. Returns the layout; skin is left empty without bones.
+    inline const VertexLayout& PackVertices(const vector<Vertex>& vertices,
+                                            vector<unsigned char>& packed, vector<SkinVertex>& skin)
+    {
+        bool halfUV = true, skinned = false;
+        for (const Vertex& vertex : vertices) {
+            halfUV = halfUV && glm::abs(vertex.TexCoords.x) <= HALF_UV_LIMIT && glm::abs(vertex.TexCoords.y) <= HALF_UV_LIMIT;
+            for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+                skinned = skinned || vertex.m_Weights[i] > 0.0f;
+        }
+
+        const VertexLayout& layout = halfUV ? (skinned ? SkinnedVertexLayout : PackedVertexLayout)
+                                            : (skinned ? SkinnedVertexWideUVLayout : PackedVertexWideUVLayout);
+        packed.resize(vertices.size() * layout.stride);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (halfUV)
+                PackVertex(vertices[i], reinterpret_cast<PackedVertex*>(packed.data())[i]);
+            else
+                PackVertex(vertices[i], reinterpret_cast<PackedVertexWideUV*>(packed.data())[i]);
+        }
+
+        skin.clear();
+        if (skinned) {
+            skin.reserve(vertices.size());
+            for (const Vertex& vertex : vertices)
+                skin.push_back(PackSkin(vertex));
+        }
+        return layout;
+    }
+
     struct Texture {
         unsigned int id;
         string type;
         string path;
     };
 
+    // A mesh in the form it is uploaded: packed vertices, and the indices of
+    // every level of detail back to back
+    struct PackedMesh {
+        const VertexLayout* layout = nullptr;
+        vector<unsigned char> vertices;
+        vector<SkinVertex> skin;           // empty unless the layout has the skinning stream
+        GLuint vertexCount = 0;
+        vector<unsigned int> indices;
+        vector<MeshLod> lods;              // lods[0] is the full mesh
+        AABB bounds;
+
+        static PackedMesh Pack(const vector<Vertex>& vertices, const vector<unsigned int>& indices,
+                               const MeshLodChain& lodChain)
+        {
+            PackedMesh mesh;
+            mesh.layout = &PackVertices(vertices, mesh.vertices, mesh.skin);
+            mesh.vertexCount = static_cast<GLuint>(vertices.size());
+            for (const Vertex& vertex : vertices)
+                mesh.bounds.expand(vertex.Position);
+
+            // one allocation for every level, so they move together when the pool compacts
+            MeshLod full;
+            full.indexCount = static_cast<GLsizei>(indices.size());
+            mesh.lods.assign(1, full);
+            mesh.indices = indices;
+            mesh.indices.insert(mesh.indices.end(), lodChain.indices.begin(), lodChain.indices.end());
+            for (MeshLod level : lodChain.levels) {
+                level.firstIndex += static_cast<GLuint>(indices.size());
+                mesh.lods.push_back(level);
+            }
+            return mesh;
+        }
+    };
+
     class Mesh {
     public:
         // mesh Data
         vector<Vertex>       vertices;
         vector<unsigned int> indices;
         vector<Texture>      textures;
-        unsigned int VAO;
+        // the textures as a binding table, built once; Draw and BindTextures go through it
+        Material             material;
+        unsigned int VAO; // the GeometryPool page VAO, shared with other meshes
+        // vertex and index range inside the GeometryPool
+        GeometryHandle geometry = INVALID_GEOMETRY;
+        // local space bounds of the vertex positions, used for culling
+        AABB bounds;
+        // levels of detail, ranges of the pooled indices; lods[0] is the full mesh
+        vector<MeshLod> lods;
+        // the packed format the GPU copy is in, chosen from the vertex contents
+        const VertexLayout* layout = nullptr;
 
-        // constructor
-        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+        // constructor; the LOD chain (see MeshSimplifier) is uploaded behind the indices
+        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures,
+             const MeshLodChain& lodChain = MeshLodChain())
         {
             this->vertices = vertices;
             this->indices = indices;
             this->textures = textures;
+            setupMaterial();
+
+            for (const Vertex& vertex : this->vertices)
+                bounds.expand(vertex.Position);
 
             // now that we have all the required data, set the vertex buffers and its attribute pointers.
-            setupMesh();
+            setupMesh(lodChain);
         }
 
-        // render the mesh
-        void Draw(Shader &shader) 
+        // constructor for data already packed in `layout` (see PackedMesh), e.g. mapped from the
+        // MeshCache: uploads straight from that memory and keeps no CPU copy of the vertices.
+        // indices hold every level; lods say where each starts
+        Mesh(const VertexLayout& layout, const void* packedVertices, const void* skinVertices, GLuint vertexCount,
+             const GLuint* indices, GLuint indexCount, const vector<MeshLod>& lods, const AABB& bounds,
+             vector<Texture> textures)
+            : textures(std::move(textures)), bounds(bounds), lods(lods), layout(&layout)
         {
-            // bind appropriate textures
-            unsigned int diffuseNr  = 1;
-            unsigned int specularNr = 1;
-            unsigned int normalNr   = 1;
-            unsigned int heightNr   = 1;
+            setupMaterial();
+            upload(packedVertices, skinVertices, vertexCount, indices, indexCount);
+        }
 
+        // simplified levels for a mesh about to be constructed
+        static MeshLodChain BuildLods(const vector<Vertex>& vertices, const vector<unsigned int>& indices)
+        {
+            if (vertices.empty())
+                return MeshLodChain();
+            MeshLodChain chain = MeshSimplifier::BuildLodChain(indices.data(), indices.size(),
+                                                               &vertices[0].Position.x, vertices.size(), sizeof(Vertex));
+            // collapses leave the triangles in level 0's order with holes; reorder each level for the cache
+            for (const MeshLod& level : chain.levels)
+                MeshOptimizer::OptimizeVertexCache(&chain.indices[level.firstIndex], level.indexCount, vertices.size());
+            return chain;
+        }
+
+        // welds duplicated vertices and reorders triangles and vertices for
+        // the GPU caches (see MeshOptimizer); run before BuildLods
+        static MeshOptimizeReport Optimize(vector<Vertex>& vertices, vector<unsigned int>& indices)
+        {
+            size_t vertexCount = vertices.size();
+            MeshOptimizeReport report = MeshOptimizer::Optimize(vertices.data(), vertexCount, sizeof(Vertex),
+                                                                indices, offsetof(Vertex, Position));
+            vertices.resize(vertexCount);
+            return report;
+        }
+
+        // the level of detail to draw this mesh at under the given model matrix
+        int SelectLod(const glm::mat4& model, uint8_t& current) const
+        {
+            return LodSelector::Select(lods, bounds, model, current);
+        }
+
+        // render the mesh
+        void Draw(Shader &shader, int lod = 0) 
+        {
             // First, activate the shader
             shader.Use();
 
             // Then bind textures
-            for(unsigned int i = 0; i < textures.size(); i++)
-            {
-                glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-                // retrieve texture number (the N in diffuse_textureN)
-                std::string number;
-                std::string name = textures[i].type;
-                if(name == "texture_diffuse")
-                    number = std::to_string(diffuseNr++);
-                else if(name == "texture_specular")
-                    number = std::to_string(specularNr++); // transfer unsigned int to string
-                else if(name == "texture_normal")
-                    number = std::to_string(normalNr++); // transfer unsigned int to string
-                else if(name == "texture_height")
-                    number = std::to_string(heightNr++); // transfer unsigned int to string
-                std::string texture = name + number;
-
-                // Set the uniform only if the shader has the uniform
-                GLint location = glGetUniformLocation(shader.ID, texture.c_str());
-                if (location != -1) {
-                    shader.SetInteger(texture.c_str(), i);
-                    // and finally bind the texture
-                    glBindTexture(GL_TEXTURE_2D, textures[i].id);
-                }
-            }
+            BindTextures(shader);
             
             // draw mesh
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            GLStateCache::BindVertexArray(VAO);
+            DrawElements(lod);
+            GLStateCache::BindVertexArray(0);
 
             // always good practice to set everything back to defaults once configured.
-            glActiveTexture(GL_TEXTURE0);
+            GLStateCache::ActiveTexture(GL_TEXTURE0);
+        }
+
+        // bind the material textures and point the samplers at them; the shader must be in use.
+        // returns the number of textures bound
+        unsigned int BindTextures(Shader &shader) const
+        {
+            return material.Bind(shader);
+        }
+
+        // issue the draw call; the VAO must already be bound
+        void DrawElements(int lod = 0) const
+        {
+            if (geometry == INVALID_GEOMETRY)
+                return;
+            const GeometryRange& range = GeometryPool::Get(geometry);
+            const MeshLod& level = lods[lod];
+            glDrawElementsBaseVertex(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT,
+                                     range.indexOffset(level.firstIndex),
+                                     range.baseVertex);
+            RenderStats::RecordDraw(GL_TRIANGLES, level.indexCount);
+        }
+
+        // draw instanceCount copies in one call; the bound VAO must use the pool buffers
+        void DrawElementsInstanced(GLsizei instanceCount, int lod = 0) const
+        {
+            if (geometry == INVALID_GEOMETRY)
+                return;
+            const GeometryRange& range = GeometryPool::Get(geometry);
+            const MeshLod& level = lods[lod];
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT,
+                                              range.indexOffset(level.firstIndex),
+                                              instanceCount, range.baseVertex);
+            RenderStats::RecordDraw(GL_TRIANGLES, level.indexCount, instanceCount);
+        }
+
+        GLuint VertexCount() const
+        {
+            return geometry == INVALID_GEOMETRY ? 0 : GeometryPool::Get(geometry).vertexCount;
+        }
+
+        // bytes of the GPU vertex data, every stream
+        size_t VertexBytes() const
+        {
+            return layout ? VertexCount() * size_t(layout->vertexSize()) : 0;
+        }
+
+        // return the vertex and index range to the pool; copies of this mesh must not draw afterwards
+        void Release()
+        {
+            GeometryPool::Free(geometry);
+            geometry = INVALID_GEOMETRY;
+            VAO = 0;
         }
 
     private:
-        // render data 
-        unsigned int VBO, EBO;
-
-        // initializes all the buffer objects/arrays
-        void setupMesh()
-        {
-            // create buffers/arrays
-            glGenVertexArrays(1, &VAO);
-            glGenBuffers(1, &VBO);
-            glGenBuffers(1, &EBO);
-
-            glBindVertexArray(VAO);
-            // load data into vertex buffers
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            // A great thing about structs is that their memory layout is sequential for all its items.
-            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-            // again translates to 3/2 floats which translates to a byte array.
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-             indices.data(), GL_STATIC_DRAW);
-
-            // set the vertex attribute pointers
-            // vertex Positions
-            glEnableVertexAttribArray(0);	
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-            // vertex normals
-            glEnableVertexAttribArray(1);	
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-            // vertex texture coords
-            glEnableVertexAttribArray(2);	
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-            // vertex tangent
-            glEnableVertexAttribArray(3);
-            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-            // vertex bitangent
-            glEnableVertexAttribArray(4);
-            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-            // ids
-            glEnableVertexAttribArray(5);
-            glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-            // weights
-            glEnableVertexAttribArray(6);
-            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-            glBindVertexArray(0);
+        // texture i goes to unit i, its sampler named after its type (the N in texture_diffuseN)
+        void setupMaterial()
+        {
+            material = Material();
+            for (const Texture& texture : textures)
+                material.Add(texture.type, texture.id);
+        }
+
+        // packs the vertices and uploads them with the indices
+        void setupMesh(const MeshLodChain& lodChain)
+        {
+            PackedMesh packed = PackedMesh::Pack(vertices, indices, lodChain);
+            layout = packed.layout;
+            lods = packed.lods;
+            upload(packed.vertices.data(), packed.skin.empty() ? nullptr : packed.skin.data(), packed.vertexCount,
+                   packed.indices.data(), static_cast<GLuint>(packed.indices.size()));
+        }
+
+        // suballocates the vertex and index data from the shared GeometryPool
+        void upload(const void* packedVertices, const void* skinVertices, GLuint vertexCount,
+                    const GLuint* allIndices, GLuint indexCount)
+        {
+            geometry = GeometryPool::Allocate(*layout, packedVertices, vertexCount, allIndices, indexCount, skinVertices);
+            VAO = geometry == INVALID_GEOMETRY ? 0 : GeometryPool::Get(geometry).vao;
         }
     };
 }
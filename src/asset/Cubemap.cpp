@@ -6,6 +6,7 @@
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <glad/glad.h>
+#include "../render/GLStateCache.h"
 
 Cubemap::Cubemap() 
     : ID(0),
@@ -34,7 +35,7 @@ bool Cubemap::Load(const std::vector<std::string>& faces) {
         throw std::runtime_error("Cubemap requires exactly 6 faces, got " + std::to_string(faces.size()));
     }
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+    GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, ID);
 
     try {
         int width, height, nrChannels;
@@ -78,11 +79,11 @@ bool Cubemap::Load(const std::vector<std::string>& faces) {
         }
 #endif
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, 0);
         return true;
     } catch (const std::exception& e) {
         std::cerr << "Cubemap loading error: " << e.what() << std::endl;
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, 0);
         return false;
     }
 }
@@ -125,7 +126,7 @@ bool Cubemap::LoadFromSingleImage(const std::string& path, Layout layout) {
         size_t faceSize = faceWidth * faceHeight * channels;
         std::vector<unsigned char> faceData(faceSize);
         
-        glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+        GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, ID);
         
         // Process each face
         for (int i = 0; i < 6; i++) {
@@ -195,16 +196,16 @@ bool Cubemap::LoadFromSingleImage(const std::string& path, Layout layout) {
 #endif
 
         stbi_image_free(srcData);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, 0);
         return true;
         
     } catch (const std::exception& e) {
         std::cerr << "Failed to load cubemap from single image: " << e.what() << std::endl;
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, 0);
         return false;
     }
 }
 
 void Cubemap::Bind() const {
-    glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+    GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, ID);
 }
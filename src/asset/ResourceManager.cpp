@@ -8,8 +8,16 @@
 #include "util/Util.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+#include "../render/GLStateCache.h"
+#include "../render/ShaderCache.h"
+#include "../render/ShaderPreprocessor.h"
+#include "../render/TextureBaker.h"
+#include "../render/TextureRegistry.h"
+#include "../render/TextureStreamer.h"
+#include "../util/FileStamp.h"
 
 std::map<std::string, std::shared_ptr<Shader>> ResourceManager::Shaders;
+std::map<std::string, std::shared_ptr<ShaderPermutations>> ResourceManager::Permutations;
 std::map<std::string, Texture1D> ResourceManager::Textures1D;
 std::map<std::string, std::shared_ptr<Texture2D>> ResourceManager::Textures2D;
 std::map<std::string, Texture3D> ResourceManager::Textures3D;
@@ -17,6 +25,17 @@ std::map<std::string, Texture3D> ResourceManager::Textures3D;
 // Static member initialization
 std::string ResourceManager::root = "";
 
+namespace {
+
+// What besides the file makes two loads different textures, for the TextureRegistry
+uint64_t texture2DVariant(bool alpha, GLint sWrap, GLint tWrap, GLint minFilter, GLint magFilter)
+{
+    const GLint settings[] = { alpha, sWrap, tWrap, minFilter, magFilter };
+    return Fnv1a(HashString("ResourceManager::Texture2D"), settings, sizeof(settings));
+}
+
+} // namespace
+
 // Implement full path handling for shaders and textures
 const char *ResourceManager::GetFullPath(const std::string &filename)
 {
@@ -178,6 +197,32 @@ Shader *ResourceManager::ShaderP(std::string &name)
     return Shaders[name].get(); // Assuming Shaders is a map or similar structure
 }
 
+ShaderPermutations& ResourceManager::LoadShaderPermutations(const char *vShaderFile, const char *fShaderFile,
+                                                            const std::vector<std::string>& features, std::string name)
+{
+    std::string vertexPath = includes(vShaderFile, ":") ? vShaderFile : GetShaderPath(vShaderFile);
+    std::string fragmentPath = includes(fShaderFile, ":") ? fShaderFile : GetShaderPath(fShaderFile);
+
+    auto permutations = std::make_shared<ShaderPermutations>(vertexPath, fragmentPath, features);
+    if (!permutations->Load()) {
+        std::cout << "ERROR::SHADER: Failed to build " << vertexPath << " / " << fragmentPath
+                  << ", the program will not draw" << std::endl;
+    }
+    Permutations[name] = permutations;
+    Shaders[name] = permutations->GetUberShader();
+    return *permutations;
+}
+
+ShaderPermutations& ResourceManager::GetShaderPermutations(std::string name)
+{
+    auto it = Permutations.find(name);
+    if (it == Permutations.end())
+    {
+        throw std::runtime_error("Shader permutations not found: " + name);
+    }
+    return *it->second;
+}
+
 Texture1D ResourceManager::LoadTexture1D(const char *file, bool alpha, std::string name,
                                          GLint sWrap, GLint minFilter, GLint magFilter)
 {
@@ -200,7 +245,35 @@ Texture2D ResourceManager::LoadTexture2D(const char *file, std::string name, boo
     {
         file = GetTexturePath(file);
     }
-    auto ptr = std::make_shared<Texture2D>(loadTexture2DFromFile(file, alpha, sWrap, tWrap, minFilter, magFilter));
+    // the same image loaded again with the same settings, under any name, is the texture already made
+    TextureKey key = 0;
+    if (!TextureRegistry::KeyForFile(file, texture2DVariant(alpha, sWrap, tWrap, minFilter, magFilter), key))
+        key = 0;
+    std::shared_ptr<Texture2D> ptr;
+    if (GLuint shared = key ? TextureRegistry::Acquire(key) : 0)
+    {
+        ptr = std::make_shared<Texture2D>(shared);
+        for (auto& iter : Textures2D)
+        {
+            if (iter.second && iter.second->ID == shared)
+            {
+                *ptr = *iter.second;
+                break;
+            }
+        }
+    }
+    else if (TextureStreamer::IsEnabled() || TextureBaker::IsEnabled())
+    {
+        ptr = streamTexture2DFromFile(file, alpha, sWrap, tWrap, minFilter, magFilter);
+        if (key)
+            TextureRegistry::Add(key, ptr->ID, 0); // its size once it is resident
+    }
+    else
+    {
+        ptr = std::make_shared<Texture2D>(loadTexture2DFromFile(file, alpha, sWrap, tWrap, minFilter, magFilter));
+        if (key && ptr->status == 1)
+            TextureRegistry::Add(key, ptr->ID, size_t(ptr->Width) * ptr->Height * (ptr->Image_Format == GL_RGBA ? 4 : 3));
+    }
     Textures2D[file] = ptr;
     if(file != name){
         Textures2D[name] = ptr;
@@ -272,26 +345,34 @@ void ResourceManager::LoadAllTexturesFromDirectory()
     }
 }
 void ResourceManager::Clear() {
+    // Clear shader variants (their uber-shaders are in Shaders)
+    for (auto& iter : Permutations) {
+        iter.second->Clear();
+    }
+    Permutations.clear();
+
     // Clear shaders
     for (auto& iter : Shaders) {
-        glDeleteProgram(iter.second->ID);
+        GLStateCache::DeleteProgram(iter.second->ID);
     }
 
     // Clear 1D textures
     for (auto& iter : Textures1D) {
-        glDeleteTextures(1, &iter.second.ID);
+        GLStateCache::DeleteTextures(1, &iter.second.ID);
     }
 
-    // Clear 2D textures
+    // Clear 2D textures: each one loaded holds a TextureRegistry reference, and may be in the map under two names
+    std::vector<Texture2D*> released;
     for (auto& iter : Textures2D) {
-        if (iter.second) { // Check if the shared_ptr is valid
-            glDeleteTextures(1, &iter.second->ID); // Use -> for dereferencing
+        if (iter.second && std::find(released.begin(), released.end(), iter.second.get()) == released.end()) {
+            TextureRegistry::Release(iter.second->ID);
+            released.push_back(iter.second.get());
         }
     }
 
     // Clear 3D textures
     for (auto& iter : Textures3D) {
-        glDeleteTextures(1, &iter.second.ID);
+        GLStateCache::DeleteTextures(1, &iter.second.ID);
     }
 }
 void ResourceManager::loadShaderFromFile(Shader &shader, const char *vShaderFile, const char *fShaderFile, const char *gShaderFile)
@@ -349,15 +430,23 @@ void ResourceManager::loadShaderFromFile(Shader &shader, const char *vShaderFile
         std::cout << "ERROR::SHADER: Failed to read shader files: " << e.what() << std::endl;
         throw;
     }
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
-    const char *gShaderCode = geometryCode.c_str();
-    try {
-        shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
-        std::cout << "Shader compilation successful" << std::endl;
-    } catch (std::exception &e) {
-        std::cout << "ERROR::SHADER: Failed to compile shader: " << e.what() << std::endl;
-        throw;
+    // expand #include before hashing, so editing an included file invalidates the cached binary
+    std::string vertexSource, fragmentSource, geometrySource;
+    if (!ShaderPreprocessor::Process(vertexCode, vShaderFile, ShaderDefines(), vertexSource) ||
+        !ShaderPreprocessor::Process(fragmentCode, fShaderFile, ShaderDefines(), fragmentSource) ||
+        (gShaderFile != nullptr &&
+         !ShaderPreprocessor::Process(geometryCode, gShaderFile, ShaderDefines(), geometrySource))) {
+        std::cout << "ERROR::SHADER: Failed to preprocess " << vShaderFile << " / " << fShaderFile
+                  << ", the program will not draw" << std::endl;
+        return;
+    }
+
+    // a cached program binary skips compiling and linking entirely
+    if (ShaderCache::LoadOrCompile(shader, vertexSource, fragmentSource, gShaderFile != nullptr ? &geometrySource : nullptr)) {
+        std::cout << "Shader ready: program " << shader.ID << std::endl;
+    } else {
+        std::cout << "ERROR::SHADER: Failed to compile " << vShaderFile << " / " << fShaderFile
+                  << ", the program will not draw" << std::endl;
     }
 }
 
@@ -419,6 +508,64 @@ Texture2D ResourceManager::loadTexture2DFromFile(const char *file, bool alpha, G
     return texture;
 }
 
+std::shared_ptr<Texture2D> ResourceManager::streamTexture2DFromFile(const char *file, bool alpha,
+                                                                    GLint sWrap, GLint tWrap, GLint minFilter, GLint magFilter)
+{
+    auto texture = std::make_shared<Texture2D>();
+    std::error_code error;
+    if (!std::filesystem::exists(file, error))
+    {
+        std::cerr << "Failed to load texture: " << file << std::endl;
+        texture->status = -1;
+        return texture;
+    }
+    texture->status = 1;
+    texture->Wrap_S = sWrap;
+    texture->Wrap_T = tWrap;
+    texture->Filter_Min = minFilter;
+    texture->Filter_Max = magFilter;
+
+    TextureStreamParams params;
+    params.wrapS = sWrap;
+    params.wrapT = tWrap;
+    params.minFilter = minFilter;
+    params.magFilter = magFilter;
+    params.anisotropic = false;
+    // every Texture2D sharing the texture through the TextureRegistry
+    const unsigned int id = texture->ID;
+    params.onResident = [id](const TextureImage &image) {
+        for (auto& iter : Textures2D)
+        {
+            if (!iter.second || iter.second->ID != id)
+                continue;
+            iter.second->Width = image.width;
+            iter.second->Height = image.height;
+            iter.second->Internal_Format = iter.second->Image_Format = image.compressedFormat ? image.compressedFormat
+                                                                     : (image.components == 4 ? GL_RGBA : GL_RGB);
+        }
+        TextureRegistry::SetBytes(id, image.size());
+    };
+
+    std::string path = file;
+    TextureStreamer::StreamInto(texture->ID, [path, alpha] {
+        TextureImage image;
+        if (TextureBaker::Load(path, TextureUsage::Color, image))
+            return image;
+        // RGB or RGBA, as loadTexture2DFromFile stores it
+        int channels = 0;
+        if (!stbi_info(path.c_str(), &image.width, &image.height, &channels))
+            channels = 4;
+        image.components = (alpha || channels > 3) ? 4 : 3;
+        unsigned char *data = stbi_load(path.c_str(), &image.width, &image.height, &channels, image.components);
+        if (data)
+            image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+        else
+            std::cerr << "Failed to load texture: " << path << std::endl;
+        return image;
+    }, params);
+    return texture;
+}
+
 Texture3D ResourceManager::loadTexture3DFromFile(const char *file, bool alpha,
                                                  GLint sWrap, GLint tWrap, GLint rWrap,
                                                  GLint minFilter, GLint magFilter)
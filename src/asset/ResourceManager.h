@@ -24,6 +24,7 @@
 #include "Texture2D.h"
 #include "Texture3D.h"
 #include "../render/Shader.h"
+#include "../render/ShaderPermutations.h"
 #include "../util/Log.h"
 
 #define BUFFER_SIZE 1024
@@ -36,6 +37,7 @@ public:
 
     // Resource maps
     static std::map<std::string, std::shared_ptr<Shader>> Shaders;
+    static std::map<std::string, std::shared_ptr<ShaderPermutations>> Permutations;
     static std::map<std::string, Texture1D> Textures1D;
     static std::map<std::string, std::shared_ptr<Texture2D>> Textures2D;
     static std::map<std::string, Texture3D> Textures3D;
@@ -45,6 +47,11 @@ public:
     static Shader&    LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
     static Shader&   GetShader(std::string name);
     static Shader*   ShaderP(std::string& name);
+    // uber-shader plus variants keyed by a bitmask over features (#defines, see ShaderPermutations);
+    // the uber-shader is also registered under name, so GetShader(name) keeps working
+    static ShaderPermutations& LoadShaderPermutations(const char *vShaderFile, const char *fShaderFile,
+                                                      const std::vector<std::string>& features, std::string name);
+    static ShaderPermutations& GetShaderPermutations(std::string name);
 
     // Texture management
     static Texture1D LoadTexture1D(const char *file, bool alpha, std::string name,
@@ -88,6 +95,10 @@ private:
     static Texture2D loadTexture2DFromFile(const char *file, bool alpha = false,
                                            GLint sWrap = GL_REPEAT, GLint tWrap = GL_REPEAT,
                                            GLint minFilter = GL_LINEAR, GLint magFilter = GL_LINEAR);
+    // Returns at once through TextureStreamer, preferring the TextureBaker copy; Width, Height and the
+    // formats are set when it is resident
+    static std::shared_ptr<Texture2D> streamTexture2DFromFile(const char *file, bool alpha,
+                                                              GLint sWrap, GLint tWrap, GLint minFilter, GLint magFilter);
     static Texture3D loadTexture3DFromFile(const char *file, bool alpha, GLint sWrap, GLint tWrap, GLint rWrap,
                                            GLint minFilter, GLint magFilter);
 };
@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <string>
 #include <iostream>
+#include "../render/GLStateCache.h"
 
 // TextureSimple class (formerly Texture2D)
 class TextureSimple {
@@ -35,7 +36,7 @@ public:
         this->Height = height;
         
         // Create texture
-        glBindTexture(GL_TEXTURE_2D, this->ID);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, this->ID);
         glTexImage2D(GL_TEXTURE_2D, 0, this->Internal_Format, width, height, 0, this->Image_Format, GL_UNSIGNED_BYTE, data);
         
         // Set texture wrap and filter modes
@@ -45,11 +46,11 @@ public:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->Filter_Max);
         
         // Unbind texture
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
     }
     
     // Bind texture as current active GL_TEXTURE_2D texture object
     void Bind() const {
-        glBindTexture(GL_TEXTURE_2D, this->ID);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, this->ID);
     }
 }; 
\ No newline at end of file
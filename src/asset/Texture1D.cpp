@@ -1,4 +1,5 @@
 #include "Texture1D.h"
+#include "../render/GLStateCache.h"
 
 Texture1D::Texture1D()
     : Width(0), Internal_Format(GL_RGB), Image_Format(GL_RGB),
@@ -8,14 +9,14 @@ Texture1D::Texture1D()
 
 void Texture1D::Generate(unsigned int width, unsigned char* data) {
     Width = width;
-    glBindTexture(GL_TEXTURE_1D, ID);
+    GLStateCache::BindTexture(GL_TEXTURE_1D, ID);
     glTexImage1D(GL_TEXTURE_1D, 0, Internal_Format, width, 0, Image_Format, GL_UNSIGNED_BYTE, data);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, Wrap_S);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, Filter_Min);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, Filter_Max);
-    glBindTexture(GL_TEXTURE_1D, 0);
+    GLStateCache::BindTexture(GL_TEXTURE_1D, 0);
 }
 
 void Texture1D::Bind() const {
-    glBindTexture(GL_TEXTURE_1D, ID);
+    GLStateCache::BindTexture(GL_TEXTURE_1D, ID);
 }
\ No newline at end of file
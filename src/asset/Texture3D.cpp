@@ -1,4 +1,5 @@
 #include "Texture3D.h"
+#include "../render/GLStateCache.h"
 
 Texture3D::Texture3D()
     : Width(0), Height(0), Depth(0), Internal_Format(GL_RGB), Image_Format(GL_RGB),
@@ -10,16 +11,16 @@ void Texture3D::Generate(unsigned int width, unsigned int height, unsigned int d
     Width = width;
     Height = height;
     Depth = depth;
-    glBindTexture(GL_TEXTURE_3D, ID);
+    GLStateCache::BindTexture(GL_TEXTURE_3D, ID);
     glTexImage3D(GL_TEXTURE_3D, 0, Internal_Format, width, height, depth, 0, Image_Format, GL_UNSIGNED_BYTE, data);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, Wrap_S);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, Wrap_T);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, Wrap_R);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, Filter_Min);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, Filter_Max);
-    glBindTexture(GL_TEXTURE_3D, 0);
+    GLStateCache::BindTexture(GL_TEXTURE_3D, 0);
 }
 
 void Texture3D::Bind() const {
-    glBindTexture(GL_TEXTURE_3D, ID);
+    GLStateCache::BindTexture(GL_TEXTURE_3D, ID);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "Particle.h"
 #include "game/Camera.h"
+#include "../render/GLStateCache.h"
+#include "../render/RenderStats.h"
 
 ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
     : shader(shader)
@@ -42,7 +44,7 @@ void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newPar
 void ParticleGenerator::Draw()
 {
     // use additive blending to give it a 'glow' effect
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE);
     this->shader.Use();
     for (Particle particle : this->particles)
     {
@@ -55,13 +57,14 @@ void ParticleGenerator::Draw()
             this->shader.SetMatrix4("view", glm::mat4(1.0f));
             
             this->texture.Bind();
-            glBindVertexArray(this->VAO);
+            GLStateCache::BindVertexArray(this->VAO);
             glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
+            RenderStats::RecordDraw(GL_TRIANGLES, 6);
+            GLStateCache::BindVertexArray(0);
         }
     }
     // don't forget to reset to default blending mode
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void ParticleGenerator::init()
@@ -79,14 +82,15 @@ void ParticleGenerator::init()
     }; 
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &VBO);
-    glBindVertexArray(this->VAO);
+    GLStateCache::BindVertexArray(this->VAO);
     // fill mesh buffer
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
+    RenderStats::RecordUpload(sizeof(particle_quad));
     // set mesh attributes
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 
     // create this->amount default particle instances
     for (unsigned int i = 0; i < this->amount; ++i)
@@ -1,6 +1,8 @@
 #include "PostProcessor.h"
 
 #include <iostream>
+#include "../render/GLStateCache.h"
+#include "../render/RenderStats.h"
 
 PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int height) 
     : PostProcessingShader(shader), Texture(), Width(width), Height(height), Confuse(false), Chaos(false), Shake(false)
@@ -10,19 +12,19 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
     glGenFramebuffers(1, &this->FBO);
     glGenRenderbuffers(1, &this->RBO);
     // initialize renderbuffer storage with a multisampled color buffer (don't need a depth/stencil buffer)
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
     glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGB, width, height); // allocate storage for render buffer object
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); // attach MS render buffer object to framebuffer
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
     // also initialize the FBO/texture to blit multisampled color-buffer to; used for shader operations (for postprocessing effects)
-    glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, this->FBO);
     this->Texture.Generate(width, height, NULL);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture.ID, 0); // attach texture to framebuffer as its color attachment
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::POSTPROCESSOR: Failed to initialize FBO" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
     // initialize render data and uniforms
     this->initRenderData();
     this->PostProcessingShader.SetInteger("scene", 0, true);
@@ -55,17 +57,17 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
 
 void PostProcessor::BeginRender()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 void PostProcessor::EndRender()
 {
     // now resolve multisampled color-buffer into intermediate FBO to store to texture
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
+    GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
+    GLStateCache::BindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
     glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0); // binds both READ and WRITE framebuffer to default framebuffer
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0); // binds both READ and WRITE framebuffer to default framebuffer
 }
 
 void PostProcessor::Render(float time)
@@ -77,11 +79,12 @@ void PostProcessor::Render(float time)
     this->PostProcessingShader.SetInteger("chaos", this->Chaos);
     this->PostProcessingShader.SetInteger("shake", this->Shake);
     // render textured quad
-    glActiveTexture(GL_TEXTURE0);
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
     this->Texture.Bind();	
-    glBindVertexArray(this->VAO);
+    GLStateCache::BindVertexArray(this->VAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_TRIANGLES, 6);
+    GLStateCache::BindVertexArray(0);
 }
 
 void PostProcessor::initRenderData()
@@ -103,10 +106,11 @@ void PostProcessor::initRenderData()
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    RenderStats::RecordUpload(sizeof(vertices));
 
-    glBindVertexArray(this->VAO);
+    GLStateCache::BindVertexArray(this->VAO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
\ No newline at end of file
@@ -15,7 +15,22 @@
 #include "render/DynamicEnvironmentMapping.h"
 
 #include <random>
+#include <algorithm>
+#include <cstdio>
+#include <limits>
 #include "../render/ReflectionRenderer.h"
+#include "../render/GLStateCache.h"
+#include "../render/FrameBenchmark.h"
+#include "../render/Profiler.h"
+#include "../render/RenderStats.h"
+#include "../render/MeshLod.h"
+#include "../render/ShaderCache.h"
+#include "../render/MeshCache.h"
+#include "../render/TextureBaker.h"
+#include "../render/TextureRegistry.h"
+#include "../render/MaterialAtlas.h"
+#include "../render/TextureStreamer.h"
+#include "../ui/ProfilerPanel.h"
 
 const unsigned SCREEN_WIDTH = 1600;
 const unsigned SCREEN_HEIGHT = 900;
@@ -54,6 +69,14 @@ Game3D::Game3D()
     useRefraction = game::cfg().GetUseRefraction();
     reflectionIntensity = game::cfg().GetReflectionIntensity();
     refractionRatio = game::cfg().GetRefractionRatio();
+    randomPointLightCount = game::cfg().GetRandomPointLights();
+    renderPath = game::cfg().GetUseDeferredShading() ? RenderPath::Deferred : RenderPath::Forward;
+    LodSelector::Enabled = game::cfg().GetUseMeshLod();
+    LodSelector::PixelError = game::cfg().GetLodPixelError();
+    RenderStats::AddBudgets(game::cfg().GetRenderBudgets());
+    if (!game::cfg().GetRenderStatsCsv().empty()) {
+        RenderStats::OpenCsv(game::cfg().GetRenderStatsCsv());
+    }
 
     // Initialize dynamic environment mapping
     dynamicEnvMapping = std::make_unique<DynamicEnvironmentMapping>();
@@ -67,13 +90,14 @@ Game3D::~Game3D() {
 
     // Clean up reflection map texture
     if (reflectionMapTexture != 0) {
-        glDeleteTextures(1, &reflectionMapTexture);
+        GLStateCache::DeleteTextures(1, &reflectionMapTexture);
     }
 
     for (auto* body : celestialBodies) {
         delete body;
     }
     celestialBodies.clear();
+    sphereBatch.reset();
 
     // Clean up dynamic environment mapping
     if (dynamicEnvMapping) {
@@ -82,67 +106,101 @@ Game3D::~Game3D() {
 }
 
 void Game3D::init() {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-    glfwWindowHint(GLFW_RESIZABLE, true);
-
-    window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "3D Model Viewer", nullptr, nullptr);
-    if (window == nullptr) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return;
-    }
-    glfwMakeContextCurrent(window);
+    startupTime = std::chrono::steady_clock::now();
+    if (headless) {
+        // No window: everything renders into m_framebuffer
+        if (!headlessContext.create(SCREEN_WIDTH, SCREEN_HEIGHT, headlessBackend)) {
+            return;
+        }
+        if (!gladLoadGLLoader((GLADloadproc) HeadlessContext::getProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            headlessContext.destroy();
+            return;
+        }
+    } else {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    #ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    #endif
+        glfwWindowHint(GLFW_RESIZABLE, true);
+
+        window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "3D Model Viewer", nullptr, nullptr);
+        if (window == nullptr) {
+            std::cerr << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return;
+        }
+        glfwMakeContextCurrent(window);
 
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return;
-    }
+        if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return;
+        }
 
-    glfwSetWindowUserPointer(window, this);
+        glfwSetWindowUserPointer(window, this);
     
-    auto mouse_callback_lambda = [](GLFWwindow* w, double x, double y){
-        static_cast<Game3D*>(glfwGetWindowUserPointer(w))->mouse_callback(x, y);
-    };
-    glfwSetCursorPosCallback(window, mouse_callback_lambda);
+        auto mouse_callback_lambda = [](GLFWwindow* w, double x, double y){
+            static_cast<Game3D*>(glfwGetWindowUserPointer(w))->mouse_callback(x, y);
+        };
+        glfwSetCursorPosCallback(window, mouse_callback_lambda);
 
-    auto scroll_callback_lambda = [](GLFWwindow* w, double x, double y){
-        static_cast<Game3D*>(glfwGetWindowUserPointer(w))->scroll_callback(x, y);
-    };
-    glfwSetScrollCallback(window, scroll_callback_lambda);
-
-    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glEnable(GL_STENCIL_TEST);
-    glEnable(GL_BLEND);
-    glEnable(GL_CULL_FACE);
-    //glEnable(GL_FRAMEBUFFER_SRGB); 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        auto scroll_callback_lambda = [](GLFWwindow* w, double x, double y){
+            static_cast<Game3D*>(glfwGetWindowUserPointer(w))->scroll_callback(x, y);
+        };
+        glfwSetScrollCallback(window, scroll_callback_lambda);
+
+        glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    }
+
+    // shader variants compile in the background where the driver allows it
+    if (Shader::InitParallelCompile(headless ? (GLADloadproc) HeadlessContext::getProcAddress
+                                             : (GLADloadproc) glfwGetProcAddress)) {
+        std::cout << "Parallel shader compilation available" << std::endl;
+    }
+
+    GLStateCache::Enable(GL_DEPTH_TEST);
+    GLStateCache::DepthFunc(GL_LESS);
+    GLStateCache::Enable(GL_STENCIL_TEST);
+    GLStateCache::Enable(GL_BLEND);
+    GLStateCache::Enable(GL_CULL_FACE);
+    //GLStateCache::Enable(GL_FRAMEBUFFER_SRGB); 
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLStateCache::StencilFunc(GL_NOTEQUAL, 1, 0xFF);
+    GLStateCache::StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
     if(!m_framebuffer) {
         m_framebuffer = std::make_shared<Framebuffer>();
     }
     if(!m_screenQuad) {
         m_screenQuad = std::make_shared<VO::Quad>();
     }
-    Gui::Init(window);
+    if (window) {
+        Gui::Init(window);
+    }
 
     char cwd[1024];
     if (getcwd(cwd, sizeof(cwd)) != NULL) {
         ResourceManager::root = cwd;
     }
     std::cout << "Root directory: " << ResourceManager::root << std::endl;
+    ShaderCache::SetEnabled(game::cfg().GetUseShaderCache());
+    ShaderCache::SetDirectory(ResourceManager::root + "/" + game::cfg().GetShaderCacheDirectory());
+    MeshCache::SetEnabled(game::cfg().GetUseMeshCache());
+    TextureBaker::DetectSupport();
+    TextureBaker::SetEnabled(game::cfg().GetUseTextureBaking());
+    MaterialAtlas::DetectSupport(headless ? (GLADloadproc) HeadlessContext::getProcAddress
+                                          : (GLADloadproc) glfwGetProcAddress);
+    MaterialAtlas::SetEnabled(game::cfg().GetUseMaterialAtlas(), game::cfg().GetMaterialAtlasBindless());
+    initTextureStreaming();
     std::cout << "Loading shader: model" << std::endl;
-    ResourceManager::LoadShader("3d.vs", "3d.fs", nullptr, "model");
+    ResourceManager::LoadShaderPermutations("3d.vs", "3d.fs", Renderer3D::ModelShaderFeatures(), "model")
+        .SetVariantsEnabled(game::cfg().GetUseShaderVariants());
     ResourceManager::LoadShader("outline.vs", "outline.fs", nullptr, "outline");
+    ResourceManager::LoadShader("bounds.vs", "bounds.fs", nullptr, "bounds");
+    ResourceManager::LoadShader("gbuffer.vs", "gbuffer.fs", nullptr, "gbuffer");
+    ResourceManager::LoadShader("deferred_lighting.vs", "deferred_lighting.fs", nullptr, "deferred_lighting");
     std::cout << "Creating framebuffer" << std::endl;
     float aspectRatio = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
     int fbWidth = 1200;
@@ -219,24 +277,24 @@ void Game3D::init() {
 
     // Clean up existing reflection map if it exists
     if (reflectionMapTexture != 0) {
-        glDeleteTextures(1, &reflectionMapTexture);
+        GLStateCache::DeleteTextures(1, &reflectionMapTexture);
         reflectionMapTexture = 0;
     }
 
     // Generate and set up the reflection map texture
     glGenTextures(1, &reflectionMapTexture);
-    glBindTexture(GL_TEXTURE_2D, reflectionMapTexture);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, reflectionMapTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, reflectionMapData);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 
     m_showMirror = false;
-    maxAsteroids = 10; // Reduced from 25 to 10
-    maxKuiperBeltObjects = 50; // Reduced from 200 to 50
-    maxDistantStars = 100; // Reduced from 1000 to 100
+    maxAsteroids = 100000; // instanced, see CelestialInstanceBatch
+    maxKuiperBeltObjects = 2000;
+    maxDistantStars = 100; // each Star still allocates its own HDR and bloom targets
     if (m_showMirror) {
         std::cout << "Creating rear-view mirror" << std::endl;
         m_rearViewMirror = std::make_unique<Mirror>();
@@ -252,7 +310,92 @@ void Game3D::init() {
         initSolarSystemScene();
     } else {
         loadModels(std::string(cwd) + "/models", std::string(cwd) + "/bin/models");
+        spawnRandomPointLights(randomPointLightCount);
+    }
+    ShaderCache::PrintReport();
+}
+
+void Game3D::processUploads(double budgetMs, size_t budgetBytes) {
+    if (!modelLoader) {
+        return;
+    }
+    {
+        PROFILE_SCOPE("Model uploads");
+        uploadQueue.process(budgetMs, budgetBytes);
+    }
+    if (!modelsReported && modelLoader->idle()) {
+        modelsReported = true;
+        const UploadQueueStats& uploads = uploadQueue.getStats();
+        std::printf("Loaded %zu models in %.1f ms; %zu uploads (%zu KB), longest frame share %.2f ms\n",
+                    modelLoader->finished(), modelLoader->elapsedMs(), uploads.totalTasks, uploads.totalBytes / 1024,
+                    uploads.worstMs);
+        MeshCache::PrintReport();
+        TextureStreamer::PrintReport();
+        TextureBaker::PrintReport();
+        TextureRegistry::PrintReport();
+        MaterialAtlas::PrintReport();
+    }
+}
+
+void Game3D::initTextureStreaming() {
+    TextureStreamer::SetEnabled(game::cfg().GetUseTextureStreaming());
+    TextureStreamer::SetFrameBudget(static_cast<size_t>(game::cfg().GetTextureStreamBudgetMB()) << 20);
+    if (!TextureStreamer::IsEnabled()) {
+        return;
+    }
+    TextureStreamer::Init();
+    if (!window || !game::cfg().GetTextureStreamSharedContext()) {
+        return;
+    }
+    // the hints of the main window still hold, so the context matches it
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    uploadWindow = glfwCreateWindow(1, 1, "Texture uploads", nullptr, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!uploadWindow) {
+        std::cout << "Failed to create the texture upload context" << std::endl;
+        return;
+    }
+    GLFWwindow* context = uploadWindow;
+    TextureStreamer::SetUploadContext([context] {
+        glfwMakeContextCurrent(context);
+        return glfwGetCurrentContext() == context;
+    }, [] {
+        glfwMakeContextCurrent(nullptr);
+    });
+}
+
+void Game3D::shutdownTextureStreaming() {
+    TextureStreamer::Shutdown();
+    if (uploadWindow) {
+        glfwDestroyWindow(uploadWindow);
+        uploadWindow = nullptr;
+    }
+}
+
+void Game3D::spawnRandomPointLights(int count) {
+    count = std::max(0, std::min(count, MAX_POINT_LIGHTS));
+    randomPointLightCount = count;
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> groundDist(-50.0f, 50.0f); // the ground plane of Renderer3D
+    std::uniform_real_distribution<float> heightDist(0.5f, 6.0f);
+    std::uniform_real_distribution<float> colorDist(0.2f, 1.0f);
+
+    renderer.randomPointLights.clear();
+    for (int i = 0; i < count; i++) {
+        PointLight light;
+        light.position = glm::vec3(groundDist(gen), heightDist(gen), groundDist(gen));
+        light.constant = 1.0f;
+        light.linear = 0.35f;
+        light.quadratic = 0.44f;
+        glm::vec3 color(colorDist(gen), colorDist(gen), colorDist(gen));
+        light.ambient = color * 0.02f;
+        light.diffuse = color;
+        light.specular = color;
+        light.enabled = true;
+        renderer.randomPointLights.push_back(light);
     }
+    renderer.useRandomPointLights = count > 0;
 }
 void Game3D::initSolarSystemScene() {
     std::cout << "Initializing Solar System Scene with Physics" << std::endl;
@@ -274,6 +417,7 @@ void Game3D::initSolarSystemScene() {
     // Load shaders
     ResourceManager::LoadShader("star.vs", "star.fs", nullptr, "star");
     ResourceManager::LoadShader("planet.vs", "planet.fs", nullptr, "planet");
+    ResourceManager::LoadShader("planet_instanced.vs", "planet.fs", nullptr, "planet_instanced");
     ResourceManager::LoadShader("glow.vs", "glow.fs", nullptr, "glow");
     ResourceManager::LoadShader("corona.vs", "corona.fs", nullptr, "corona");
     ResourceManager::LoadShader("limb_darkening.vs", "limb_darkening.fs", nullptr, "limb_darkening");
@@ -283,10 +427,16 @@ void Game3D::initSolarSystemScene() {
 
     // Assign loaded shaders to member variables
     planetShader = ResourceManager::GetShader("planet");
+    planetInstancedShader = ResourceManager::GetShader("planet_instanced");
     
     // Create shared sphere mesh
     auto sphere = std::make_shared<m3D::Sphere>("Sphere", glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(1.0f));
     sphereMesh = sphere->getMesh();
+
+    // Small bodies (asteroids, Kuiper belt objects, background stars) cover a few
+    // pixels at most, so the instanced batch draws a coarser unit sphere
+    auto instancedSphere = std::make_shared<m3D::Sphere>("InstancedSphere", glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(1.0f), 12, 8);
+    sphereBatch = std::make_unique<CelestialInstanceBatch>(instancedSphere->getMesh());
     
     // Setup projection matrix
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), 
@@ -695,8 +845,8 @@ void Game3D::initSolarSystemScene() {
 
         backgroundStar->SetPosition(starPosition);
 
-        // Disable expensive effects for distant stars would go here
-        // Currently not implemented in Star class
+        // No glow, corona or solar wind; drawn through the instanced batch
+        backgroundStar->SetDistant(true);
 
         celestialBodies.push_back(backgroundStar);
     }
@@ -708,18 +858,28 @@ void Game3D::updateSolarSystem(float deltaTime) {
     // Apply time scale
     float scaledDeltaTime = deltaTime * timeScale;
 
-    // Update celestial bodies with a reasonable limit to prevent CPU overload
-    int updateCount = 0;
-    const int maxUpdatedBodies = 50; // Limit to prevent CPU overload
-
+    PROFILE_SCOPE("Celestial update");
+    // Every body moves. Stars, planets with moons or rings go first, in order, since
+    // others read their positions; the instanced ones (asteroids, Kuiper belt objects,
+    // distant stars) touch nothing but themselves and are updated in parallel
+    independentBodies.clear();
     for (auto* body : celestialBodies) {
-        if (updateCount >= maxUpdatedBodies) {
-            break; // Stop updating if we've reached the limit
+        if (body->IsInstanceable()) {
+            independentBodies.push_back(body);
+        } else {
+            body->Update(scaledDeltaTime);
         }
-        body->Update(scaledDeltaTime);
-        updateCount++;
     }
 
+    const size_t bodiesPerJob = 1024;
+    const size_t count = independentBodies.size();
+    bodyUpdatePool.run((count + bodiesPerJob - 1) / bodiesPerJob, [&](size_t job) {
+        size_t end = std::min(count, (job + 1) * bodiesPerJob);
+        for (size_t i = job * bodiesPerJob; i < end; i++) {
+            independentBodies[i]->Update(scaledDeltaTime);
+        }
+    });
+
     // Update sun position for lighting (if sun moved)
     if (!celestialBodies.empty()) {
         CelestialBody* sun = celestialBodies[0]; // First body is the Sun
@@ -728,6 +888,7 @@ void Game3D::updateSolarSystem(float deltaTime) {
 }
 
 void Game3D::renderSolarSystem(Shader& shader) {
+    PROFILE_SCOPE("Solar system");
     // Setup camera and projection
     glm::mat4 projection = glm::perspective(
         glm::radians(camera.Zoom),
@@ -736,10 +897,10 @@ void Game3D::renderSolarSystem(Shader& shader) {
     );
     glm::mat4 view = camera.GetViewMatrix();
 
+    // Camera and lights reach the planet shader through the shared uniform blocks
+    renderer.updateFrameConstants(camera, projection, view, 0.1f, 10000.0f);
+    renderer.updateLightBlock();
     shader.Use();
-    shader.SetMatrix4("projection", projection);
-    shader.SetMatrix4("view", view);
-    shader.SetVector3f("viewPos", camera.Position);
 
     // Handle dynamic environment mapping
     if (useDynamicEnvironmentMapping && dynamicEnvMapping) {
@@ -762,269 +923,571 @@ void Game3D::renderSolarSystem(Shader& shader) {
         renderer.dynamicEnvMapping = std::move(dynamicEnvMapping);
         dynamicEnvMapping = std::make_unique<DynamicEnvironmentMapping>();
         dynamicEnvMapping->initialize();
+
+        // Probe capture leaves the default framebuffer bound
+        m_framebuffer->bind();
+        glViewport(0, 0, m_framebufferSize.x, m_framebufferSize.y);
+        shader.Use();
     } else {
         renderer.useDynamicEnvironmentMapping = false;
     }
 
-    // Render all celestial bodies with a reasonable limit to prevent GPU overload
-    int renderCount = 0;
-    const int maxRenderedBodies = 50; // Limit to prevent GPU overload
+    // Render the celestial bodies inside the view frustum
+    const Frustum& frustum = renderer.getFrustum();
+    bodyCulling.reset();
+
+    sphereBatch->Clear();
 
     for (auto* body : celestialBodies) {
-        if (renderCount >= maxRenderedBodies) {
-            break; // Stop rendering if we've reached the limit
+        if (!frustum.intersects(body->GetPosition(), body->GetBoundingRadius())) {
+            bodyCulling.culled++;
+            continue;
+        }
+        bodyCulling.visible++;
+
+        // Plain spheres are collected and drawn with one instanced call below
+        if (body->IsInstanceable()) {
+            body->GetInstanceData(sphereBatch->Add(body->SelectLod(sphereBatch->GetMesh())));
+            continue;
         }
 
         // Check if it's a Star or Planet for specialized rendering
         if (Star* star = dynamic_cast<Star*>(body)) {
             star->Draw(shader);
-            renderCount++;
         } else if (Planet* planet = dynamic_cast<Planet*>(body)) {
             planet->Draw(shader);
-            renderCount++;
         } else {
             body->Draw(shader);
-            renderCount++;
         }
     }
-}
-void Game3D::run() {
-    lastFrame = static_cast<float>(glfwGetTime());
-
-    while (!glfwWindowShouldClose(window)) {
-        // Timing
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        Timers::tick();
-        processInput();
-
-        // FPS calculation
-        frameCount++;
-        avgFrameTime += deltaTime;
-
-        if (currentFrame - lastFPSUpdate >= 1.0f) { // Update every second
-            fps = static_cast<int>(frameCount / (currentFrame - lastFPSUpdate));
-            avgFrameTime /= frameCount;
-
-            frameCount = 0;
-            lastFPSUpdate = currentFrame;
-
-            // Store frame times for history (last 100 frames)
-            frameTimes.push_back(avgFrameTime * 1000.0f); // Convert to milliseconds
-            if (frameTimes.size() > 100) {
-                frameTimes.erase(frameTimes.begin());
-            }
 
-            avgFrameTime = 0.0f;
+    planetInstancedShader.Use();
+    planetInstancedShader.SetInteger("useBlinnPhong", static_cast<int>(!usePhong));
+    sphereBatch->Draw(planetInstancedShader);
+}
+void Game3D::updateUniformBenchmark() {
+    const int framesPerPhase = 120;
+    int phase = benchFrame < framesPerPhase ? 0 : 1;
+    ShaderCallCounters& totals = benchTotals[phase];
+    totals.locationQueries += Shader::Counters.locationQueries;
+    totals.errorChecks += Shader::Counters.errorChecks;
+    totals.uniformUploads += Shader::Counters.uniformUploads;
+    totals.programBinds += Shader::Counters.programBinds;
+    Shader::Counters.reset();
+
+    benchFrame++;
+    if (benchFrame == framesPerPhase) {
+        Shader::LegacyUniformLookup = false;
+    } else if (benchFrame == 2 * framesPerPhase) {
+        const char* labels[2] = {"legacy", "cached"};
+        std::cout << "Uniform benchmark (" << framesPerPhase << " frames per mode, GL calls per frame)" << std::endl;
+        for (int i = 0; i < 2; i++) {
+            std::cout << "  " << labels[i]
+                      << ": glGetUniformLocation " << benchTotals[i].locationQueries / framesPerPhase
+                      << ", glGetError " << benchTotals[i].errorChecks / framesPerPhase
+                      << ", glUniform* " << benchTotals[i].uniformUploads / framesPerPhase
+                      << ", glUseProgram " << benchTotals[i].programBinds / framesPerPhase
+                      << ", total " << benchTotals[i].total() / framesPerPhase << std::endl;
         }
+        glfwSetWindowShouldClose(window, true);
+    }
+}
 
+void Game3D::renderFrame() {
+    LodSelector::Stats.reset();
+    {
+        PROFILE_SCOPE("Update");
         // Update orbital mechanics
         for (auto& orbitalData : orbitalBodies) {
             orbitalData.currentAngle += orbitalData.orbitSpeed * deltaTime;
             glm::vec3 centerOfOrbit = orbitalData.parentBody ? orbitalData.parentBody->position : glm::vec3(0.0f);
-            
+        
             float x = centerOfOrbit.x + orbitalData.orbitRadius * cos(orbitalData.currentAngle);
             float z = centerOfOrbit.z + orbitalData.orbitRadius * sin(orbitalData.currentAngle);
             orbitalData.body->position = glm::vec3(x, centerOfOrbit.y, z);
             orbitalData.body->rotation.y += orbitalData.rotationSpeed * deltaTime;
         }
         if(useSolarSystemScene) {
-            planetShader.Use();
-            planetShader.SetInteger("useBlinnPhong", static_cast<int>(!usePhong)); // Remove the extra 'true' parameter
             updateSolarSystem(deltaTime);
-            renderSolarSystem(planetShader);
         } else {
-            auto& modelShader = ResourceManager::GetShader("model");
-            modelShader.Use();
-            modelShader.SetInteger("useBlinnPhong", static_cast<int>(!usePhong));
+            renderer.useBlinnPhong = !usePhong;
         }
         scene.update(deltaTime);
+    }
 
-        // MIRROR PASS: Render rear-view to mirror framebuffer (if enabled)
-        if (m_rearViewMirror && m_showMirror) {
-            glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 
-                                                  (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 
-                                                  0.1f, 1000.0f);
-            
-            m_rearViewMirror->renderMirrorView(camera.GetViewMatrix(), projection, 
-                [&](const glm::mat4& mirrorView, const glm::mat4& proj) {
-                    // Create temporary camera for mirror rendering
-                    Camera tempCamera = camera; // Copy current camera
-                    // Override the view matrix for mirror rendering
-                    renderer.renderWithCustomView(scene, tempCamera, mirrorView, proj);
-                });
-        }
+    // MIRROR PASS: Render rear-view to mirror framebuffer (if enabled)
+    if (m_rearViewMirror && m_showMirror) {
+        PROFILE_GPU_SCOPE("Mirror pass");
+        FramePassScope statsPass(FramePass::Mirror);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 
+                                              (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 
+                                              0.1f, 1000.0f);
+        
+        m_rearViewMirror->renderMirrorView(camera.GetViewMatrix(), projection, 
+            [&](const glm::mat4& mirrorView, const glm::mat4& proj) {
+                // Create temporary camera for mirror rendering
+                Camera tempCamera = camera; // Copy current camera
+                // Override the view matrix for mirror rendering
+                renderer.renderWithCustomView(scene, tempCamera, mirrorView, proj);
+            });
+    }
 
-        // MAIN PASS: Render scene to main framebuffer
-        m_framebuffer->bind();
-        glViewport(0, 0, m_framebufferSize.x, m_framebufferSize.y);
-        m_framebuffer->clear(0.05f, 0.05f, 0.1f);
-        glEnable(GL_DEPTH_TEST);
-
-        // Configure reflection for models scene
-        if (!useSolarSystemScene && skyboxCubemap) {
-            renderer.useModelReflection = useReflection;  // Use config value
-            renderer.modelReflectivity = reflectionIntensity;  // Use reflection intensity from UI/config
-            renderer.skyboxTexture = skyboxCubemap->ID;  // Use the skybox texture for reflections
-        } else {
-            renderer.useModelReflection = false;  // Disable reflection for solar system scene
-            renderer.modelReflectivity = 0.0f;
-            renderer.skyboxTexture = 0;
+    // MAIN PASS: Render scene to main framebuffer; the zone also covers the
+    // reflection and skybox draws below, which go into the same framebuffer
+    PROFILE_GPU_SCOPE("Main pass");
+    FramePassScope statsPass(FramePass::Main);
+    m_framebuffer->bind();
+    glViewport(0, 0, m_framebufferSize.x, m_framebufferSize.y);
+    m_framebuffer->clear(0.05f, 0.05f, 0.1f);
+    GLStateCache::Enable(GL_DEPTH_TEST);
+
+    // The celestial bodies go into the scene framebuffer with everything else
+    if (useSolarSystemScene) {
+        planetShader.Use();
+        planetShader.SetInteger("useBlinnPhong", static_cast<int>(!usePhong));
+        renderSolarSystem(planetShader);
+    }
+
+    // Configure reflection for models scene
+    if (!useSolarSystemScene && skyboxCubemap) {
+        renderer.useModelReflection = useReflection;  // Use config value
+        renderer.modelReflectivity = reflectionIntensity;  // Use reflection intensity from UI/config
+        renderer.skyboxTexture = skyboxCubemap->ID;  // Use the skybox texture for reflections
+    } else {
+        renderer.useModelReflection = false;  // Disable reflection for solar system scene
+        renderer.modelReflectivity = 0.0f;
+        renderer.skyboxTexture = 0;
+    }
+
+    // Configure refraction settings
+    renderer.useModelRefraction = useRefraction;
+    renderer.modelRefractionRatio = refractionRatio;
+
+    // Temporarily disable dynamic environment mapping to troubleshoot crashes
+    // renderer.useDynamicEnvironmentMapping = useDynamicEnvironmentMapping;
+    // if (useDynamicEnvironmentMapping && dynamicEnvMapping) {
+    //     // Add a reflection probe at the camera position for dynamic environment mapping
+    //     if (dynamicEnvMapping->getProbeCount() == 0) {
+    //         dynamicEnvMapping->addReflectionProbe(camera.Position);
+    //     } else {
+    //         // Update the existing probe position
+    //         dynamicEnvMapping->updateProbePosition(0, camera.Position);
+    //     }
+    // }
+    renderer.useDynamicEnvironmentMapping = false;  // Disable for now
+
+    // the planets are already in the framebuffer, and the deferred path would overwrite their depth
+    renderer.renderPath = useSolarSystemScene ? RenderPath::Forward : renderPath;
+    renderer.render(scene, camera);
+
+    // Render reflective objects
+    if (m_reflectionRenderer && skyboxCubemap) {
+        PROFILE_GPU_SCOPE("Reflection");
+        FramePassScope reflectionStats(FramePass::Reflection);
+        // Simple reflective cube at position (0, 5, -5)
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, 5.0f, -5.0f));
+        model = glm::scale(model, glm::vec3(2.0f));
+
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+                                              (float)m_framebufferSize.x / (float)m_framebufferSize.y,
+                                              0.1f, 1000.0f);
+        // Render with reflection map settings
+        m_reflectionRenderer->renderReflection(model, camera.GetViewMatrix(), projection,
+                                              camera.Position, skyboxCubemap->ID,
+                                              reflectionIntensity, useReflectionMap, reflectionMapTexture);
+    }
+
+    // Render skybox last (if enabled) for performance
+    if (skybox && useSkybox) {
+        PROFILE_GPU_SCOPE("Skybox");
+        FramePassScope skyboxStats(FramePass::Skybox);
+        // Use the same projection as main camera
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+                                              (float)m_framebufferSize.x / (float)m_framebufferSize.y,
+                                              0.1f, 1000.0f);
+        skybox->render(camera.GetViewMatrix(), projection);
+    }
+}
+
+int Game3D::runBenchmark() {
+    if (!window && !headlessContext.isCurrent()) {
+        std::cout << "Benchmark: no OpenGL context" << std::endl;
+        return 1;
+    }
+
+    // Fixed time step and a full turn of the camera over the run, so that
+    // two runs of the same build render exactly the same frames
+    const float frameDelta = 1.0f / 60.0f;
+    const float yawStep = 360.0f / std::max(benchFrames, 1) / camera.MouseSensitivity;
+
+    if (!benchStatsCsv.empty() && !RenderStats::OpenCsv(benchStatsCsv)) {
+        return 1;
+    }
+    // every run measures the whole scene, not the frames in which models pop in
+    if (modelLoader) {
+        modelLoader->wait();
+        processUploads(std::numeric_limits<double>::infinity(), std::numeric_limits<size_t>::max());
+    }
+    TextureStreamer::Flush();
+    std::vector<RenderPath> paths;
+    if (benchComparePaths && !useSolarSystemScene) {
+        paths = { RenderPath::Forward, RenderPath::Deferred };
+    } else {
+        paths = { renderPath };
+    }
+    const char* glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const Camera startCamera = camera;
+    std::vector<std::unique_ptr<FrameBenchmark>> runs;
+    std::string json;
+
+    for (RenderPath path : paths) {
+        const char* pathName = path == RenderPath::Deferred ? "deferred" : "forward";
+        std::cout << "Benchmark: " << benchFrames << " frames of the "
+                  << (useSolarSystemScene ? "solar system" : "models") << " scene, " << pathName << std::endl;
+        // every run sees the same camera path
+        camera = startCamera;
+        renderPath = path;
+        runs.push_back(std::make_unique<FrameBenchmark>());
+        FrameBenchmark& bench = *runs.back();
+        for (int frame = 0; frame < benchFrames; frame++) {
+            if (window) {
+                glfwPollEvents();
+            }
+            lastFrameGLState = GLStateCache::GetCounters();
+            GLStateCache::ResetCounters();
+            RenderStats::BeginFrame();
+            deltaTime = frameDelta;
+            camera.ProcessMouseMovement(yawStep, 0.0f);
+
+            Profiler::BeginFrame();
+            bench.beginFrame();
+            renderFrame();
+            bench.endFrame();
+            Profiler::EndFrame();
+            RenderStats::EndFrame();
+        }
+        bench.finish();
+
+        std::string summary = bench.summaryJson(useSolarSystemScene ? "solar" : "models",
+                                                useSolarSystemScene ? "forward" : pathName,
+                                                window ? "glfw" : headlessContext.description(),
+                                                glRenderer ? glRenderer : "unknown",
+                                                static_cast<int>(m_framebufferSize.x),
+                                                static_cast<int>(m_framebufferSize.y));
+        std::cout << summary << std::endl;
+        json += (json.empty() ? "" : ",\n") + summary;
+    }
+    RenderStats::CloseCsv();
+
+    if (runs.size() == 2) {
+        // forward first, deferred second
+        FrameTimeSummary forwardCpu = runs[0]->cpuSummary(), deferredCpu = runs[1]->cpuSummary();
+        FrameTimeSummary forwardGpu = runs[0]->gpuSummary(), deferredGpu = runs[1]->gpuSummary();
+        std::printf("%-9s %12s %12s %12s %12s\n", "path", "cpu mean", "cpu p95", "gpu mean", "gpu p95");
+        std::printf("%-9s %12.3f %12.3f %12.3f %12.3f\n", "forward", forwardCpu.mean, forwardCpu.p95,
+                    forwardGpu.mean, forwardGpu.p95);
+        std::printf("%-9s %12.3f %12.3f %12.3f %12.3f\n", "deferred", deferredCpu.mean, deferredCpu.p95,
+                    deferredGpu.mean, deferredGpu.p95);
+        if (deferredGpu.mean > 0.0) {
+            std::printf("deferred / forward gpu time: %.2fx\n", deferredGpu.mean / forwardGpu.mean);
+        }
+        json = "[\n" + json + "\n]";
+    }
+    if (!benchOutput.empty()) {
+        std::ofstream out(benchOutput);
+        out << json << std::endl;
+        if (!out.good()) {
+            std::cout << "Benchmark: could not write " << benchOutput << std::endl;
         }
+    }
+    if (!benchScreenshot.empty()) {
+        m_framebuffer->screenshot(benchScreenshot);
+    }
+    if (!benchTrace.empty()) {
+        Profiler::WriteChromeTrace(benchTrace);
+    }
+    const FramePassStats lastTotals = RenderStats::GetLastFrame().total();
+    std::cout << "Last frame: " << lastTotals.get(RenderMetric::DrawCalls) << " draws, "
+              << lastTotals.get(RenderMetric::Triangles) << " triangles" << std::endl;
+    if (MaterialAtlas::IsEnabled()) {
+        const RenderQueueStats& queueStats = renderer.getQueueStats();
+        std::cout << "Last frame: " << queueStats.mergedDraws << " draws merged into " << queueStats.multiDraws
+                  << " multi-draws" << std::endl;
+    }
+    RenderStats::PrintBudgetReport();
+    const bool budgetsMet = RenderStats::BudgetsMet();
+
+    shutdownTextureStreaming();
+    ResourceManager::Clear();
+    MaterialAtlas::Clear();
+    if (window) {
+        Gui::Clean();
+        glfwTerminate();
+    }
+    return budgetsMet ? 0 : 2;
+}
+
+void Game3D::renderGui() {
+    Gui::Start();
+
+    // Reflection model selection window
+    if (showReflectionWindow && m_reflectionRenderer) {
+        ImGui::Begin("Reflection Model Selection", &showReflectionWindow);
 
-        // Configure refraction settings
-        renderer.useModelRefraction = useRefraction;
-        renderer.modelRefractionRatio = refractionRatio;
-
-        // Temporarily disable dynamic environment mapping to troubleshoot crashes
-        // renderer.useDynamicEnvironmentMapping = useDynamicEnvironmentMapping;
-        // if (useDynamicEnvironmentMapping && dynamicEnvMapping) {
-        //     // Add a reflection probe at the camera position for dynamic environment mapping
-        //     if (dynamicEnvMapping->getProbeCount() == 0) {
-        //         dynamicEnvMapping->addReflectionProbe(camera.Position);
-        //     } else {
-        //         // Update the existing probe position
-        //         dynamicEnvMapping->updateProbePosition(0, camera.Position);
-        //     }
-        // }
-        renderer.useDynamicEnvironmentMapping = false;  // Disable for now
-
-        renderer.render(scene, camera);
-
-        // Render reflective objects
-        if (m_reflectionRenderer && skyboxCubemap) {
-            // Simple reflective cube at position (0, 5, -5)
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0.0f, 5.0f, -5.0f));
-            model = glm::scale(model, glm::vec3(2.0f));
-
-            glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-                                                  (float)m_framebufferSize.x / (float)m_framebufferSize.y,
-                                                  0.1f, 1000.0f);
-            // Render with reflection map settings
-            m_reflectionRenderer->renderReflection(model, camera.GetViewMatrix(), projection,
-                                                  camera.Position, skyboxCubemap->ID,
-                                                  reflectionIntensity, useReflectionMap, reflectionMapTexture);
+        if (ImGui::Button("Toggle Reflection Window")) {
+            showReflectionWindow = !showReflectionWindow;
         }
 
-        // Render skybox last (if enabled) for performance
-        if (skybox && useSkybox) {
-            // Use the same projection as main camera
-            glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-                                                  (float)m_framebufferSize.x / (float)m_framebufferSize.y,
-                                                  0.1f, 1000.0f);
-            skybox->render(camera.GetViewMatrix(), projection);
+        // Model selection dropdown
+        int currentIdx = m_reflectionRenderer->getCurrentModelIndex();
+        std::string currentModel = m_reflectionRenderer->getCurrentModelName();
+
+        if (ImGui::BeginCombo("Reflection Model", currentModel.c_str())) {
+            for (int i = 0; i < m_reflectionRenderer->getModelCount(); i++) {
+                std::string modelName = m_reflectionRenderer->getModelName(i);
+                bool isSelected = (currentIdx == i);
+                if (ImGui::Selectable(modelName.c_str(), isSelected)) {
+                    m_reflectionRenderer->setModelByIndex(i);
+                }
+                if (isSelected) {
+                    ImGui::SetItemDefaultFocus();
+                }
+            }
+            ImGui::EndCombo();
         }
 
-        // SCREEN PASS: Render framebuffer to screen with post-processing
-        m_framebuffer->unbind();
-        glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f); 
-        glClear(GL_COLOR_BUFFER_BIT);
-        glDisable(GL_DEPTH_TEST);
-        
-        // Draw the main scene
-        m_postProcessShader->Use();
-        m_postProcessShader->SetInteger("screenTexture", 0);
-        m_framebuffer->bindColorTexture(0);
-        m_screenQuad->draw();
-
-        // Draw mirror overlay on top
-        if (m_rearViewMirror && m_showMirror) {
-            m_rearViewMirror->drawMirror(SCREEN_WIDTH, SCREEN_HEIGHT);
+        ImGui::Text("Current model: %s", currentModel.c_str());
+
+        ImGui::Separator();
+
+        // Reflection map controls
+        ImGui::Text("Reflection Settings:");
+        ImGui::Checkbox("Use Reflection Map", &useReflectionMap);
+        if (ImGui::Checkbox("Use Model Reflections", &useReflection)) {  // Toggle general model reflections
+            game::cfg().SetUseReflection(useReflection);
+        }
+        if (ImGui::SliderFloat("Reflection Intensity", &reflectionIntensity, 0.0f, 2.0f, "%.2f")) {
+            game::cfg().SetReflectionIntensity(reflectionIntensity);
         }
 
-        // GUI
-        Gui::Start();
+        // Refraction controls
+        ImGui::Separator();
+        ImGui::Text("Refraction Settings:");
+        if (ImGui::Checkbox("Use Model Refraction", &useRefraction)) {  // Toggle refractions
+            game::cfg().SetUseRefraction(useRefraction);
+        }
+        if (ImGui::SliderFloat("Refraction Ratio", &refractionRatio, 0.0f, 1.0f, "%.2f")) {
+            game::cfg().SetRefractionRatio(refractionRatio);
+        }
 
-        // Reflection model selection window
-        if (showReflectionWindow && m_reflectionRenderer) {
-            ImGui::Begin("Reflection Model Selection", &showReflectionWindow);
+        ImGui::End();
+    }
 
-            if (ImGui::Button("Toggle Reflection Window")) {
-                showReflectionWindow = !showReflectionWindow;
+    if (ImGui::BeginMainMenuBar()) {
+        if (ImGui::BeginMenu("Tools")) {
+            ImGui::MenuItem("Reflection Models", nullptr, &showReflectionWindow);
+            if (ImGui::MenuItem("Reflection Controls")) {
+                showReflectionControls = !showReflectionControls;
             }
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
 
-            // Model selection dropdown
-            int currentIdx = m_reflectionRenderer->getCurrentModelIndex();
-            std::string currentModel = m_reflectionRenderer->getCurrentModelName();
-
-            if (ImGui::BeginCombo("Reflection Model", currentModel.c_str())) {
-                for (int i = 0; i < m_reflectionRenderer->getModelCount(); i++) {
-                    std::string modelName = m_reflectionRenderer->getModelName(i);
-                    bool isSelected = (currentIdx == i);
-                    if (ImGui::Selectable(modelName.c_str(), isSelected)) {
-                        m_reflectionRenderer->setModelByIndex(i);
-                    }
-                    if (isSelected) {
-                        ImGui::SetItemDefaultFocus();
-                    }
-                }
-                ImGui::EndCombo();
-            }
+    // Additional reflection controls window
+    if (showReflectionControls) {
+        ImGui::Begin("Reflection Controls", &showReflectionControls);
 
-            ImGui::Text("Current model: %s", currentModel.c_str());
+        ImGui::Checkbox("Use Reflection Map", &useReflectionMap);
+        if (ImGui::SliderFloat("Reflection Intensity", &reflectionIntensity, 0.0f, 2.0f, "%.2f")) {
+            game::cfg().SetReflectionIntensity(reflectionIntensity);
+        }
 
-            ImGui::Separator();
+        if (ImGui::Button("Toggle Reflection Window")) {
+            showReflectionWindow = !showReflectionWindow;
+        }
 
-            // Reflection map controls
-            ImGui::Text("Reflection Settings:");
-            ImGui::Checkbox("Use Reflection Map", &useReflectionMap);
-            if (ImGui::Checkbox("Use Model Reflections", &useReflection)) {  // Toggle general model reflections
-                game::cfg().SetUseReflection(useReflection);
-            }
-            if (ImGui::SliderFloat("Reflection Intensity", &reflectionIntensity, 0.0f, 2.0f, "%.2f")) {
-                game::cfg().SetReflectionIntensity(reflectionIntensity);
-            }
+        ImGui::End();
+    }
 
-            // Refraction controls
-            ImGui::Separator();
-            ImGui::Text("Refraction Settings:");
-            if (ImGui::Checkbox("Use Model Refraction", &useRefraction)) {  // Toggle refractions
-                game::cfg().SetUseRefraction(useRefraction);
+    // Performance panel (F1): counters and the profiler's flame graphs
+    if (showPerformanceOverlay) {
+        const RenderQueueStats& queueStats = renderer.getQueueStats();
+        ImGui::SetNextWindowPos(ImVec2(10.0f, 30.0f), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(520.0f, 480.0f), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowBgAlpha(0.75f);
+        ImGui::Begin("Performance", &showPerformanceOverlay);
+        ImGui::Text("FPS: %d", fps);
+        ImGui::Separator();
+        ImGui::Text("Queued draws: %u", queueStats.drawCalls);
+        ImGui::Text("Program binds: %u", queueStats.programBinds);
+        ImGui::Text("Texture binds: %u", queueStats.textureBinds);
+        ImGui::Text("VAO binds: %u", queueStats.vaoBinds);
+        if (MaterialAtlas::IsEnabled()) {
+            ImGui::Text("Merged draws: %u in %u multi-draws", queueStats.mergedDraws, queueStats.multiDraws);
+        }
+        const CullingStats& sceneCulling = renderer.getCullingStats();
+        ImGui::Text("Scene visible/culled: %u / %u", sceneCulling.visible, sceneCulling.culled);
+        if (useSolarSystemScene) {
+            ImGui::Text("Bodies visible/culled: %u / %u", bodyCulling.visible, bodyCulling.culled);
+        }
+        ImGui::Text("GL state calls: %lu (%lu skipped)", lastFrameGLState.total(), lastFrameGLState.skipped);
+        if (modelLoader && !modelLoader->idle()) {
+            const UploadQueueStats& uploads = uploadQueue.getStats();
+            ImGui::Text("Loading models: %zu of %zu, %zu uploads queued (%.2f ms, %zu KB this frame)",
+                        modelLoader->finished(), modelLoader->requested(), uploads.pending, uploads.ms,
+                        uploads.bytes / 1024);
+        }
+        const TextureStreamerStats& streaming = TextureStreamer::GetStats();
+        if (streaming.decoding + streaming.waiting > 0) {
+            ImGui::Text("Streaming textures: %u of %u resident, %u decoding, %u waiting (%zu KB this frame)",
+                        streaming.resident, streaming.requested, streaming.decoding, streaming.waiting,
+                        streaming.frameBytes / 1024);
+        }
+        const TextureRegistryStats sharing = TextureRegistry::GetStats();
+        ImGui::Text("Textures: %u shared by %u references, %zu KB, %zu KB saved by %u hits",
+                    sharing.textures, sharing.references, sharing.residentBytes / 1024, sharing.savedBytes / 1024,
+                    sharing.hits);
+        ShaderPermutations& modelPermutations = ResourceManager::GetShaderPermutations("model");
+        ShaderPermutationStats variantStats = modelPermutations.GetStats();
+        bool useVariants = modelPermutations.VariantsEnabled();
+        if (ImGui::Checkbox("Model shader variants", &useVariants)) {
+            modelPermutations.SetVariantsEnabled(useVariants);
+        }
+        ImGui::SameLine();
+        ImGui::Text("%u ready, %u compiling, %u failed", variantStats.ready, variantStats.pending, variantStats.failed);
+        ImGui::Checkbox("Mesh LOD", &LodSelector::Enabled);
+        ImGui::SameLine();
+        ImGui::SliderFloat("Pixel error", &LodSelector::PixelError, 0.25f, 8.0f, "%.2f");
+        const LodSelectionStats& lodStats = LodSelector::Stats;
+        ImGui::Text("LOD draws 0/1/2/3: %u / %u / %u / %u, indices %u of %u", lodStats.draws[0], lodStats.draws[1],
+                    lodStats.draws[2], lodStats.draws[3], lodStats.indices, lodStats.fullIndices);
+        if (!useSolarSystemScene) {
+            bool deferred = renderPath == RenderPath::Deferred;
+            if (ImGui::Checkbox("Deferred shading", &deferred)) {
+                renderPath = deferred ? RenderPath::Deferred : RenderPath::Forward;
             }
-            if (ImGui::SliderFloat("Refraction Ratio", &refractionRatio, 0.0f, 1.0f, "%.2f")) {
-                game::cfg().SetRefractionRatio(refractionRatio);
+            int lightCount = randomPointLightCount;
+            if (ImGui::SliderInt("Random point lights", &lightCount, 0, MAX_POINT_LIGHTS)) {
+                spawnRandomPointLights(lightCount);
             }
-
-            ImGui::End();
+            const LightClusterStats& clusterStats = renderer.getLightClusterStats();
+            ImGui::Text("Clustered: %u visible, %u refs, max %u/cluster, %u dropped, %.3f ms", clusterStats.visibleLights,
+                        clusterStats.references, clusterStats.maxPerCluster, clusterStats.dropped, clusterStats.assignMs);
         }
-
-        if (ImGui::BeginMainMenuBar()) {
-            if (ImGui::BeginMenu("Tools")) {
-                ImGui::MenuItem("Reflection Models", nullptr, &showReflectionWindow);
-                if (ImGui::MenuItem("Reflection Controls")) {
-                    showReflectionControls = !showReflectionControls;
-                }
-                ImGui::EndMenu();
+        ImGui::Separator();
+        // previous frame, per pass: the current one is still being recorded
+        const RenderFrameStats& frameStats = RenderStats::GetLastFrame();
+        ImGui::Text("%-10s %6s %9s %5s %5s %5s %5s %6s %9s", "pass", "draws", "tris", "prog", "tex", "vao", "fbo", "unif", "bytes");
+        for (size_t i = 0; i < static_cast<size_t>(FramePass::Count); i++) {
+            const FramePassStats& stats = frameStats.passes[i];
+            if (stats.empty()) {
+                continue;
             }
-            ImGui::EndMainMenuBar();
+            ImGui::Text("%-10s %6lu %9lu %5lu %5lu %5lu %5lu %6lu %9lu", RenderStats::PassName(static_cast<FramePass>(i)),
+                        stats.get(RenderMetric::DrawCalls), stats.get(RenderMetric::Triangles),
+                        stats.get(RenderMetric::ProgramBinds), stats.get(RenderMetric::TextureBinds),
+                        stats.get(RenderMetric::VaoBinds), stats.get(RenderMetric::FramebufferBinds),
+                        stats.get(RenderMetric::UniformCalls), stats.get(RenderMetric::BufferBytes));
+        }
+        if (!RenderStats::BudgetsMet()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Render budget exceeded, see console");
         }
+        ImGui::Separator();
+        ProfilerPanel::Draw();
+        ImGui::End();
+    }
 
-        // Additional reflection controls window
-        if (showReflectionControls) {
-            ImGui::Begin("Reflection Controls", &showReflectionControls);
+    Gui::Render();
+}
 
-            ImGui::Checkbox("Use Reflection Map", &useReflectionMap);
-            if (ImGui::SliderFloat("Reflection Intensity", &reflectionIntensity, 0.0f, 2.0f, "%.2f")) {
-                game::cfg().SetReflectionIntensity(reflectionIntensity);
-            }
+void Game3D::run() {
+    lastFrame = static_cast<float>(glfwGetTime());
+    const double uploadBudgetMs = game::cfg().GetUploadBudgetMs();
+    const size_t uploadBudgetBytes = static_cast<size_t>(game::cfg().GetUploadBudgetMB()) << 20;
+    if (uniformBenchmark) {
+        Shader::LegacyUniformLookup = true;
+        Shader::Counters.reset();
+    }
 
-            if (ImGui::Button("Toggle Reflection Window")) {
-                showReflectionWindow = !showReflectionWindow;
+    while (!glfwWindowShouldClose(window)) {
+        Profiler::BeginFrame();
+        // Timing
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+        Timers::tick();
+        lastFrameGLState = GLStateCache::GetCounters();
+        GLStateCache::ResetCounters();
+        RenderStats::BeginFrame();
+        processInput();
+        processUploads(uploadBudgetMs, uploadBudgetBytes);
+        {
+            PROFILE_SCOPE("Texture streaming");
+            TextureStreamer::Update();
+        }
+
+        // FPS calculation, frame times are kept by the Profiler
+        frameCount++;
+        if (currentFrame - lastFPSUpdate >= 1.0f) { // Update every second
+            fps = static_cast<int>(frameCount / (currentFrame - lastFPSUpdate));
+            frameCount = 0;
+            lastFPSUpdate = currentFrame;
+        }
+
+        renderFrame();
+
+        // SCREEN PASS: Render framebuffer to screen with post-processing
+        {
+            PROFILE_GPU_SCOPE("Post-process");
+            FramePassScope statsPass(FramePass::PostProcess);
+            m_framebuffer->unbind();
+            glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            GLStateCache::Disable(GL_DEPTH_TEST);
+
+            // Draw the main scene
+            m_postProcessShader->Use();
+            m_postProcessShader->SetInteger("screenTexture", 0);
+            m_framebuffer->bindColorTexture(0);
+            m_screenQuad->draw();
+
+            // Draw mirror overlay on top
+            if (m_rearViewMirror && m_showMirror) {
+                m_rearViewMirror->drawMirror(SCREEN_WIDTH, SCREEN_HEIGHT);
             }
+        }
 
-            ImGui::End();
+        {
+            PROFILE_GPU_SCOPE("GUI");
+            FramePassScope statsPass(FramePass::Gui);
+            renderGui();
         }
+        RenderStats::EndFrame();
 
-        Gui::Render();
+        if (uniformBenchmark) {
+            updateUniformBenchmark();
+        }
 
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("Swap");
+            glfwSwapBuffers(window);
+        }
+        if (!firstFrameReported) {
+            firstFrameReported = true;
+            std::printf("First frame after %.1f ms, %zu of %zu models loaded\n",
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupTime).count(),
+                        modelLoader ? modelLoader->finished() : 0, modelLoader ? modelLoader->requested() : 0);
+        }
         glfwPollEvents();
+        Profiler::EndFrame();
     }
 
+    shutdownTextureStreaming();
     ResourceManager::Clear();
+    MaterialAtlas::Clear();
     Gui::Clean();
     glfwTerminate();
 }
@@ -1039,6 +1502,14 @@ void Game3D::processInput()
         std::cout << "Cursor mode toggled: " << (cursorEnabled ? "Enabled" : "Disabled") << std::endl;
     }
 
+    // Left click with a free cursor picks the model under it
+    static bool leftMouseWasPressed = false;
+    bool leftMousePressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    if (leftMousePressed && !leftMouseWasPressed && cursorEnabled && !ImGui::GetIO().WantCaptureMouse) {
+        pickModelAtCursor();
+    }
+    leftMouseWasPressed = leftMousePressed;
+
     static bool perfToggle = false;
     if (toggleKey(GLFW_KEY_F1, perfToggle)) {
         showPerformanceOverlay = !showPerformanceOverlay;
@@ -1065,9 +1536,9 @@ void Game3D::processInput()
     if (srgbToggle != lastSrgbToggle) {
         lastSrgbToggle = srgbToggle;
         if (srgbToggle) {
-            glEnable(GL_FRAMEBUFFER_SRGB);
+            GLStateCache::Enable(GL_FRAMEBUFFER_SRGB);
         } else {
-            glDisable(GL_FRAMEBUFFER_SRGB);
+            GLStateCache::Disable(GL_FRAMEBUFFER_SRGB);
         }
     }
 
@@ -1133,6 +1604,43 @@ bool Game3D::toggleKey(int key, bool &toggleState) {
     return false;
 }
 
+void Game3D::pickModelAtCursor() {
+    double cursorX, cursorY;
+    int width, height;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    glfwGetWindowSize(window, &width, &height);
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // Unproject the cursor on the near and far planes
+    glm::vec2 ndc(2.0f * static_cast<float>(cursorX) / width - 1.0f,
+                  1.0f - 2.0f * static_cast<float>(cursorY) / height);
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+                                            (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 1000.0f);
+    glm::mat4 inverseViewProjection = glm::inverse(projection * camera.GetViewMatrix());
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+    SceneHit hit;
+    if (!scene.raycast(origin, direction, 1000.0f, hit) || !hit.item.component) {
+        return;
+    }
+
+    const auto& entities = scene.getEntities();
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (entities[i].get() == hit.item.component->entity) {
+            selectedModel = static_cast<int>(i);
+            std::cout << "Selected model: "
+                      << (i < modelNames.size() ? modelNames[i] : std::to_string(i))
+                      << " (" << hit.distance << " units away)" << std::endl;
+            return;
+        }
+    }
+}
+
 void Game3D::toggleCursor() {
     cursorEnabled = !cursorEnabled;
     glfwSetInputMode(window, GLFW_CURSOR, cursorEnabled ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
@@ -1167,14 +1675,19 @@ bool Game3D::loadModel(const std::string& name,
             return false;
         }
 
+        // the entity shows as a box until the loader has uploaded the model into it
+        if (!modelLoader) {
+            modelLoader = std::make_unique<ModelLoader>(uploadQueue);
+        }
         auto entity = std::make_unique<Entity>();
-        auto model = new m3D::Model(path);
+        auto model = new m3D::Model();
+        modelLoader->load(*model, path);
         entity->addComponent<ModelComponent>(model);
         entity->addComponent<TransformComponent>(position, rotation, scale);
         scene.addEntity(std::move(entity));
 
         modelNames.push_back(name);
-        std::cout << "Loaded model: " << name << " from " << path << std::endl;
+        std::cout << "Loading model: " << name << " from " << path << std::endl;
         return true;
 
     } catch (const std::exception& e) {
@@ -1185,6 +1698,7 @@ bool Game3D::loadModel(const std::string& name,
 
 void Game3D::loadModels(const std::string& modelBasePath, const std::string& binModelBasePath) {
     std::cout << "Starting to load models using Scene class..." << std::endl;
+    MeshCache::SetDirectory(binModelBasePath + "/cooked");
 
     struct ModelData {
         std::string name;
@@ -3,12 +3,16 @@
 #include "../scene/Scene.h"
 #include "../render/Renderer3D.h"
 #include "../include/Camera.hpp"
+#include <chrono>
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <glm/glm.hpp>
 #include "../render/Shader.h"
 #include "../render/Model.h"
+#include "../render/ModelLoader.h"
+#include "../render/UploadQueue.h"
 #include "../render/primitives/PrimitiveShapes.h"
 #include "render/Framebuffer.hpp"
 #include "render/primitives/2d/2D.hpp"
@@ -16,9 +20,12 @@
 #include "render/space/CelestialBody.h"
 #include "render/space/Star.h"
 #include "render/space/Planet.h"
+#include "render/space/CelestialInstanceBatch.h"
 #include "render/Skybox.h"
 #include "render/ReflectionRenderer.h"
 #include "render/DynamicEnvironmentMapping.h"
+#include "render/GLStateCache.h"
+#include "render/HeadlessContext.h"
 #include "../ConfigManager.hpp"
 struct GLFWwindow;
 
@@ -28,6 +35,21 @@ public:
     ~Game3D();
     void init();
     void run();
+    // --bench: renders benchFrames frames into m_framebuffer with no GUI, prints
+    // per-frame CPU/GPU times and a JSON summary; returns the process exit code
+    // (2 when a RenderStats budget was exceeded)
+    int runBenchmark();
+
+    bool headless = false; // create an EGL/OSMesa context instead of a GLFW window
+    HeadlessBackend headlessBackend = HeadlessBackend::Auto;
+    int benchFrames = 300;
+    std::string benchOutput;     // also write the summary JSON here
+    std::string benchScreenshot; // save the last frame here, for image comparisons
+    std::string benchTrace;      // Chrome trace of the last Profiler::HISTORY_FRAMES frames
+    std::string benchStatsCsv;   // RenderStats of every frame
+    int randomPointLightCount = 0; // models scene, see spawnRandomPointLights()
+    RenderPath renderPath = RenderPath::Forward; // models scene; the solar system is always forward
+    bool benchComparePaths = false; // --path both: a forward and a deferred run of the same frames
 
 private:
     void processInput();
@@ -35,9 +57,25 @@ private:
     void scroll_callback(double xoffset, double yoffset);
     bool toggleKey(int key, bool &toggleState);
     void toggleCursor();
+    // casts a ray through the cursor into the scene BVH and selects the entity hit
+    void pickModelAtCursor();
     void initSolarSystemScene();
+    // replaces the renderer's random point lights with count lights over the
+    // ground; seeded, so the same count always gives the same lights
+    void spawnRandomPointLights(int count);
+    void updateUniformBenchmark();
     void loadModels(const std::string& modelBasePath, const std::string& binModelBasePath);
     bool loadModel(const std::string& name, const std::string& relativePath, const std::string& modelRoot, const std::string& binRoot, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+    // simulation step and scene passes into m_framebuffer, shared by run() and runBenchmark()
+    void renderFrame();
+    // this frame's share of the background model uploads; reports when the last model is in
+    void processUploads(double budgetMs, size_t budgetBytes);
+    void initTextureStreaming();
+    void shutdownTextureStreaming();
+    // ImGui windows of the interactive loop
+    void renderGui();
+    // declared before every member that owns GL objects, so it is destroyed after them
+    HeadlessContext headlessContext;
     std::shared_ptr<Framebuffer> m_framebuffer;
     std::shared_ptr<VO::Quad> m_screenQuad;
     Shader* m_postProcessShader;
@@ -79,6 +117,10 @@ public:
 
     std::vector<CelestialBody*> celestialBodies;
     float timeScale = 1000.0f; // Speed up time for visualization
+    // Instanced bodies only move themselves, so updateSolarSystem spreads them over the pool
+    // once the bodies they orbit are done
+    WorkerPool bodyUpdatePool;
+    std::vector<CelestialBody*> independentBodies;
 
 
     void updateSolarSystem(float deltaTime);
@@ -107,6 +149,9 @@ public:
 
     std::shared_ptr<m3D::Mesh> sphereMesh;
     Shader planetShader;  // Shader for rendering planets with gradients
+    Shader planetInstancedShader;  // planet shading with per instance model matrix and material
+    // Bodies without rings, moons or effects, drawn in one glDrawElementsInstanced call
+    std::unique_ptr<CelestialInstanceBatch> sphereBatch;
 
     // Skybox functionality
     Skybox* skybox;
@@ -116,11 +161,12 @@ public:
     bool showTriangleContours;
     bool runMode;
     float baseMovementSpeed;
-    int maxAsteroids = 10; // Reduced from 100 to 10
-    int maxKuiperBeltObjects = 50; // Reduced from 200 to 50
-    int maxDistantStars = 100; // Reduced from 1000 to 100
+    int maxAsteroids = 100000;
+    int maxKuiperBeltObjects = 2000;
+    int maxDistantStars = 100;
     bool useFramebuffer;
     bool showPerformanceOverlay = true; // Toggle for FPS and performance counter
+    bool uniformBenchmark = false; // --uniform-bench: compare legacy and cached uniform lookups, then exit
 
     // Dynamic environment mapping
     bool useDynamicEnvironmentMapping = false; // Whether to enable dynamic environment mapping
@@ -131,10 +177,26 @@ private:
     Renderer3D renderer;
     GLFWwindow* window;
 
+    // Models import on the loader threads and upload through the queue; the
+    // loader goes first on destruction, as its tasks count into it
+    UploadQueue uploadQueue;
+    std::unique_ptr<ModelLoader> modelLoader;
+    bool modelsReported = false;
+    std::chrono::steady_clock::time_point startupTime;
+    bool firstFrameReported = false;
+    // hidden, sharing objects with window; TextureStreamer uploads from its context
+    GLFWwindow* uploadWindow = nullptr;
+
     // Performance counters
     float frameCount = 0;
     float lastFPSUpdate = 0.0f;
     int fps = 0;
-    float avgFrameTime = 0.0f;
-    std::vector<float> frameTimes;
+    // GL state calls of the previous frame (issued vs skipped by GLStateCache)
+    GLStateCounters lastFrameGLState;
+    // celestial bodies tested against the frustum in renderSolarSystem
+    CullingStats bodyCulling;
+
+    // Uniform benchmark state: phase 0 uses legacy lookups, phase 1 the cached table
+    int benchFrame = 0;
+    ShaderCallCounters benchTotals[2];
 };
\ No newline at end of file
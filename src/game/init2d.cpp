@@ -1,6 +1,7 @@
 #include "init2d.h"
 #include "../ui/Gui.h"
 #include <setup.h>
+#include "../render/GLStateCache.h"
 
 
 // Define the dimensions
@@ -38,8 +39,8 @@ int game2d(int argc, char *argv[], const std::string& type)
     // OpenGL configuration
     // --------------------
     glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLStateCache::Enable(GL_BLEND);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     Gui::Init(window);
     // initialize game
     // ---------------
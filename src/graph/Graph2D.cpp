@@ -7,6 +7,7 @@
 #include <cmath>
 #include <cfloat>
 #include <cstring>
+#include "../render/GLStateCache.h"
 
 Graph2D::Graph2D(const std::string& name) : Graph(name), inputType(CARTESIAN_Y_EQ_FX) {
     strncpy(equationBuffer, name.c_str(), sizeof(equationBuffer));
@@ -16,14 +17,14 @@ Graph2D::Graph2D(const std::string& name) : Graph(name), inputType(CARTESIAN_Y_E
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
 
-    glBindVertexArray(vao);
+    GLStateCache::BindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
     glEnableVertexAttribArray(0);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void Graph2D::generateMesh() {
@@ -117,9 +118,9 @@ void Graph2D::render() {
     lineShader.SetFloat("yMin", yMin);
     lineShader.SetFloat("yMax", yMax);
 
-    glBindVertexArray(vao);
+    GLStateCache::BindVertexArray(vao);
     glDrawArrays(GL_LINE_STRIP, 0, lineVertices.size());
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 
     ImGui::Begin("Graph2D");
     ImGui::InputText("Equation", equationBuffer, sizeof(equationBuffer));
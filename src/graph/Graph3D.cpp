@@ -7,6 +7,7 @@
 #include <GLFW/glfw3.h>
 #include <cfloat>
 #include <cmath>
+#include "../render/GLStateCache.h"
 
 Graph3D::Graph3D(const std::string& name) : Graph(name), camera(glm::vec3(5.0f, 5.0f, 5.0f)), inputType(CARTESIAN_Z_EQ_FXY) {
     strncpy(equationBuffer, name.c_str(), sizeof(equationBuffer));
@@ -17,7 +18,7 @@ Graph3D::Graph3D(const std::string& name) : Graph(name), camera(glm::vec3(5.0f,
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
 
-    glBindVertexArray(vao);
+    GLStateCache::BindVertexArray(vao);
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
@@ -28,7 +29,7 @@ Graph3D::Graph3D(const std::string& name) : Graph(name), camera(glm::vec3(5.0f,
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void Graph3D::generateMesh() {
@@ -123,13 +124,13 @@ void Graph3D::generateMesh() {
 
         te_free(expr);
 
-        glBindVertexArray(vao);
+        GLStateCache::BindVertexArray(vao);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_DYNAMIC_DRAW);
-        glBindVertexArray(0);
+        GLStateCache::BindVertexArray(0);
 
         meshGenerated = true;
     }
@@ -169,9 +170,9 @@ void Graph3D::render() {
     surfaceShader.SetFloat("zMin", zMin);
     surfaceShader.SetFloat("zMax", zMax);
 
-    glBindVertexArray(vao);
+    GLStateCache::BindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 
     ImGui::Begin("Graph3D");
     ImGui::InputText("Equation", equationBuffer, sizeof(equationBuffer));
@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <iostream>
 #include "graph/VectorField.h"
+#include "../render/GLStateCache.h"
 
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
@@ -43,7 +44,7 @@ void GraphApp::init() {
         return;
     }
 
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::Enable(GL_DEPTH_TEST);
     Gui::Init(window);
 
     currentGraph = std::make_unique<Graph2D>("sin(x)");
@@ -6,6 +6,7 @@
 #include "imgui.h"
 #include <GLFW/glfw3.h>
 #include <cmath>
+#include "../render/GLStateCache.h"
 
 VectorField::VectorField(const std::string& name) : Graph(name), camera(glm::vec3(5.0f, 5.0f, 5.0f)) {
     strncpy(equationBufferX, "y", sizeof(equationBufferX));
@@ -18,7 +19,7 @@ VectorField::VectorField(const std::string& name) : Graph(name), camera(glm::vec
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
 
-    glBindVertexArray(vao);
+    GLStateCache::BindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
@@ -27,7 +28,7 @@ VectorField::VectorField(const std::string& name) : Graph(name), camera(glm::vec
     glEnableVertexAttribArray(1);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void VectorField::generateMesh() {
@@ -106,10 +107,10 @@ void VectorField::generateMesh() {
         te_free(exprY);
         te_free(exprZ);
 
-        glBindVertexArray(vao);
+        GLStateCache::BindVertexArray(vao);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, arrowVertices.size() * sizeof(float), arrowVertices.data(), GL_DYNAMIC_DRAW);
-        glBindVertexArray(0);
+        GLStateCache::BindVertexArray(0);
 
         meshGenerated = true;
     }
@@ -140,9 +141,9 @@ void VectorField::render() {
     vectorShader.SetMatrix4("view", view);
     vectorShader.SetMatrix4("model", model);
 
-    glBindVertexArray(vao);
+    GLStateCache::BindVertexArray(vao);
     glDrawArrays(GL_LINES, 0, arrowVertices.size() / 6); // 6 floats per vertex (pos + color)
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 
     ImGui::Begin("VectorField");
     ImGui::InputText("Vx", equationBufferX, sizeof(equationBufferX));
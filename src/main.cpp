@@ -1,12 +1,22 @@
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 #include "game/Game.h"
 #include "game/Game3D.h"
 #include "graph/GraphApp.h"
 #include "ConfigManager.hpp"
+#include "scene/BVHBenchmark.h"
+#include "render/LightClusterBenchmark.h"
+#include "render/GLStateCacheCheck.h"
+#include "render/AllocationCheck.h"
+#include "render/HeadlessContext.h"
+#include "render/RenderStats.h"
+#include "render/TextureBaker.h"
 
 int main(int argc, char *argv[])
 {
     bool loadModelsScene = false; // New flag
+    bool uniformBenchmark = false;
 
     // Initialize configuration system
     game::cfg().Load();
@@ -21,26 +31,117 @@ int main(int argc, char *argv[])
 
     std::string mode = argv[1];
 
-    if (mode == "--graph") {
+    if (mode == "--bench") {
+        const char* usage = "Usage: --bench <models|solar> [--frames N] [--backend auto|egl|osmesa|window] [--out file.json] [--screenshot file.png] [--trace trace.json] [--stats-csv stats.csv] [--budget draws<=2000] [--lights N] [--path forward|deferred|both]";
+        if (argc < 3 || (std::string(argv[2]) != "models" && std::string(argv[2]) != "solar")) {
+            std::cout << usage << std::endl;
+            return -1;
+        }
+        Game3D game;
+        game.useSolarSystemScene = std::string(argv[2]) == "solar";
+        game.headless = true;
+        for (int i = 3; i < argc; i += 2) {
+            std::string option = argv[i];
+            if (i + 1 == argc) {
+                // every option takes a value; a dropped --budget would let the CI gate pass
+                std::cout << "Missing value for benchmark option " << option << std::endl << usage << std::endl;
+                return -1;
+            }
+            std::string value = argv[i + 1];
+            if (option == "--frames") {
+                game.benchFrames = std::max(1, std::atoi(value.c_str()));
+            } else if (option == "--backend") {
+                if (value == "window") {
+                    game.headless = false;
+                } else if (!HeadlessContext::parseBackend(value, game.headlessBackend)) {
+                    std::cout << "Unknown backend " << value << ", use auto, egl, osmesa or window." << std::endl;
+                    return -1;
+                }
+            } else if (option == "--out") {
+                game.benchOutput = value;
+            } else if (option == "--screenshot") {
+                game.benchScreenshot = value;
+            } else if (option == "--trace") {
+                game.benchTrace = value;
+            } else if (option == "--stats-csv") {
+                game.benchStatsCsv = value;
+            } else if (option == "--lights") {
+                // random point lights in the models scene
+                game.randomPointLightCount = std::max(0, std::atoi(value.c_str()));
+            } else if (option == "--path") {
+                // both: forward and deferred runs of the same frames, with a comparison table
+                if (value == "forward" || value == "both") {
+                    game.renderPath = RenderPath::Forward;
+                } else if (value == "deferred") {
+                    game.renderPath = RenderPath::Deferred;
+                } else {
+                    std::cout << "Unknown render path " << value << ", use forward, deferred or both." << std::endl;
+                    return -1;
+                }
+                game.benchComparePaths = value == "both";
+            } else if (option == "--budget") {
+                // [pass.]metric<=limit, may be repeated
+                if (!RenderStats::AddBudget(value)) {
+                    return -1;
+                }
+            } else {
+                std::cout << "Unknown benchmark option " << option << std::endl;
+                return -1;
+            }
+        }
+        game.init();
+        return game.runBenchmark();
+    } else if (mode == "--bake-textures") {
+        // --bake-textures [directory...]: block-compressed copies ahead of time, CPU only
+        std::vector<std::string> directories;
+        for (int i = 2; i < argc; i++) {
+            directories.push_back(argv[i]);
+        }
+        if (directories.empty()) {
+            directories = { "models", "textures" };
+        }
+        for (const std::string& directory : directories) {
+            std::cout << "Baked " << TextureBaker::BakeDirectory(directory) << " textures under " << directory << std::endl;
+        }
+        TextureBaker::PrintReport();
+        return 0;
+    } else if (mode == "--bvh-bench") {
+        // CPU only, no window
+        return runBVHBenchmark();
+    } else if (mode == "--cluster-bench") {
+        // CPU only, no window
+        return runLightClusterBenchmark();
+    } else if (mode == "--state-cache-check") {
+        // headless GLStateCache recording, no context
+        return runGLStateCacheCheck();
+    } else if (mode == "--alloc-check") {
+        // headless context, counts allocations of warmed-up draws
+        return runAllocationCheck();
+    } else if (mode == "--graph") {
         GraphApp app;
         app.run();
         return 0;
     } else if (mode == "--models") { // New mode
         loadModelsScene = true;
         // Fall through to 3d mode to initialize Game3D
+    } else if (mode == "--uniform-bench") {
+        // Models scene, counting shader GL calls with legacy vs cached uniform lookups
+        loadModelsScene = true;
+        uniformBenchmark = true;
     } else if (mode == "2d") {
         // return game2d(argc, argv, type);
         return 0;
     } else if (mode == "3d") {
         // This is the default 3D mode, will use solar system unless --models is specified
     } else {
-        std::cout << "Invalid mode. Use --graph, --models, 2d or 3d." << std::endl;
+        std::cout << "Invalid mode. Use --graph, --models, --uniform-bench, --bench, --bake-textures, --bvh-bench, --cluster-bench, --state-cache-check, --alloc-check, 2d or 3d." << std::endl;
         return -1;
     }
 
     // Initialize and run Game3D based on flags
     Game3D game;
     game.useSolarSystemScene = !loadModelsScene; // Set flag in Game3D
+    game.uniformBenchmark = uniformBenchmark;
     game.init();
     game.run();
     return 0;
@@ -0,0 +1,117 @@
+#include "AllocationCheck.h"
+#include "HeadlessContext.h"
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+#include "../Mesh.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Replaces global operator new for the whole program; allocations are only
+// counted while a thread has counting switched on, so other modes pay for one
+// thread_local test per allocation and nothing else.
+namespace {
+    thread_local bool counting = false;
+    thread_local size_t allocations = 0;
+
+    void* allocate(size_t size) {
+        if (counting)
+            allocations++;
+        void* p = std::malloc(size ? size : 1);
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+    const int WARMUP_FRAMES = 4;
+    const int FRAMES = 100;
+    const int ITEMS_PER_FRAME = 10;
+    const int DRAWS = 1000;
+
+    const char* VERTEX_SOURCE =
+        "#version 330 core\n"
+        "layout(location = 0) in vec3 aPos;\n"
+        "void main() { gl_Position = vec4(aPos, 1.0); }\n";
+    // samples two of the mesh's three maps, so Draw also meets a sampler the program lacks
+    const char* FRAGMENT_SOURCE =
+        "#version 330 core\n"
+        "uniform sampler2D texture_diffuse1;\n"
+        "uniform sampler2D texture_normal1;\n"
+        "out vec4 color;\n"
+        "void main() { color = texture(texture_diffuse1, vec2(0.5)) + texture(texture_normal1, vec2(0.5)); }\n";
+
+    void queueFrame(RenderQueue& queue, Shader& shader, const m3D::Mesh& mesh, const RenderQueue::ShaderSetup& setup) {
+        const glm::mat4 model(1.0f);
+        queue.begin(glm::vec3(0.0f), 100.0f);
+        for (int i = 0; i < ITEMS_PER_FRAME; i++)
+            queue.submit(shader, mesh, model);
+        queue.sort();
+        queue.execute(setup);
+    }
+
+    bool expectNone(const char* what, size_t count) {
+        std::printf("%-36s %6zu allocations%s\n", what, count, count == 0 ? "" : "  FAILED");
+        return count == 0;
+    }
+}
+
+int runAllocationCheck() {
+    HeadlessContext context;
+    if (!context.create(64, 64)) {
+        std::printf("Allocation check: no headless GL context\n");
+        return 1;
+    }
+    if (!gladLoadGLLoader((GLADloadproc) HeadlessContext::getProcAddress)) {
+        std::printf("Allocation check: failed to load GL functions\n");
+        return 1;
+    }
+
+    Shader shader;
+    if (!shader.Compile(VERTEX_SOURCE, FRAGMENT_SOURCE))
+        return 1;
+    GLuint textures[3];
+    glGenTextures(3, textures);
+    std::vector<m3D::Vertex> vertices(3);
+    vertices[1].Position = glm::vec3(1.0f, 0.0f, 0.0f);
+    vertices[2].Position = glm::vec3(0.0f, 1.0f, 0.0f);
+    bool ok = true;
+    {
+        m3D::Mesh mesh(vertices, {0, 1, 2}, {{textures[0], "texture_diffuse", ""},
+                                             {textures[1], "texture_specular", ""},
+                                             {textures[2], "texture_normal", ""}});
+        RenderQueue queue;
+        const RenderQueue::ShaderSetup setup = [](Shader&) {};
+
+        // material tables are resolved and the queue's buffers grown here
+        for (int frame = 0; frame < WARMUP_FRAMES; frame++) {
+            mesh.Draw(shader);
+            queueFrame(queue, shader, mesh, setup);
+        }
+
+        counting = true;
+        allocations = 0;
+        for (int i = 0; i < DRAWS; i++)
+            mesh.Draw(shader);
+        size_t drawAllocations = allocations;
+        allocations = 0;
+        for (int frame = 0; frame < FRAMES; frame++)
+            queueFrame(queue, shader, mesh, setup);
+        size_t queueAllocations = allocations;
+        counting = false;
+
+        ok &= expectNone("Mesh::Draw x1000", drawAllocations);
+        ok &= expectNone("RenderQueue 100 frames of 10 draws", queueAllocations);
+    }
+    GLStateCache::DeleteTextures(3, textures);
+    std::printf("%s\n", ok ? "Allocation check passed" : "Allocation check FAILED");
+    return ok ? 0 : 1;
+}
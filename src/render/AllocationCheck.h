@@ -0,0 +1,10 @@
+#pragma once
+
+// Check that drawing allocates nothing once warmed up (--alloc-check): a mesh
+// with diffuse, specular and normal maps is drawn through Mesh::Draw and
+// through RenderQueue frames until its material tables and the queue's
+// buffers are built, then the same work is repeated while global operator new
+// counts the render thread's allocations. Needs a headless GL context (see
+// HeadlessContext). Returns the process exit code (1 if any steady-state
+// frame allocated, or no context could be created).
+int runAllocationCheck();
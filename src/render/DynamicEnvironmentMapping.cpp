@@ -1,6 +1,7 @@
 #include "DynamicEnvironmentMapping.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include "GLStateCache.h"
 
 DynamicEnvironmentMapping::DynamicEnvironmentMapping() 
     : captureFBO(0), captureRBO(0), envCubemap(0), shaderProgram(0) {
@@ -26,7 +27,7 @@ void DynamicEnvironmentMapping::initialize() {
     
     // Generate a texture for the cubemap
     glGenTextures(1, &envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
     for (unsigned int i = 0; i < 6; ++i) {
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, 
                      GL_RGB, GL_FLOAT, nullptr);
@@ -44,20 +45,20 @@ void DynamicEnvironmentMapping::initialize() {
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
     
     // Attach the depth buffer to the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, captureFBO);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
                               GL_RENDERBUFFER, captureRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void DynamicEnvironmentMapping::cleanup() {
     if (captureFBO != 0) {
-        glDeleteFramebuffers(1, &captureFBO);
+        GLStateCache::DeleteFramebuffers(1, &captureFBO);
         captureFBO = 0;
     }
     
     if (envCubemap != 0) {
-        glDeleteTextures(1, &envCubemap);
+        GLStateCache::DeleteTextures(1, &envCubemap);
         envCubemap = 0;
     }
     
@@ -69,16 +70,18 @@ void DynamicEnvironmentMapping::cleanup() {
     // Clean up all probes
     for (auto& probe : probes) {
         if (probe.framebuffer != 0) {
-            glDeleteFramebuffers(1, &probe.framebuffer);
+            GLStateCache::DeleteFramebuffers(1, &probe.framebuffer);
         }
         if (probe.textureID != 0) {
-            glDeleteTextures(1, &probe.textureID);
+            GLStateCache::DeleteTextures(1, &probe.textureID);
         }
         if (probe.depthMap != 0) {
             glDeleteRenderbuffers(1, &probe.depthMap);
         }
     }
     probes.clear();
+    probeTree.clear();
+    probeProxies.clear();
 }
 
 void DynamicEnvironmentMapping::addReflectionProbe(const glm::vec3& position) {
@@ -89,7 +92,7 @@ void DynamicEnvironmentMapping::addReflectionProbe(const glm::vec3& position) {
     
     // Generate texture for this probe's cubemap
     glGenTextures(1, &probe.textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, probe.textureID);
+    GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, probe.textureID);
     for (unsigned int i = 0; i < 6; ++i) {
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, 
                      GL_RGB, GL_FLOAT, nullptr);
@@ -107,11 +110,14 @@ void DynamicEnvironmentMapping::addReflectionProbe(const glm::vec3& position) {
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
     
     // Attach depth buffer to framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, probe.framebuffer);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, probe.framebuffer);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
                               GL_RENDERBUFFER, probe.depthMap);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
     
+    AABB point;
+    point.expand(position);
+    probeProxies.push_back(probeTree.insert(point, static_cast<uint32_t>(probes.size())));
     probes.push_back(probe);
 }
 
@@ -133,7 +139,7 @@ void DynamicEnvironmentMapping::renderProbe(int probeIndex,
     ReflectionProbe& probe = probes[probeIndex];
     
     // Bind the framebuffer for this probe
-    glBindFramebuffer(GL_FRAMEBUFFER, probe.framebuffer);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, probe.framebuffer);
     
     // Set the viewport to match the cubemap texture size
     glViewport(0, 0, 512, 512);
@@ -142,7 +148,7 @@ void DynamicEnvironmentMapping::renderProbe(int probeIndex,
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     // Use the shader program
-    glUseProgram(shaderProgram);
+    GLStateCache::UseProgram(shaderProgram);
     
     // Render to each face of the cubemap
     for (unsigned int i = 0; i < 6; ++i) {
@@ -161,7 +167,7 @@ void DynamicEnvironmentMapping::renderProbe(int probeIndex,
     }
     
     // Unbind the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
     
     // Mark as updated
     probe.needsUpdate = false;
@@ -175,28 +181,22 @@ unsigned int DynamicEnvironmentMapping::getProbeCubemap(int probeIndex) const {
 }
 
 int DynamicEnvironmentMapping::getClosestProbe(const glm::vec3& position) const {
-    if (probes.empty()) {
+    std::vector<BVHHit> closest;
+    probeTree.nearest(position, 1, closest);
+    if (closest.empty()) {
         return -1;
     }
-    
-    float minDistance = std::numeric_limits<float>::max();
-    int closestIndex = 0;
-    
-    for (size_t i = 0; i < probes.size(); ++i) {
-        float distance = glm::distance(position, probes[i].position);
-        if (distance < minDistance) {
-            minDistance = distance;
-            closestIndex = static_cast<int>(i);
-        }
-    }
-    
-    return closestIndex;
+    return static_cast<int>(closest[0].userData);
 }
 
 void DynamicEnvironmentMapping::updateProbePosition(int index, const glm::vec3& newPosition) {
     if (index >= 0 && index < probes.size()) {
         probes[index].position = newPosition;
         probes[index].needsUpdate = true;
+
+        AABB point;
+        point.expand(newPosition);
+        probeTree.move(probeProxies[index], point);
     }
 }
 
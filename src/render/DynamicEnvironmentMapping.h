@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <unordered_map>
+#include "../scene/BVH.h"
 
 class DynamicEnvironmentMapping {
 public:
@@ -24,6 +25,9 @@ public:
 
 private:
     std::vector<ReflectionProbe> probes;
+    // probe positions as point boxes, for closest probe lookups
+    BVH probeTree;
+    std::vector<int> probeProxies;
     std::vector<glm::mat4> shadowTransforms;
     unsigned int captureFBO;
     unsigned int captureRBO;
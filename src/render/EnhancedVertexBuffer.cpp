@@ -1,6 +1,8 @@
 #include "EnhancedVertexBuffer.h"
 #include <iostream>
 #include <cstring>
+#include "GLStateCache.h"
+#include "RenderStats.h"
 
 namespace VO {
 
@@ -15,7 +17,7 @@ EnhancedVertexBuffer::~EnhancedVertexBuffer() {
         unmapBuffer();
     }
     
-    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VAO) GLStateCache::DeleteVertexArrays(1, &VAO);
     if (VBO) glDeleteBuffers(1, &VBO);
     if (EBO) glDeleteBuffers(1, &EBO);
     
@@ -33,7 +35,7 @@ void EnhancedVertexBuffer::initializeInterleaved(const std::vector<VertexData>&
     
     // Generate and bind VAO
     glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    GLStateCache::BindVertexArray(VAO);
     
     // Generate and bind VBO
     glGenBuffers(1, &VBO);
@@ -42,6 +44,7 @@ void EnhancedVertexBuffer::initializeInterleaved(const std::vector<VertexData>&
     // Allocate and fill buffer with vertex data
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VertexData), 
                  vertices.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(vertices.size() * sizeof(VertexData));
     
     // Setup vertex attributes
     setupInterleavedAttributes();
@@ -53,7 +56,7 @@ void EnhancedVertexBuffer::initializeInterleaved(const std::vector<VertexData>&
     
     elementCount = indices.empty() ? vertices.size() : indices.size();
     
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void EnhancedVertexBuffer::initializeBatched(const std::vector<glm::vec3>& positions, 
@@ -66,7 +69,7 @@ void EnhancedVertexBuffer::initializeBatched(const std::vector<glm::vec3>& posit
     
     // Generate and bind VAO
     glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    GLStateCache::BindVertexArray(VAO);
     
     // Generate individual buffers for each attribute
     glGenBuffers(1, &positionVBO);
@@ -79,26 +82,31 @@ void EnhancedVertexBuffer::initializeBatched(const std::vector<glm::vec3>& posit
     glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
     glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), 
                  positions.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(positions.size() * sizeof(glm::vec3));
     
     // Fill normal buffer
     glBindBuffer(GL_ARRAY_BUFFER, normalVBO);
     glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), 
                  normals.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(normals.size() * sizeof(glm::vec3));
     
     // Fill texture coordinate buffer
     glBindBuffer(GL_ARRAY_BUFFER, texCoordVBO);
     glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), 
                  texCoords.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(texCoords.size() * sizeof(glm::vec2));
     
     // Fill tangent buffer
     glBindBuffer(GL_ARRAY_BUFFER, tangentVBO);
     glBufferData(GL_ARRAY_BUFFER, tangents.size() * sizeof(glm::vec3), 
                  tangents.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(tangents.size() * sizeof(glm::vec3));
     
     // Fill bitangent buffer
     glBindBuffer(GL_ARRAY_BUFFER, bitangentVBO);
     glBufferData(GL_ARRAY_BUFFER, bitangents.size() * sizeof(glm::vec3), 
                  bitangents.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(bitangents.size() * sizeof(glm::vec3));
     
     // Setup vertex attributes for batched layout
     setupBatchedAttributes();
@@ -110,7 +118,7 @@ void EnhancedVertexBuffer::initializeBatched(const std::vector<glm::vec3>& posit
     
     elementCount = indices.empty() ? positions.size() : indices.size();
     
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void EnhancedVertexBuffer::initializeDynamic(size_t maxVertices) {
@@ -118,7 +126,7 @@ void EnhancedVertexBuffer::initializeDynamic(size_t maxVertices) {
     
     // Generate and bind VAO
     glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    GLStateCache::BindVertexArray(VAO);
     
     // Generate and bind VBO with dynamic storage
     glGenBuffers(1, &VBO);
@@ -131,7 +139,7 @@ void EnhancedVertexBuffer::initializeDynamic(size_t maxVertices) {
     // Setup vertex attributes
     setupInterleavedAttributes();
     
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void EnhancedVertexBuffer::setupInterleavedAttributes() {
@@ -196,6 +204,7 @@ void EnhancedVertexBuffer::setupElementBuffer(const std::vector<unsigned int>& i
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), 
                  indices.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(indices.size() * sizeof(unsigned int));
 }
 
 void EnhancedVertexBuffer::updateInterleavedSubData(size_t offset, size_t count, const VertexData* data) {
@@ -207,6 +216,7 @@ void EnhancedVertexBuffer::updateInterleavedSubData(size_t offset, size_t count,
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(VertexData), 
                     count * sizeof(VertexData), data);
+    RenderStats::RecordUpload(count * sizeof(VertexData));
 }
 
 void EnhancedVertexBuffer::updateBatchedSubData(const std::vector<glm::vec3>* positions,
@@ -224,6 +234,7 @@ void EnhancedVertexBuffer::updateBatchedSubData(const std::vector<glm::vec3>* po
         glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, positions->size() * sizeof(glm::vec3), 
                        positions->data());
+        RenderStats::RecordUpload(positions->size() * sizeof(glm::vec3));
     }
     
     // Update normal buffer if provided
@@ -231,6 +242,7 @@ void EnhancedVertexBuffer::updateBatchedSubData(const std::vector<glm::vec3>* po
         glBindBuffer(GL_ARRAY_BUFFER, normalVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, normals->size() * sizeof(glm::vec3), 
                        normals->data());
+        RenderStats::RecordUpload(normals->size() * sizeof(glm::vec3));
     }
     
     // Update texture coordinate buffer if provided
@@ -238,6 +250,7 @@ void EnhancedVertexBuffer::updateBatchedSubData(const std::vector<glm::vec3>* po
         glBindBuffer(GL_ARRAY_BUFFER, texCoordVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, texCoords->size() * sizeof(glm::vec2), 
                        texCoords->data());
+        RenderStats::RecordUpload(texCoords->size() * sizeof(glm::vec2));
     }
     
     // Update tangent buffer if provided
@@ -245,6 +258,7 @@ void EnhancedVertexBuffer::updateBatchedSubData(const std::vector<glm::vec3>* po
         glBindBuffer(GL_ARRAY_BUFFER, tangentVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, tangents->size() * sizeof(glm::vec3), 
                        tangents->data());
+        RenderStats::RecordUpload(tangents->size() * sizeof(glm::vec3));
     }
     
     // Update bitangent buffer if provided
@@ -252,6 +266,7 @@ void EnhancedVertexBuffer::updateBatchedSubData(const std::vector<glm::vec3>* po
         glBindBuffer(GL_ARRAY_BUFFER, bitangentVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, bitangents->size() * sizeof(glm::vec3), 
                        bitangents->data());
+        RenderStats::RecordUpload(bitangents->size() * sizeof(glm::vec3));
     }
 }
 
@@ -308,31 +323,35 @@ void EnhancedVertexBuffer::copyFrom(const EnhancedVertexBuffer& source,
 }
 
 void EnhancedVertexBuffer::bind() const {
-    glBindVertexArray(VAO);
+    GLStateCache::BindVertexArray(VAO);
 }
 
 void EnhancedVertexBuffer::unbind() const {
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void EnhancedVertexBuffer::draw() const {
-    glBindVertexArray(VAO);
+    GLStateCache::BindVertexArray(VAO);
     if (EBO) {
         glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0);
+        RenderStats::RecordDraw(GL_TRIANGLES, elementCount);
     } else {
         glDrawArrays(GL_TRIANGLES, 0, elementCount);
+        RenderStats::RecordDraw(GL_TRIANGLES, elementCount);
     }
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void EnhancedVertexBuffer::drawInstanced(unsigned int instanceCount) const {
-    glBindVertexArray(VAO);
+    GLStateCache::BindVertexArray(VAO);
     if (EBO) {
         glDrawElementsInstanced(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0, instanceCount);
+        RenderStats::RecordDraw(GL_TRIANGLES, elementCount, instanceCount);
     } else {
         glDrawArraysInstanced(GL_TRIANGLES, 0, elementCount, instanceCount);
+        RenderStats::RecordDraw(GL_TRIANGLES, elementCount, instanceCount);
     }
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void EnhancedVertexBuffer::generateTangentsBitangents(std::vector<VertexData>& vertices, 
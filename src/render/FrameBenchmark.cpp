@@ -0,0 +1,156 @@
+#include "FrameBenchmark.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+FrameTimeSummary FrameTimeSummary::of(std::vector<double> values)
+{
+    FrameTimeSummary summary;
+    if (values.empty())
+        return summary;
+
+    std::sort(values.begin(), values.end());
+    // nearest rank percentile
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+        return values[std::min(rank, values.size() - 1)];
+    };
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+
+    summary.min = values.front();
+    summary.max = values.back();
+    summary.mean = sum / values.size();
+    summary.median = percentile(0.5);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    return summary;
+}
+
+FrameBenchmark::FrameBenchmark(int warmupFrames) : warmupFrames(warmupFrames)
+{
+    glGenQueries(QUERY_RING, queries);
+    runStart = std::chrono::steady_clock::now();
+}
+
+FrameBenchmark::~FrameBenchmark()
+{
+    glDeleteQueries(QUERY_RING, queries);
+}
+
+void FrameBenchmark::beginFrame()
+{
+    // The ring slot of this frame must have been read back first
+    if (frames.size() - nextToResolve >= QUERY_RING)
+        resolve(true);
+
+    frameStart = std::chrono::steady_clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, queries[frames.size() % QUERY_RING]);
+}
+
+void FrameBenchmark::endFrame()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    FrameSample sample;
+    sample.cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    frames.push_back(sample);
+
+    resolve(false);
+}
+
+void FrameBenchmark::finish()
+{
+    while (nextToResolve < frames.size())
+        resolve(true);
+    wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+}
+
+void FrameBenchmark::resolve(bool wait)
+{
+    // in order, so at most the oldest outstanding frame is waited for
+    while (nextToResolve < frames.size()) {
+        GLuint query = queries[nextToResolve % QUERY_RING];
+        if (!wait) {
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+        FrameSample& sample = frames[nextToResolve];
+        sample.gpuMs = elapsed / 1.0e6;
+        std::printf("frame %zu: cpu %.3f ms, gpu %.3f ms%s\n", nextToResolve, sample.cpuMs, sample.gpuMs,
+                    static_cast<int>(nextToResolve) < warmupFrames ? " (warm-up)" : "");
+        nextToResolve++;
+        wait = false;
+    }
+}
+
+static std::string jsonString(const std::string& text)
+{
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void writeSummary(std::ostringstream& out, const char* name, const FrameTimeSummary& s)
+{
+    out << "  \"" << name << "\": {\"min\": " << s.min << ", \"mean\": " << s.mean
+        << ", \"median\": " << s.median << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99
+        << ", \"max\": " << s.max << "}";
+}
+
+std::vector<double> FrameBenchmark::measured(bool gpu) const
+{
+    std::vector<double> values;
+    for (size_t i = std::min(frames.size(), static_cast<size_t>(warmupFrames)); i < frames.size(); i++) {
+        if (!gpu)
+            values.push_back(frames[i].cpuMs);
+        else if (frames[i].gpuMs >= 0.0)
+            values.push_back(frames[i].gpuMs);
+    }
+    return values;
+}
+
+FrameTimeSummary FrameBenchmark::cpuSummary() const
+{
+    return FrameTimeSummary::of(measured(false));
+}
+
+FrameTimeSummary FrameBenchmark::gpuSummary() const
+{
+    return FrameTimeSummary::of(measured(true));
+}
+
+std::string FrameBenchmark::summaryJson(const std::string& scene, const std::string& renderPath,
+                                        const std::string& backend, const std::string& renderer, int width,
+                                        int height) const
+{
+    size_t measuredFrames = measured(false).size();
+
+    std::ostringstream out;
+    out << "{\n"
+        << "  \"scene\": " << jsonString(scene) << ",\n"
+        << "  \"renderPath\": " << jsonString(renderPath) << ",\n"
+        << "  \"backend\": " << jsonString(backend) << ",\n"
+        << "  \"renderer\": " << jsonString(renderer) << ",\n"
+        << "  \"width\": " << width << ",\n"
+        << "  \"height\": " << height << ",\n"
+        << "  \"frames\": " << measuredFrames << ",\n"
+        << "  \"warmupFrames\": " << frames.size() - measuredFrames << ",\n"
+        << "  \"wallSeconds\": " << wallSeconds << ",\n"
+        << "  \"fps\": " << (wallSeconds > 0.0 ? frames.size() / wallSeconds : 0.0) << ",\n";
+    writeSummary(out, "cpuMs", cpuSummary());
+    out << ",\n";
+    writeSummary(out, "gpuMs", gpuSummary());
+    out << "\n}";
+    return out.str();
+}
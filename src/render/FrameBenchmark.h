@@ -0,0 +1,60 @@
+#ifndef FRAME_BENCHMARK_H
+#define FRAME_BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// CPU and GPU time of one frame; gpuMs is negative when the GPU time is unknown
+struct FrameSample {
+    double cpuMs = 0.0;
+    double gpuMs = -1.0;
+};
+
+// min / mean / percentiles of one column of samples, in milliseconds
+struct FrameTimeSummary {
+    double min = 0.0, mean = 0.0, median = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+
+    static FrameTimeSummary of(std::vector<double> values);
+};
+
+// Times frames on the CPU (wall clock around the frame's submission) and on
+// the GPU (GL_TIME_ELAPSED queries). Queries are kept in a small ring and read
+// a few frames late so that reading them never stalls the pipeline.
+// Frames are printed as their GPU time becomes available.
+class FrameBenchmark {
+public:
+    explicit FrameBenchmark(int warmupFrames = 5);
+    ~FrameBenchmark();
+
+    void beginFrame();
+    void endFrame();
+    // waits for the outstanding queries; call before summaryJson()
+    void finish();
+
+    const std::vector<FrameSample>& samples() const { return frames; }
+    // statistics over the frames after the warm-up
+    FrameTimeSummary cpuSummary() const;
+    FrameTimeSummary gpuSummary() const;
+    // the same, as one JSON object
+    std::string summaryJson(const std::string& scene, const std::string& renderPath, const std::string& backend,
+                            const std::string& renderer, int width, int height) const;
+
+private:
+    static const int QUERY_RING = 4;
+
+    // cpu or gpu milliseconds of the frames after the warm-up
+    std::vector<double> measured(bool gpu) const;
+
+    void resolve(bool wait);
+
+    int warmupFrames;
+    std::vector<FrameSample> frames;
+    unsigned int queries[QUERY_RING] = {0};
+    size_t nextToResolve = 0;          // first frame whose GPU time is not read yet
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point runStart;
+    double wallSeconds = 0.0;
+};
+
+#endif // FRAME_BENCHMARK_H
@@ -11,6 +11,7 @@
 #include "stb_image_write.h"
 #include <ctime>
 #include <chrono>
+#include "GLStateCache.h"
 class Framebuffer {
 private:
     GLuint m_fbo = 0;
@@ -59,7 +60,7 @@ public:
         
         // Generate framebuffer
         glGenFramebuffers(1, &m_fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_fbo);
         glCheckError(__FILE__, __LINE__);
         
         // Create color texture attachment
@@ -82,7 +83,7 @@ public:
         }
         
         // Unbind framebuffer
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
         return true;
     }
     
@@ -90,7 +91,7 @@ public:
      * @brief Bind this framebuffer for rendering
      */
     void bind() const {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_fbo);
         glViewport(0, 0, m_width, m_height);
         glCheckError(__FILE__, __LINE__);
     }
@@ -99,7 +100,7 @@ public:
      * @brief Unbind framebuffer (bind default framebuffer)
      */
     void unbind() const {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
         glCheckError(__FILE__, __LINE__);
     }
     /**
@@ -115,7 +116,7 @@ public:
         }
         
         // Bind this framebuffer to read from it
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
         
         // Allocate buffer for pixel data
         std::unique_ptr<unsigned char[]> pixels(new unsigned char[m_width * m_height * 3]);
@@ -147,7 +148,7 @@ public:
         }
         
         // Restore default framebuffer
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
         
         if (success) {
             std::cout << "Screenshot saved: " << filename << " (" << m_width << "x" << m_height << ")" << std::endl;
@@ -165,9 +166,9 @@ public:
      * @param type GL_UNSIGNED_BYTE, GL_FLOAT, etc.
      */
     void getPixelData(void* outPixels, GLenum format = GL_RGB, GLenum type = GL_UNSIGNED_BYTE) const {
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
         glReadPixels(0, 0, m_width, m_height, format, type, outPixels);
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
         glCheckError(__FILE__, __LINE__);
     }
 
@@ -175,8 +176,8 @@ public:
      * @brief Bind the color texture for sampling
      */
     void bindColorTexture(int textureUnit = 0) const {
-        glActiveTexture(GL_TEXTURE0 + textureUnit);
-        glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+        GLStateCache::ActiveTexture(GL_TEXTURE0 + textureUnit);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, m_colorTexture);
         glCheckError(__FILE__, __LINE__);
     }
     
@@ -232,7 +233,7 @@ public:
     private:
     void cleanup() {
         if (m_colorTexture) {
-            glDeleteTextures(1, &m_colorTexture);
+            GLStateCache::DeleteTextures(1, &m_colorTexture);
             m_colorTexture = 0;
         }
         if (m_depthStencilRBO) {
@@ -240,7 +241,7 @@ public:
             m_depthStencilRBO = 0;
         }
         if (m_fbo) {
-            glDeleteFramebuffers(1, &m_fbo);
+            GLStateCache::DeleteFramebuffers(1, &m_fbo);
             m_fbo = 0;
         }
         glCheckError(__FILE__, __LINE__);
@@ -248,7 +249,7 @@ public:
     
     bool createColorTexture() {
         glGenTextures(1, &m_colorTexture);
-        glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, m_colorTexture);
         
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_width, m_height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -256,7 +257,7 @@ public:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
         
         // Attach to framebuffer
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
@@ -279,13 +280,15 @@ public:
     }
 };
 
-// Multi-target framebuffer for advanced effects
+// Multi-target framebuffer for advanced effects. Depth and stencil live in a
+// GL_DEPTH24_STENCIL8 texture, so later passes can sample the depth (e.g. to
+// reconstruct positions in a deferred lighting pass).
 class MultitargetFramebuffer {
 private:
     GLuint m_fbo = 0;
     std::vector<GLuint> m_colorTextures;
-    GLuint m_depthStencilRBO = 0;
-    int m_width, m_height;
+    GLuint m_depthStencilTexture = 0;
+    int m_width = 0, m_height = 0;
     
 public:
     MultitargetFramebuffer() = default;
@@ -298,21 +301,31 @@ public:
     MultitargetFramebuffer& operator=(MultitargetFramebuffer&&) = default;
     
     bool create(int width, int height, int colorAttachments = 1) {
+        return create(width, height, std::vector<GLenum>(colorAttachments, GL_RGBA16F));
+    }
+
+    /**
+     * @brief Create one colour attachment per internal format (e.g. GL_RGBA8, GL_RGBA16F)
+     */
+    bool create(int width, int height, const std::vector<GLenum>& formats) {
         cleanup();
         
         m_width = width;
         m_height = height;
-        m_colorTextures.resize(colorAttachments);
+        m_colorTextures.resize(formats.size());
         
         glGenFramebuffers(1, &m_fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_fbo);
         
         // Create color attachments
         std::vector<GLenum> drawBuffers;
-        for (int i = 0; i < colorAttachments; ++i) {
+        for (size_t i = 0; i < formats.size(); ++i) {
+            const bool floating = formats[i] == GL_RGBA16F || formats[i] == GL_RGBA32F || formats[i] == GL_RG16F ||
+                                  formats[i] == GL_RGB16F || formats[i] == GL_R11F_G11F_B10F;
             glGenTextures(1, &m_colorTextures[i]);
-            glBindTexture(GL_TEXTURE_2D, m_colorTextures[i]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+            GLStateCache::BindTexture(GL_TEXTURE_2D, m_colorTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, formats[i], width, height, 0, GL_RGBA,
+                         floating ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -324,29 +337,59 @@ public:
         
         glDrawBuffers(drawBuffers.size(), drawBuffers.data());
         
-        // Depth/stencil
-        glGenRenderbuffers(1, &m_depthStencilRBO);
-        glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencilRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencilRBO);
+        // Depth/stencil, as a texture so that it can be sampled
+        glGenTextures(1, &m_depthStencilTexture);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, m_depthStencilTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL,
+                     GL_UNSIGNED_INT_24_8, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthStencilTexture, 0);
         
         bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete) {
+            std::cerr << "ERROR::FRAMEBUFFER: Multitarget framebuffer is not complete!" << std::endl;
+        }
         
         return complete;
     }
     
     void bind() const {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_fbo);
         glViewport(0, 0, m_width, m_height);
     }
     
     void bindColorTexture(int attachment, int textureUnit) const {
         if (attachment >= 0 && static_cast<size_t>(attachment) < m_colorTextures.size()) {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, m_colorTextures[attachment]);
+            GLStateCache::ActiveTexture(GL_TEXTURE0 + textureUnit);
+            GLStateCache::BindTexture(GL_TEXTURE_2D, m_colorTextures[attachment]);
         }
     }
+
+    void bindDepthTexture(int textureUnit) const {
+        GLStateCache::ActiveTexture(GL_TEXTURE0 + textureUnit);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, m_depthStencilTexture);
+    }
+
+    /**
+     * @brief Copy depth and stencil into another framebuffer of the same size and
+     * GL_DEPTH24_STENCIL8 format, so forward passes can draw on top of this one
+     */
+    void blitDepthStencilTo(GLuint targetFbo) const {
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo);
+        glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height,
+                          GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, targetFbo);
+    }
+
+    GLuint getFBO() const { return m_fbo; }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
     
 
     /**
@@ -359,7 +402,7 @@ public:
         }
         
         // Set read buffer to specific attachment
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
         glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
         
         // Allocate buffer for pixel data
@@ -392,7 +435,7 @@ public:
         }
         
         // Restore default framebuffer
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
         
         if (success) {
             std::cout << "Screenshot saved: " << filename << " (" << m_width << "x" << m_height << ")" << std::endl;
@@ -405,14 +448,14 @@ public:
 private:
     void cleanup() {
         for (auto tex : m_colorTextures) {
-            if (tex) glDeleteTextures(1, &tex);
+            if (tex) GLStateCache::DeleteTextures(1, &tex);
         }
         m_colorTextures.clear();
         
-        if (m_depthStencilRBO) glDeleteRenderbuffers(1, &m_depthStencilRBO);
-        if (m_fbo) glDeleteFramebuffers(1, &m_fbo);
+        if (m_depthStencilTexture) GLStateCache::DeleteTextures(1, &m_depthStencilTexture);
+        if (m_fbo) GLStateCache::DeleteFramebuffers(1, &m_fbo);
         
-        m_fbo = m_depthStencilRBO = 0;
+        m_fbo = m_depthStencilTexture = 0;
     }
 };
 
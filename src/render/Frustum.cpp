@@ -0,0 +1,129 @@
+#include "Frustum.h"
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE 1
+#endif
+
+AABB AABB::transformed(const glm::mat4& matrix) const
+{
+    if (!valid())
+        return *this;
+
+    // Start from the translation and add the min/max contribution of every axis
+    AABB result;
+    result.min = result.max = glm::vec3(matrix[3]);
+    for (int column = 0; column < 3; column++) {
+        for (int row = 0; row < 3; row++) {
+            float a = matrix[column][row] * min[column];
+            float b = matrix[column][row] * max[column];
+            result.min[row] += a < b ? a : b;
+            result.max[row] += a < b ? b : a;
+        }
+    }
+    return result;
+}
+
+BoundingSphere BoundingSphere::fromAABB(const AABB& box)
+{
+    BoundingSphere sphere;
+    if (box.valid()) {
+        sphere.center = box.center();
+        sphere.radius = glm::length(box.extents());
+    }
+    return sphere;
+}
+
+Frustum::Frustum()
+{
+    // Padding planes (and an unextracted frustum) accept everything
+    for (int i = 0; i < PLANE_COUNT; i++) {
+        nx[i] = ny[i] = nz[i] = 0.0f;
+        d[i] = 1.0f;
+    }
+}
+
+void Frustum::extract(const glm::mat4& m)
+{
+    // Gribb/Hartmann: rows of the matrix combined with the w row.
+    // glm is column-major, so row r is (m[0][r], m[1][r], m[2][r], m[3][r]).
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    const glm::vec4 planes[6] = {
+        row3 + row0, // left
+        row3 - row0, // right
+        row3 + row1, // bottom
+        row3 - row1, // top
+        row3 + row2, // near
+        row3 - row2  // far
+    };
+
+    for (int i = 0; i < 6; i++) {
+        float length = glm::length(glm::vec3(planes[i]));
+        float inv = length > 0.0f ? 1.0f / length : 0.0f;
+        nx[i] = planes[i].x * inv;
+        ny[i] = planes[i].y * inv;
+        nz[i] = planes[i].z * inv;
+        d[i] = planes[i].w * inv;
+    }
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+    if (!box.valid())
+        return true;
+
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extents();
+
+#ifdef FRUSTUM_USE_SSE
+    // outside if n.c + d < -|n|.e for any plane
+    const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+    const __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (int i = 0; i < PLANE_COUNT; i += 4) {
+        __m128 px = _mm_load_ps(nx + i), py = _mm_load_ps(ny + i), pz = _mm_load_ps(nz + i);
+        __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)),
+                                 _mm_add_ps(_mm_mul_ps(pz, cz), _mm_load_ps(d + i)));
+        __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, px), ex),
+                                              _mm_mul_ps(_mm_andnot_ps(signMask, py), ey)),
+                                   _mm_mul_ps(_mm_andnot_ps(signMask, pz), ez));
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps())))
+            return false;
+    }
+    return true;
+#else
+    for (int i = 0; i < 6; i++) {
+        float dist = nx[i] * c.x + ny[i] * c.y + nz[i] * c.z + d[i];
+        float radius = std::fabs(nx[i]) * e.x + std::fabs(ny[i]) * e.y + std::fabs(nz[i]) * e.z;
+        if (dist + radius < 0.0f)
+            return false;
+    }
+    return true;
+#endif
+}
+
+bool Frustum::intersects(const glm::vec3& center, float radius) const
+{
+#ifdef FRUSTUM_USE_SSE
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    const __m128 r = _mm_set1_ps(radius);
+    for (int i = 0; i < PLANE_COUNT; i += 4) {
+        __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(nx + i), cx), _mm_mul_ps(_mm_load_ps(ny + i), cy)),
+                                 _mm_add_ps(_mm_mul_ps(_mm_load_ps(nz + i), cz), _mm_load_ps(d + i)));
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, r), _mm_setzero_ps())))
+            return false;
+    }
+    return true;
+#else
+    for (int i = 0; i < 6; i++) {
+        if (nx[i] * center.x + ny[i] * center.y + nz[i] * center.z + d[i] < -radius)
+            return false;
+    }
+    return true;
+#endif
+}
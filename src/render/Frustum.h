@@ -0,0 +1,61 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <limits>
+
+// Axis aligned box; starts out empty (min > max) and grows with expand()
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    void expand(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+    void expand(const AABB& box) { if (box.valid()) { expand(box.min); expand(box.max); } }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    // box enclosing this one after the affine transform (Arvo's method)
+    AABB transformed(const glm::mat4& matrix) const;
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // smallest sphere around the box centre that contains the box
+    static BoundingSphere fromAABB(const AABB& box);
+};
+
+// Objects tested against the frustum in the last pass
+struct CullingStats {
+    unsigned int visible = 0;
+    unsigned int culled = 0;
+
+    void reset() { visible = culled = 0; }
+};
+
+// View frustum as six inward facing planes, extracted from a view-projection
+// matrix. Planes are stored as structure-of-arrays (padded to eight) so that
+// the box and sphere tests evaluate four planes per SSE instruction.
+class Frustum {
+public:
+    Frustum();
+
+    void extract(const glm::mat4& viewProjection);
+
+    // false if the volume is completely outside at least one plane
+    bool intersects(const AABB& worldBox) const;
+    bool intersects(const glm::vec3& center, float radius) const;
+    bool intersects(const BoundingSphere& sphere) const { return intersects(sphere.center, sphere.radius); }
+
+private:
+    static const int PLANE_COUNT = 8; // six planes + two that always pass
+
+    alignas(16) float nx[PLANE_COUNT];
+    alignas(16) float ny[PLANE_COUNT];
+    alignas(16) float nz[PLANE_COUNT];
+    alignas(16) float d[PLANE_COUNT];
+};
+
+#endif // FRUSTUM_H
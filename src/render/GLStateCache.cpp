@@ -0,0 +1,335 @@
+#include "GLStateCache.h"
+
+namespace {
+    const GLuint UNKNOWN = ~0u;
+
+    const GLenum cachedCapabilities[] = {
+        GL_BLEND, GL_DEPTH_TEST, GL_STENCIL_TEST, GL_CULL_FACE,
+        GL_SCISSOR_TEST, GL_FRAMEBUFFER_SRGB, GL_PROGRAM_POINT_SIZE, GL_MULTISAMPLE
+    };
+
+    const GLenum cachedTextureTargets[] = {
+        GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY
+    };
+}
+
+bool GLStateCache::headless = false;
+GLStateCounters GLStateCache::counters;
+std::vector<GLRecordedCall> GLStateCache::recorded;
+
+GLuint GLStateCache::program = UNKNOWN;
+GLuint GLStateCache::vertexArray = UNKNOWN;
+GLuint GLStateCache::activeUnit = UNKNOWN;
+GLuint GLStateCache::textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+int8_t GLStateCache::capabilities[CAPABILITY_COUNT];
+int8_t GLStateCache::depthWrite = -1;
+GLenum GLStateCache::depthFunc = UNKNOWN;
+GLenum GLStateCache::blendSrc = UNKNOWN;
+GLenum GLStateCache::blendDst = UNKNOWN;
+GLenum GLStateCache::stencilFunc = UNKNOWN;
+GLint GLStateCache::stencilRef = 0;
+GLuint GLStateCache::stencilFuncMask = 0;
+GLenum GLStateCache::stencilFail = UNKNOWN;
+GLenum GLStateCache::stencilDepthFail = UNKNOWN;
+GLenum GLStateCache::stencilPass = UNKNOWN;
+GLuint GLStateCache::stencilWriteMask = UNKNOWN;
+GLenum GLStateCache::cullFace = UNKNOWN;
+GLuint GLStateCache::drawFramebuffer = UNKNOWN;
+GLuint GLStateCache::readFramebuffer = UNKNOWN;
+
+// the arrays above start out unknown as well
+static const bool stateInvalidatedAtStartup = (GLStateCache::Invalidate(), true);
+
+unsigned long GLStateCounters::total() const
+{
+    unsigned long sum = 0;
+    for (unsigned long n : issued)
+        sum += n;
+    return sum;
+}
+
+int GLStateCache::capabilityIndex(GLenum capability)
+{
+    for (int i = 0; i < CAPABILITY_COUNT; i++)
+        if (cachedCapabilities[i] == capability)
+            return i;
+    return -1;
+}
+
+int GLStateCache::textureTargetIndex(GLenum target)
+{
+    for (int i = 0; i < TEXTURE_TARGET_COUNT; i++)
+        if (cachedTextureTargets[i] == target)
+            return i;
+    return -1;
+}
+
+bool GLStateCache::issue(GLStateCall call, GLuint a, GLuint b, GLuint c)
+{
+    counters.issued[static_cast<size_t>(call)]++;
+    if (headless) {
+        recorded.push_back({call, {a, b, c}});
+        return false;
+    }
+    return true;
+}
+
+bool GLStateCache::UseProgram(GLuint id)
+{
+    if (program == id) { counters.skipped++; return false; }
+    program = id;
+    if (issue(GLStateCall::UseProgram, id))
+        glUseProgram(id);
+    return true;
+}
+
+void GLStateCache::BindVertexArray(GLuint vao)
+{
+    if (vertexArray == vao) { counters.skipped++; return; }
+    vertexArray = vao;
+    if (issue(GLStateCall::BindVertexArray, vao))
+        glBindVertexArray(vao);
+}
+
+void GLStateCache::ActiveTexture(GLenum unit)
+{
+    GLuint index = unit - GL_TEXTURE0;
+    if (activeUnit == index) { counters.skipped++; return; }
+    activeUnit = index;
+    if (issue(GLStateCall::ActiveTexture, unit))
+        glActiveTexture(unit);
+}
+
+void GLStateCache::BindTexture(GLenum target, GLuint texture)
+{
+    int slot = textureTargetIndex(target);
+    if (slot >= 0 && activeUnit < MAX_TEXTURE_UNITS) {
+        GLuint& bound = textures[activeUnit][slot];
+        if (bound == texture) { counters.skipped++; return; }
+        bound = texture;
+    }
+    if (issue(GLStateCall::BindTexture, target, texture))
+        glBindTexture(target, texture);
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    int slot = textureTargetIndex(target);
+    if (slot >= 0 && unit < MAX_TEXTURE_UNITS && textures[unit][slot] == texture) {
+        counters.skipped++;
+        return;
+    }
+    ActiveTexture(GL_TEXTURE0 + unit);
+    BindTexture(target, texture);
+}
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled)
+{
+    int slot = capabilityIndex(capability);
+    if (slot >= 0) {
+        if (capabilities[slot] == (enabled ? 1 : 0)) { counters.skipped++; return; }
+        capabilities[slot] = enabled ? 1 : 0;
+    }
+    if (enabled) {
+        if (issue(GLStateCall::Enable, capability))
+            glEnable(capability);
+    } else {
+        if (issue(GLStateCall::Disable, capability))
+            glDisable(capability);
+    }
+}
+
+void GLStateCache::Enable(GLenum capability)
+{
+    SetEnabled(capability, true);
+}
+
+void GLStateCache::Disable(GLenum capability)
+{
+    SetEnabled(capability, false);
+}
+
+bool GLStateCache::IsEnabled(GLenum capability)
+{
+    int slot = capabilityIndex(capability);
+    if (slot >= 0 && capabilities[slot] != -1)
+        return capabilities[slot] == 1;
+    if (headless)
+        return false;
+    bool enabled = glIsEnabled(capability) == GL_TRUE;
+    if (slot >= 0)
+        capabilities[slot] = enabled ? 1 : 0;
+    return enabled;
+}
+
+void GLStateCache::DepthMask(GLboolean flag)
+{
+    int8_t value = flag ? 1 : 0;
+    if (depthWrite == value) { counters.skipped++; return; }
+    depthWrite = value;
+    if (issue(GLStateCall::DepthMask, flag))
+        glDepthMask(flag);
+}
+
+void GLStateCache::DepthFunc(GLenum func)
+{
+    if (depthFunc == func) { counters.skipped++; return; }
+    depthFunc = func;
+    if (issue(GLStateCall::DepthFunc, func))
+        glDepthFunc(func);
+}
+
+GLenum GLStateCache::GetDepthFunc()
+{
+    if (depthFunc == UNKNOWN) {
+        if (headless)
+            return GL_LESS;
+        GLint func = GL_LESS;
+        glGetIntegerv(GL_DEPTH_FUNC, &func);
+        depthFunc = static_cast<GLenum>(func);
+    }
+    return depthFunc;
+}
+
+void GLStateCache::BlendFunc(GLenum src, GLenum dst)
+{
+    if (blendSrc == src && blendDst == dst) { counters.skipped++; return; }
+    blendSrc = src;
+    blendDst = dst;
+    if (issue(GLStateCall::BlendFunc, src, dst))
+        glBlendFunc(src, dst);
+}
+
+void GLStateCache::StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+    if (stencilFunc == func && stencilRef == ref && stencilFuncMask == mask) { counters.skipped++; return; }
+    stencilFunc = func;
+    stencilRef = ref;
+    stencilFuncMask = mask;
+    if (issue(GLStateCall::StencilFunc, func, static_cast<GLuint>(ref), mask))
+        glStencilFunc(func, ref, mask);
+}
+
+void GLStateCache::StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+    if (stencilFail == sfail && stencilDepthFail == dpfail && stencilPass == dppass) { counters.skipped++; return; }
+    stencilFail = sfail;
+    stencilDepthFail = dpfail;
+    stencilPass = dppass;
+    if (issue(GLStateCall::StencilOp, sfail, dpfail, dppass))
+        glStencilOp(sfail, dpfail, dppass);
+}
+
+void GLStateCache::StencilMask(GLuint mask)
+{
+    if (stencilWriteMask == mask) { counters.skipped++; return; }
+    stencilWriteMask = mask;
+    if (issue(GLStateCall::StencilMask, mask))
+        glStencilMask(mask);
+}
+
+void GLStateCache::CullFace(GLenum mode)
+{
+    if (cullFace == mode) { counters.skipped++; return; }
+    cullFace = mode;
+    if (issue(GLStateCall::CullFace, mode))
+        glCullFace(mode);
+}
+
+void GLStateCache::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if ((!draw || drawFramebuffer == framebuffer) && (!read || readFramebuffer == framebuffer)) {
+        counters.skipped++;
+        return;
+    }
+    if (draw) drawFramebuffer = framebuffer;
+    if (read) readFramebuffer = framebuffer;
+    if (issue(GLStateCall::BindFramebuffer, target, framebuffer))
+        glBindFramebuffer(target, framebuffer);
+}
+
+GLuint GLStateCache::GetDrawFramebuffer()
+{
+    if (drawFramebuffer == UNKNOWN) {
+        if (headless)
+            return 0;
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        drawFramebuffer = static_cast<GLuint>(framebuffer);
+    }
+    return drawFramebuffer;
+}
+
+void GLStateCache::DeleteTextures(GLsizei count, const GLuint* ids)
+{
+    for (GLsizei i = 0; i < count; i++) {
+        if (ids[i] == 0)
+            continue;
+        // GL rebinds 0 wherever a deleted texture was bound
+        for (auto& unit : textures)
+            for (GLuint& bound : unit)
+                if (bound == ids[i])
+                    bound = 0;
+    }
+    if (!headless)
+        glDeleteTextures(count, ids);
+}
+
+void GLStateCache::DeleteVertexArrays(GLsizei count, const GLuint* arrays)
+{
+    for (GLsizei i = 0; i < count; i++)
+        if (arrays[i] != 0 && vertexArray == arrays[i])
+            vertexArray = 0;
+    if (!headless)
+        glDeleteVertexArrays(count, arrays);
+}
+
+void GLStateCache::DeleteFramebuffers(GLsizei count, const GLuint* framebuffers)
+{
+    for (GLsizei i = 0; i < count; i++) {
+        if (framebuffers[i] == 0)
+            continue;
+        if (drawFramebuffer == framebuffers[i]) drawFramebuffer = 0;
+        if (readFramebuffer == framebuffers[i]) readFramebuffer = 0;
+    }
+    if (!headless)
+        glDeleteFramebuffers(count, framebuffers);
+}
+
+void GLStateCache::DeleteProgram(GLuint id)
+{
+    // a program in use is only flagged for deletion, but its name may be reused later
+    if (program == id)
+        program = UNKNOWN;
+    if (!headless)
+        glDeleteProgram(id);
+}
+
+void GLStateCache::Invalidate()
+{
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    activeUnit = UNKNOWN;
+    for (auto& unit : textures)
+        for (GLuint& bound : unit)
+            bound = UNKNOWN;
+    for (int8_t& capability : capabilities)
+        capability = -1;
+    depthWrite = -1;
+    depthFunc = UNKNOWN;
+    blendSrc = blendDst = UNKNOWN;
+    stencilFunc = UNKNOWN;
+    stencilFail = stencilDepthFail = stencilPass = UNKNOWN;
+    stencilWriteMask = UNKNOWN;
+    cullFace = UNKNOWN;
+    drawFramebuffer = readFramebuffer = UNKNOWN;
+}
+
+void GLStateCache::SetHeadless(bool enabled)
+{
+    headless = enabled;
+    recorded.clear();
+    Invalidate();
+}
@@ -0,0 +1,126 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glad/glad.h>
+
+// Calls that GLStateCache forwards to the driver (or records when headless)
+enum class GLStateCall : uint8_t {
+    UseProgram,
+    BindVertexArray,
+    ActiveTexture,
+    BindTexture,
+    Enable,
+    Disable,
+    DepthMask,
+    DepthFunc,
+    BlendFunc,
+    StencilFunc,
+    StencilOp,
+    StencilMask,
+    CullFace,
+    BindFramebuffer,
+    Count
+};
+
+// One forwarded call with its arguments, only kept in headless mode
+struct GLRecordedCall {
+    GLStateCall call;
+    GLuint args[3];
+};
+
+// Issued vs skipped calls since the last ResetCounters()
+struct GLStateCounters {
+    unsigned long issued[static_cast<size_t>(GLStateCall::Count)] = {0};
+    unsigned long skipped = 0;
+
+    unsigned long count(GLStateCall call) const { return issued[static_cast<size_t>(call)]; }
+    unsigned long total() const;
+    void reset() { *this = GLStateCounters(); }
+};
+
+// Shadows the bound program, VAO, per-unit textures, framebuffers and the
+// blend/depth/stencil/cull state so that redundant driver calls are skipped.
+// Engine code binds through here instead of calling gl* directly; code that
+// changes state behind its back must call Invalidate() afterwards.
+//
+// In headless mode nothing reaches GL: calls are only counted and recorded,
+// so call counts can be checked without a context.
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+
+    // false if the program was already bound and the call was skipped
+    static bool UseProgram(GLuint program);
+    static void BindVertexArray(GLuint vao);
+    static void ActiveTexture(GLenum unit);                    // GL_TEXTURE0 + n
+    static void BindTexture(GLenum target, GLuint texture);    // on the active unit
+    static void BindTexture(GLuint unit, GLenum target, GLuint texture); // unit is 0-based
+    static void Enable(GLenum capability);
+    static void Disable(GLenum capability);
+    static void SetEnabled(GLenum capability, bool enabled);
+    static bool IsEnabled(GLenum capability);  // queries GL if not shadowed yet
+    static void DepthMask(GLboolean flag);
+    static void DepthFunc(GLenum func);
+    static GLenum GetDepthFunc();              // queries GL if not shadowed yet
+    static void BlendFunc(GLenum src, GLenum dst);
+    static void StencilFunc(GLenum func, GLint ref, GLuint mask);
+    static void StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass);
+    static void StencilMask(GLuint mask);
+    static void CullFace(GLenum mode);
+    static void BindFramebuffer(GLenum target, GLuint framebuffer);
+    static GLuint GetDrawFramebuffer();        // queries GL if not shadowed yet
+
+    // names are recycled by glGen*, so bindings to deleted objects must be forgotten
+    static void DeleteTextures(GLsizei count, const GLuint* textures);
+    static void DeleteVertexArrays(GLsizei count, const GLuint* arrays);
+    static void DeleteFramebuffers(GLsizei count, const GLuint* framebuffers);
+    static void DeleteProgram(GLuint program);
+
+    // forget everything; the next call of each kind always reaches the driver
+    static void Invalidate();
+
+    static void SetHeadless(bool enabled);
+    static bool IsHeadless() { return headless; }
+    static const std::vector<GLRecordedCall>& GetRecordedCalls() { return recorded; }
+    static void ClearRecordedCalls() { recorded.clear(); }
+
+    static const GLStateCounters& GetCounters() { return counters; }
+    static void ResetCounters() { counters.reset(); }
+
+private:
+    GLStateCache() { }
+
+    // capabilities with a shadow slot; others are forwarded uncached
+    static int capabilityIndex(GLenum capability);
+    static int textureTargetIndex(GLenum target);
+    static bool issue(GLStateCall call, GLuint a = 0, GLuint b = 0, GLuint c = 0);
+
+    static const int CAPABILITY_COUNT = 8;
+    static const int TEXTURE_TARGET_COUNT = 5;
+
+    static bool headless;
+    static GLStateCounters counters;
+    static std::vector<GLRecordedCall> recorded;
+
+    static GLuint program;
+    static GLuint vertexArray;
+    static GLuint activeUnit;
+    static GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+    static int8_t capabilities[CAPABILITY_COUNT]; // -1 unknown, 0 off, 1 on
+    static int8_t depthWrite;
+    static GLenum depthFunc;
+    static GLenum blendSrc, blendDst;
+    static GLenum stencilFunc;
+    static GLint stencilRef;
+    static GLuint stencilFuncMask;
+    static GLenum stencilFail, stencilDepthFail, stencilPass;
+    static GLuint stencilWriteMask;
+    static GLenum cullFace;
+    static GLuint drawFramebuffer, readFramebuffer;
+};
+
+#endif // GL_STATE_CACHE_H
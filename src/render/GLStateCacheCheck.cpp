@@ -0,0 +1,68 @@
+#include "GLStateCacheCheck.h"
+#include "GLStateCache.h"
+#include <cstdio>
+#include <vector>
+
+namespace {
+    const GLuint PROGRAM = 7;
+    const GLuint TEXTURE = 11;
+    const GLuint VAO = 5;
+    const GLuint UNIT = 2;
+
+    // one frame's worth of binds; the second run of it should be skipped completely
+    void bindState() {
+        GLStateCache::UseProgram(PROGRAM);
+        GLStateCache::BindTexture(UNIT, GL_TEXTURE_2D, TEXTURE);
+        GLStateCache::BindVertexArray(VAO);
+        GLStateCache::Enable(GL_DEPTH_TEST);
+        GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    bool expect(const char* what, unsigned long actual, unsigned long expected) {
+        std::printf("%-36s %6lu (expected %lu)%s\n", what, actual, expected, actual == expected ? "" : "  MISMATCH");
+        return actual == expected;
+    }
+
+    bool sameCall(const GLRecordedCall& call, GLStateCall kind, GLuint a, GLuint b = 0) {
+        return call.call == kind && call.args[0] == a && call.args[1] == b;
+    }
+}
+
+int runGLStateCacheCheck() {
+    GLStateCache::SetHeadless(true);
+    GLStateCache::ResetCounters();
+    bool ok = true;
+
+    // first run: every call reaches the driver, the texture bind after its unit switch
+    bindState();
+    const std::vector<GLRecordedCall>& calls = GLStateCache::GetRecordedCalls();
+    ok &= expect("first run: recorded calls", calls.size(), 6);
+    ok &= expect("first run: skipped", GLStateCache::GetCounters().skipped, 0);
+    bool ordered = calls.size() == 6 &&
+                   sameCall(calls[0], GLStateCall::UseProgram, PROGRAM) &&
+                   sameCall(calls[1], GLStateCall::ActiveTexture, GL_TEXTURE0 + UNIT) &&
+                   sameCall(calls[2], GLStateCall::BindTexture, GL_TEXTURE_2D, TEXTURE) &&
+                   sameCall(calls[3], GLStateCall::BindVertexArray, VAO) &&
+                   sameCall(calls[4], GLStateCall::Enable, GL_DEPTH_TEST) &&
+                   sameCall(calls[5], GLStateCall::BlendFunc, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    ok &= expect("first run: calls in order", ordered ? 1 : 0, 1);
+
+    // second run: nothing new, one skip per call made
+    GLStateCache::ClearRecordedCalls();
+    GLStateCache::ResetCounters();
+    bindState();
+    ok &= expect("second run: recorded calls", GLStateCache::GetRecordedCalls().size(), 0);
+    ok &= expect("second run: issued", GLStateCache::GetCounters().total(), 0);
+    ok &= expect("second run: skipped", GLStateCache::GetCounters().skipped, 5);
+
+    // a deleted name may come back from glGenTextures, so binding it again must reach the driver
+    GLStateCache::ResetCounters();
+    GLStateCache::DeleteTextures(1, &TEXTURE);
+    GLStateCache::BindTexture(UNIT, GL_TEXTURE_2D, TEXTURE);
+    ok &= expect("after delete: texture binds", GLStateCache::GetCounters().count(GLStateCall::BindTexture), 1);
+    ok &= expect("after delete: unit switches", GLStateCache::GetCounters().count(GLStateCall::ActiveTexture), 0);
+
+    GLStateCache::SetHeadless(false);
+    std::printf("%s\n", ok ? "GLStateCache check passed" : "GLStateCache check FAILED");
+    return ok ? 0 : 1;
+}
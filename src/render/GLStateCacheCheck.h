@@ -0,0 +1,8 @@
+#pragma once
+
+// Check of GLStateCache's redundancy filtering (--state-cache-check): the same
+// program, texture, VAO and fixed-function state are bound twice in headless
+// mode, and the recorded calls and skip counters are compared with what should
+// have reached the driver. Needs no GL context. Returns the process exit code
+// (1 if any count differs).
+int runGLStateCacheCheck();
@@ -0,0 +1,319 @@
+#include "GeometryPool.h"
+#include "GLStateCache.h"
+#include <algorithm>
+#include "RenderStats.h"
+
+std::vector<GeometryPool::Page> GeometryPool::pages;
+std::vector<GeometryRange> GeometryPool::ranges;
+std::vector<GeometryHandle> GeometryPool::freeHandles;
+unsigned int GeometryPool::compactions = 0;
+
+int GeometryPool::CreatePage(const VertexLayout& layout, GLuint vertexCapacity, GLuint indexCapacity)
+{
+    Page page;
+    page.layout = &layout;
+    page.vertexCapacity = vertexCapacity;
+    page.indexCapacity = indexCapacity;
+    page.freeVertices.push_back({0, vertexCapacity});
+    page.freeIndices.push_back({0, indexCapacity});
+    page.liveAllocations = 0;
+
+    glGenVertexArrays(1, &page.vao);
+    glGenBuffers(1, &page.vbo);
+    glGenBuffers(1, &page.ebo);
+    page.secondaryVbo = 0;
+    if (layout.secondaryStride > 0)
+        glGenBuffers(1, &page.secondaryVbo);
+
+    // The element buffer binding is VAO state, so the VAO is bound first
+    GLStateCache::BindVertexArray(page.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, page.vbo);
+    glBufferData(GL_ARRAY_BUFFER, size_t(vertexCapacity) * layout.stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size_t(indexCapacity) * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+    layout.setupAttributes();
+    if (page.secondaryVbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, page.secondaryVbo);
+        glBufferData(GL_ARRAY_BUFFER, size_t(vertexCapacity) * layout.secondaryStride, nullptr, GL_STATIC_DRAW);
+        layout.setupSecondaryAttributes();
+    }
+    GLStateCache::BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    pages.push_back(page);
+    return static_cast<int>(pages.size()) - 1;
+}
+
+bool GeometryPool::TakeBlock(std::vector<FreeBlock>& blocks, GLuint size, GLuint& offset)
+{
+    // first fit keeps allocations packed towards the start of the page
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (blocks[i].size < size)
+            continue;
+        offset = blocks[i].offset;
+        blocks[i].offset += size;
+        blocks[i].size -= size;
+        if (blocks[i].size == 0)
+            blocks.erase(blocks.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+void GeometryPool::ReturnBlock(std::vector<FreeBlock>& blocks, GLuint offset, GLuint size)
+{
+    auto it = std::lower_bound(blocks.begin(), blocks.end(), offset,
+                               [](const FreeBlock& block, GLuint value) { return block.offset < value; });
+    it = blocks.insert(it, {offset, size});
+
+    // merge with the following and the preceding block
+    auto next = it + 1;
+    if (next != blocks.end() && it->offset + it->size == next->offset) {
+        it->size += next->size;
+        blocks.erase(next);
+    }
+    if (it != blocks.begin()) {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset) {
+            prev->size += it->size;
+            blocks.erase(it);
+        }
+    }
+}
+
+GeometryHandle GeometryPool::Allocate(const VertexLayout& layout,
+                                      const void* vertices, GLuint vertexCount,
+                                      const GLuint* indices, GLuint indexCount,
+                                      const void* secondaryVertices)
+{
+    if (vertexCount == 0 || indexCount == 0)
+        return INVALID_GEOMETRY;
+
+    GeometryRange range;
+    GLuint vertexOffset = 0, indexOffset = 0;
+    for (size_t i = 0; i < pages.size() && range.page < 0; i++) {
+        Page& page = pages[i];
+        if (page.layout != &layout)
+            continue;
+        if (!TakeBlock(page.freeVertices, vertexCount, vertexOffset))
+            continue;
+        if (!TakeBlock(page.freeIndices, indexCount, indexOffset)) {
+            ReturnBlock(page.freeVertices, vertexOffset, vertexCount);
+            continue;
+        }
+        range.page = static_cast<int>(i);
+    }
+
+    if (range.page < 0) {
+        range.page = CreatePage(layout, std::max(vertexCount, PAGE_VERTICES), std::max(indexCount, PAGE_INDICES));
+        TakeBlock(pages[range.page].freeVertices, vertexCount, vertexOffset);
+        TakeBlock(pages[range.page].freeIndices, indexCount, indexOffset);
+    }
+
+    Page& page = pages[range.page];
+    page.liveAllocations++;
+    range.vao = page.vao;
+    range.baseVertex = static_cast<GLint>(vertexOffset);
+    range.vertexCount = vertexCount;
+    range.firstIndex = indexOffset;
+    range.indexCount = static_cast<GLsizei>(indexCount);
+
+    // Upload through the copy targets so the bound VAO's element buffer is untouched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, size_t(vertexOffset) * layout.stride, size_t(vertexCount) * layout.stride, vertices);
+    RenderStats::RecordUpload(size_t(vertexCount) * layout.stride);
+    if (page.secondaryVbo && secondaryVertices) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.secondaryVbo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, size_t(vertexOffset) * layout.secondaryStride,
+                        size_t(vertexCount) * layout.secondaryStride, secondaryVertices);
+        RenderStats::RecordUpload(size_t(vertexCount) * layout.secondaryStride);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, size_t(indexOffset) * sizeof(GLuint), size_t(indexCount) * sizeof(GLuint), indices);
+    RenderStats::RecordUpload(size_t(indexCount) * sizeof(GLuint));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GeometryHandle handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        ranges[handle] = range;
+    } else {
+        handle = static_cast<GeometryHandle>(ranges.size());
+        ranges.push_back(range);
+    }
+    return handle;
+}
+
+void GeometryPool::Free(GeometryHandle handle)
+{
+    if (handle < 0 || handle >= static_cast<GeometryHandle>(ranges.size()) || ranges[handle].page < 0)
+        return;
+
+    GeometryRange& range = ranges[handle];
+    Page& page = pages[range.page];
+    ReturnBlock(page.freeVertices, static_cast<GLuint>(range.baseVertex), range.vertexCount);
+    ReturnBlock(page.freeIndices, range.firstIndex, static_cast<GLuint>(range.indexCount));
+    page.liveAllocations--;
+
+    range = GeometryRange();
+    freeHandles.push_back(handle);
+}
+
+GLuint GeometryPool::CreateVertexArray(GeometryHandle handle)
+{
+    const Page& page = pages[ranges[handle].page];
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    GLStateCache::BindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, page.vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo);
+    page.layout->setupAttributes();
+    if (page.secondaryVbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, page.secondaryVbo);
+        page.layout->setupSecondaryAttributes();
+    }
+    GLStateCache::BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vao;
+}
+
+bool GeometryPool::Fragmented(const Page& page)
+{
+    // packed means at most one free block and it runs to the end of the page
+    auto packed = [](const std::vector<FreeBlock>& blocks, GLuint capacity) {
+        return blocks.empty() || (blocks.size() == 1 && blocks[0].offset + blocks[0].size == capacity);
+    };
+    return !packed(page.freeVertices, page.vertexCapacity) || !packed(page.freeIndices, page.indexCapacity);
+}
+
+void GeometryPool::CompactPage(int pageIndex)
+{
+    Page& page = pages[pageIndex];
+    const VertexLayout& layout = *page.layout;
+
+    std::vector<GeometryHandle> live;
+    for (size_t h = 0; h < ranges.size(); h++) {
+        if (ranges[h].page == pageIndex)
+            live.push_back(static_cast<GeometryHandle>(h));
+    }
+
+    GLuint usedVertices = 0, usedIndices = 0;
+    for (GeometryHandle h : live) {
+        usedVertices += ranges[h].vertexCount;
+        usedIndices += static_cast<GLuint>(ranges[h].indexCount);
+    }
+
+    struct Stream {
+        GLuint buffer;
+        size_t elementSize;
+    };
+
+    // glCopyBufferSubData cannot copy between overlapping ranges of one buffer,
+    // so the live data is packed into a scratch buffer and copied back in one go.
+    // Every stream is copied from the old offsets before the ranges move.
+    auto compactStreams = [&](const std::vector<Stream>& streams, GLuint usedElements, bool vertexData) {
+        if (usedElements == 0)
+            return;
+        std::sort(live.begin(), live.end(), [&](GeometryHandle a, GeometryHandle b) {
+            return vertexData ? ranges[a].baseVertex < ranges[b].baseVertex
+                              : ranges[a].firstIndex < ranges[b].firstIndex;
+        });
+        auto from = [&](const GeometryRange& range) {
+            return vertexData ? static_cast<GLuint>(range.baseVertex) : range.firstIndex;
+        };
+        auto count = [&](const GeometryRange& range) {
+            return vertexData ? range.vertexCount : static_cast<GLuint>(range.indexCount);
+        };
+
+        for (const Stream& stream : streams) {
+            const size_t elementSize = stream.elementSize;
+            GLuint scratch;
+            glGenBuffers(1, &scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+            glBufferData(GL_COPY_WRITE_BUFFER, usedElements * elementSize, nullptr, GL_STREAM_COPY);
+            glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer);
+
+            GLuint cursor = 0;
+            for (GeometryHandle h : live) {
+                const GeometryRange& range = ranges[h];
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                    from(range) * elementSize, cursor * elementSize, count(range) * elementSize);
+                cursor += count(range);
+            }
+
+            glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedElements * elementSize);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &scratch);
+        }
+
+        GLuint cursor = 0;
+        for (GeometryHandle h : live) {
+            GeometryRange& range = ranges[h];
+            if (vertexData)
+                range.baseVertex = static_cast<GLint>(cursor);
+            else
+                range.firstIndex = cursor;
+            cursor += count(range);
+        }
+    };
+
+    // indices are relative to baseVertex, so moving vertices needs no index rewrite
+    std::vector<Stream> vertexStreams = {{page.vbo, size_t(layout.stride)}};
+    if (page.secondaryVbo)
+        vertexStreams.push_back({page.secondaryVbo, size_t(layout.secondaryStride)});
+    compactStreams(vertexStreams, usedVertices, true);
+    compactStreams({{page.ebo, sizeof(GLuint)}}, usedIndices, false);
+
+    page.freeVertices.clear();
+    page.freeIndices.clear();
+    if (usedVertices < page.vertexCapacity)
+        page.freeVertices.push_back({usedVertices, page.vertexCapacity - usedVertices});
+    if (usedIndices < page.indexCapacity)
+        page.freeIndices.push_back({usedIndices, page.indexCapacity - usedIndices});
+    compactions++;
+}
+
+void GeometryPool::Compact()
+{
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (Fragmented(pages[i]))
+            CompactPage(static_cast<int>(i));
+    }
+}
+
+void GeometryPool::Clear()
+{
+    for (Page& page : pages) {
+        GLStateCache::DeleteVertexArrays(1, &page.vao);
+        glDeleteBuffers(1, &page.vbo);
+        glDeleteBuffers(1, &page.ebo);
+        if (page.secondaryVbo)
+            glDeleteBuffers(1, &page.secondaryVbo);
+    }
+    pages.clear();
+    ranges.clear();
+    freeHandles.clear();
+}
+
+GeometryPoolStats GeometryPool::GetStats()
+{
+    GeometryPoolStats stats;
+    stats.pages = static_cast<unsigned int>(pages.size());
+    stats.compactions = compactions;
+    for (const Page& page : pages) {
+        stats.allocations += page.liveAllocations;
+        stats.vertexBytesReserved += size_t(page.vertexCapacity) * page.layout->vertexSize();
+        stats.indexBytesReserved += size_t(page.indexCapacity) * sizeof(GLuint);
+    }
+    for (const GeometryRange& range : ranges) {
+        if (range.page < 0)
+            continue;
+        stats.vertexBytesUsed += size_t(range.vertexCount) * pages[range.page].layout->vertexSize();
+        stats.indexBytesUsed += size_t(range.indexCount) * sizeof(GLuint);
+    }
+    return stats;
+}
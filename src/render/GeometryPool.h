@@ -0,0 +1,109 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <vector>
+#include <cstddef>
+#include <glad/glad.h>
+
+// A vertex format: the size of one vertex and a function that declares its
+// attribute pointers on the bound VAO / GL_ARRAY_BUFFER. Pages only hold one
+// format, so layouts are compared by identity and must outlive the pool.
+// A format may have a second stream in a buffer of its own, for attributes
+// that only some meshes carry (e.g. skinning).
+struct VertexLayout {
+    GLsizei stride;
+    void (*setupAttributes)();
+    GLsizei secondaryStride = 0;             // 0: no second stream
+    void (*setupSecondaryAttributes)() = nullptr;
+
+    GLsizei vertexSize() const { return stride + secondaryStride; }
+};
+
+typedef int GeometryHandle;
+static const GeometryHandle INVALID_GEOMETRY = -1;
+
+// Where a mesh lives inside the pool; indices are relative to baseVertex
+struct GeometryRange {
+    GLuint vao = 0;            // shared by every mesh of the page
+    int page = -1;
+    GLint baseVertex = 0;
+    GLuint vertexCount = 0;
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+
+    // byte offset of the first index, or of `first` indices further (e.g. a level of detail)
+    const void* indexOffset(GLuint first = 0) const { return (const void*)(size_t(firstIndex + first) * sizeof(GLuint)); }
+};
+
+struct GeometryPoolStats {
+    unsigned int pages = 0;
+    unsigned int allocations = 0;
+    size_t vertexBytesUsed = 0;
+    size_t vertexBytesReserved = 0;
+    size_t indexBytesUsed = 0;
+    size_t indexBytesReserved = 0;
+    unsigned int compactions = 0; // pages defragmented so far
+};
+
+// Suballocates the vertex and index data of static meshes from a few large
+// buffers ("pages"), one VAO per page. Meshes of the same layout then share
+// their VAO and are drawn with glDrawElementsBaseVertex, so switching between
+// them needs no VAO bind. Freed ranges go back to per-page free lists;
+// Compact() slides the live ranges of fragmented pages back together.
+class GeometryPool
+{
+public:
+    static constexpr GLuint PAGE_VERTICES = 1u << 18; // meshes bigger than a page get a page of their own
+    static constexpr GLuint PAGE_INDICES = 1u << 20;
+
+    // uploads the data and returns a handle, or INVALID_GEOMETRY for empty meshes;
+    // secondaryVertices is the second stream of layouts that have one
+    static GeometryHandle Allocate(const VertexLayout& layout,
+                                   const void* vertices, GLuint vertexCount,
+                                   const GLuint* indices, GLuint indexCount,
+                                   const void* secondaryVertices = nullptr);
+    static void Free(GeometryHandle handle);
+
+    // ranges move when their page is compacted, so look them up at draw time
+    static const GeometryRange& Get(GeometryHandle handle) { return ranges[handle]; }
+
+    // a new VAO over the buffers of the handle's page with the layout attributes
+    // declared; the caller may add attributes (e.g. per instance) and owns it
+    static GLuint CreateVertexArray(GeometryHandle handle);
+
+    // defragments every page with holes; live handles stay valid
+    static void Compact();
+    // deletes all buffers; existing handles become invalid
+    static void Clear();
+
+    static GeometryPoolStats GetStats();
+
+private:
+    struct FreeBlock {
+        GLuint offset;
+        GLuint size;
+    };
+
+    struct Page {
+        const VertexLayout* layout;
+        GLuint vao, vbo, ebo;
+        GLuint secondaryVbo;                 // 0 unless the layout has a second stream
+        GLuint vertexCapacity, indexCapacity;
+        std::vector<FreeBlock> freeVertices; // sorted by offset, adjacent blocks merged
+        std::vector<FreeBlock> freeIndices;
+        unsigned int liveAllocations;
+    };
+
+    static int CreatePage(const VertexLayout& layout, GLuint vertexCapacity, GLuint indexCapacity);
+    static void CompactPage(int page);
+    static bool TakeBlock(std::vector<FreeBlock>& blocks, GLuint size, GLuint& offset);
+    static void ReturnBlock(std::vector<FreeBlock>& blocks, GLuint offset, GLuint size);
+    static bool Fragmented(const Page& page);
+
+    static std::vector<Page> pages;
+    static std::vector<GeometryRange> ranges; // indexed by handle
+    static std::vector<GeometryHandle> freeHandles;
+    static unsigned int compactions;
+};
+
+#endif // GEOMETRY_POOL_H
@@ -0,0 +1,213 @@
+#include "HeadlessContext.h"
+#include <iostream>
+#include <cstring>
+
+// No glad here: GL/osmesa.h pulls in the system GL/gl.h
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#ifdef HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+HeadlessBackend HeadlessContext::loaderBackend = HeadlessBackend::Auto;
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+bool HeadlessContext::parseBackend(const std::string& text, HeadlessBackend& out)
+{
+    if (text == "auto") {
+        out = HeadlessBackend::Auto;
+    } else if (text == "egl") {
+        out = HeadlessBackend::EGL;
+    } else if (text == "osmesa") {
+        out = HeadlessBackend::OSMesa;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessContext::create(int width, int height, HeadlessBackend backend)
+{
+    destroy();
+
+    bool created = false;
+    if (backend == HeadlessBackend::Auto || backend == HeadlessBackend::EGL)
+        created = createEGL(width, height);
+    if (!created && (backend == HeadlessBackend::Auto || backend == HeadlessBackend::OSMesa))
+        created = createOSMesa(width, height);
+
+    if (!created) {
+        std::cout << "ERROR::HEADLESS: Could not create an OpenGL 3.3 core context without a window" << std::endl;
+        return false;
+    }
+    loaderBackend = active;
+    std::cout << "Headless context: " << name << " (" << width << "x" << height << ")" << std::endl;
+    return true;
+}
+
+bool HeadlessContext::createEGL(int width, int height)
+{
+#ifdef HAVE_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // Mesa's surfaceless platform needs neither X11 nor a GPU device node
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    bool surfacelessPlatform = false;
+    if (clientExtensions && getPlatformDisplay && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        surfacelessPlatform = display != EGL_NO_DISPLAY;
+    }
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cout << "ERROR::HEADLESS: eglInitialize failed" << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "ERROR::HEADLESS: EGL display has no desktop OpenGL support" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    // A pbuffer gives a real default framebuffer; the surfaceless platform has none
+    EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, surfacelessPlatform ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        std::cout << "ERROR::HEADLESS: No suitable EGL config" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cout << "ERROR::HEADLESS: eglCreateContext failed for OpenGL 3.3 core" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfacelessPlatform) {
+        EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cout << "ERROR::HEADLESS: eglMakeCurrent failed" << std::endl;
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    eglDisplay = display;
+    eglContext = context;
+    eglSurface = surface;
+    active = HeadlessBackend::EGL;
+    name = surface == EGL_NO_SURFACE ? "egl-surfaceless" : "egl";
+    return true;
+#else
+    (void)width;
+    (void)height;
+    std::cout << "Headless: built without EGL support" << std::endl;
+    return false;
+#endif
+}
+
+bool HeadlessContext::createOSMesa(int width, int height)
+{
+#ifdef HAVE_OSMESA
+    const int attribs[] = {
+        OSMESA_FORMAT, OSMESA_RGBA,
+        OSMESA_DEPTH_BITS, 24,
+        OSMESA_STENCIL_BITS, 8,
+        OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 3,
+        OSMESA_CONTEXT_MINOR_VERSION, 3,
+        0
+    };
+    OSMesaContext context = OSMesaCreateContextAttribs(attribs, nullptr);
+    if (!context) {
+        std::cout << "ERROR::HEADLESS: OSMesaCreateContextAttribs failed for OpenGL 3.3 core" << std::endl;
+        return false;
+    }
+
+    unsigned char* buffer = new unsigned char[size_t(width) * height * 4];
+    if (!OSMesaMakeCurrent(context, buffer, GL_UNSIGNED_BYTE, width, height)) {
+        std::cout << "ERROR::HEADLESS: OSMesaMakeCurrent failed" << std::endl;
+        OSMesaDestroyContext(context);
+        delete[] buffer;
+        return false;
+    }
+
+    osmesaContext = context;
+    osmesaBuffer = buffer;
+    active = HeadlessBackend::OSMesa;
+    name = "osmesa";
+    return true;
+#else
+    (void)width;
+    (void)height;
+    std::cout << "Headless: built without OSMesa support" << std::endl;
+    return false;
+#endif
+}
+
+void HeadlessContext::destroy()
+{
+#ifdef HAVE_EGL
+    if (eglDisplay) {
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (eglSurface)
+            eglDestroySurface(eglDisplay, eglSurface);
+        if (eglContext)
+            eglDestroyContext(eglDisplay, eglContext);
+        eglTerminate(eglDisplay);
+    }
+#endif
+#ifdef HAVE_OSMESA
+    if (osmesaContext)
+        OSMesaDestroyContext(static_cast<OSMesaContext>(osmesaContext));
+#endif
+    delete[] osmesaBuffer;
+
+    eglDisplay = eglContext = eglSurface = osmesaContext = nullptr;
+    osmesaBuffer = nullptr;
+    active = HeadlessBackend::Auto;
+    name.clear();
+}
+
+void* HeadlessContext::getProcAddress(const char* name)
+{
+#ifdef HAVE_EGL
+    if (loaderBackend == HeadlessBackend::EGL)
+        return reinterpret_cast<void*>(eglGetProcAddress(name));
+#endif
+#ifdef HAVE_OSMESA
+    if (loaderBackend == HeadlessBackend::OSMesa)
+        return reinterpret_cast<void*>(OSMesaGetProcAddress(name));
+#endif
+    (void)name;
+    return nullptr;
+}
@@ -0,0 +1,56 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <string>
+
+// Which library provides the windowless GL context
+enum class HeadlessBackend {
+    Auto,   // EGL first, then OSMesa
+    EGL,    // EGL with a pbuffer, or surfaceless (EGL_MESA_platform_surfaceless) on Mesa
+    OSMesa  // Mesa's off-screen renderer (llvmpipe / softpipe)
+};
+
+// An OpenGL 3.3 core context without a window, for benchmarks and image
+// regression tests on build machines with no display. Backends are compiled
+// in when CMake finds them (HAVE_EGL / HAVE_OSMESA); create() fails with a
+// message otherwise. Render into your own framebuffer objects: the default
+// framebuffer exists only for the EGL pbuffer and OSMesa backends.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // creates the context and makes it current; width/height size the default framebuffer
+    bool create(int width, int height, HeadlessBackend backend = HeadlessBackend::Auto);
+    void destroy();
+
+    bool isCurrent() const { return active != HeadlessBackend::Auto; }
+    HeadlessBackend backend() const { return active; }
+    // "egl", "egl-surfaceless" or "osmesa"
+    const std::string& description() const { return name; }
+
+    // loader for gladLoadGLLoader, valid once a context is current
+    static void* getProcAddress(const char* name);
+
+    static bool parseBackend(const std::string& text, HeadlessBackend& out);
+
+private:
+    bool createEGL(int width, int height);
+    bool createOSMesa(int width, int height);
+
+    HeadlessBackend active = HeadlessBackend::Auto; // Auto while no context exists
+    std::string name;
+
+    // backend handles, kept opaque so this header needs no EGL or OSMesa includes
+    void* eglDisplay = nullptr;
+    void* eglContext = nullptr;
+    void* eglSurface = nullptr;
+    void* osmesaContext = nullptr;
+    unsigned char* osmesaBuffer = nullptr;
+
+    static HeadlessBackend loaderBackend;
+};
+
+#endif // HEADLESS_CONTEXT_H
@@ -0,0 +1,93 @@
+#include "LightClusterBenchmark.h"
+#include "LightClusters.h"
+#include "../util/WorkerPool.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    bool sameAssignment(const LightClusterGrid& a, const LightClusterGrid& b) {
+        return a.getRanges() == b.getRanges() && a.getIndices() == b.getIndices();
+    }
+}
+
+int runLightClusterBenchmark() {
+    const size_t counts[] = { 128, 512, 1024, 4096 };
+    const float worldHalfSize = 100.0f;
+    const int views = 200;
+
+    // fixed seed so runs are comparable
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coordinate(-worldHalfSize, worldHalfSize);
+    std::uniform_real_distribution<float> height(0.0f, 20.0f);
+    std::uniform_real_distribution<float> radius(5.0f, 40.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // same projection as Renderer3D
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    WorkerPool pool;
+
+    std::printf("threads: %u\n", pool.concurrency());
+    std::printf("%8s %10s %10s %10s %10s %9s %9s %9s\n", "lights", "brute ms", "simd ms", "pool ms", "speedup",
+                "visible", "refs", "max/clu");
+
+    for (size_t count : counts) {
+        std::vector<ClusterLight> lights(count);
+        for (ClusterLight& light : lights) {
+            light.position = glm::vec3(coordinate(rng), height(rng), coordinate(rng));
+            light.radius = radius(rng);
+        }
+
+        std::vector<glm::mat4> viewMatrices(views);
+        for (glm::mat4& view : viewMatrices) {
+            glm::vec3 eye(coordinate(rng), height(rng), coordinate(rng));
+            glm::vec3 forward(unit(rng), 0.3f * unit(rng), unit(rng));
+            if (glm::length(forward) < 0.01f) forward = glm::vec3(0.0f, 0.0f, -1.0f);
+            view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+
+        LightClusterGrid reference, simd, threaded;
+        reference.setProjection(projection, 0.1f, 1000.0f);
+        simd.setProjection(projection, 0.1f, 1000.0f);
+        threaded.setProjection(projection, 0.1f, 1000.0f);
+
+        double bruteMs = 0.0, simdMs = 0.0, poolMs = 0.0;
+        unsigned long visible = 0, references = 0, maxPerCluster = 0;
+        for (const glm::mat4& view : viewMatrices) {
+            Clock::time_point start = Clock::now();
+            reference.assignBruteForce(view, lights.data(), lights.size());
+            bruteMs += millisecondsSince(start);
+
+            start = Clock::now();
+            simd.assign(view, lights.data(), lights.size());
+            simdMs += millisecondsSince(start);
+
+            start = Clock::now();
+            threaded.assign(view, lights.data(), lights.size(), &pool);
+            poolMs += millisecondsSince(start);
+
+            if (!sameAssignment(reference, simd) || !sameAssignment(reference, threaded)) {
+                std::printf("Light cluster mismatch with %zu lights: %u/%u/%u references (brute/simd/pool)\n", count,
+                            reference.getStats().references, simd.getStats().references,
+                            threaded.getStats().references);
+                return 1;
+            }
+            visible += reference.getStats().visibleLights;
+            references += reference.getStats().references;
+            if (reference.getStats().maxPerCluster > maxPerCluster) maxPerCluster = reference.getStats().maxPerCluster;
+        }
+
+        std::printf("%8zu %10.4f %10.4f %10.4f %9.1fx %9lu %9lu %9lu\n", count, bruteMs / views, simdMs / views,
+                    poolMs / views, bruteMs / poolMs, visible / views, references / views, maxPerCluster);
+    }
+    std::printf("ms columns are per view; all assignments match the brute-force reference\n");
+    return 0;
+}
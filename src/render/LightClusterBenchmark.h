@@ -0,0 +1,8 @@
+#pragma once
+
+// CPU-only check and benchmark of the clustered light assignment
+// (--cluster-bench): random lights and cameras, the SSE and threaded paths of
+// LightClusterGrid compared cluster by cluster against the brute-force
+// reference, then timed. Needs no GL context. Returns the process exit code
+// (1 if any assignment differs from the reference).
+int runLightClusterBenchmark();
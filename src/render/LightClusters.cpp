@@ -0,0 +1,259 @@
+#include "LightClusters.h"
+#include "../util/WorkerPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LIGHT_CLUSTERS_USE_SSE 1
+#endif
+
+namespace {
+
+// squared distance from a point to a box, 0 inside; the SSE path computes the same expression
+inline float distanceSquared(float cx, float cy, float cz, float minX, float minY, float minZ, float maxX,
+                             float maxY, float maxZ)
+{
+    float dx = std::max(std::max(minX - cx, cx - maxX), 0.0f);
+    float dy = std::max(std::max(minY - cy, cy - maxY), 0.0f);
+    float dz = std::max(std::max(minZ - cz, cz - maxZ), 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+} // namespace
+
+LightClusterGrid::LightClusterGrid(int tilesX, int tilesY, int slices)
+    : tilesX(tilesX), tilesY(tilesY), slices(slices), rowStride((tilesX + 3) & ~3)
+{
+    size_t boxes = static_cast<size_t>(slices) * tilesY * rowStride;
+    minX.assign(boxes, 0.0f);
+    minY.assign(boxes, 0.0f);
+    minZ.assign(boxes, 0.0f);
+    maxX.assign(boxes, 0.0f);
+    maxY.assign(boxes, 0.0f);
+    maxZ.assign(boxes, 0.0f);
+    clusterLights.resize(getClusterCount());
+    clusterDropped.assign(slices, 0);
+    ranges.assign(getClusterCount(), glm::uvec2(0));
+}
+
+void LightClusterGrid::setProjection(const glm::mat4& newProjection, float newNear, float newFar)
+{
+    if (newProjection == projection && newNear == nearPlane && newFar == farPlane)
+        return;
+    projection = newProjection;
+    nearPlane = newNear;
+    farPlane = newFar;
+
+    const float depthRatio = std::log(farPlane / nearPlane);
+    sliceScale = slices / depthRatio;
+    sliceBias = -slices * std::log(nearPlane) / depthRatio;
+
+    // a view-space point at depth d on NDC (x, y) is (x * d / P00, y * d / P11, -d)
+    const float inverseX = 1.0f / projection[0][0];
+    const float inverseY = 1.0f / projection[1][1];
+    const float empty = std::numeric_limits<float>::max();
+
+    for (int slice = 0; slice < slices; slice++) {
+        const float depths[2] = {
+            nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / slices),
+            nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice + 1) / slices)
+        };
+        for (int y = 0; y < tilesY; y++) {
+            const float ndcY[2] = { -1.0f + 2.0f * y / tilesY, -1.0f + 2.0f * (y + 1) / tilesY };
+            size_t row = rowStart(slice, y);
+            for (int x = 0; x < rowStride; x++) {
+                size_t box = row + x;
+                if (x >= tilesX) {
+                    minX[box] = minY[box] = minZ[box] = empty;
+                    maxX[box] = maxY[box] = maxZ[box] = -empty;
+                    continue;
+                }
+                const float ndcX[2] = { -1.0f + 2.0f * x / tilesX, -1.0f + 2.0f * (x + 1) / tilesX };
+                AABB bounds;
+                for (float depth : depths) {
+                    for (float nx : ndcX) {
+                        for (float ny : ndcY)
+                            bounds.expand(glm::vec3(nx * depth * inverseX, ny * depth * inverseY, -depth));
+                    }
+                }
+                minX[box] = bounds.min.x;
+                minY[box] = bounds.min.y;
+                minZ[box] = bounds.min.z;
+                maxX[box] = bounds.max.x;
+                maxY[box] = bounds.max.y;
+                maxZ[box] = bounds.max.z;
+            }
+        }
+    }
+}
+
+AABB LightClusterGrid::getClusterBounds(int cluster) const
+{
+    int x = cluster % tilesX;
+    int y = (cluster / tilesX) % tilesY;
+    int slice = cluster / (tilesX * tilesY);
+    size_t box = rowStart(slice, y) + x;
+    AABB bounds;
+    bounds.min = glm::vec3(minX[box], minY[box], minZ[box]);
+    bounds.max = glm::vec3(maxX[box], maxY[box], maxZ[box]);
+    return bounds;
+}
+
+void LightClusterGrid::prepareLights(const glm::mat4& view, const ClusterLight* lights, size_t count)
+{
+    viewLights.clear();
+    count = std::min<size_t>(count, MAX_LIGHTS);
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+        float radius = lights[i].radius;
+        float depth = -center.z;
+        if (radius <= 0.0f || depth + radius < nearPlane || depth - radius > farPlane)
+            continue;
+
+        // one extra slice on both sides, so rounding in log() never loses a box the sphere touches
+        float nearest = std::max(depth - radius, nearPlane);
+        float farthest = std::min(depth + radius, farPlane);
+        int first = static_cast<int>(std::floor(std::log(nearest) * sliceScale + sliceBias)) - 1;
+        int last = static_cast<int>(std::floor(std::log(farthest) * sliceScale + sliceBias)) + 1;
+
+        ViewLight light;
+        light.center = center;
+        light.radius = radius;
+        light.firstSlice = std::max(first, 0);
+        light.lastSlice = std::min(last, slices - 1);
+        light.index = static_cast<uint16_t>(i);
+        viewLights.push_back(light);
+    }
+}
+
+void LightClusterGrid::assignSlices(int firstSlice, int endSlice)
+{
+    for (int slice = firstSlice; slice < endSlice; slice++) {
+        const int clusterBase = slice * tilesX * tilesY;
+        for (int i = 0; i < tilesX * tilesY; i++)
+            clusterLights[clusterBase + i].clear();
+        unsigned int dropped = 0;
+
+        for (const ViewLight& light : viewLights) {
+            if (slice < light.firstSlice || slice > light.lastSlice)
+                continue;
+            const float radiusSquared = light.radius * light.radius;
+#ifdef LIGHT_CLUSTERS_USE_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 cx = _mm_set1_ps(light.center.x);
+            const __m128 cy = _mm_set1_ps(light.center.y);
+            const __m128 cz = _mm_set1_ps(light.center.z);
+            const __m128 r2 = _mm_set1_ps(radiusSquared);
+#endif
+
+            for (int y = 0; y < tilesY; y++) {
+                const size_t row = rowStart(slice, y);
+                const int clusterRow = clusterBase + y * tilesX;
+                for (int x = 0; x < rowStride; x += 4) {
+                    int hits = 0;
+#ifdef LIGHT_CLUSTERS_USE_SSE
+                    const size_t box = row + x;
+                    __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[box]), cx),
+                                                      _mm_sub_ps(cx, _mm_loadu_ps(&maxX[box]))), zero);
+                    __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minY[box]), cy),
+                                                      _mm_sub_ps(cy, _mm_loadu_ps(&maxY[box]))), zero);
+                    __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minZ[box]), cz),
+                                                      _mm_sub_ps(cz, _mm_loadu_ps(&maxZ[box]))), zero);
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                    hits = _mm_movemask_ps(_mm_cmple_ps(distance, r2));
+#else
+                    for (int lane = 0; lane < 4; lane++) {
+                        const size_t box = row + x + lane;
+                        if (distanceSquared(light.center.x, light.center.y, light.center.z, minX[box], minY[box],
+                                            minZ[box], maxX[box], maxY[box], maxZ[box]) <= radiusSquared)
+                            hits |= 1 << lane;
+                    }
+#endif
+                    // padding boxes are empty, so a hit is always a real tile
+                    for (int lane = 0; hits != 0; lane++, hits >>= 1) {
+                        if (!(hits & 1))
+                            continue;
+                        std::vector<uint16_t>& list = clusterLights[clusterRow + x + lane];
+                        if (list.size() < MAX_LIGHTS_PER_CLUSTER)
+                            list.push_back(light.index);
+                        else
+                            dropped++;
+                    }
+                }
+            }
+        }
+        clusterDropped[slice] = dropped;
+    }
+}
+
+void LightClusterGrid::assign(const glm::mat4& view, const ClusterLight* lights, size_t count, WorkerPool* pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    prepareLights(view, lights, count);
+
+    if (pool && pool->concurrency() > 1) {
+        // a few jobs per thread, so uneven slices still balance
+        const int jobs = std::min<int>(slices, pool->concurrency() * 3);
+        pool->run(jobs, [&](size_t job) {
+            assignSlices(static_cast<int>(job * slices / jobs), static_cast<int>((job + 1) * slices / jobs));
+        });
+    } else {
+        assignSlices(0, slices);
+    }
+
+    compact(count);
+    stats.assignMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LightClusterGrid::assignBruteForce(const glm::mat4& view, const ClusterLight* lights, size_t count)
+{
+    auto start = std::chrono::steady_clock::now();
+    prepareLights(view, lights, count);
+
+    std::fill(clusterDropped.begin(), clusterDropped.end(), 0u);
+    for (int slice = 0; slice < slices; slice++) {
+        for (int y = 0; y < tilesY; y++) {
+            for (int x = 0; x < tilesX; x++) {
+                const size_t box = rowStart(slice, y) + x;
+                std::vector<uint16_t>& list = clusterLights[(slice * tilesY + y) * tilesX + x];
+                list.clear();
+                for (const ViewLight& light : viewLights) {
+                    if (distanceSquared(light.center.x, light.center.y, light.center.z, minX[box], minY[box],
+                                        minZ[box], maxX[box], maxY[box], maxZ[box]) > light.radius * light.radius)
+                        continue;
+                    if (list.size() < MAX_LIGHTS_PER_CLUSTER)
+                        list.push_back(light.index);
+                    else
+                        clusterDropped[slice]++;
+                }
+            }
+        }
+    }
+
+    compact(count);
+    stats.assignMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LightClusterGrid::compact(size_t lightCount)
+{
+    stats = LightClusterStats();
+    stats.lights = static_cast<unsigned int>(lightCount);
+
+    indices.clear();
+    referenced.assign(std::min<size_t>(lightCount, MAX_LIGHTS), false);
+    for (int cluster = 0; cluster < getClusterCount(); cluster++) {
+        const std::vector<uint16_t>& list = clusterLights[cluster];
+        ranges[cluster] = glm::uvec2(static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(list.size()));
+        indices.insert(indices.end(), list.begin(), list.end());
+        stats.maxPerCluster = std::max(stats.maxPerCluster, static_cast<unsigned int>(list.size()));
+        for (uint16_t light : list)
+            referenced[light] = true;
+    }
+    stats.references = static_cast<unsigned int>(indices.size());
+    stats.visibleLights = static_cast<unsigned int>(std::count(referenced.begin(), referenced.end(), true));
+    for (unsigned int dropped : clusterDropped)
+        stats.dropped += dropped;
+}
@@ -0,0 +1,111 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+class WorkerPool;
+
+// A point light as far as clustering is concerned: it lights nothing beyond radius
+struct ClusterLight {
+    glm::vec3 position;   // world space
+    float radius;
+};
+
+struct LightClusterStats {
+    unsigned int lights = 0;          // handed to assign()
+    unsigned int visibleLights = 0;   // referenced by at least one cluster
+    unsigned int references = 0;      // light indices over all clusters
+    unsigned int maxPerCluster = 0;
+    unsigned int dropped = 0;         // references over MAX_LIGHTS_PER_CLUSTER
+    double assignMs = 0.0;
+};
+
+// Clustered light assignment, on the CPU and without GL.
+//
+// The view frustum is cut into tilesX x tilesY screen tiles and `slices`
+// depth slices that grow exponentially with distance (slice = log(depth) *
+// sliceScale + sliceBias), and every cluster keeps a view-space box. assign()
+// moves the lights into view space and tests each sphere against the boxes
+// of the slices its depth range covers, four boxes per SSE instruction; the
+// slices are split into jobs for a WorkerPool. The result is a range
+// (offset, count) per cluster into one list of 16-bit light indices, which
+// Renderer3D uploads into buffer textures for 3d.fs.
+//
+// Clusters are numbered (slice * tilesY + y) * tilesX + x, with tile (0, 0)
+// at the bottom left of the screen. Only symmetric perspective projections
+// are supported.
+class LightClusterGrid
+{
+public:
+    static const unsigned int MAX_LIGHTS_PER_CLUSTER = 256;
+    static const unsigned int MAX_LIGHTS = 65535;
+
+    LightClusterGrid(int tilesX = 16, int tilesY = 9, int slices = 24);
+
+    // rebuilds the cluster boxes when the projection or depth range changed
+    void setProjection(const glm::mat4& projection, float nearPlane, float farPlane);
+
+    // assigns lights (world space) given the camera's view matrix; a null pool runs on this thread
+    void assign(const glm::mat4& view, const ClusterLight* lights, size_t count, WorkerPool* pool = nullptr);
+    // same result from every light against every box, one at a time; the reference for assign()
+    void assignBruteForce(const glm::mat4& view, const ClusterLight* lights, size_t count);
+
+    int getTilesX() const { return tilesX; }
+    int getTilesY() const { return tilesY; }
+    int getSlices() const { return slices; }
+    int getClusterCount() const { return tilesX * tilesY * slices; }
+    float getSliceScale() const { return sliceScale; }
+    float getSliceBias() const { return sliceBias; }
+
+    // per cluster: first index into getIndices() and number of lights
+    const std::vector<glm::uvec2>& getRanges() const { return ranges; }
+    const std::vector<uint16_t>& getIndices() const { return indices; }
+    const LightClusterStats& getStats() const { return stats; }
+
+    // view-space box of a cluster
+    AABB getClusterBounds(int cluster) const;
+
+private:
+    // SoA index of a tile row; rows are padded to a multiple of four boxes
+    size_t rowStart(int slice, int y) const { return (static_cast<size_t>(slice) * tilesY + y) * rowStride; }
+    void prepareLights(const glm::mat4& view, const ClusterLight* lights, size_t count);
+    void assignSlices(int firstSlice, int endSlice);
+    void compact(size_t lightCount);
+
+    int tilesX, tilesY, slices;
+    int rowStride;
+    float sliceScale = 0.0f;
+    float sliceBias = 0.0f;
+    glm::mat4 projection = glm::mat4(0.0f);
+    float nearPlane = 0.0f;
+    float farPlane = 0.0f;
+
+    // cluster boxes, structure of arrays; padding boxes are empty and never hit
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+    // lights of the current assign() in view space, with the slices they touch
+    struct ViewLight {
+        glm::vec3 center;
+        float radius;
+        int firstSlice;
+        int lastSlice;
+        uint16_t index;
+    };
+    std::vector<ViewLight> viewLights;
+
+    // per cluster light lists; a cluster is only written by the job that owns its slice
+    std::vector<std::vector<uint16_t>> clusterLights;
+    std::vector<unsigned int> clusterDropped;
+
+    std::vector<glm::uvec2> ranges;
+    std::vector<uint16_t> indices;
+    // lights some cluster references, rebuilt by compact(); kept to reuse its storage
+    std::vector<bool> referenced;
+    LightClusterStats stats;
+};
+
+#endif // LIGHT_CLUSTERS_H
@@ -0,0 +1,62 @@
+#include "Material.h"
+#include "GLStateCache.h"
+#include "../util/FileStamp.h"
+
+namespace {
+
+// the types whose samplers are numbered, texture_diffuse1, texture_diffuse2...
+const char* const NUMBERED_TYPES[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+} // namespace
+
+void Material::Add(const std::string& type, GLuint texture)
+{
+    std::string sampler = type;
+    for (size_t i = 0; i < numbered.size(); i++) {
+        if (type == NUMBERED_TYPES[i]) {
+            sampler += std::to_string(++numbered[i]);
+            break;
+        }
+    }
+    // the sampler too: the same texture as diffuse or as specular map is another material.
+    // Its terminating zero keeps the names apart
+    hash = Fnv1a(hash == 0 ? FNV1A_BASIS : hash, sampler.c_str(), sampler.size() + 1);
+    hash = Fnv1a(hash, &texture, sizeof(texture));
+    samplers.push_back(std::move(sampler));
+    textures.push_back(texture);
+    // a resolved table no longer covers every texture
+    for (ProgramTable& program : programs)
+        program.version = 0;
+}
+
+const Material::ProgramTable& Material::resolve(const Shader& shader) const
+{
+    for (const ProgramTable& program : programs) {
+        if (program.version == shader.UniformVersion())
+            return program;
+    }
+
+    ProgramTable& program = programs[nextProgram];
+    nextProgram = (nextProgram + 1) % MAX_PROGRAMS;
+    program.version = shader.UniformVersion();
+    program.bindings.clear();
+    for (size_t i = 0; i < samplers.size(); i++) {
+        UniformHandle sampler = shader.GetUniform(samplers[i].c_str());
+        if (sampler.valid())
+            program.bindings.push_back({ sampler.location, static_cast<GLuint>(i), textures[i] });
+    }
+    return program;
+}
+
+unsigned int Material::Bind(Shader& shader) const
+{
+    if (textures.empty())
+        return 0;
+    const ProgramTable& program = resolve(shader);
+    for (const Binding& binding : program.bindings) {
+        GLStateCache::ActiveTexture(GL_TEXTURE0 + binding.unit);
+        shader.SetInteger(UniformHandle{ binding.location }, static_cast<int>(binding.unit));
+        GLStateCache::BindTexture(GL_TEXTURE_2D, binding.texture);
+    }
+    return static_cast<unsigned int>(program.bindings.size());
+}
@@ -0,0 +1,60 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "Shader.h"
+
+// The textures a mesh draws with, as a binding table. The sampler each
+// texture goes to (texture_diffuse1, texture_normal1, ...) is named once,
+// when the mesh is made; the first draw with a program resolves those names
+// to uniform locations. Bind() is then a loop over the resolved table: no
+// strings, lookups or allocations per draw.
+//
+// Texture i goes to unit i, as Mesh::BindTextures always did. Render thread.
+class Material
+{
+public:
+    // programs whose table is kept at once (forward, G-buffer, shadow...); the oldest is resolved again
+    static const size_t MAX_PROGRAMS = 4;
+
+    // appends a texture of the given type (texture_diffuse, ...), numbered after those of its type already added
+    void Add(const std::string& type, GLuint texture);
+
+    // binds every texture the shader samples and points its sampler at the unit; the shader must be
+    // in use. Returns the number bound
+    unsigned int Bind(Shader& shader) const;
+
+    // FNV-1a over the samplers and texture ids in order, which decide the units; 0 without textures
+    uint64_t Hash() const { return hash; }
+    size_t TextureCount() const { return textures.size(); }
+    // per texture, in the order added
+    const std::vector<std::string>& Samplers() const { return samplers; }
+    const std::vector<GLuint>& Textures() const { return textures; }
+
+private:
+    struct Binding {
+        GLint location;
+        GLuint unit;
+        GLuint texture;
+    };
+    // the bindings one program uses, resolved at its uniform version (see Shader::UniformVersion)
+    struct ProgramTable {
+        uint32_t version = 0;
+        std::vector<Binding> bindings;
+    };
+
+    const ProgramTable& resolve(const Shader& shader) const;
+
+    std::vector<std::string> samplers; // per texture
+    std::vector<GLuint> textures;
+    std::array<unsigned int, 4> numbered = {}; // textures added of each numbered type
+    uint64_t hash = 0;
+    mutable std::array<ProgramTable, MAX_PROGRAMS> programs;
+    mutable size_t nextProgram = 0;
+};
+
+#endif // MATERIAL_H
@@ -0,0 +1,469 @@
+#include "MaterialAtlas.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include "GLStateCache.h"
+#include "RenderStats.h"
+#include "TextureStreamer.h"
+
+bool MaterialAtlas::supported = false;
+bool MaterialAtlas::bindlessSupported = false;
+bool MaterialAtlas::enabled = false;
+bool MaterialAtlas::bindless = false;
+bool MaterialAtlas::dirty = false;
+std::vector<MaterialAtlasEntry> MaterialAtlas::entries;
+MaterialAtlasStats MaterialAtlas::stats;
+
+static_assert(sizeof(MaterialDrawRecord) == 112, "MaterialDrawRecord must match the std430 MaterialDraw");
+
+namespace {
+
+// ARB_bindless_texture is not in the generated glad, its entry points are loaded by DetectSupport
+typedef GLuint64 (APIENTRYP GetTextureHandleProc)(GLuint texture);
+typedef void (APIENTRYP MakeTextureHandleResidentProc)(GLuint64 handle);
+typedef void (APIENTRYP MakeTextureHandleNonResidentProc)(GLuint64 handle);
+GetTextureHandleProc getTextureHandle = nullptr;
+MakeTextureHandleResidentProc makeTextureHandleResident = nullptr;
+MakeTextureHandleNonResidentProc makeTextureHandleNonResident = nullptr;
+
+// the samplers of a Material that go to each slot
+const char* const SLOT_SAMPLERS[MaterialAtlas::SlotCount] = {
+    "texture_diffuse1", "texture_specular1", "texture_normal1", "texture_height1"
+};
+
+// the textures of a material asked for by Find, per slot (0: none)
+typedef std::array<GLuint, MaterialAtlas::SlotCount> SlotTextures;
+std::unordered_map<uint64_t, SlotTextures> materials;
+// Material::Hash -> index into entries; -1 for a material that could not be packed
+std::unordered_map<uint64_t, int> entryIndex;
+
+// arrays path
+struct TextureInfo {
+    GLint width = 0, height = 0;
+    GLenum format = 0;   // sized internal format
+    GLint levels = 0;
+};
+struct LayerArray {
+    GLuint texture = 0;
+    GLint width, height;
+    GLenum format;
+    GLint levels;
+    GLint layers;
+};
+std::vector<LayerArray> arrays;
+std::vector<SlotTextures> batchArrays;   // per batch, the array bound to each slot's unit
+
+// bindless path: texture -> resident handle
+std::unordered_map<GLuint, GLuint64> handles;
+
+GLuint drawBuffer = 0;
+size_t drawBufferCapacity = 0;
+
+double elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// some drivers report the unsized format a texture was specified with
+GLenum sizedFormat(GLenum format)
+{
+    switch (format) {
+        case GL_RED: return GL_R8;
+        case GL_RG: return GL_RG8;
+        case GL_RGB: return GL_RGB8;
+        case GL_RGBA: return GL_RGBA8;
+        case GL_SRGB: return GL_SRGB8;
+        case GL_SRGB_ALPHA: return GL_SRGB8_ALPHA8;
+        default: return format;
+    }
+}
+
+bool queryTexture(GLuint texture, TextureInfo& info)
+{
+    GLStateCache::BindTexture(GL_TEXTURE_2D, texture);
+    GLint format = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &info.width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &info.height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    if (info.width <= 0 || info.height <= 0)
+        return false;
+    info.format = sizedFormat(static_cast<GLenum>(format));
+    // the levels actually specified: a texture without mipmaps has one
+    info.levels = 1;
+    GLint width = info.width, height = info.height;
+    while (width > 1 || height > 1) {
+        GLint levelWidth = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, info.levels, GL_TEXTURE_WIDTH, &levelWidth);
+        if (levelWidth <= 0)
+            break;
+        info.levels++;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return true;
+}
+
+// bytes of a level of the bound GL_TEXTURE_2D
+size_t levelBytes(GLint level)
+{
+    GLint compressed = 0, size = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+    if (compressed) {
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+        return static_cast<size_t>(size);
+    }
+    // close enough for the report: at most four bytes a texel in the formats meshes use
+    GLint width = 0, height = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+    return static_cast<size_t>(width) * height * 4;
+}
+
+void deleteArrays()
+{
+    for (LayerArray& array : arrays)
+        GLStateCache::DeleteTextures(1, &array.texture);
+    arrays.clear();
+    batchArrays.clear();
+}
+
+void releaseHandles()
+{
+    for (auto& handle : handles)
+        makeTextureHandleNonResident(handle.second);
+    handles.clear();
+}
+
+} // namespace
+
+void MaterialAtlas::DetectSupport(GLADloadproc loader)
+{
+    bool storage = false, drawParameters = false, bindlessTexture = false;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (!name)
+            continue;
+        storage = storage || std::strcmp(name, "GL_ARB_shader_storage_buffer_object") == 0;
+        drawParameters = drawParameters || std::strcmp(name, "GL_ARB_shader_draw_parameters") == 0;
+        bindlessTexture = bindlessTexture || std::strcmp(name, "GL_ARB_bindless_texture") == 0;
+    }
+    // glCopyImageSubData and glTexStorage3D come with 4.3 as well
+    supported = GLAD_GL_VERSION_4_3 && storage && drawParameters;
+    if (supported && bindlessTexture && loader) {
+        getTextureHandle = reinterpret_cast<GetTextureHandleProc>(loader("glGetTextureHandleARB"));
+        makeTextureHandleResident = reinterpret_cast<MakeTextureHandleResidentProc>(loader("glMakeTextureHandleResidentARB"));
+        makeTextureHandleNonResident = reinterpret_cast<MakeTextureHandleNonResidentProc>(loader("glMakeTextureHandleNonResidentARB"));
+    }
+    bindlessSupported = supported && getTextureHandle && makeTextureHandleResident && makeTextureHandleNonResident;
+    if (!supported)
+        std::cout << "Material atlas: needs GL 4.3 and ARB_shader_draw_parameters, draws are not merged" << std::endl;
+}
+
+void MaterialAtlas::SetEnabled(bool enable, bool useBindless)
+{
+    bool wasBindless = IsBindless();
+    enabled = enable;
+    bindless = useBindless && bindlessSupported;
+    if (IsBindless() != wasBindless || !IsEnabled()) {
+        // the entries point into the other mode's storage
+        Clear();
+        dirty = true;
+    }
+}
+
+int MaterialAtlas::Find(const Material& material)
+{
+    uint64_t hash = material.Hash();
+    if (hash == 0)
+        return -1;
+    auto it = entryIndex.find(hash);
+    if (it != entryIndex.end())
+        return it->second;
+
+    SlotTextures textures = {};
+    const std::vector<std::string>& samplers = material.Samplers();
+    for (size_t i = 0; i < samplers.size(); i++) {
+        for (int slot = 0; slot < SlotCount; slot++) {
+            if (samplers[i] == SLOT_SAMPLERS[slot])
+                textures[slot] = material.Textures()[i];
+        }
+    }
+    materials[hash] = textures;
+    entryIndex[hash] = -1;
+    dirty = true;
+    return -1;
+}
+
+void MaterialAtlas::Update()
+{
+    if (!IsEnabled() || !dirty)
+        return;
+    // a texture still streaming is a placeholder texel; it would be copied (or made immutable) as that
+    const TextureStreamerStats& streaming = TextureStreamer::GetStats();
+    if (streaming.decoding + streaming.waiting > 0)
+        return;
+    build();
+}
+
+void MaterialAtlas::build()
+{
+    auto start = std::chrono::steady_clock::now();
+    dirty = false;
+    entries.clear();
+    deleteArrays();
+    if (bindless)
+        releaseHandles();
+    MaterialAtlasStats next;
+    next.builds = stats.builds + 1;
+
+    // a missing slot samples the diffuse texture, as the unit-0 default of Material::Bind does
+    auto fillMissing = [](SlotTextures& textures) {
+        for (GLuint& texture : textures) {
+            if (texture == 0)
+                texture = textures[Diffuse];
+        }
+    };
+
+    if (bindless) {
+        for (auto& material : materials) {
+            SlotTextures textures = material.second;
+            fillMissing(textures);
+            if (textures[Diffuse] == 0) {
+                entryIndex[material.first] = -1;
+                continue;
+            }
+            MaterialAtlasEntry entry;
+            entry.batch = 0;   // a handle needs no binding, so every material draws together
+            for (int slot = 0; slot < SlotCount; slot++) {
+                auto handle = handles.find(textures[slot]);
+                if (handle == handles.end()) {
+                    GLuint64 value = getTextureHandle(textures[slot]);
+                    makeTextureHandleResident(value);
+                    handle = handles.emplace(textures[slot], value).first;
+                }
+                entry.layers[slot] = 0;
+                entry.handles[slot / 2][(slot % 2) * 2] = static_cast<GLuint>(handle->second & 0xFFFFFFFFu);
+                entry.handles[slot / 2][(slot % 2) * 2 + 1] = static_cast<GLuint>(handle->second >> 32);
+            }
+            entryIndex[material.first] = static_cast<int>(entries.size());
+            entries.push_back(entry);
+        }
+        next.materials = static_cast<unsigned int>(entries.size());
+        next.batches = entries.empty() ? 0 : 1;
+        next.handles = static_cast<unsigned int>(handles.size());
+    } else {
+        GLint maxLayers = 256;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+        // group the textures by size, format and mip count; each group fills arrays of up to maxLayers
+        std::unordered_map<GLuint, TextureInfo> infos;
+        std::unordered_map<GLuint, std::pair<int, GLint>> placement;   // texture -> array, layer
+        std::map<std::tuple<GLint, GLint, GLenum, GLint>, int> openArrays;
+        std::vector<std::vector<GLuint>> arrayTextures;
+        for (auto& material : materials) {
+            SlotTextures textures = material.second;
+            fillMissing(textures);
+            bool packable = textures[Diffuse] != 0;
+            for (GLuint texture : textures) {
+                if (!packable || placement.count(texture))
+                    continue;
+                TextureInfo& info = infos[texture];
+                if (!queryTexture(texture, info)) {
+                    packable = false;
+                    continue;
+                }
+                auto key = std::make_tuple(info.width, info.height, info.format, info.levels);
+                auto open = openArrays.find(key);
+                if (open == openArrays.end() || arrays[open->second].layers >= maxLayers) {
+                    arrays.push_back({ 0, info.width, info.height, info.format, info.levels, 0 });
+                    arrayTextures.emplace_back();
+                    open = openArrays.insert_or_assign(key, static_cast<int>(arrays.size() - 1)).first;
+                }
+                LayerArray& array = arrays[open->second];
+                placement[texture] = { open->second, array.layers++ };
+                arrayTextures[open->second].push_back(texture);
+            }
+            if (!packable)
+                entryIndex[material.first] = -2;   // decided below, once the arrays exist
+        }
+
+        for (size_t a = 0; a < arrays.size(); a++) {
+            LayerArray& array = arrays[a];
+            glGenTextures(1, &array.texture);
+            GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.levels, array.format, array.width, array.height, array.layers);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                            array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+#ifdef GL_MAX_TEXTURE_MAX_ANISOTROPY
+            if (array.levels > 1) {
+                float aniso = 0.0f;
+                glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &aniso);
+                if (aniso > 0.0f)
+                    glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY, aniso);
+            }
+#endif
+            for (GLint layer = 0; layer < array.layers; layer++) {
+                GLuint source = arrayTextures[a][layer];
+                GLStateCache::BindTexture(GL_TEXTURE_2D, source);
+                GLint width = array.width, height = array.height;
+                for (GLint level = 0; level < array.levels; level++) {
+                    glCopyImageSubData(source, GL_TEXTURE_2D, level, 0, 0, 0,
+                                       array.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                                       width, height, 1);
+                    next.arrayBytes += levelBytes(level);
+                    width = std::max(width / 2, 1);
+                    height = std::max(height / 2, 1);
+                }
+            }
+        }
+
+        // materials whose slots sample the same arrays form a batch
+        std::map<SlotTextures, uint32_t> batchIds;
+        for (auto& material : materials) {
+            if (entryIndex[material.first] == -2) {
+                entryIndex[material.first] = -1;
+                continue;
+            }
+            SlotTextures textures = material.second;
+            fillMissing(textures);
+            if (textures[Diffuse] == 0) {
+                entryIndex[material.first] = -1;
+                continue;
+            }
+            MaterialAtlasEntry entry;
+            SlotTextures bound = {};
+            for (int slot = 0; slot < SlotCount; slot++) {
+                const std::pair<int, GLint>& at = placement[textures[slot]];
+                bound[slot] = arrays[at.first].texture;
+                entry.layers[slot] = at.second;
+            }
+            auto batch = batchIds.find(bound);
+            if (batch == batchIds.end()) {
+                batch = batchIds.emplace(bound, static_cast<uint32_t>(batchArrays.size())).first;
+                batchArrays.push_back(bound);
+            }
+            entry.batch = batch->second;
+            entryIndex[material.first] = static_cast<int>(entries.size());
+            entries.push_back(entry);
+        }
+        next.materials = static_cast<unsigned int>(entries.size());
+        next.batches = static_cast<unsigned int>(batchArrays.size());
+        next.arrays = static_cast<unsigned int>(arrays.size());
+        for (const LayerArray& array : arrays)
+            next.layers += array.layers;
+    }
+    GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
+    GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    next.buildMs = elapsedMs(start);
+    stats = next;
+    PrintReport();
+}
+
+void MaterialAtlas::Evict(GLuint texture)
+{
+    if (texture == 0 || materials.empty())
+        return;
+    bool used = false;
+    for (auto it = materials.begin(); it != materials.end();) {
+        if (std::find(it->second.begin(), it->second.end(), texture) != it->second.end()) {
+            entryIndex.erase(it->first);
+            it = materials.erase(it);
+            used = true;
+        } else {
+            ++it;
+        }
+    }
+    auto handle = handles.find(texture);
+    if (handle != handles.end()) {
+        makeTextureHandleNonResident(handle->second);
+        handles.erase(handle);
+    }
+    if (used) {
+        // the arrays still hold copies of it, and other entries point at layers about to move
+        for (auto& index : entryIndex)
+            index.second = -1;
+        entries.clear();
+        dirty = true;
+    }
+}
+
+void MaterialAtlas::SetupProgram(Shader& shader)
+{
+    if (shader.ID == 0)
+        return;
+    GLuint block = glGetProgramResourceIndex(shader.ID, GL_SHADER_STORAGE_BLOCK, "MaterialDraws");
+    if (block != GL_INVALID_INDEX)
+        glShaderStorageBlockBinding(shader.ID, block, MATERIAL_DRAWS_BINDING);
+    shader.Use();
+    for (int slot = 0; slot < SlotCount; slot++) {
+        std::string name = "materialArrays[" + std::to_string(slot) + "]";
+        shader.SetInteger(name.c_str(), static_cast<int>(MATERIAL_ARRAY_UNIT + slot));
+    }
+}
+
+unsigned int MaterialAtlas::BindBatch(uint32_t batch)
+{
+    if (bindless || batch >= batchArrays.size())
+        return 0;
+    for (int slot = 0; slot < SlotCount; slot++)
+        GLStateCache::BindTexture(MATERIAL_ARRAY_UNIT + slot, GL_TEXTURE_2D_ARRAY, batchArrays[batch][slot]);
+    return SlotCount;
+}
+
+void MaterialAtlas::UploadDraws(const MaterialDrawRecord* records, size_t count)
+{
+    size_t bytes = count * sizeof(MaterialDrawRecord);
+    if (drawBuffer == 0)
+        glGenBuffers(1, &drawBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+    if (bytes > drawBufferCapacity) {
+        drawBufferCapacity = std::max(bytes, drawBufferCapacity * 2);
+    }
+    // orphaned every time, so the multi-draw before this one is not waited for
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawBufferCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, records);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_DRAWS_BINDING, drawBuffer);
+    RenderStats::RecordUpload(bytes);
+}
+
+void MaterialAtlas::Clear()
+{
+    deleteArrays();
+    if (!handles.empty())
+        releaseHandles();
+    entries.clear();
+    for (auto& index : entryIndex)
+        index.second = -1;
+    dirty = !materials.empty();
+    if (drawBuffer) {
+        glDeleteBuffers(1, &drawBuffer);
+        drawBuffer = 0;
+        drawBufferCapacity = 0;
+    }
+    unsigned int builds = stats.builds;
+    stats = MaterialAtlasStats();
+    stats.builds = builds;
+}
+
+void MaterialAtlas::PrintReport()
+{
+    if (stats.builds == 0)
+        return;
+    std::cout << "Material atlas: " << stats.materials << " materials in " << stats.batches << " batches; ";
+    if (IsBindless())
+        std::cout << stats.handles << " resident handles";
+    else
+        std::cout << stats.layers << " layers in " << stats.arrays << " arrays, " << stats.arrayBytes / 1024 << " KB copied";
+    std::cout << "; built " << stats.builds << " times, last in " << stats.buildMs << " ms" << std::endl;
+}
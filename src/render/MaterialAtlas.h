@@ -0,0 +1,102 @@
+#ifndef MATERIAL_ATLAS_H
+#define MATERIAL_ATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Material.h"
+
+// the material arrays take the units after the clustered light buffers (UniformBuffer.h)
+const GLuint MATERIAL_ARRAY_UNIT = 10;
+// shader storage binding point of the per-draw records
+const GLuint MATERIAL_DRAWS_BINDING = 0;
+
+// One draw of a multi-draw, as the MaterialDraws buffer holds it (std430, see
+// shaders/include/material_atlas.glsl)
+struct MaterialDrawRecord {
+    glm::mat4 model;
+    glm::ivec4 layers;      // per slot; -1 without a texture
+    glm::uvec4 handles[2];  // bindless: per slot, the low and high half of the handle
+};
+
+// Where a packed material's textures are
+struct MaterialAtlasEntry {
+    uint32_t batch = 0;     // materials of one batch sample the same arrays, so their draws can merge
+    glm::ivec4 layers = glm::ivec4(-1);
+    glm::uvec4 handles[2] = { glm::uvec4(0), glm::uvec4(0) };
+};
+
+struct MaterialAtlasStats {
+    unsigned int materials = 0;    // packed
+    unsigned int batches = 0;
+    unsigned int arrays = 0;
+    unsigned int layers = 0;
+    unsigned int handles = 0;      // bindless handles resident
+    size_t arrayBytes = 0;         // the copies in the arrays; bindless makes none
+    unsigned int builds = 0;
+    double buildMs = 0.0;          // the last build
+};
+
+// Material textures gathered so that meshes with different textures can be
+// drawn by one glMultiDrawElementsBaseVertex. With ARB_bindless_texture every
+// texture gets a resident handle; otherwise textures of the same size, format
+// and mip count are copied into the layers of a GL_TEXTURE_2D_ARRAY. Either
+// way a draw's textures are numbers in the per-draw record instead of binds,
+// and only materials whose arrays differ split a batch (bindless: none do).
+//
+// Materials are packed when RenderQueue first asks for them and the texture
+// streamer is idle, so nothing is copied or made resident while it is still a
+// placeholder. A new material repacks everything. Render thread only.
+//
+// Needs GL 4.3 (shader storage buffers, glCopyImageSubData) and
+// ARB_shader_draw_parameters for gl_DrawIDARB.
+class MaterialAtlas
+{
+public:
+    // the material slots, as shaders/include/material_atlas.glsl numbers them
+    enum Slot { Diffuse = 0, Specular = 1, Normal = 2, Height = 3, SlotCount = 4 };
+
+    // render thread, with the context current; loader resolves the bindless entry points
+    static void DetectSupport(GLADloadproc loader);
+    static bool IsSupported() { return supported; }
+    static bool IsBindlessSupported() { return bindlessSupported; }
+    static void SetEnabled(bool enabled, bool bindless);
+    static bool IsEnabled() { return enabled && supported; }
+    static bool IsBindless() { return IsEnabled() && bindless; }
+
+    // the entry of material, or -1 if it is not packed yet (it is packed by a later Update)
+    static int Find(const Material& material);
+    static const MaterialAtlasEntry& GetEntry(int index) { return entries[index]; }
+    // packs the materials asked for since the last build, once the texture streamer is idle; once a frame
+    static void Update();
+    // texture is about to be deleted: entries using it go, its handle is made non resident
+    static void Evict(GLuint texture);
+
+    // points a program built with MATERIAL_ATLAS at the draw records and the array units; once after linking
+    static void SetupProgram(Shader& shader);
+    // binds the arrays of batch and returns how many; nothing to do for bindless
+    static unsigned int BindBatch(uint32_t batch);
+    // uploads the records of one multi-draw and binds them at MATERIAL_DRAWS_BINDING
+    static void UploadDraws(const MaterialDrawRecord* records, size_t count);
+
+    // deletes the arrays, the draw buffer and the handles
+    static void Clear();
+
+    static const MaterialAtlasStats& GetStats() { return stats; }
+    static void PrintReport();
+
+private:
+    static void build();
+
+    static bool supported;
+    static bool bindlessSupported;
+    static bool enabled;
+    static bool bindless;
+    static bool dirty;
+    static std::vector<MaterialAtlasEntry> entries;
+    static MaterialAtlasStats stats;
+};
+
+#endif // MATERIAL_ATLAS_H
@@ -0,0 +1,412 @@
+#include "MeshCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <type_traits>
+#include "../util/FileStamp.h"
+
+bool MeshCache::enabled = true;
+std::string MeshCache::directory = "bin/models/cooked";
+MeshCacheStats MeshCache::stats;
+
+namespace {
+
+// Load and Store run on the ModelLoader threads
+std::mutex statsMutex;
+
+const char CACHE_MAGIC[4] = { 'M', '3', 'D', 'M' };
+const uint32_t CACHE_VERSION = 1;
+
+// index of each layout in the file; the strides are stored too and checked
+const VertexLayout* const LAYOUTS[] = {
+    &m3D::PackedVertexLayout, &m3D::PackedVertexWideUVLayout,
+    &m3D::SkinnedVertexLayout, &m3D::SkinnedVertexWideUVLayout
+};
+const uint32_t LAYOUT_COUNT = sizeof(LAYOUTS) / sizeof(LAYOUTS[0]);
+
+struct FileString {
+    uint32_t offset;   // into the string section
+    uint32_t length;
+};
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t dependencyCount;
+    uint32_t textureCount;
+    uint32_t meshCount;
+    uint32_t textureUseCount;
+    uint64_t dependencyOffset;
+    uint64_t textureOffset;
+    uint64_t meshOffset;
+    uint64_t textureUseOffset;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+    uint64_t fileSize;
+    double importMs;   // what importing from source cost, for the startup report
+};
+
+struct FileDependency {
+    FileString path;
+    uint64_t size;
+    int64_t modified;
+    uint64_t hash;
+};
+
+struct FileTexture {
+    uint32_t kind;
+    FileString type;
+    FileString path;
+    float color[3];
+    uint32_t width;
+    uint32_t height;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+struct FileMesh {
+    uint32_t layout;
+    uint32_t stride;
+    uint32_t secondaryStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    MeshLod lods[MeshSimplifier::MAX_LODS];
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t firstTextureUse;
+    uint32_t textureUseCount;
+    uint64_t vertexOffset;
+    uint64_t skinOffset;   // 0 without the skinning stream
+    uint64_t indexOffset;
+};
+
+static_assert(std::is_trivially_copyable<FileMesh>::value, "mesh table entries are written as bytes");
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// the section [offset, offset + size) lies inside the file
+bool inside(uint64_t offset, uint64_t size, size_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+} // namespace
+
+std::string MeshCache::pathFor(const std::string& sourcePath)
+{
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(HashString(sourcePath)));
+    return directory + "/" + std::filesystem::path(sourcePath).stem().string() + "-" + key + ".m3dmesh";
+}
+
+bool MeshCache::Load(const std::string& sourcePath, MeshCacheFile& file)
+{
+    if (!enabled)
+        return false;
+    auto start = std::chrono::steady_clock::now();
+    const std::string path = pathFor(sourcePath);
+    if (!file.mapping.open(path))
+        return false;
+
+    double importMs = 0.0;
+    if (!parse(file, importMs)) {
+        file.mapping.close();
+        file.meshes.clear();
+        file.textures.clear();
+        std::cout << "Mesh cache: discarding stale entry " << path << std::endl;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.stale++;
+        return false;
+    }
+
+    double loadMs = elapsedMs(start);
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.hits++;
+    stats.loadMs += loadMs;
+    stats.savedMs += importMs - loadMs;
+    std::cout << "Mesh cache: mapped " << file.meshes.size() << " meshes from " << path << std::endl;
+    return true;
+}
+
+bool MeshCache::parse(MeshCacheFile& file, double& importMs)
+{
+    const unsigned char* data = file.mapping.data();
+    const size_t size = file.mapping.size();
+
+    FileHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (!std::equal(header.magic, header.magic + 4, CACHE_MAGIC) || header.version != CACHE_VERSION ||
+        header.fileSize != size ||
+        !inside(header.dependencyOffset, uint64_t(header.dependencyCount) * sizeof(FileDependency), size) ||
+        !inside(header.textureOffset, uint64_t(header.textureCount) * sizeof(FileTexture), size) ||
+        !inside(header.meshOffset, uint64_t(header.meshCount) * sizeof(FileMesh), size) ||
+        !inside(header.textureUseOffset, uint64_t(header.textureUseCount) * sizeof(uint32_t), size) ||
+        !inside(header.stringOffset, header.stringSize, size))
+        return false;
+    importMs = header.importMs;
+
+    const char* strings = reinterpret_cast<const char*>(data + header.stringOffset);
+    auto text = [&](const FileString& string, std::string& out) {
+        if (!inside(string.offset, string.length, header.stringSize))
+            return false;
+        out.assign(strings + string.offset, string.length);
+        return true;
+    };
+
+    // a dependency whose stamp changed is hashed; only different content is stale
+    for (uint32_t i = 0; i < header.dependencyCount; i++) {
+        FileDependency dependency;
+        std::memcpy(&dependency, data + header.dependencyOffset + i * sizeof(FileDependency), sizeof(dependency));
+        std::string dependencyPath;
+        uint64_t currentSize = 0, currentHash = 0;
+        int64_t modified = 0;
+        if (!text(dependency.path, dependencyPath) || !GetFileStamp(dependencyPath, currentSize, modified) ||
+            currentSize != dependency.size)
+            return false;
+        if (modified != dependency.modified && (!HashFile(dependencyPath, currentHash) || currentHash != dependency.hash))
+            return false;
+    }
+
+    file.textures.resize(header.textureCount);
+    for (uint32_t i = 0; i < header.textureCount; i++) {
+        FileTexture entry;
+        std::memcpy(&entry, data + header.textureOffset + i * sizeof(FileTexture), sizeof(entry));
+        CookedTexture& texture = file.textures[i];
+        if (entry.kind > uint32_t(CookedTextureKind::Embedded) || !text(entry.type, texture.type) ||
+            !text(entry.path, texture.path) || !inside(entry.dataOffset, entry.dataSize, size))
+            return false;
+        texture.kind = static_cast<CookedTextureKind>(entry.kind);
+        texture.color = glm::vec3(entry.color[0], entry.color[1], entry.color[2]);
+        texture.width = entry.width;
+        texture.height = entry.height;
+        texture.data = entry.dataSize ? data + entry.dataOffset : nullptr;
+        texture.dataSize = entry.dataSize;
+    }
+
+    const uint32_t* uses = reinterpret_cast<const uint32_t*>(data + header.textureUseOffset);
+    file.meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        FileMesh entry;
+        std::memcpy(&entry, data + header.meshOffset + i * sizeof(FileMesh), sizeof(entry));
+        if (entry.layout >= LAYOUT_COUNT || entry.lodCount == 0 || entry.lodCount > MeshSimplifier::MAX_LODS)
+            return false;
+        const VertexLayout* layout = LAYOUTS[entry.layout];
+        if (entry.stride != uint32_t(layout->stride) || entry.secondaryStride != uint32_t(layout->secondaryStride) ||
+            !inside(entry.vertexOffset, uint64_t(entry.vertexCount) * layout->stride, size) ||
+            !inside(entry.skinOffset, uint64_t(entry.vertexCount) * layout->secondaryStride, size) ||
+            !inside(entry.indexOffset, uint64_t(entry.indexCount) * sizeof(GLuint), size) ||
+            uint64_t(entry.firstTextureUse) + entry.textureUseCount > header.textureUseCount)
+            return false;
+
+        CookedMesh& mesh = file.meshes[i];
+        mesh.layout = layout;
+        mesh.vertices = data + entry.vertexOffset;
+        mesh.skin = layout->secondaryStride ? data + entry.skinOffset : nullptr;
+        mesh.vertexCount = entry.vertexCount;
+        mesh.indices = reinterpret_cast<const GLuint*>(data + entry.indexOffset);
+        mesh.indexCount = entry.indexCount;
+        mesh.lods.assign(entry.lods, entry.lods + entry.lodCount);
+        for (const MeshLod& lod : mesh.lods) {
+            if (uint64_t(lod.firstIndex) + uint64_t(std::max(lod.indexCount, 0)) > entry.indexCount)
+                return false;
+        }
+        mesh.bounds.min = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        mesh.bounds.max = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+        mesh.textures.assign(uses + entry.firstTextureUse, uses + entry.firstTextureUse + entry.textureUseCount);
+        for (uint32_t texture : mesh.textures) {
+            if (texture >= header.textureCount)
+                return false;
+        }
+    }
+    return true;
+}
+
+void MeshCache::Store(const std::string& sourcePath, const std::vector<std::string>& dependencies,
+                      const std::vector<CookedMesh>& meshes, const std::vector<CookedTexture>& textures,
+                      double importMs)
+{
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.misses++;
+        stats.importMs += importMs;
+    }
+    if (!enabled)
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cout << "Mesh cache: could not create " << directory << ": " << error.message() << std::endl;
+        return;
+    }
+
+    std::string strings;
+    auto addString = [&](const std::string& text) {
+        FileString string = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size()) };
+        strings += text;
+        return string;
+    };
+
+    // the source itself first, then whatever else the importer opened
+    std::vector<std::string> files(1, sourcePath);
+    for (const std::string& dependency : dependencies) {
+        if (std::find(files.begin(), files.end(), dependency) == files.end())
+            files.push_back(dependency);
+    }
+    std::vector<FileDependency> dependencyTable;
+    for (const std::string& dependencyPath : files) {
+        FileDependency dependency = {};
+        if (!GetFileStamp(dependencyPath, dependency.size, dependency.modified) ||
+            !HashFile(dependencyPath, dependency.hash))
+            continue; // opened but gone again (e.g. a probe for a file that does not exist)
+        dependency.path = addString(dependencyPath);
+        dependencyTable.push_back(dependency);
+    }
+
+    FileHeader header = {};
+    std::copy(CACHE_MAGIC, CACHE_MAGIC + 4, header.magic);
+    header.version = CACHE_VERSION;
+    header.dependencyCount = static_cast<uint32_t>(dependencyTable.size());
+    header.textureCount = static_cast<uint32_t>(textures.size());
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.importMs = importMs;
+
+    std::vector<FileTexture> textureTable(textures.size());
+    for (size_t i = 0; i < textures.size(); i++) {
+        const CookedTexture& texture = textures[i];
+        FileTexture& entry = textureTable[i];
+        entry = {};
+        entry.kind = static_cast<uint32_t>(texture.kind);
+        entry.type = addString(texture.type);
+        entry.path = addString(texture.path);
+        entry.color[0] = texture.color.r;
+        entry.color[1] = texture.color.g;
+        entry.color[2] = texture.color.b;
+        entry.width = texture.width;
+        entry.height = texture.height;
+        entry.dataSize = texture.data ? texture.dataSize : 0;
+    }
+
+    std::vector<FileMesh> meshTable(meshes.size());
+    std::vector<uint32_t> textureUses;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const CookedMesh& mesh = meshes[i];
+        FileMesh& entry = meshTable[i];
+        entry = {};
+        entry.layout = static_cast<uint32_t>(std::find(LAYOUTS, LAYOUTS + LAYOUT_COUNT, mesh.layout) - LAYOUTS);
+        if (entry.layout == LAYOUT_COUNT) {
+            std::cout << "Mesh cache: not storing " << sourcePath << ", a mesh has an unknown vertex layout" << std::endl;
+            return;
+        }
+        entry.stride = static_cast<uint32_t>(mesh.layout->stride);
+        entry.secondaryStride = static_cast<uint32_t>(mesh.layout->secondaryStride);
+        entry.vertexCount = mesh.vertexCount;
+        entry.indexCount = mesh.indexCount;
+        entry.lodCount = static_cast<uint32_t>(std::min<size_t>(mesh.lods.size(), MeshSimplifier::MAX_LODS));
+        std::copy(mesh.lods.begin(), mesh.lods.begin() + entry.lodCount, entry.lods);
+        for (int axis = 0; axis < 3; axis++) {
+            entry.boundsMin[axis] = mesh.bounds.min[axis];
+            entry.boundsMax[axis] = mesh.bounds.max[axis];
+        }
+        entry.firstTextureUse = static_cast<uint32_t>(textureUses.size());
+        entry.textureUseCount = static_cast<uint32_t>(mesh.textures.size());
+        textureUses.insert(textureUses.end(), mesh.textures.begin(), mesh.textures.end());
+    }
+    header.textureUseCount = static_cast<uint32_t>(textureUses.size());
+
+    // tables, then the strings, then every blob on an aligned offset so it can be uploaded in place
+    uint64_t offset = sizeof(FileHeader);
+    header.dependencyOffset = offset;
+    offset += dependencyTable.size() * sizeof(FileDependency);
+    header.textureOffset = offset;
+    offset += textureTable.size() * sizeof(FileTexture);
+    header.meshOffset = offset;
+    offset += meshTable.size() * sizeof(FileMesh);
+    header.textureUseOffset = offset;
+    offset += textureUses.size() * sizeof(uint32_t);
+    header.stringOffset = offset;
+    header.stringSize = strings.size();
+    offset += strings.size();
+
+    struct Blob {
+        const void* data;
+        uint64_t size;
+        uint64_t offset;
+    };
+    std::vector<Blob> blobs;
+    auto addBlob = [&](const void* data, uint64_t size) {
+        offset = alignUp(offset, BLOB_ALIGNMENT);
+        blobs.push_back({data, size, offset});
+        offset += size;
+        return blobs.back().offset;
+    };
+    for (size_t i = 0; i < textures.size(); i++) {
+        if (textureTable[i].dataSize)
+            textureTable[i].dataOffset = addBlob(textures[i].data, textureTable[i].dataSize);
+    }
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const CookedMesh& mesh = meshes[i];
+        FileMesh& entry = meshTable[i];
+        entry.vertexOffset = addBlob(mesh.vertices, uint64_t(mesh.vertexCount) * mesh.layout->stride);
+        if (mesh.layout->secondaryStride)
+            entry.skinOffset = addBlob(mesh.skin, uint64_t(mesh.vertexCount) * mesh.layout->secondaryStride);
+        entry.indexOffset = addBlob(mesh.indices, uint64_t(mesh.indexCount) * sizeof(GLuint));
+    }
+    header.fileSize = offset;
+
+    // write next to the final name and rename, so a crash never leaves half a file behind
+    const std::string path = pathFor(sourcePath);
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(dependencyTable.data()), dependencyTable.size() * sizeof(FileDependency));
+        out.write(reinterpret_cast<const char*>(textureTable.data()), textureTable.size() * sizeof(FileTexture));
+        out.write(reinterpret_cast<const char*>(meshTable.data()), meshTable.size() * sizeof(FileMesh));
+        out.write(reinterpret_cast<const char*>(textureUses.data()), textureUses.size() * sizeof(uint32_t));
+        out.write(strings.data(), strings.size());
+        uint64_t written = header.stringOffset + strings.size();
+        static const char padding[BLOB_ALIGNMENT] = {};
+        for (const Blob& blob : blobs) {
+            out.write(padding, blob.offset - written);
+            out.write(static_cast<const char*>(blob.data), blob.size);
+            written = blob.offset + blob.size;
+        }
+        if (!out) {
+            std::cout << "Mesh cache: could not write " << temporary << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+        std::cout << "Mesh cache: could not store " << path << ": " << error.message() << std::endl;
+    else
+        std::cout << "Mesh cache: stored " << meshes.size() << " meshes (" << header.fileSize / 1024 << " KB) in "
+                  << path << std::endl;
+}
+
+void MeshCache::PrintReport()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    std::printf("Mesh cache: %u hits, %u imported (%u stale); %.1f ms mapping caches, %.1f ms importing, "
+                "%.1f ms of startup saved\n",
+                stats.hits, stats.misses, stats.stale, stats.loadMs, stats.importMs, stats.savedMs);
+}
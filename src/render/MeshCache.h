@@ -0,0 +1,110 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../Mesh.hpp"
+#include "../util/MappedFile.h"
+
+// How a material texture is recreated without the source scene
+enum class CookedTextureKind : uint32_t {
+    File = 0,      // an image next to the model, path relative to its directory
+    Color = 1,     // a 1x1 texture of a material's diffuse colour
+    Embedded = 2   // image data that was inside the model file; stored in the cache
+};
+
+struct CookedTexture {
+    CookedTextureKind kind = CookedTextureKind::File;
+    std::string type;                  // texture_diffuse, texture_normal, ...
+    std::string path;
+    glm::vec3 color = glm::vec3(0.0f);
+    // Embedded: a compressed image file when height is 0, else width x height RGBA texels
+    uint32_t width = 0, height = 0;
+    const unsigned char* data = nullptr;
+    size_t dataSize = 0;
+};
+
+// A mesh as PackedMesh lays it out, by pointer: into the import's buffers
+// when storing, into the mapped file when loading
+struct CookedMesh {
+    const VertexLayout* layout = nullptr;
+    const void* vertices = nullptr;
+    const void* skin = nullptr;
+    GLuint vertexCount = 0;
+    const GLuint* indices = nullptr;   // every level
+    GLuint indexCount = 0;
+    std::vector<MeshLod> lods;
+    AABB bounds;
+    std::vector<uint32_t> textures;    // into the texture table
+};
+
+// A cache file mapped into memory; the cooked meshes and the embedded
+// texture data point into the mapping and are valid while this lives
+class MeshCacheFile
+{
+public:
+    std::vector<CookedMesh> meshes;
+    std::vector<CookedTexture> textures;
+
+private:
+    friend class MeshCache;
+    MappedFile mapping;
+};
+
+struct MeshCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;       // imported (and stored if possible)
+    unsigned int stale = 0;        // a source changed since the file was cooked
+    double loadMs = 0.0;           // mapping cache files and validating them
+    double importMs = 0.0;         // importing the misses
+    double savedMs = 0.0;          // import time recorded for the hits, minus loadMs
+};
+
+// On-disk cache of imported models, cooked into the packed form their meshes
+// are uploaded in (vertices, every LOD's indices, bounds, texture references).
+//
+// Files are named after a hash of the source path and record the size,
+// modification time and content hash of every file the import read (the
+// model and companions such as .mtl or .bin), so editing any of them
+// re-imports; a touched but unchanged file still hits. Texture images are
+// only referenced and read at load time as before. Loading maps the file
+// and uploads from the mapping. Load and Store may run on several threads
+// at once, for different sources.
+//
+// Layout, every blob aligned to BLOB_ALIGNMENT:
+//   header | dependency table | texture table | mesh table | texture uses | strings | blobs
+class MeshCache
+{
+public:
+    static const uint32_t BLOB_ALIGNMENT = 64;
+
+    static void SetEnabled(bool enabled) { MeshCache::enabled = enabled; }
+    static bool IsEnabled() { return enabled; }
+    static void SetDirectory(const std::string& directory) { MeshCache::directory = directory; }
+    static const std::string& GetDirectory() { return directory; }
+
+    // Maps the cooked file of sourcePath if there is one and none of its
+    // dependencies changed; stale files are deleted
+    static bool Load(const std::string& sourcePath, MeshCacheFile& file);
+
+    // Cooks what an import of sourcePath produced. dependencies are the files
+    // the import read; importMs is what it cost, for the report
+    static void Store(const std::string& sourcePath, const std::vector<std::string>& dependencies,
+                      const std::vector<CookedMesh>& meshes, const std::vector<CookedTexture>& textures,
+                      double importMs);
+
+    static const MeshCacheStats& GetStats() { return stats; }
+    static void PrintReport();
+
+private:
+    static std::string pathFor(const std::string& sourcePath);
+    static bool parse(MeshCacheFile& file, double& importMs);
+
+    static bool enabled;
+    static std::string directory;
+    static MeshCacheStats stats;
+};
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,353 @@
+#include "MeshLod.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool LodSelector::Enabled = true;
+float LodSelector::PixelError = 1.0f;
+float LodSelector::Hysteresis = 0.25f;
+LodSelectionStats LodSelector::Stats;
+glm::vec3 LodSelector::cameraPosition = glm::vec3(0.0f);
+float LodSelector::pixelScale = 0.0f;
+bool LodSelector::persistent = true;
+
+namespace {
+
+// Sum of squared distances to a set of planes, weighted by triangle area:
+// Q(p) = p^T A p + 2 b.p + c with A symmetric
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::dvec3& n, double d, double w) {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+        b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+    }
+
+    double evaluate(const glm::dvec3& p) const {
+        double result = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                        2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                        2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double error; // mean squared distance, relative to the bounding radius
+};
+
+inline uint64_t edgeKey(unsigned int a, unsigned int b) {
+    return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a);
+}
+
+// State of one simplification, so that a LOD chain continues collapsing
+// where the previous level stopped instead of starting over
+class EdgeCollapser {
+public:
+    EdgeCollapser(const unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount,
+                  size_t positionStride);
+
+    // collapses until at most targetIndexCount indices remain or the cheapest
+    // collapse exceeds targetError; returns the largest error so far
+    float collapseTo(size_t targetIndexCount, float targetError);
+    const std::vector<unsigned int>& indices() const { return triangles; }
+
+private:
+    bool flipsTriangle(unsigned int from, unsigned int to) const;
+    size_t collapsePass(size_t targetIndexCount, double limit);
+
+    std::vector<unsigned int> triangles;
+    std::vector<glm::dvec3> points;   // inside the unit bounding sphere
+    std::vector<Quadric> quadrics;
+    std::vector<uint8_t> locked;
+    double reached = 0.0;             // squared
+
+    // scratch of collapsePass()
+    std::vector<uint64_t> edges;
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> remap;
+    std::vector<uint8_t> touched;
+    std::vector<unsigned int> triangleOffsets; // vertex -> triangles adjacency
+    std::vector<unsigned int> vertexTriangles;
+};
+
+EdgeCollapser::EdgeCollapser(const unsigned int* indices, size_t indexCount, const float* positions,
+                             size_t vertexCount, size_t positionStride)
+{
+    triangles.reserve(indexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        if (indices[i] == indices[i + 1] || indices[i] == indices[i + 2] || indices[i + 1] == indices[i + 2])
+            continue;
+        triangles.insert(triangles.end(), indices + i, indices + i + 3);
+    }
+
+    // work inside the unit bounding sphere, so errors come out relative to the radius
+    AABB bounds;
+    points.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * positionStride);
+        points[v] = glm::dvec3(p[0], p[1], p[2]);
+        bounds.expand(glm::vec3(p[0], p[1], p[2]));
+    }
+    const glm::dvec3 center = glm::dvec3(bounds.center());
+    const double radius = std::max(double(glm::length(bounds.extents())), 1e-12);
+    for (glm::dvec3& point : points)
+        point = (point - center) / radius;
+
+    // border edges belong to one triangle only
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        for (int k = 0; k < 3; k++)
+            edges.push_back(edgeKey(triangles[i + k], triangles[i + (k + 1) % 3]));
+    }
+    std::sort(edges.begin(), edges.end());
+    locked.assign(vertexCount, 0);
+    for (size_t i = 0; i < edges.size();) {
+        size_t end = i + 1;
+        while (end < edges.size() && edges[end] == edges[i])
+            end++;
+        if (end - i == 1) {
+            locked[edges[i] >> 32] = 1;
+            locked[edges[i] & 0xFFFFFFFFu] = 1;
+        }
+        i = end;
+    }
+
+    quadrics.resize(vertexCount);
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        const glm::dvec3& p0 = points[triangles[i]];
+        glm::dvec3 normal = glm::cross(points[triangles[i + 1]] - p0, points[triangles[i + 2]] - p0);
+        double length = glm::length(normal);
+        if (length <= 0.0)
+            continue;
+        normal /= length;
+        for (int k = 0; k < 3; k++)
+            quadrics[triangles[i + k]].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+    }
+
+    remap.resize(vertexCount);
+    touched.resize(vertexCount);
+    triangleOffsets.resize(vertexCount + 1);
+}
+
+float EdgeCollapser::collapseTo(size_t targetIndexCount, float targetError)
+{
+    const double limit = double(targetError) * targetError;
+    // each pass collapses a set of independent edges, then rebuilds the topology
+    while (triangles.size() > targetIndexCount && collapsePass(targetIndexCount, limit) > 0) {
+    }
+    return static_cast<float>(std::sqrt(reached));
+}
+
+// true if moving `from` onto `to` turns one of its surviving triangles over
+bool EdgeCollapser::flipsTriangle(unsigned int from, unsigned int to) const
+{
+    for (unsigned int i = triangleOffsets[from]; i < triangleOffsets[from + 1]; i++) {
+        const unsigned int* corners = &triangles[vertexTriangles[i] * 3];
+        if (corners[0] == to || corners[1] == to || corners[2] == to)
+            continue; // collapses to nothing
+
+        glm::dvec3 before[3], after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = points[corners[k]];
+            after[k] = corners[k] == from ? points[to] : before[k];
+        }
+        glm::dvec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::dvec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+        // also rejects triangles that turn by more than ~75 degrees
+        if (glm::dot(n0, n1) < 0.25 * glm::length(n0) * glm::length(n1))
+            return true;
+    }
+    return false;
+}
+
+size_t EdgeCollapser::collapsePass(size_t targetIndexCount, double limit)
+{
+    const size_t vertexCount = points.size();
+    edges.clear();
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        for (int k = 0; k < 3; k++)
+            edges.push_back(edgeKey(triangles[i + k], triangles[i + (k + 1) % 3]));
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // the cheaper direction of every edge that may collapse
+    collapses.clear();
+    for (uint64_t edge : edges) {
+        unsigned int a = static_cast<unsigned int>(edge >> 32);
+        unsigned int b = static_cast<unsigned int>(edge & 0xFFFFFFFFu);
+        if (locked[a] && locked[b])
+            continue;
+        Quadric merged = quadrics[a];
+        merged.add(quadrics[b]);
+        const double weight = std::max(merged.weight, 1e-30);
+        double intoB = locked[a] ? std::numeric_limits<double>::max() : merged.evaluate(points[b]) / weight;
+        double intoA = locked[b] ? std::numeric_limits<double>::max() : merged.evaluate(points[a]) / weight;
+        if (intoB <= intoA)
+            collapses.push_back({a, b, intoB});
+        else
+            collapses.push_back({b, a, intoA});
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+        return x.error != y.error ? x.error < y.error : (x.from != y.from ? x.from < y.from : x.to < y.to);
+    });
+
+    std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0u);
+    for (unsigned int index : triangles)
+        triangleOffsets[index + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        triangleOffsets[v + 1] += triangleOffsets[v];
+    vertexTriangles.resize(triangles.size());
+    remap.assign(triangleOffsets.begin(), triangleOffsets.end() - 1); // fill cursors for now
+    for (size_t i = 0; i < triangles.size(); i++)
+        vertexTriangles[remap[triangles[i]]++] = static_cast<unsigned int>(i / 3);
+
+    for (size_t v = 0; v < vertexCount; v++)
+        remap[v] = static_cast<unsigned int>(v);
+    std::fill(touched.begin(), touched.end(), 0);
+
+    size_t triangleCount = triangles.size() / 3;
+    const size_t targetTriangles = targetIndexCount / 3;
+    size_t applied = 0;
+    for (const Collapse& collapse : collapses) {
+        if (collapse.error > limit || triangleCount <= targetTriangles)
+            break;
+        if (touched[collapse.from] || touched[collapse.to] || flipsTriangle(collapse.from, collapse.to))
+            continue;
+
+        // the triangles around `from` change shape, so their vertices wait for the next pass
+        for (unsigned int i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++) {
+            const unsigned int* corners = &triangles[vertexTriangles[i] * 3];
+            touched[corners[0]] = touched[corners[1]] = touched[corners[2]] = 1;
+            if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+                triangleCount--;
+        }
+        remap[collapse.from] = collapse.to;
+        quadrics[collapse.to].add(quadrics[collapse.from]);
+        reached = std::max(reached, collapse.error);
+        applied++;
+    }
+
+    if (applied > 0) {
+        size_t write = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            unsigned int a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+            if (a == b || a == c || b == c)
+                continue;
+            triangles[write++] = a;
+            triangles[write++] = b;
+            triangles[write++] = c;
+        }
+        triangles.resize(write);
+    }
+    return applied;
+}
+
+} // namespace
+
+float MeshSimplifier::Simplify(std::vector<unsigned int>& destination, const unsigned int* indices, size_t indexCount,
+                               const float* positions, size_t vertexCount, size_t positionStride,
+                               size_t targetIndexCount, float targetError)
+{
+    EdgeCollapser collapser(indices, indexCount, positions, vertexCount, positionStride);
+    float error = collapser.collapseTo(targetIndexCount, targetError);
+    destination = collapser.indices();
+    return error;
+}
+
+MeshLodChain MeshSimplifier::BuildLodChain(const unsigned int* indices, size_t indexCount,
+                                           const float* positions, size_t vertexCount, size_t positionStride)
+{
+    // beyond this a level is only drawn for a few pixels anyway
+    const float maxError = 0.25f;
+
+    MeshLodChain chain;
+    if (indexCount < MIN_LOD_INDICES || vertexCount == 0)
+        return chain;
+
+    // every level continues from the one before; the quadrics still hold the
+    // planes of the full mesh, so the errors are measured against it
+    EdgeCollapser collapser(indices, indexCount, positions, vertexCount, positionStride);
+    size_t previousCount = indexCount;
+    for (int lod = 1; lod < MAX_LODS && previousCount >= MIN_LOD_INDICES; lod++) {
+        float error = collapser.collapseTo((indexCount >> lod) / 3 * 3, maxError);
+        const std::vector<unsigned int>& level = collapser.indices();
+        if (level.empty() || level.size() > previousCount * 4 / 5)
+            break;
+
+        MeshLod lodRange;
+        lodRange.firstIndex = static_cast<GLuint>(chain.indices.size());
+        lodRange.indexCount = static_cast<GLsizei>(level.size());
+        lodRange.error = error;
+        chain.levels.push_back(lodRange);
+        chain.indices.insert(chain.indices.end(), level.begin(), level.end());
+        previousCount = level.size();
+    }
+    return chain;
+}
+
+void LodSelector::SetView(const glm::vec3& position, float scale, bool keepSelection)
+{
+    cameraPosition = position;
+    pixelScale = scale;
+    persistent = keepSelection;
+}
+
+float LodSelector::ProjectedRadius(const AABB& localBounds, const glm::mat4& model)
+{
+    if (!localBounds.valid())
+        return std::numeric_limits<float>::max();
+    const glm::vec3 center = glm::vec3(model * glm::vec4(localBounds.center(), 1.0f));
+    const float scale = std::max(glm::length(glm::vec3(model[0])),
+                                 std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    const float radius = glm::length(localBounds.extents()) * scale;
+    const float distance = glm::length(center - cameraPosition);
+    if (distance <= radius)
+        return std::numeric_limits<float>::max(); // camera inside the sphere
+    return radius * pixelScale / distance;
+}
+
+int LodSelector::Select(const std::vector<MeshLod>& lods, float projectedRadius, uint8_t& current)
+{
+    const int count = static_cast<int>(lods.size());
+    int level = 0;
+    if (Enabled && count > 1) {
+        // the errors grow with the level
+        int desired = 0;
+        while (desired + 1 < count && lods[desired + 1].error * projectedRadius <= PixelError)
+            desired++;
+
+        level = std::min<int>(current, count - 1);
+        if (desired > level) {
+            // coarser only once the error is comfortably inside the budget
+            while (desired > level && lods[desired].error * projectedRadius > PixelError * (1.0f - Hysteresis))
+                desired--;
+            level = desired;
+        } else if (desired < level && lods[level].error * projectedRadius > PixelError * (1.0f + Hysteresis)) {
+            level = desired;
+        }
+        if (persistent)
+            current = static_cast<uint8_t>(level);
+    }
+
+    Stats.draws[level]++;
+    if (count > 0) {
+        Stats.indices += lods[level].indexCount;
+        Stats.fullIndices += lods[0].indexCount;
+    }
+    return level;
+}
@@ -0,0 +1,97 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+// One level of detail of a mesh: a range of its index list
+struct MeshLod {
+    GLuint firstIndex = 0;   // relative to the first index of the mesh
+    GLsizei indexCount = 0;
+    float error = 0.0f;      // quadric (RMS) distance to the full mesh, relative to its bounding radius
+};
+
+// The simplified levels of a mesh, built before it is uploaded: their indices
+// back to back and where each level starts inside them. Level 0 (the full
+// mesh) is not part of the chain.
+struct MeshLodChain {
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> levels;
+};
+
+// Level currently drawn by an object, one per mesh; kept between frames so
+// that LodSelector can apply hysteresis
+typedef std::vector<uint8_t> LodSelection;
+
+// Quadric error metric simplification (Garland & Heckbert) by half-edge
+// collapse: a vertex is merged into a neighbour, so the remaining vertices
+// keep their attributes and the levels share the mesh's vertex buffer.
+// Vertices on open borders (which includes UV and normal seams, where the
+// index topology is split) are locked so that the outline does not crack.
+class MeshSimplifier
+{
+public:
+    static const int MAX_LODS = 4;                 // level 0 included
+    static const size_t MIN_LOD_INDICES = 3 * 64;  // smaller meshes get no levels
+
+    // Collapses edges, cheapest first, until at most targetIndexCount indices
+    // remain or the next collapse would exceed targetError (relative to the
+    // bounding radius). positions point at the first float of vertex 0 and
+    // are positionStride bytes apart. Returns the error reached.
+    static float Simplify(std::vector<unsigned int>& destination, const unsigned int* indices, size_t indexCount,
+                          const float* positions, size_t vertexCount, size_t positionStride,
+                          size_t targetIndexCount, float targetError);
+
+    // Up to MAX_LODS - 1 levels, each about half the triangles of the one
+    // before; stops early once a level barely reduces anything
+    static MeshLodChain BuildLodChain(const unsigned int* indices, size_t indexCount,
+                                      const float* positions, size_t vertexCount, size_t positionStride);
+};
+
+struct LodSelectionStats {
+    unsigned int draws[MeshSimplifier::MAX_LODS] = {};
+    unsigned int indices = 0;      // drawn with the selected levels
+    unsigned int fullIndices = 0;  // the same draws at level 0
+
+    void reset() { *this = LodSelectionStats(); }
+};
+
+// Picks the level of a mesh from the size of its bounding sphere on screen:
+// the coarsest level whose error projects to at most pixelError pixels. A
+// level in use is kept until its error leaves the band pixelError * (1 +-
+// hysteresis), so objects near a threshold do not flicker between levels.
+class LodSelector
+{
+public:
+    static bool Enabled;
+    static float PixelError;
+    static float Hysteresis;
+
+    // Camera of the following draws; scale is projection[1][1] * viewport height / 2.
+    // Views that are not the main camera (mirrors, probes) pass keepSelection = false
+    // so they do not disturb the selection kept for the main view.
+    static void SetView(const glm::vec3& position, float scale, bool keepSelection = true);
+
+    // radius in pixels of the bounding sphere of localBounds under model
+    static float ProjectedRadius(const AABB& localBounds, const glm::mat4& model);
+
+    // level to draw; current is the object's selection from the last frame and is updated
+    static int Select(const std::vector<MeshLod>& lods, float projectedRadius, uint8_t& current);
+    static int Select(const std::vector<MeshLod>& lods, const AABB& localBounds, const glm::mat4& model,
+                      uint8_t& current) {
+        return Select(lods, ProjectedRadius(localBounds, model), current);
+    }
+
+    static LodSelectionStats Stats;
+
+private:
+    static glm::vec3 cameraPosition;
+    static float pixelScale;
+    static bool persistent;
+};
+
+#endif // MESH_LOD_H
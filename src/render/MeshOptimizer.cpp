@@ -0,0 +1,357 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+namespace {
+
+const unsigned int INVALID_INDEX = ~0u;
+
+// Forsyth's scoring: the three most recent vertices score flat (so strips do
+// not just swing back and forth), older entries decay, and vertices with few
+// triangles left get a boost so they are finished off rather than orphaned
+const int FORSYTH_CACHE_SIZE = 32;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float CACHE_DECAY_POWER = 1.5f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+const unsigned int VALENCE_TABLE_SIZE = 32;
+
+struct ForsythTables {
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[VALENCE_TABLE_SIZE];
+
+    ForsythTables() {
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+            cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+                             : std::pow(1.0f - float(i - 3) / float(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+        valence[0] = 0.0f;
+        for (unsigned int i = 1; i < VALENCE_TABLE_SIZE; i++)
+            valence[i] = VALENCE_BOOST_SCALE * std::pow(float(i), -VALENCE_BOOST_POWER);
+    }
+
+    float score(int cachePosition, unsigned int remaining) const {
+        if (remaining == 0)
+            return -1.0f; // nothing left to draw with it
+        float result = cachePosition < 0 ? 0.0f : cache[cachePosition];
+        result += remaining < VALENCE_TABLE_SIZE ? valence[remaining]
+                                                 : VALENCE_BOOST_SCALE * std::pow(float(remaining), -VALENCE_BOOST_POWER);
+        return result;
+    }
+};
+
+// FIFO post-transform cache model by timestamps: a vertex is resident while
+// fewer than `size` misses happened since it was loaded
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, unsigned int size) : stamps(vertexCount, 0), time(size + 1), size(size) {}
+
+    unsigned int triangle(const unsigned int* corners) {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = corners[k];
+            if (time - stamps[v] > size) {
+                stamps[v] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    // everything currently resident becomes stale
+    void flush() { time += size + 1; }
+
+private:
+    std::vector<unsigned int> stamps;
+    unsigned int time;
+    unsigned int size;
+};
+
+inline glm::vec3 positionOf(const float* positions, size_t stride, unsigned int v) {
+    const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * stride);
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+inline uint64_t hashBytes(const unsigned char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+size_t MeshOptimizer::WeldVertices(void* vertices, size_t vertexCount, size_t vertexSize,
+                                   unsigned int* indices, size_t indexCount) {
+    unsigned char* data = static_cast<unsigned char*>(vertices);
+
+    // open addressing table of kept vertices, at most half full
+    size_t buckets = 1;
+    while (buckets < vertexCount * 2)
+        buckets *= 2;
+    std::vector<unsigned int> table(buckets, INVALID_INDEX);
+    std::vector<unsigned int> remap(vertexCount);
+
+    size_t unique = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const unsigned char* vertex = data + v * vertexSize;
+        size_t bucket = hashBytes(vertex, vertexSize) & (buckets - 1);
+        while (table[bucket] != INVALID_INDEX &&
+               std::memcmp(data + size_t(table[bucket]) * vertexSize, vertex, vertexSize) != 0)
+            bucket = (bucket + 1) & (buckets - 1);
+
+        if (table[bucket] == INVALID_INDEX) {
+            // kept vertices are compacted in place; the slot is never ahead of v
+            if (unique != v)
+                std::memcpy(data + unique * vertexSize, vertex, vertexSize);
+            table[bucket] = static_cast<unsigned int>(unique++);
+        }
+        remap[v] = table[bucket];
+    }
+
+    for (size_t i = 0; i < indexCount; i++)
+        indices[i] = remap[indices[i]];
+    return unique;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+    static const ForsythTables tables;
+
+    // triangles around each vertex; the live ones are kept at the front of
+    // each list, the first `remaining[v]` entries
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        remaining[indices[i]]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    {
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+                adjacency[cursor[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = tables.score(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t best = size_t(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+    size_t scan = 0; // next candidate in input order once the cache has nothing left
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (best == size_t(-1)) {
+            while (emitted[scan])
+                scan++;
+            best = scan;
+        }
+
+        const unsigned int* corners = indices + best * 3;
+        const unsigned int triangle[3] = {corners[0], corners[1], corners[2]};
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[best] = 1;
+
+        for (unsigned int v : triangle) {
+            unsigned int* first = &adjacency[offsets[v]];
+            unsigned int* last = first + remaining[v];
+            unsigned int* found = std::find(first, last, static_cast<unsigned int>(best));
+            if (found != last) {
+                std::swap(*found, *(last - 1));
+                remaining[v]--;
+            }
+        }
+
+        // the triangle's vertices move to the front, the rest shift back
+        nextCache.assign(triangle, triangle + 3);
+        for (unsigned int v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        for (size_t i = 0; i < nextCache.size(); i++) {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < size_t(FORSYTH_CACHE_SIZE) ? int(i) : -1;
+            vertexScore[v] = tables.score(cachePosition[v], remaining[v]);
+        }
+
+        // rescore the triangles around the cache and pick the best of them
+        best = size_t(-1);
+        float bestScore = -1.0f;
+        for (unsigned int v : nextCache) {
+            for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+                unsigned int t = adjacency[a];
+                const unsigned int* c = indices + t * 3;
+                float score = vertexScore[c[0]] + vertexScore[c[1]] + vertexScore[c[2]];
+                triangleScore[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (nextCache.size() > size_t(FORSYTH_CACHE_SIZE))
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        std::swap(cache, nextCache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t indexCount, const float* positions,
+                                     size_t vertexCount, size_t positionStride, float threshold) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    // hard boundaries: where the cache order itself starts over, i.e. a
+    // triangle that reuses nothing from before
+    std::vector<size_t> hard;
+    {
+        FifoCache cache(vertexCount, ANALYZE_CACHE_SIZE);
+        for (size_t t = 0; t < triangleCount; t++)
+            if (cache.triangle(indices + t * 3) == 3)
+                hard.push_back(t);
+    }
+    hard.push_back(triangleCount);
+
+    // soft boundaries: inside each run, cut as soon as the part since the last
+    // cut (starting from a cold cache) is within threshold of the run's ACMR
+    std::vector<size_t> clusters;
+    FifoCache cache(vertexCount, ANALYZE_CACHE_SIZE);
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        const size_t start = hard[h], end = hard[h + 1];
+        cache.flush();
+        unsigned int runMisses = 0;
+        for (size_t t = start; t < end; t++)
+            runMisses += cache.triangle(indices + t * 3);
+        const float limit = threshold * float(runMisses) / float(end - start);
+
+        cache.flush();
+        clusters.push_back(start);
+        unsigned int misses = 0;
+        size_t clusterStart = start;
+        for (size_t t = start; t < end; t++) {
+            misses += cache.triangle(indices + t * 3);
+            if (t + 1 < end && float(misses) <= limit * float(t + 1 - clusterStart)) {
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // sort key: how far the cluster sits out along its own facing direction,
+    // measured from the mesh centre; convex outer shells draw first
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+    for (size_t c = 0; c < clusterCount; c++) {
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            glm::vec3 p0 = positionOf(positions, positionStride, indices[t * 3]);
+            glm::vec3 p1 = positionOf(positions, positionStride, indices[t * 3 + 1]);
+            glm::vec3 p2 = positionOf(positions, positionStride, indices[t * 3 + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            float triangleArea = glm::length(normal);
+            clusterCentroid[c] += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            clusterNormal[c] += normal;
+            area += triangleArea;
+        }
+        meshCentroid += clusterCentroid[c];
+        meshArea += area;
+        clusterCentroid[c] = area > 0.0f ? clusterCentroid[c] / area
+                                         : positionOf(positions, positionStride, indices[clusters[c] * 3]);
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    std::vector<float> key(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float length = glm::length(clusterNormal[c]);
+        if (length > 0.0f)
+            key[c] = glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / length);
+    }
+    std::vector<unsigned int> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        order[c] = static_cast<unsigned int>(c);
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return key[a] > key[b]; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(triangleCount * 3);
+    for (unsigned int c : order)
+        sorted.insert(sorted.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize,
+                                          unsigned int* indices, size_t indexCount) {
+    std::vector<unsigned int> remap(vertexCount, INVALID_INDEX);
+    unsigned int next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int& slot = remap[indices[i]];
+        if (slot == INVALID_INDEX)
+            slot = next++;
+        indices[i] = slot;
+    }
+
+    unsigned char* data = static_cast<unsigned char*>(vertices);
+    std::vector<unsigned char> copy(data, data + vertexCount * vertexSize);
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] != INVALID_INDEX)
+            std::memcpy(data + size_t(remap[v]) * vertexSize, copy.data() + v * vertexSize, vertexSize);
+    }
+    return next;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                                   unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t t = 0; t + 2 < indexCount; t += 3)
+        stats.misses += cache.triangle(indices + t);
+    stats.acmr = float(stats.misses) / float(indexCount / 3);
+    stats.atvr = float(stats.misses) / float(vertexCount);
+    return stats;
+}
+
+MeshOptimizeReport MeshOptimizer::Optimize(void* vertices, size_t& vertexCount, size_t vertexSize,
+                                           std::vector<unsigned int>& indices, size_t positionOffset) {
+    MeshOptimizeReport report;
+    report.verticesBefore = vertexCount;
+    report.before = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+    vertexCount = WeldVertices(vertices, vertexCount, vertexSize, indices.data(), indices.size());
+    OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    const float* positions = reinterpret_cast<const float*>(static_cast<const char*>(vertices) + positionOffset);
+    OptimizeOverdraw(indices.data(), indices.size(), positions, vertexCount, vertexSize);
+    vertexCount = OptimizeVertexFetch(vertices, vertexCount, vertexSize, indices.data(), indices.size());
+
+    report.verticesAfter = vertexCount;
+    report.after = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+    return report;
+}
@@ -0,0 +1,60 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+
+// Post-transform vertex cache efficiency of an index list under a FIFO cache
+struct VertexCacheStats {
+    unsigned int misses = 0;
+    float acmr = 0.0f;  // average cache miss ratio: misses per triangle (0.5 ideal, 3 worst)
+    float atvr = 0.0f;  // average transformed vertex ratio: misses per vertex (1 ideal)
+};
+
+// What Optimize() did to one mesh, for the load log
+struct MeshOptimizeReport {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Index and vertex order optimisations for static triangle meshes, run
+// between import and upload. Vertices are opaque blobs of vertexSize bytes
+// (compared bitwise), positions are three floats at a byte stride.
+class MeshOptimizer
+{
+public:
+    static const unsigned int ANALYZE_CACHE_SIZE = 16; // FIFO entries of the cache model used for reporting
+
+    // Merges bitwise identical vertices and rewrites the indices; returns the new vertex count
+    static size_t WeldVertices(void* vertices, size_t vertexCount, size_t vertexSize,
+                               unsigned int* indices, size_t indexCount);
+
+    // Reorders triangles for the post-transform cache (Forsyth's linear-speed
+    // algorithm with a 32 entry LRU model)
+    static void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+    // Splits the cache-ordered triangles into clusters, cutting only where
+    // the ACMR of a cluster stays within threshold of its uncut run, and
+    // sorts the clusters so that those on the outside, facing away from the
+    // mesh centre, come first and occlude the rest
+    static void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const float* positions,
+                                 size_t vertexCount, size_t positionStride, float threshold = 1.05f);
+
+    // Reorders vertices by first use so that fetches stream linearly; unused
+    // vertices are dropped. Returns the new vertex count
+    static size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize,
+                                      unsigned int* indices, size_t indexCount);
+
+    static VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                               unsigned int cacheSize = ANALYZE_CACHE_SIZE);
+
+    // The whole pipeline: weld, cache order, overdraw order, fetch order.
+    // Positions are positionOffset bytes into each vertex; vertexCount is
+    // updated to the vertices left at the front of the array
+    static MeshOptimizeReport Optimize(void* vertices, size_t& vertexCount, size_t vertexSize,
+                                       std::vector<unsigned int>& indices, size_t positionOffset);
+};
+
+#endif // MESH_OPTIMIZER_H
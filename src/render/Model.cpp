@@ -1,19 +1,188 @@
 #include "Model.h"
+#include "RenderQueue.h"
 #include <iostream>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
 #include <fstream>
+#include <algorithm>
+#include <assimp/DefaultIOSystem.h>
+#include "GLStateCache.h"
+#include "../util/FileStamp.h"
+#include "../util/WorkerPool.h"
+#include <chrono>
+#include <cstring>
+#include <functional>
 
 using namespace std;
 
+namespace
+{
+    // Remembers every file the importer opens (.mtl, .bin, ...), so the MeshCache can tell when one changes
+    class RecordingIOSystem : public Assimp::DefaultIOSystem
+    {
+    public:
+        explicit RecordingIOSystem(std::vector<std::string> &opened) : opened(opened) {}
+
+        Assimp::IOStream* Open(const char *file, const char *mode = "rb") override
+        {
+            Assimp::IOStream* stream = DefaultIOSystem::Open(file, mode);
+            if (stream)
+                opened.push_back(file);
+            return stream;
+        }
+
+    private:
+        std::vector<std::string> &opened;
+    };
+
+    double elapsedMs(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    // over the pool if there is one, else on the calling thread
+    void runJobs(WorkerPool *pool, size_t count, const std::function<void(size_t)> &job)
+    {
+        if (pool) {
+            pool->run(count, job);
+        } else {
+            for (size_t i = 0; i < count; i++)
+                job(i);
+        }
+    }
+
+    std::shared_ptr<unsigned char> copyPixels(const unsigned char *pixels, size_t size)
+    {
+        std::shared_ptr<unsigned char> copy(new unsigned char[size], std::default_delete<unsigned char[]>());
+        std::memcpy(copy.get(), pixels, size);
+        return copy;
+    }
+
+    std::shared_ptr<unsigned char> stbiPixels(unsigned char *pixels)
+    {
+        return std::shared_ptr<unsigned char>(pixels, stbi_image_free);
+    }
+
+    // DecodeTextureFile once the path is resolved
+    TextureImage decodeResolvedTexture(const std::string &filename, TextureUsage usage)
+    {
+        TextureImage image;
+
+        // Special handling for GLTF embedded textures (data URIs)
+        if (filename.find("data:") == 0) {
+            std::cout << "Detected embedded texture data URI, creating placeholder texture" << std::endl;
+            
+            // Create a simple colored texture as placeholder for embedded textures
+            static const unsigned char embeddedTexture[] = {
+                200, 200, 200, 255,  180, 180, 180, 255,
+                180, 180, 180, 255,  200, 200, 200, 255
+            };
+            image.width = image.height = 2;
+            image.components = 4;
+            image.pixels = copyPixels(embeddedTexture, sizeof(embeddedTexture));
+            image.placeholder = true;
+            return image;
+        }
+
+        std::cout << "Loading texture: " << filename << std::endl;
+
+        if (TextureBaker::Load(filename, usage, image))
+            return image;
+
+        unsigned char *data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+        if (data)
+        {
+            std::cout << "Texture loaded successfully: " << filename << " (" << image.width << "x" << image.height 
+                      << ", " << image.components << " components)" << std::endl;
+            image.pixels = stbiPixels(data);
+        }
+        else
+        {
+            cout << "Texture failed to load at path: " << filename << " - Error: " << stbi_failure_reason() << endl;
+            // Create a default texture (checkerboard) to indicate missing texture
+            static const unsigned char checkerboard[] = {
+                180, 180, 180, 255,  100, 100, 100, 255,
+                100, 100, 100, 255,  180, 180, 180, 255
+            };
+            image.width = image.height = 2;
+            image.components = 4;
+            image.pixels = copyPixels(checkerboard, sizeof(checkerboard));
+            image.placeholder = true;
+        }
+        return image;
+    }
+
+    // the placeholder texel is what the material reads as neutral until the image is resident
+    TextureStreamParams streamParams(const std::string &type, bool gamma)
+    {
+        TextureStreamParams params;
+        params.gamma = gamma;
+        if (type == "texture_normal")
+            params.placeholder = glm::vec4(0.5f, 0.5f, 1.0f, 1.0f);
+        else if (type == "texture_specular")
+            params.placeholder = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        return params;
+    }
+
+    // What besides its content makes two model textures different GL textures: every model samples
+    // with the streamParams defaults, so only the usage and sRGB
+    uint64_t textureVariant(TextureUsage usage, bool gamma)
+    {
+        static const uint64_t model = HashString("m3D::Model");
+        return model ^ (uint64_t(usage) << 1 | uint64_t(gamma));
+    }
+}
+
 namespace m3D 
 {
     Model::Model(const std::string &path, bool gamma) : gammaCorrection(gamma) // No default value here
     {
         std::cout << "Loading model from path: " << path << std::endl;
-        
+        WorkerPool pool;
+        Upload(*Import(path, &pool, gamma));
+    }
+
+    Model::Model(bool gamma) : gammaCorrection(gamma)
+    {
+    }
+
+    Model::~Model()
+    {
+        for (Mesh &mesh : meshes)
+            mesh.Release();
+        GeometryPool::Compact();
+        for (const Texture &texture : textures_loaded)
+            TextureRegistry::Release(texture.id);
+    }
+
+    void Model::Draw(Shader &shader)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader);
+    }
+
+    void Model::Draw(Shader &shader, const glm::mat4 &modelMatrix, LodSelection &lods)
+    {
+        if (lods.size() != meshes.size())
+            lods.assign(meshes.size(), 0);
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader, meshes[i].SelectLod(modelMatrix, lods[i]));
+    }
+
+    void Model::Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelMatrix, LodSelection *lods) const
+    {
+        if (lods && lods->size() != meshes.size())
+            lods->assign(meshes.size(), 0);
+        for (size_t i = 0; i < meshes.size(); i++) {
+            int lod = lods ? meshes[i].SelectLod(modelMatrix, (*lods)[i]) : 0;
+            queue.submit(shader, meshes[i], modelMatrix, RenderPass::Opaque, lod);
+        }
+    }
+
+    std::unique_ptr<ModelImport> Model::Import(const std::string &path, WorkerPool *pool, bool gamma)
+    {
         // Check if the file exists before trying to load it
         std::ifstream fileCheck(path);
         if (!fileCheck.good()) {
@@ -21,18 +190,37 @@ namespace m3D
             throw std::runtime_error("Model file not found: " + path);
         }
         fileCheck.close();
-        
-        loadModel(path);
-    }
 
-    void Model::Draw(Shader &shader)
-    {
-        for (unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        auto start = std::chrono::steady_clock::now();
+        auto import = std::make_unique<ModelImport>();
+        import->path = path;
+        import->gamma = gamma;
+        import->directory = path.substr(0, path.find_last_of('/'));
+        std::cout << "Model directory set to: " << import->directory << std::endl;
+
+        // A cooked copy is read straight from the mapped file, without Assimp
+        if (MeshCache::Load(path, import->cached)) {
+            import->meshes = std::move(import->cached.meshes);
+            import->textures = std::move(import->cached.textures);
+            decodeTextures(*import, pool);
+        } else {
+            importScene(*import, pool);
+        }
+
+        for (const CookedMesh &mesh : import->meshes) {
+            import->bounds.expand(mesh.bounds);
+            import->meshBytes += size_t(mesh.vertexCount) * mesh.layout->vertexSize() + size_t(mesh.indexCount) * sizeof(GLuint);
+        }
+        for (const TextureImage &image : import->images)
+            import->textureBytes += image.size();
+        import->importMs = elapsedMs(start);
+        return import;
     }
 
-    void Model::loadModel(const std::string &path)
+    void Model::importScene(ModelImport &import, WorkerPool *pool)
     {
+        const std::string &path = import.path;
+        auto importStart = std::chrono::steady_clock::now();
         std::cout << "Starting Assimp import for: " << path << std::endl;
         
         // Check if this is a GLTF file
@@ -50,7 +238,9 @@ namespace m3D
             importFlags |= aiProcess_PreTransformVertices; // Pre-transform vertices
         }
         
+        std::vector<std::string> dependencies;
         Assimp::Importer importer;
+        importer.SetIOHandler(new RecordingIOSystem(dependencies)); // owned by the importer
         const aiScene* scene = importer.ReadFile(path, importFlags);
         
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
@@ -59,9 +249,6 @@ namespace m3D
             throw std::runtime_error("Failed to load model: " + path + " - " + importer.GetErrorString());
         }
 
-        directory = path.substr(0, path.find_last_of('/'));
-        std::cout << "Model directory set to: " << directory << std::endl;
-        
         // For GLTF files, check for embedded textures
         if (isGltf) {
             std::cout << "Checking for embedded textures in GLTF file..." << std::endl;
@@ -88,34 +275,272 @@ namespace m3D
         }
         
         std::cout << "Processing model nodes..." << std::endl;
-        processNode(scene->mRootNode, scene);
-        std::cout << "Model loaded successfully with " << meshes.size() << " meshes" << std::endl;
+        std::vector<LoadedMesh> loaded;
+        processNode(scene->mRootNode, scene, loaded);
+
+        // Optimise and simplify the meshes in parallel; only the upload needs the GL thread.
+        // Welding first also joins the per-face copies of OBJ/DAE vertices, so the simplifier
+        // sees the real topology instead of locking every edge as a seam
+        auto lodStart = std::chrono::steady_clock::now();
+        runJobs(pool, loaded.size(), [&](size_t i) {
+            LoadedMesh &mesh = loaded[i];
+            mesh.optimized = Mesh::Optimize(mesh.vertices, mesh.indices);
+            mesh.lods = Mesh::BuildLods(mesh.vertices, mesh.indices);
+            mesh.packed = PackedMesh::Pack(mesh.vertices, mesh.indices, mesh.lods);
+            std::vector<Vertex>().swap(mesh.vertices);
+        });
+        size_t levels = 0;
+        for (const LoadedMesh &mesh : loaded) {
+            const MeshOptimizeReport &report = mesh.optimized;
+            std::cout << "Optimized mesh " << mesh.name << ": " << report.verticesBefore << " -> "
+                      << report.verticesAfter << " vertices, ACMR " << report.before.acmr << " -> "
+                      << report.after.acmr << ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+                      << std::endl;
+            levels += mesh.lods.levels.size();
+        }
+        std::cout << "Optimized " << loaded.size() << " meshes and generated " << levels << " LOD levels in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lodStart).count()
+                  << " ms" << std::endl;
+
+        // The cooked form points into the packed meshes; textures are shared between meshes in one table
+        import.packed.resize(loaded.size());
+        import.meshes.resize(loaded.size());
+        for (size_t i = 0; i < loaded.size(); i++) {
+            import.packed[i] = std::move(loaded[i].packed);
+            const PackedMesh &packed = import.packed[i];
+            CookedMesh &mesh = import.meshes[i];
+            mesh.layout = packed.layout;
+            mesh.vertices = packed.vertices.data();
+            mesh.skin = packed.skin.empty() ? nullptr : packed.skin.data();
+            mesh.vertexCount = packed.vertexCount;
+            mesh.indices = packed.indices.data();
+            mesh.indexCount = static_cast<GLuint>(packed.indices.size());
+            mesh.lods = packed.lods;
+            mesh.bounds = packed.bounds;
+            for (const CookedTexture &source : loaded[i].textureSources) {
+                auto same = [&](const CookedTexture &entry) {
+                    return entry.kind == source.kind && entry.type == source.type && entry.path == source.path &&
+                           entry.color == source.color;
+                };
+                auto found = std::find_if(import.textures.begin(), import.textures.end(), same);
+                mesh.textures.push_back(static_cast<uint32_t>(found - import.textures.begin()));
+                if (found == import.textures.end())
+                    import.textures.push_back(source);
+            }
+        }
+
+        // embedded texture data still points into the scene, so both happen before the importer goes
+        decodeTextures(import, pool);
+        MeshCache::Store(path, dependencies, import.meshes, import.textures, elapsedMs(importStart));
+        for (CookedTexture &texture : import.textures)
+            texture.data = nullptr;
+    }
+
+    void Model::decodeTextures(ModelImport &import, WorkerPool *pool)
+    {
+        // a file used by several table entries (as diffuse and specular, say) is decoded once per TextureUsage
+        const size_t count = import.textures.size();
+        std::vector<size_t> first(count);
+        for (size_t i = 0; i < count; i++) {
+            first[i] = i;
+            for (size_t j = 0; j < i; j++) {
+                if (import.textures[i].kind == CookedTextureKind::File && import.textures[j].kind == CookedTextureKind::File &&
+                    import.textures[i].path == import.textures[j].path &&
+                    TextureBaker::UsageFor(import.textures[i].type) == TextureBaker::UsageFor(import.textures[j].type)) {
+                    first[i] = j;
+                    break;
+                }
+            }
+        }
+
+        import.images.assign(count, TextureImage());
+        import.keys.assign(count, 0);
+        import.shared.assign(count, 0);
+        runJobs(pool, count, [&](size_t i) {
+            const CookedTexture &source = import.textures[i];
+            TextureImage &image = import.images[i];
+            TextureKey &key = import.keys[i];
+            const TextureUsage usage = TextureBaker::UsageFor(source.type);
+            // colours are made sRGB, embedded images have always been linear
+            const bool gamma = source.kind == CookedTextureKind::File ? import.gamma : source.kind == CookedTextureKind::Color;
+            std::string filename;
+
+            if (source.kind == CookedTextureKind::Color) {
+                key = TextureRegistry::KeyForColor(glm::vec4(source.color, 1.0f), textureVariant(usage, gamma));
+                return;
+            } else if (source.kind == CookedTextureKind::File) {
+                filename = ResolveTextureFile(source.path.c_str(), import.directory);
+                if (filename.find("data:") == 0)
+                    key = TextureRegistry::KeyForBytes(filename.data(), filename.size(), textureVariant(usage, gamma));
+                else if (!TextureRegistry::KeyForFile(filename, textureVariant(usage, gamma), key))
+                    key = 0; // missing: its checkerboard is not shared
+            } else {
+                // raw texels are keyed by their size too
+                const uint64_t size = uint64_t(source.width) << 32 | source.height;
+                key = TextureRegistry::KeyForBytes(source.data, source.dataSize, textureVariant(usage, gamma) ^ size);
+            }
+            // a duplicate is acquired on upload, once the first is registered
+            if (first[i] != i)
+                return;
+            if (key && (import.shared[i] = TextureRegistry::Acquire(key)) != 0)
+                return;
+            // stb's flip flag is global state; loaders use their own copy
+            stbi_set_flip_vertically_on_load_thread(false);
+
+            if (source.kind == CookedTextureKind::File) {
+                image = decodeResolvedTexture(filename, usage);
+            } else if (source.height == 0) {
+                // Compressed texture data
+                unsigned char* data = stbi_load_from_memory(source.data, static_cast<int>(source.dataSize),
+                                                            &image.width, &image.height, &image.components, 0);
+                if (data)
+                    image.pixels = stbiPixels(data);
+                else
+                    std::cout << "Failed to load embedded texture: " << source.path << std::endl;
+            } else {
+                // Raw texture data (not compressed)
+                image.width = static_cast<int>(source.width);
+                image.height = static_cast<int>(source.height);
+                image.components = 4;
+                image.pixels = copyPixels(source.data, source.dataSize);
+            }
+        });
+        for (size_t i = 0; i < count; i++)
+            import.images[i] = import.images[first[i]];
+    }
+
+    void Model::Upload(const ModelImport &import)
+    {
+        BeginUpload(import);
+        for (size_t i = 0; i < import.textures.size(); i++)
+            UploadTexture(import, i);
+        for (size_t i = 0; i < import.meshes.size(); i++)
+            UploadMesh(import, i);
+        FinishUpload(import);
+    }
+
+    void Model::BeginUpload(const ModelImport &import)
+    {
+        directory = import.directory;
+        bounds = import.bounds;
+        importTextures.clear();
+        importTextures.reserve(import.textures.size());
+        meshes.reserve(meshes.size() + import.meshes.size());
+    }
+
+    size_t Model::UploadTexture(const ModelImport &import, size_t index)
+    {
+        const CookedTexture &source = import.textures[index];
+        const TextureImage &image = import.images[index];
+        const TextureKey key = import.keys[index];
+        Texture texture;
+        texture.type = source.type;
+        texture.path = source.path;
+
+        // shared with this or another model, or registered since the import looked
+        texture.id = import.shared[index];
+        if (texture.id == 0 && key != 0)
+            texture.id = TextureRegistry::Acquire(key);
+        if (texture.id != 0) {
+            textures_loaded.push_back(texture);
+            importTextures.push_back(texture);
+            return 0;
+        }
+
+        if (source.kind == CookedTextureKind::Color) {
+            texture.id = createColorTexture(source.color.r, source.color.g, source.color.b);
+        } else if (source.kind == CookedTextureKind::Embedded) {
+            if (image.pixels) {
+                // embedded images have always been linear
+                texture.id = TextureStreamer::StreamImage(image, streamParams(source.type, false));
+            } else {
+                // Fallback to a default texture, which is not the image's to share
+                texture.id = createColorTexture(0.8f, 0.8f, 0.8f);
+                textures_loaded.push_back(texture);
+                importTextures.push_back(texture);
+                return 0;
+            }
+        } else {
+            texture.id = TextureStreamer::StreamImage(image, streamParams(source.type, import.gamma));
+        }
+        if (key != 0)
+            TextureRegistry::Add(key, texture.id, source.kind == CookedTextureKind::Color ? 4 : image.size());
+
+        textures_loaded.push_back(texture);
+        importTextures.push_back(texture);
+        // images are uploaded by TextureStreamer, within its own budget
+        return 0;
+    }
+
+    size_t Model::UploadMesh(const ModelImport &import, size_t index)
+    {
+        const CookedMesh &mesh = import.meshes[index];
+        std::vector<Texture> meshTextures;
+        for (uint32_t texture : mesh.textures)
+            meshTextures.push_back(importTextures[texture]);
+        meshes.emplace_back(*mesh.layout, mesh.vertices, mesh.skin, mesh.vertexCount, mesh.indices, mesh.indexCount,
+                            mesh.lods, mesh.bounds, std::move(meshTextures));
+        return size_t(mesh.vertexCount) * mesh.layout->vertexSize() + size_t(mesh.indexCount) * sizeof(GLuint);
+    }
+
+    void Model::FinishUpload(const ModelImport &import)
+    {
+        importTextures.clear();
+        bounds = AABB();
+        for (const Mesh &mesh : meshes)
+            bounds.expand(mesh.bounds);
+        loading = false;
+        reportVertexMemory();
+        std::cout << "Model loaded with " << meshes.size() << " meshes and " << import.textures.size()
+                  << " textures (" << (import.meshBytes + import.textureBytes) / 1024 << " KB) from " << import.path
+                  << ", import took " << import.importMs << " ms" << std::endl;
+    }
+
+    void Model::FailUpload()
+    {
+        loading = false;
+    }
+
+    void Model::reportVertexMemory() const
+    {
+        // every vertex fetched costs its packed size in bandwidth too
+        size_t vertexCount = 0, packedBytes = 0;
+        for (const Mesh &mesh : meshes) {
+            vertexCount += mesh.VertexCount();
+            packedBytes += mesh.VertexBytes();
+        }
+        if (vertexCount > 0) {
+            const size_t fullBytes = vertexCount * sizeof(Vertex);
+            std::cout << "Packed " << vertexCount << " vertices into " << packedBytes / 1024 << " KB ("
+                      << packedBytes / vertexCount << " bytes each) instead of " << fullBytes / 1024 << " KB, saving "
+                      << 100 - packedBytes * 100 / fullBytes << "% of vertex memory and fetch bandwidth" << std::endl;
+        }
     }
 
-    void Model::processNode(aiNode *node, const aiScene *scene)
+    void Model::processNode(aiNode *node, const aiScene *scene, std::vector<LoadedMesh> &loaded)
     {
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            loaded.push_back(processMesh(mesh, scene));
         }
         for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, loaded);
         }
     }
 
-    Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
+    Model::LoadedMesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
     {
         vector<Vertex> vertices;
         vector<unsigned int> indices;
-        vector<Texture> textures;
+        vector<CookedTexture> sources;
 
         std::cout << "Processing mesh: " << mesh->mName.C_Str() << " with " << mesh->mNumVertices << " vertices" << std::endl;
 
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
+            Vertex vertex{}; // zeroed, so that unused fields do not keep identical vertices from welding
             glm::vec3 vector;
 
             // Positions
@@ -199,162 +624,77 @@ namespace m3D
             }
             
             // Load textures
-            vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", scene);
-            textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+            size_t diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", scene, sources);
             
             // If no diffuse textures but has diffuse color, create a texture from the color
-            if (diffuseMaps.empty() && hasDiffuseColor) {
+            if (diffuseMaps == 0 && hasDiffuseColor) {
                 std::cout << "Creating texture from diffuse color" << std::endl;
-                Texture colorTexture;
-                colorTexture.id = createColorTexture(diffuseColor.r, diffuseColor.g, diffuseColor.b);
-                colorTexture.type = "texture_diffuse";
-                colorTexture.path = "generated_color";
-                textures.push_back(colorTexture);
-                textures_loaded.push_back(colorTexture);
+                CookedTexture source;
+                source.kind = CookedTextureKind::Color;
+                source.type = "texture_diffuse";
+                source.path = "generated_color";
+                source.color = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+                sources.push_back(source);
             }
             
             // Load other texture types
-            vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", scene);
-            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+            loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", scene, sources);
             
             // Try both HEIGHT and NORMALS for normal maps (GLTF often uses NORMALS)
-            std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", scene);
-            if (normalMaps.empty()) {
-                normalMaps = loadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal", scene);
+            if (loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", scene, sources) == 0) {
+                loadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal", scene, sources);
             }
-            textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
             
-            std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", scene);
-            textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+            loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", scene, sources);
         }
         
-        std::cout << "Mesh processed with " << textures.size() << " textures" << std::endl;
-        return Mesh(vertices, indices, textures);
+        std::cout << "Mesh processed with " << sources.size() << " textures" << std::endl;
+        LoadedMesh loaded;
+        loaded.name = mesh->mName.C_Str();
+        loaded.vertices = std::move(vertices);
+        loaded.indices = std::move(indices);
+        loaded.textureSources = std::move(sources);
+        return loaded;
     }
 
-    vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName, const aiScene* scene)
+    size_t Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName, const aiScene* scene,
+                                       std::vector<CookedTexture> &sources)
     {
-        vector<Texture> textures;
-        for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        const unsigned int count = mat->GetTextureCount(type);
+        for (unsigned int i = 0; i < count; i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
 
+            CookedTexture source;
+            source.type = typeName;
+            source.path = str.C_Str();
+
             // Check if the texture is embedded
             if (str.C_Str()[0] == '*') {
                 int textureIndex = atoi(str.C_Str() + 1);
                 if (textureIndex >= 0 && textureIndex < scene->mNumTextures) {
                     const aiTexture* embeddedTexture = scene->mTextures[textureIndex];
-                    
+                    source.kind = CookedTextureKind::Embedded;
+                    source.data = reinterpret_cast<const unsigned char*>(embeddedTexture->pcData);
+
                     // Check if texture is compressed (mHeight == 0) or raw data (mHeight > 0)
                     if (embeddedTexture->mHeight == 0) {
-                        // Compressed texture data
-                        // Create a copy of the data to avoid double-free issues
-                        std::vector<unsigned char> textureData(embeddedTexture->mWidth);
-                        std::memcpy(textureData.data(), embeddedTexture->pcData, embeddedTexture->mWidth);
-                        
-                        // Load the texture from memory
-                        int width, height, nrComponents;
-                        stbi_set_flip_vertically_on_load(false);
-                        unsigned char* data = stbi_load_from_memory(
-                            textureData.data(), static_cast<int>(textureData.size()),
-                            &width, &height, &nrComponents, 0);
-                        
-                        Texture texture;
-                        if (data) {
-                            texture.id = createTextureFromMemory(
-                                data, width, height, nrComponents, gammaCorrection);
-                            stbi_image_free(data);
-                        } else {
-                            std::cout << "Failed to load embedded texture: " << str.C_Str() << std::endl;
-                            // Fallback to a default texture
-                            texture.id = createColorTexture(0.8f, 0.8f, 0.8f);
-                        }
-                        texture.type = typeName;
-                        texture.path = str.C_Str();
-                        textures.push_back(texture);
-                        textures_loaded.push_back(texture);
+                        source.dataSize = embeddedTexture->mWidth;
                     } else {
-                        // Raw texture data (not compressed)
-                        size_t dataSize = embeddedTexture->mWidth * embeddedTexture->mHeight * 4; // RGBA
-                        std::vector<unsigned char> textureData(embeddedTexture->mWidth * embeddedTexture->mHeight * 4);
-                        std::memcpy(textureData.data(), embeddedTexture->pcData, dataSize);
-                        
-                        Texture texture;
-                        texture.id = createTextureFromMemory(
-                            textureData.data(),
-                            static_cast<int>(embeddedTexture->mWidth),
-                            static_cast<int>(embeddedTexture->mHeight),
-                            4, // RGBA
-                            gammaCorrection
-                        );
-                        texture.type = typeName;
-                        texture.path = str.C_Str();
-                        textures.push_back(texture);
-                        textures_loaded.push_back(texture);
+                        source.width = embeddedTexture->mWidth;
+                        source.height = embeddedTexture->mHeight;
+                        source.dataSize = size_t(source.width) * source.height * 4; // RGBA
                     }
-                    continue; // Skip to next texture
                 }
             }
 
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true;
-                    break;
-                }
-            }
-            if (!skip)
-            {
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory, gammaCorrection);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);
-            }
+            sources.push_back(source);
         }
-        return textures;
+        return count;
     }
 
-    unsigned int Model::createTextureFromMemory(unsigned char* data, int width, int height, int nrComponents, bool gamma)
-    {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        if (data)
-        {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-            else
-                format = GL_RGB; // Default fallback
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        }
-        else
-        {
-            std::cout << "Texture failed to load from memory" << std::endl;
-        }
-
-        return textureID;
-    }
-
-    unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
+    std::string ResolveTextureFile(const char *path, const std::string &directory)
     {
         string filename = string(path);
         
@@ -368,34 +708,10 @@ namespace m3D
             std::cout << "Using relative texture path: " << filename << std::endl;
         }
 
-        // Special handling for GLTF embedded textures (data URIs)
-        if (filename.find("data:") == 0) {
-            std::cout << "Detected embedded texture data URI, creating placeholder texture" << std::endl;
-            
-            unsigned int textureID;
-            glGenTextures(1, &textureID);
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            
-            // Create a simple colored texture as placeholder for embedded textures
-            unsigned char embeddedTexture[] = {
-                200, 200, 200, 255,  180, 180, 180, 255,
-                180, 180, 180, 255,  200, 200, 200, 255
-            };
-            
+        // GLTF embedded textures (data URIs) are no file
+        if (filename.find("data:") == 0)
+            return filename;
 
-            GLenum embeddedFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-            glTexImage2D(GL_TEXTURE_2D, 0, embeddedFormat, 2, 2, 0, GL_RGBA, 
-             GL_UNSIGNED_BYTE, embeddedTexture);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            
-            return textureID;
-        }
-        
-        std::cout << "Loading texture: " << filename << std::endl;
-        
         // Check if the texture file exists
         std::ifstream fileCheck(filename.c_str());
         if (!fileCheck.good()) {
@@ -424,94 +740,35 @@ namespace m3D
         } else {
             fileCheck.close();
         }
+        return filename;
+    }
 
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-        if (data)
-        {
-            std::cout << "Texture loaded successfully: " << filename << " (" << width << "x" << height 
-                      << ", " << nrComponents << " components)" << std::endl;
-                      
-            GLenum format;
-            GLenum internalFormat;
-            if (nrComponents == 1) {
-                format = GL_RED;
-                internalFormat = GL_RED;
-            }
-            else if (nrComponents == 3) {
-                format = GL_RGB;
-                internalFormat = gamma ? GL_SRGB : GL_RGB;
-            }
-            else if (nrComponents == 4) {
-                format = GL_RGBA;
-                internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-            }
-            else {
-                cout << "Unsupported number of components: " << nrComponents << " in texture: " << path << endl;
-                format = GL_RGB;
-                internalFormat = GL_RGB;
-            }
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            // Adjust texture parameters for better quality
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            
-            // Enable anisotropic filtering if available
-            // Note: These constants might not be available in all OpenGL implementations
-            // so we'll check if they're defined before using them
-#ifdef GL_MAX_TEXTURE_MAX_ANISOTROPY
-            float aniso = 0.0f;
-            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &aniso);
-            if (aniso > 0.0f) {
-                glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, aniso);
-            }
-#endif
-
-            stbi_image_free(data);
-        }
-        else
-        {
-            cout << "Texture failed to load at path: " << filename << " - Error: " << stbi_failure_reason() << endl;
-            // Create a default texture (checkerboard) to indicate missing texture
-            unsigned char checkerboard[] = {
-                180, 180, 180, 255,  100, 100, 100, 255,
-                100, 100, 100, 255,  180, 180, 180, 255
-            };
-            
-            std::cout << "Created fallback checkerboard texture with ID: " << textureID << std::endl;
-            
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            
+    TextureImage DecodeTextureFile(const char *path, const std::string &directory, TextureUsage usage)
+    {
+        return decodeResolvedTexture(ResolveTextureFile(path, directory), usage);
+    }
 
-GLenum fallbackFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-glTexImage2D(GL_TEXTURE_2D, 0, fallbackFormat, 2, 2, 0, GL_RGBA, 
-             GL_UNSIGNED_BYTE, checkerboard);
-             glGenerateMipmap(GL_TEXTURE_2D);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            
-            if (data) stbi_image_free(data);
-        }
+    unsigned int UploadTextureImage(const TextureImage &image, bool gamma)
+    {
+        TextureStreamParams params;
+        params.gamma = gamma;
+        return TextureStreamer::StreamImage(image, params);
+    }
 
-        return textureID;
+    unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
+    {
+        TextureStreamParams params;
+        params.gamma = gamma;
+        return TextureStreamer::Stream([path = std::string(path), directory] {
+            return DecodeTextureFile(path.c_str(), directory);
+        }, params);
     }
 
     // Helper function to create a texture from a color
     unsigned int Model::createColorTexture(float r, float g, float b, bool gamma) {
         unsigned int textureID;
         glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, textureID);
         
         unsigned char colorTexture[4] = {
             static_cast<unsigned char>(r * 255), 
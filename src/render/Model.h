@@ -1,37 +1,117 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "../Mesh.hpp"
+#include "MeshCache.h"
+#include "TextureBaker.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
 #include "Vertex.h"
 
+class RenderQueue;
+class WorkerPool;
+
 namespace m3D
 {
+    // Finds path next to the model, or in its textures/ and bin/ folders; data: URIs are returned as they are
+    std::string ResolveTextureFile(const char *path, const std::string &directory);
+    // Finds path as ResolveTextureFile does and decodes it, or maps its TextureBaker copy for usage if
+    // baking is enabled. No GL, so any thread
+    TextureImage DecodeTextureFile(const char *path, const std::string &directory,
+                                   TextureUsage usage = TextureUsage::Color);
+    // Both return at once with a placeholder; TextureStreamer swaps the image in when it is resident
+    unsigned int UploadTextureImage(const TextureImage &image, bool gamma);
     unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
 
+    // Everything a model import produces before the first GL call: the meshes packed for upload
+    // and the decoded material images. Model::Import makes it on any thread; Model::Upload and
+    // the Upload* steps put it on the GPU from the render thread
+    struct ModelImport {
+        std::string path;
+        std::string directory;
+        std::vector<CookedMesh> meshes;      // into packed, or into the cache mapping
+        std::vector<CookedTexture> textures; // the table the meshes index
+        std::vector<TextureImage> images;    // textures[i] decoded; empty for colours and shared textures
+        std::vector<TextureKey> keys;        // textures[i] in the TextureRegistry; 0 if it is not shared
+        std::vector<GLuint> shared;          // textures[i] found registered, a reference taken; 0 to upload
+        bool gamma = false;                  // the model's, which file textures are keyed by
+        AABB bounds;
+        double importMs = 0.0;
+        size_t textureBytes = 0, meshBytes = 0;
+
+        MeshCacheFile cached;                // a cache hit's mapping
+        std::vector<PackedMesh> packed;      // a fresh import's meshes
+    };
+
     class Model : public VO::VAO 
     {
     public:
         // Model data 
-        std::vector<Texture> textures_loaded; // stores all the textures loaded so far
+        std::vector<Texture> textures_loaded; // every texture the model holds a TextureRegistry reference on
         std::vector<Mesh> meshes;
         std::string directory;
         bool gammaCorrection;
+        AABB bounds; // union of the mesh bounds, in model space
 
-        Model(const std::string &path, bool gamma = false); // Declaration
-        void Draw(Shader &shader) override; // Draw function
+        Model(const std::string &path, bool gamma = false); // Imports and uploads the model before returning
+        explicit Model(bool gamma = false); // Empty and loading until an import is uploaded into it
+        ~Model(); // Returns the mesh geometry to the GeometryPool and defragments it, and releases the textures
+        // The destructor frees the mesh ranges and drops the TextureRegistry references; a copy would
+        // release both twice, and the registry could delete a texture still in use
+        Model(const Model &) = delete;
+        Model &operator=(const Model &) = delete;
+        void Draw(Shader &shader) override; // Draw function, at full detail
+        void Draw(Shader &shader, const glm::mat4 &modelMatrix, LodSelection &lods); // Draw with a level of detail per mesh
+        // Queue every mesh for sorted drawing; with lods, each at the level of detail its screen size needs
+        void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelMatrix, LodSelection *lods = nullptr) const;
+
+        // Reads, optimises and packs the model at path, or maps its MeshCache entry, and decodes its textures.
+        // Touches no GL state, so it can run on a loader thread; pool, if given, spreads the work of one model.
+        // Textures already in the TextureRegistry are not decoded again; gamma is the model's gammaCorrection.
+        // Throws std::runtime_error if the file cannot be imported
+        static std::unique_ptr<ModelImport> Import(const std::string &path, WorkerPool *pool = nullptr, bool gamma = false);
+
+        // Render thread: every step below at once
+        void Upload(const ModelImport &import);
+        // Render thread, in this order: BeginUpload, each texture, each mesh in order, FinishUpload.
+        // The steps return the bytes they uploaded, for the UploadQueue budget
+        void BeginUpload(const ModelImport &import); // sets the directory and the bounds
+        size_t UploadTexture(const ModelImport &import, size_t texture);
+        size_t UploadMesh(const ModelImport &import, size_t mesh);
+        void FinishUpload(const ModelImport &import);
+        void FailUpload(); // the import threw; stops the placeholder
+
+        bool IsLoading() const { return loading; }
 
     private:
-        void loadModel(const std::string &path); // Load model function
-        void processNode(aiNode *node, const aiScene *scene); // Process node function
-        Mesh processMesh(aiMesh *mesh, const aiScene *scene); // Process mesh function
-        std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName, const aiScene* scene); // Load material textures
+        // Mesh data gathered from assimp, before it is optimised, the LOD chain is built and it is packed
+        struct LoadedMesh {
+            std::string name;
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            std::vector<CookedTexture> textureSources; // the mesh's material textures
+            MeshOptimizeReport optimized;
+            MeshLodChain lods;
+            PackedMesh packed;
+        };
+
+        static void importScene(ModelImport &import, WorkerPool *pool); // Assimp import, optimisation and packing
+        static void decodeTextures(ModelImport &import, WorkerPool *pool);
+        static void processNode(aiNode *node, const aiScene *scene, std::vector<LoadedMesh> &loaded); // Process node function
+        static LoadedMesh processMesh(aiMesh *mesh, const aiScene *scene); // Process mesh function
+        static size_t loadMaterialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName, const aiScene* scene,
+                                           std::vector<CookedTexture> &sources); // Note where each material texture comes from
+        void reportVertexMemory() const;
         unsigned int createColorTexture(float r, float g, float b, bool gamma = true);
-        unsigned int createTextureFromMemory(unsigned char* data, int width, int height, int nrComponents, bool gamma); // Create a texture from a color
+
+        bool loading = true;
+        std::vector<Texture> importTextures; // the import's texture table while its meshes upload
     };
 }
 
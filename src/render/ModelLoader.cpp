@@ -0,0 +1,55 @@
+#include "ModelLoader.h"
+#include <iostream>
+#include <memory>
+
+ModelLoader::ModelLoader(UploadQueue& uploads, int threads) : uploads(uploads), imports(threads)
+{
+}
+
+void ModelLoader::load(m3D::Model& model, const std::string& path)
+{
+    if (requestedModels == 0)
+        start = std::chrono::steady_clock::now();
+    requestedModels++;
+    imports.push([this, &model, path]() { run(model, path); });
+}
+
+double ModelLoader::elapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ModelLoader::run(m3D::Model& model, const std::string& path)
+{
+    std::shared_ptr<m3D::ModelImport> import;
+    try {
+        // models load in parallel with each other, so one model's meshes go through serially
+        import = m3D::Model::Import(path, nullptr, model.gammaCorrection);
+    } catch (const std::exception& e) {
+        std::cout << "Error loading model " << path << ": " << e.what() << std::endl;
+        uploads.push([this, &model]() -> size_t {
+            model.FailUpload();
+            finishedModels++;
+            return 0;
+        });
+        return;
+    }
+
+    // the tasks share the import, which is freed (and a cache file unmapped) after the last one
+    std::vector<UploadQueue::Task> tasks;
+    tasks.reserve(import->textures.size() + import->meshes.size() + 2);
+    tasks.push_back([&model, import]() -> size_t {
+        model.BeginUpload(*import);
+        return 0;
+    });
+    for (size_t i = 0; i < import->textures.size(); i++)
+        tasks.push_back([&model, import, i]() { return model.UploadTexture(*import, i); });
+    for (size_t i = 0; i < import->meshes.size(); i++)
+        tasks.push_back([&model, import, i]() { return model.UploadMesh(*import, i); });
+    tasks.push_back([this, &model, import]() -> size_t {
+        model.FinishUpload(*import);
+        finishedModels++;
+        return 0;
+    });
+    uploads.push(std::move(tasks));
+}
@@ -0,0 +1,53 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <chrono>
+#include <string>
+#include "Model.h"
+#include "UploadQueue.h"
+#include "../util/JobQueue.h"
+
+// Imports models in the background. Each model's Assimp import (or MeshCache
+// read), mesh processing and image decoding runs on one of the loader
+// threads, several models at once; the GL part is pushed to an UploadQueue
+// as one task per texture and mesh, which the render thread works through
+// within its per-frame budget. A model loads into an empty m3D::Model that
+// reports IsLoading() until its last upload ran.
+class ModelLoader
+{
+public:
+    // threads -1 picks hardware_concurrency - 1
+    explicit ModelLoader(UploadQueue& uploads, int threads = -1);
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // Queues the import of path into model, which must outlive the uploads
+    void load(m3D::Model& model, const std::string& path);
+
+    // blocks until every queued import is done; their uploads may still be queued
+    void wait() { imports.wait(); }
+    // imports queued or running
+    size_t pending() const { return imports.pending(); }
+    // models requested and those whose uploads completed, successfully or not
+    size_t requested() const { return requestedModels; }
+    size_t finished() const { return finishedModels; }
+    // no import pending and every upload of them done
+    bool idle() const { return finishedModels == requestedModels; }
+    // since the first load()
+    double elapsedMs() const;
+
+private:
+    void run(m3D::Model& model, const std::string& path);
+
+    UploadQueue& uploads;
+
+    // counted on the render thread, by the tasks that finish a model
+    size_t requestedModels = 0;
+    size_t finishedModels = 0;
+    std::chrono::steady_clock::time_point start;
+    // last, so that it is destroyed first: imports that have not started are
+    // dropped and running ones are waited for
+    JobQueue imports;
+};
+
+#endif // MODEL_LOADER_H
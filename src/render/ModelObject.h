@@ -9,6 +9,7 @@
 class ModelObject : public SceneObject {
 private:
     std::shared_ptr<m3D::Model> model;
+    LodSelection lods; // level of detail per mesh, kept between frames
     
 public:
     // Constructor with model path
@@ -44,9 +45,21 @@ public:
         shader.SetMatrix4("model", GetModelMatrix());
         
         // Draw the model
-        model->Draw(shader);
+        model->Draw(shader, GetModelMatrix(), lods);
+    }
+
+    bool Submit(RenderQueue& queue, Shader& shader) override {
+        if (!model) return false;
+        if (visible) {
+            model->Submit(queue, shader, GetModelMatrix(), &lods);
+        }
+        return true;
     }
     
+    AABB GetLocalBounds() const override {
+        return model ? model->bounds : AABB();
+    }
+
     // Get the underlying model
     std::shared_ptr<m3D::Model> GetModel() const {
         return model;
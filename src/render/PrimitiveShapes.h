@@ -8,6 +8,7 @@
 #include <memory>
 #include <iostream>
 #include <map>
+#include "GLStateCache.h"
 
 namespace m3D {
 
@@ -15,7 +16,7 @@ namespace m3D {
 unsigned int createColorTexture(float r, float g, float b) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, textureID);
     
     // Create a simple 1x1 color texture
     unsigned char data[] = {
@@ -0,0 +1,363 @@
+#include "Profiler.h"
+#include <glad/glad.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+bool Profiler::enabled = true;
+bool Profiler::gpuEnabled = true;
+unsigned long Profiler::droppedEvents = 0;
+
+namespace {
+
+// Events of one thread. Only the owning thread writes events and `written`;
+// only the collector (EndFrame) reads them and touches `read`.
+struct ThreadBuffer {
+    static const uint64_t CAPACITY = 1 << 14;
+
+    std::vector<ProfileEvent> events = std::vector<ProfileEvent>(CAPACITY);
+    std::atomic<uint64_t> written{0};
+    uint64_t read = 0;
+    uint32_t threadId = 0;
+    uint16_t depth = 0;
+};
+
+// The registry lock is taken once per thread, on its first zone, and by the collector.
+// Buffers are never freed, the engine's threads live as long as the process.
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+thread_local ThreadBuffer* localBuffer = nullptr;
+
+ThreadBuffer& threadBuffer()
+{
+    if (!localBuffer) {
+        auto buffer = std::make_unique<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->threadId = static_cast<uint32_t>(registry.size());
+        localBuffer = buffer.get();
+        registry.push_back(std::move(buffer));
+    }
+    return *localBuffer;
+}
+
+// GL_TIMESTAMP pairs of every GPU zone of one frame
+struct GpuQuerySet {
+    GLuint queries[Profiler::MAX_GPU_ZONES * 2] = {0};
+    const char* names[Profiler::MAX_GPU_ZONES] = {nullptr};
+    uint16_t depths[Profiler::MAX_GPU_ZONES] = {0};
+    int count = 0;
+    uint64_t frameIndex = 0;
+    bool pending = false;
+};
+
+const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+
+ProfileFrame history[Profiler::HISTORY_FRAMES];
+float frameTimes[Profiler::HISTORY_FRAMES] = {0.0f};
+uint64_t frameCounter = 0;  // frames begun
+bool inFrame = false;
+uint32_t mainThreadId = 0;
+
+GpuQuerySet gpuSets[2];
+bool gpuInitialized = false;
+uint16_t gpuDepth = 0;
+int64_t gpuToCpuOffset = 0;  // add to a GL timestamp to get Profiler::Now() time
+
+ProfileFrame* findFrame(uint64_t index)
+{
+    ProfileFrame& frame = history[index % Profiler::HISTORY_FRAMES];
+    return frame.index == index ? &frame : nullptr;
+}
+
+void calibrateGpuClock()
+{
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuToCpuOffset = static_cast<int64_t>(Profiler::Now()) - gpuNow;
+}
+
+// Reads back the set if the GPU is done with it; drops its zones otherwise
+void resolveGpuSet(GpuQuerySet& set, unsigned long& dropped)
+{
+    if (!set.pending)
+        return;
+    set.pending = false;
+    ProfileFrame* frame = findFrame(set.frameIndex);
+
+    bool available = true;
+    for (int i = 0; i < set.count * 2 && available; i++) {
+        GLint ready = 0;
+        glGetQueryObjectiv(set.queries[i], GL_QUERY_RESULT_AVAILABLE, &ready);
+        available = ready != 0;
+    }
+    if (!available || !frame) {
+        dropped += set.count;
+        if (frame)
+            frame->gpuResolved = true;
+        return;
+    }
+
+    for (int i = 0; i < set.count; i++) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(set.queries[i * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(set.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+        ProfileEvent event;
+        event.name = set.names[i];
+        event.startNs = static_cast<uint64_t>(static_cast<int64_t>(begin) + gpuToCpuOffset);
+        event.durationNs = end > begin ? end - begin : 0;
+        event.threadId = Profiler::GPU_THREAD_ID;
+        event.depth = set.depths[i];
+        frame->gpuEvents.push_back(event);
+    }
+    frame->gpuResolved = true;
+}
+
+std::string jsonString(const char* text)
+{
+    std::string out = "\"";
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            out += '\\';
+        out += *c;
+    }
+    return out + "\"";
+}
+
+void writeTraceEvent(std::ofstream& out, bool& first, const char* name, const char* category,
+                     uint64_t startNs, uint64_t durationNs, uint32_t threadId)
+{
+    char times[96];
+    std::snprintf(times, sizeof(times), "\"ts\": %.3f, \"dur\": %.3f", startNs / 1000.0, durationNs / 1000.0);
+    out << (first ? "\n" : ",\n") << "  {\"name\": " << jsonString(name) << ", \"cat\": \"" << category
+        << "\", \"ph\": \"X\", " << times << ", \"pid\": 1, \"tid\": " << threadId << "}";
+    first = false;
+}
+
+void writeThreadName(std::ofstream& out, bool& first, uint32_t threadId, const std::string& name)
+{
+    out << (first ? "\n" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+        << threadId << ", \"args\": {\"name\": " << jsonString(name.c_str()) << "}}";
+    first = false;
+}
+
+} // namespace
+
+uint64_t Profiler::Now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - clockStart).count());
+}
+
+void Profiler::SetEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+bool Profiler::IsEnabled()
+{
+    return enabled;
+}
+
+void Profiler::SetGpuEnabled(bool enable)
+{
+    gpuEnabled = enable;
+}
+
+void Profiler::BeginFrame()
+{
+    if (!enabled)
+        return;
+    if (inFrame)
+        EndFrame();
+
+    if (gpuEnabled && !gpuInitialized) {
+        for (GpuQuerySet& set : gpuSets)
+            glGenQueries(MAX_GPU_ZONES * 2, set.queries);
+        gpuInitialized = true;
+        calibrateGpuClock();
+    }
+
+    // This frame reuses the query set of two frames ago: read it back first
+    GpuQuerySet& set = gpuSets[frameCounter % 2];
+    if (gpuInitialized) {
+        resolveGpuSet(set, droppedEvents);
+        // timer drift between the clocks is slow, an occasional correction is enough
+        if (frameCounter % 256 == 0)
+            calibrateGpuClock();
+    }
+    set.count = 0;
+    set.frameIndex = frameCounter;
+    gpuDepth = 0;
+
+    ProfileFrame& frame = history[frameCounter % HISTORY_FRAMES];
+    frame.index = frameCounter;
+    frame.startNs = Now();
+    frame.endNs = frame.startNs;
+    frame.cpuEvents.clear();
+    frame.gpuEvents.clear();
+    frame.gpuResolved = !gpuInitialized;
+
+    mainThreadId = threadBuffer().threadId;
+    inFrame = true;
+}
+
+void Profiler::EndFrame()
+{
+    if (!inFrame)
+        return;
+    inFrame = false;
+
+    ProfileFrame& frame = history[frameCounter % HISTORY_FRAMES];
+    frame.endNs = Now();
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& buffer : registry) {
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            if (written - buffer->read > ThreadBuffer::CAPACITY) {
+                // the owner lapped the ring since the last collection
+                droppedEvents += written - buffer->read - ThreadBuffer::CAPACITY;
+                buffer->read = written - ThreadBuffer::CAPACITY;
+            }
+            for (; buffer->read < written; buffer->read++)
+                frame.cpuEvents.push_back(buffer->events[buffer->read % ThreadBuffer::CAPACITY]);
+        }
+    }
+
+    GpuQuerySet& set = gpuSets[frameCounter % 2];
+    set.pending = gpuInitialized && set.count > 0;
+    if (set.pending) {
+        // without a swap (headless runs) nothing else submits the queries
+        glFlush();
+    }
+    if (gpuInitialized && set.count == 0)
+        frame.gpuResolved = true;
+
+    frameTimes[frameCounter % HISTORY_FRAMES] = (frame.endNs - frame.startNs) / 1.0e6f;
+    frameCounter++;
+}
+
+void Profiler::BeginCpuZone()
+{
+    threadBuffer().depth++;
+}
+
+void Profiler::EndCpuZone(const char* name, uint64_t startNs)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    buffer.depth--;
+
+    uint64_t slot = buffer.written.load(std::memory_order_relaxed);
+    ProfileEvent& event = buffer.events[slot % ThreadBuffer::CAPACITY];
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = Now() - startNs;
+    event.threadId = buffer.threadId;
+    event.depth = buffer.depth;
+    buffer.written.store(slot + 1, std::memory_order_release);
+}
+
+int Profiler::BeginGpuZone(const char* name)
+{
+    if (!enabled || !gpuInitialized || !inFrame)
+        return -1;
+    GpuQuerySet& set = gpuSets[frameCounter % 2];
+    if (set.count >= MAX_GPU_ZONES)
+        return -1;
+
+    int zone = set.count++;
+    set.names[zone] = name;
+    set.depths[zone] = gpuDepth++;
+    glQueryCounter(set.queries[zone * 2], GL_TIMESTAMP);
+    return zone;
+}
+
+void Profiler::EndGpuZone(int zone)
+{
+    if (zone < 0)
+        return;
+    GpuQuerySet& set = gpuSets[frameCounter % 2];
+    glQueryCounter(set.queries[zone * 2 + 1], GL_TIMESTAMP);
+    gpuDepth--;
+}
+
+std::vector<const ProfileFrame*> Profiler::GetHistory()
+{
+    std::vector<const ProfileFrame*> frames;
+    uint64_t completed = frameCounter;
+    // the slot after the newest frame is the next to be overwritten, leave it out
+    uint64_t first = completed > HISTORY_FRAMES - 1 ? completed - (HISTORY_FRAMES - 1) : 0;
+    for (uint64_t i = first; i < completed; i++) {
+        if (const ProfileFrame* frame = findFrame(i))
+            frames.push_back(frame);
+    }
+    return frames;
+}
+
+const ProfileFrame* Profiler::GetLastResolvedFrame()
+{
+    std::vector<const ProfileFrame*> frames = GetHistory();
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+        if ((*it)->gpuResolved)
+            return *it;
+    }
+    return nullptr;
+}
+
+const float* Profiler::GetFrameTimes()
+{
+    return frameTimes;
+}
+
+int Profiler::GetFrameTimeOffset()
+{
+    return static_cast<int>(frameCounter % HISTORY_FRAMES);
+}
+
+float Profiler::GetAverageFrameTime()
+{
+    int count = static_cast<int>(frameCounter < HISTORY_FRAMES ? frameCounter : HISTORY_FRAMES);
+    if (count == 0)
+        return 0.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++)
+        sum += frameTimes[i];
+    return sum / count;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "ERROR::PROFILER: Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<const ProfileFrame*> frames = GetHistory();
+    bool first = true;
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& buffer : registry) {
+            writeThreadName(out, first, buffer->threadId,
+                            buffer->threadId == mainThreadId ? "Main" : "Worker " + std::to_string(buffer->threadId));
+        }
+    }
+    writeThreadName(out, first, GPU_THREAD_ID, "GPU");
+
+    for (const ProfileFrame* frame : frames) {
+        std::string frameName = "Frame " + std::to_string(frame->index);
+        writeTraceEvent(out, first, frameName.c_str(), "frame", frame->startNs, frame->endNs - frame->startNs, mainThreadId);
+        for (const ProfileEvent& event : frame->cpuEvents)
+            writeTraceEvent(out, first, event.name, "cpu", event.startNs, event.durationNs, event.threadId);
+        for (const ProfileEvent& event : frame->gpuEvents)
+            writeTraceEvent(out, first, event.name, "gpu", event.startNs, event.durationNs, event.threadId);
+    }
+    out << "\n]}\n";
+
+    std::cout << "Profiler: wrote " << frames.size() << " frames to " << path << std::endl;
+    return out.good();
+}
@@ -0,0 +1,127 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One closed zone. Times are nanoseconds on the Profiler clock (steady clock
+// since the first use); GPU zones are converted onto the same clock.
+struct ProfileEvent {
+    const char* name;     // string literal passed to PROFILE_SCOPE, never copied
+    uint64_t startNs;
+    uint64_t durationNs;
+    uint32_t threadId;    // Profiler::GPU_THREAD_ID for GPU zones
+    uint16_t depth;       // nesting level within its thread
+};
+
+// Everything recorded between two BeginFrame() calls
+struct ProfileFrame {
+    uint64_t index = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    std::vector<ProfileEvent> cpuEvents;  // every thread, collected at EndFrame()
+    std::vector<ProfileEvent> gpuEvents;  // arrive two frames later
+    bool gpuResolved = false;             // false until the GPU zones were read back (or dropped)
+};
+
+// Scoped-zone frame profiler.
+//
+// CPU zones are appended to a per-thread ring that only its own thread writes
+// (no locks on the recording path); the main thread drains all rings at
+// EndFrame(). GPU zones put GL_TIMESTAMP queries around the commands of the
+// zone. Two query sets are used in turn, so a frame's queries are read back
+// just before its set is reused, two frames later, and only if the GPU has
+// finished them: the profiler never waits on the GPU, it drops the zones instead.
+//
+// GPU zones must be opened on the thread that owns the GL context.
+class Profiler
+{
+public:
+    static const uint32_t GPU_THREAD_ID = 0xFFFF;
+    static const int HISTORY_FRAMES = 240;       // frames kept for the panel and trace export
+    static const int MAX_GPU_ZONES = 64;         // per frame, further zones are CPU only
+
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+    // GPU zones need a current GL context; turn them off before profiling without one
+    static void SetGpuEnabled(bool enabled);
+
+    static void BeginFrame();
+    static void EndFrame();
+
+    // completed frames, oldest first
+    static std::vector<const ProfileFrame*> GetHistory();
+    // the newest frame whose GPU zones are known, or nullptr
+    static const ProfileFrame* GetLastResolvedFrame();
+    // CPU time of the last HISTORY_FRAMES frames as a ring; see GetFrameTimeOffset
+    static const float* GetFrameTimes();
+    static int GetFrameTimeOffset();
+    static float GetAverageFrameTime();
+    static unsigned long GetDroppedEvents() { return droppedEvents; }
+
+    // writes the history as Chrome trace_event JSON (chrome://tracing, Perfetto)
+    static bool WriteChromeTrace(const std::string& path);
+
+    // used by ProfileScope / ProfileGpuScope
+    static void BeginCpuZone();
+    static void EndCpuZone(const char* name, uint64_t startNs);
+    static int BeginGpuZone(const char* name);
+    static void EndGpuZone(int zone);
+    static uint64_t Now();
+
+private:
+    static bool enabled;
+    static bool gpuEnabled;
+    static unsigned long droppedEvents;
+};
+
+// Times the enclosing scope on the CPU
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) : name(name), startNs(0)
+    {
+        if (Profiler::IsEnabled()) {
+            Profiler::BeginCpuZone();
+            startNs = Profiler::Now();
+        } else {
+            this->name = nullptr;
+        }
+    }
+    ~ProfileScope()
+    {
+        if (name)
+            Profiler::EndCpuZone(name, startNs);
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+// Times the GL commands issued in the enclosing scope on the GPU
+class ProfileGpuScope
+{
+public:
+    explicit ProfileGpuScope(const char* name) : zone(Profiler::BeginGpuZone(name)) {}
+    ~ProfileGpuScope() { Profiler::EndGpuZone(zone); }
+    ProfileGpuScope(const ProfileGpuScope&) = delete;
+    ProfileGpuScope& operator=(const ProfileGpuScope&) = delete;
+
+private:
+    int zone;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// name must be a string literal (or otherwise outlive the profiler history)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// a CPU zone and a GPU zone with the same name
+#define PROFILE_GPU_SCOPE(name) \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name); \
+    ProfileGpuScope PROFILE_CONCAT(profileGpuScope, __LINE__)(name)
+
+#endif // PROFILER_H
@@ -7,6 +7,8 @@
 #include <glad/glad.h>
 #include <vector>
 #include <string>
+#include "GLStateCache.h"
+#include "RenderStats.h"
 
 class ReflectionRenderer {
 private:
@@ -76,9 +78,10 @@ public:
 
         glGenVertexArrays(1, &cubeVAO);
         glGenBuffers(1, &cubeVBO);
-        glBindVertexArray(cubeVAO);
+        GLStateCache::BindVertexArray(cubeVAO);
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
+        RenderStats::RecordUpload(sizeof(cubeVertices));
 
         // Position attribute
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
@@ -165,22 +168,23 @@ public:
             case 0: // backpack (default cube for now)
             case 1: // cube
             default:
-                glBindVertexArray(cubeVAO);
+                GLStateCache::BindVertexArray(cubeVAO);
 
                 // Bind skybox to unit 0
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
+                GLStateCache::ActiveTexture(GL_TEXTURE0);
+                GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
                 reflectionShader->SetInteger("skybox", 0);
 
                 // Bind reflection map to unit 1
                 if (useReflectionMap) {
-                    glActiveTexture(GL_TEXTURE1);
-                    glBindTexture(GL_TEXTURE_2D, reflectionMapTexture);
+                    GLStateCache::ActiveTexture(GL_TEXTURE1);
+                    GLStateCache::BindTexture(GL_TEXTURE_2D, reflectionMapTexture);
                     reflectionShader->SetInteger("reflectionMap", 1);
                 }
 
                 glDrawArrays(GL_TRIANGLES, 0, 36);
-                glBindVertexArray(0);
+                RenderStats::RecordDraw(GL_TRIANGLES, 36);
+                GLStateCache::BindVertexArray(0);
                 break;
             case 2: // sphere
                 // Render a sphere with reflection
@@ -210,22 +214,23 @@ private:
 
         // For now, just use a simple sphere implementation
         // In a real implementation, you'd have a sphere VAO/VBO
-        glBindVertexArray(cubeVAO); // Use cube VAO as placeholder
+        GLStateCache::BindVertexArray(cubeVAO); // Use cube VAO as placeholder
 
         // Bind skybox to unit 0
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
+        GLStateCache::ActiveTexture(GL_TEXTURE0);
+        GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
         reflectionShader->SetInteger("skybox", 0);
 
         // Bind reflection map to unit 1
         if (useReflectionMap) {
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, reflectionMapTexture);
+            GLStateCache::ActiveTexture(GL_TEXTURE1);
+            GLStateCache::BindTexture(GL_TEXTURE_2D, reflectionMapTexture);
             reflectionShader->SetInteger("reflectionMap", 1);
         }
 
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+        RenderStats::RecordDraw(GL_TRIANGLES, 36);
+        GLStateCache::BindVertexArray(0);
     }
 
 };
\ No newline at end of file
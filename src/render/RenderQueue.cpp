@@ -0,0 +1,223 @@
+#include "RenderQueue.h"
+#include "../Mesh.hpp"
+#include <algorithm>
+#include "GLStateCache.h"
+#include "RenderStats.h"
+
+uint64_t RenderQueue::makeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t mesh, uint32_t depth) {
+    return (static_cast<uint64_t>(pass) & 0xF) << 60 |
+           (static_cast<uint64_t>(shader) & 0xFFF) << 48 |
+           (static_cast<uint64_t>(material) & 0xFFFF) << 32 |
+           (static_cast<uint64_t>(mesh) & 0xFFFF) << 16 |
+           (static_cast<uint64_t>(depth) & 0xFFFF);
+}
+
+void RenderQueue::begin(const glm::vec3& position, float far) {
+    items.clear();
+    keys.clear();
+    sorted = false;
+    cameraPos = position;
+    farPlane = far > 0.0f ? far : 1.0f;
+}
+
+uint32_t RenderQueue::materialId(const m3D::Mesh& mesh) {
+    // the hash is kept by the material; the texture order matters since it decides the units
+    uint64_t hash = mesh.material.Hash();
+    if (hash == 0) {
+        return 0;
+    }
+    auto it = materialIds.find(hash);
+    if (it == materialIds.end()) {
+        it = materialIds.emplace(hash, static_cast<uint32_t>(materialIds.size() + 1)).first;
+    }
+    return it->second;
+}
+
+void RenderQueue::setAtlasShader(const Shader* sceneShader, Shader* shader) {
+    atlasSceneShader = sceneShader;
+    atlasShader = shader;
+}
+
+void RenderQueue::submit(Shader& shader, const m3D::Mesh& mesh, const glm::mat4& model, RenderPass pass, int lod) {
+    uint32_t material = materialId(mesh);
+    uint32_t sortMaterial = material;
+    int atlas = -1;
+    if (atlasShader && &shader == atlasSceneShader) {
+        atlas = MaterialAtlas::Find(mesh.material);
+        if (atlas >= 0) {
+            // materials of a batch sort together whatever their textures; the item keeps its
+            // own id, since the ones left unmerged still bind their textures one by one
+            sortMaterial = 0x8000 | (MaterialAtlas::GetEntry(atlas).batch & 0x7FFF);
+        }
+    }
+
+    // Quantize the view distance of the mesh origin into 16 bits
+    float distance = glm::length(glm::vec3(model[3]) - cameraPos);
+    float normalized = std::min(std::max(distance / farPlane, 0.0f), 1.0f);
+    uint32_t depth = static_cast<uint32_t>(normalized * 65535.0f);
+    if (pass == RenderPass::Transparent) {
+        depth = 0xFFFF - depth; // blend back-to-front
+    }
+
+    keys.push_back(makeKey(pass, shader.ID, sortMaterial, mesh.VAO, depth));
+    items.push_back({&shader, &mesh, material, model, lod, atlas});
+    sorted = false;
+}
+
+void RenderQueue::sort() {
+    const size_t count = keys.size();
+    sorted = true;
+    order.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    if (count < 2) {
+        return;
+    }
+
+    // LSD radix sort, 8 bits per pass; stable, so equal keys keep submission order
+    scratchKeys.resize(count);
+    scratchOrder.resize(count);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {0};
+        for (size_t i = 0; i < count; i++) {
+            histogram[(keys[i] >> shift) & 0xFF]++;
+        }
+        // Every key has the same byte here, nothing to reorder
+        if (histogram[(keys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            size_t n = bucket;
+            bucket = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t dst = histogram[(keys[i] >> shift) & 0xFF]++;
+            scratchKeys[dst] = keys[i];
+            scratchOrder[dst] = order[i];
+        }
+        keys.swap(scratchKeys);
+        order.swap(scratchOrder);
+    }
+}
+
+void RenderQueue::execute(const ShaderSetup& onShaderBound) {
+    stats.reset();
+    stats.items = static_cast<unsigned int>(items.size());
+    if (!sorted) {
+        sort();
+    }
+
+    Shader* currentShader = nullptr;
+    uint32_t currentMaterial = ~0u;
+    unsigned int currentVAO = 0;
+    UniformHandle modelLocation;
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const DrawItem& item = items[order[i]];
+
+        size_t run = mergeableRun(i);
+        if (run > 1) {
+            if (currentShader != atlasShader) {
+                currentShader = atlasShader;
+                currentShader->Use();
+                stats.programBinds++;
+                if (onShaderBound) {
+                    onShaderBound(*currentShader);
+                }
+            }
+            if (item.mesh->VAO != currentVAO) {
+                currentVAO = item.mesh->VAO;
+                GLStateCache::BindVertexArray(currentVAO);
+                stats.vaoBinds++;
+            }
+            executeMerged(i, run);
+            currentMaterial = ~0u;
+            i += run - 1;
+            continue;
+        }
+
+        if (item.shader != currentShader) {
+            currentShader = item.shader;
+            currentShader->Use();
+            stats.programBinds++;
+            if (onShaderBound) {
+                onShaderBound(*currentShader);
+            }
+            modelLocation = currentShader->GetUniform("model");
+            // Sampler uniforms are per program, so the material must be re-applied
+            currentMaterial = ~0u;
+        }
+
+        if (item.material != currentMaterial) {
+            currentMaterial = item.material;
+            stats.textureBinds += item.mesh->BindTextures(*currentShader);
+        }
+
+        if (item.mesh->VAO != currentVAO) {
+            currentVAO = item.mesh->VAO;
+            GLStateCache::BindVertexArray(currentVAO);
+            stats.vaoBinds++;
+        }
+
+        currentShader->SetMatrix4(modelLocation, item.model);
+        item.mesh->DrawElements(item.lod);
+        stats.drawCalls++;
+    }
+
+    if (currentVAO != 0) {
+        GLStateCache::BindVertexArray(0);
+    }
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
+}
+
+size_t RenderQueue::mergeableRun(size_t first) const {
+    const DrawItem& head = items[order[first]];
+    if (head.atlas < 0 || !atlasShader || head.mesh->geometry == INVALID_GEOMETRY) {
+        return 0;
+    }
+    size_t last = first + 1;
+    const uint32_t batch = MaterialAtlas::GetEntry(head.atlas).batch;
+    while (last < order.size()) {
+        const DrawItem& item = items[order[last]];
+        if (item.atlas < 0 || item.shader != head.shader || MaterialAtlas::GetEntry(item.atlas).batch != batch ||
+            item.mesh->VAO != head.mesh->VAO || item.mesh->geometry == INVALID_GEOMETRY) {
+            break;
+        }
+        last++;
+    }
+    return last - first;
+}
+
+void RenderQueue::executeMerged(size_t first, size_t count) {
+    const DrawItem& head = items[order[first]];
+    stats.textureBinds += MaterialAtlas::BindBatch(MaterialAtlas::GetEntry(head.atlas).batch);
+
+    drawRecords.clear();
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    GLsizei indexCount = 0;
+    for (size_t i = first; i < first + count; i++) {
+        const DrawItem& item = items[order[i]];
+        const MaterialAtlasEntry& entry = MaterialAtlas::GetEntry(item.atlas);
+        const GeometryRange& range = GeometryPool::Get(item.mesh->geometry);
+        const MeshLod& level = item.mesh->lods[item.lod];
+        drawRecords.push_back({item.model, entry.layers, {entry.handles[0], entry.handles[1]}});
+        drawCounts.push_back(level.indexCount);
+        drawOffsets.push_back(range.indexOffset(level.firstIndex));
+        drawBaseVertices.push_back(range.baseVertex);
+        indexCount += level.indexCount;
+    }
+
+    // the draw records are indexed by gl_DrawIDARB, so item i reads its matrix and textures from record i
+    MaterialAtlas::UploadDraws(drawRecords.data(), drawRecords.size());
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(),
+                                  static_cast<GLsizei>(count), drawBaseVertices.data());
+    RenderStats::RecordDraw(GL_TRIANGLES, indexCount);
+    stats.drawCalls++;
+    stats.multiDraws++;
+    stats.mergedDraws += static_cast<unsigned int>(count);
+}
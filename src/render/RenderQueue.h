@@ -0,0 +1,99 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <glm/glm.hpp>
+#include "Shader.h"
+#include "MaterialAtlas.h"
+
+namespace m3D { class Mesh; }
+
+// Passes are the most significant part of the sort key, so every item of
+// a pass is submitted before the next pass starts
+enum class RenderPass : uint8_t {
+    Opaque = 0,
+    Transparent = 1,  // sorted back-to-front instead of front-to-back
+    Overlay = 2
+};
+
+// One mesh draw, recorded during collection and replayed after sorting
+struct DrawItem {
+    Shader* shader;
+    const m3D::Mesh* mesh;
+    uint32_t material; // id of the mesh textures, decides whether they are bound again
+    glm::mat4 model;
+    int lod;  // level of detail of the mesh to draw
+    int atlas; // MaterialAtlas entry of the mesh material, -1 when drawn with its own textures
+};
+
+// State changes issued by the last execute(); compare with items to see the savings
+struct RenderQueueStats {
+    unsigned int items = 0;
+    unsigned int drawCalls = 0;
+    unsigned int programBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int vaoBinds = 0;
+    unsigned int multiDraws = 0;   // glMultiDrawElementsBaseVertex calls, each counted once in drawCalls
+    unsigned int mergedDraws = 0;  // items drawn by them
+
+    void reset() { *this = RenderQueueStats(); }
+};
+
+// Collects draw items into a flat array, radix-sorts them by a 64-bit key
+//   [63..60] pass  [59..48] shader  [47..32] material  [31..16] mesh  [15..0] depth
+// and submits them binding only the state that changes between neighbours.
+// With an atlas shader set, neighbours of the scene shader whose materials are
+// in the same MaterialAtlas batch and whose meshes share a GeometryPool VAO
+// are drawn by one glMultiDrawElementsBaseVertex instead.
+class RenderQueue {
+public:
+    // called after a program is bound so per-program uniforms can be set
+    using ShaderSetup = std::function<void(Shader&)>;
+
+    // clears the items of the previous frame; depth is measured from cameraPos
+    void begin(const glm::vec3& cameraPos, float farPlane);
+    void submit(Shader& shader, const m3D::Mesh& mesh, const glm::mat4& model,
+                RenderPass pass = RenderPass::Opaque, int lod = 0);
+    void sort();
+    void execute(const ShaderSetup& onShaderBound);
+    // items submitted with sceneShader are merged and drawn with atlasShader, its MATERIAL_ATLAS
+    // twin (see MaterialAtlas::SetupProgram); nullptr draws every item on its own
+    void setAtlasShader(const Shader* sceneShader, Shader* atlasShader);
+
+    const RenderQueueStats& getStats() const { return stats; }
+    size_t size() const { return items.size(); }
+
+    static uint64_t makeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t mesh, uint32_t depth);
+
+private:
+    uint32_t materialId(const m3D::Mesh& mesh);
+    // items from order[first] on that one multi-draw can draw
+    size_t mergeableRun(size_t first) const;
+    void executeMerged(size_t first, size_t count);
+
+    std::vector<DrawItem> items;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    // radix sort scratch, kept between frames to avoid reallocations
+    std::vector<uint64_t> scratchKeys;
+    std::vector<uint32_t> scratchOrder;
+    // texture sets are interned so equal materials share an id across frames
+    std::unordered_map<uint64_t, uint32_t> materialIds;
+    const Shader* atlasSceneShader = nullptr;
+    Shader* atlasShader = nullptr;
+    // arguments of the multi-draw being issued, kept between frames
+    std::vector<MaterialDrawRecord> drawRecords;
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+
+    glm::vec3 cameraPos = glm::vec3(0.0f);
+    float farPlane = 1000.0f;
+    bool sorted = false;
+    RenderQueueStats stats;
+};
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,277 @@
+#include "RenderStats.h"
+#include "GLStateCache.h"
+#include "Shader.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+FramePass RenderStats::currentPass = FramePass::Other;
+RenderFrameStats RenderStats::currentFrame;
+RenderFrameStats RenderStats::lastFrame;
+std::vector<RenderBudget> RenderStats::budgets;
+
+namespace {
+
+const char* PASS_NAMES[] = { "mirror", "main", "reflection", "skybox", "post", "gui", "other" };
+const char* METRIC_NAMES[] = { "draws", "instances", "triangles", "programs", "textures", "vaos",
+                               "bytes", "uniforms", "fbos" };
+
+// Counter values at the last pass switch
+struct CounterSnapshot {
+    unsigned long programBinds = 0;
+    unsigned long textureBinds = 0;
+    unsigned long vaoBinds = 0;
+    unsigned long framebufferBinds = 0;
+    unsigned long uniformCalls = 0;
+};
+CounterSnapshot snapshot;
+
+CounterSnapshot readCounters()
+{
+    const GLStateCounters& gl = GLStateCache::GetCounters();
+    CounterSnapshot now;
+    now.programBinds = gl.count(GLStateCall::UseProgram);
+    now.textureBinds = gl.count(GLStateCall::BindTexture);
+    now.vaoBinds = gl.count(GLStateCall::BindVertexArray);
+    now.framebufferBinds = gl.count(GLStateCall::BindFramebuffer);
+    now.uniformCalls = Shader::Counters.uniformUploads;
+    return now;
+}
+
+// Counters may be reset behind our back (benchmarks do); count from zero then
+unsigned long delta(unsigned long now, unsigned long before)
+{
+    return now >= before ? now - before : now;
+}
+
+std::ofstream csv;
+
+} // namespace
+
+void FramePassStats::add(const FramePassStats& other)
+{
+    for (size_t i = 0; i < static_cast<size_t>(RenderMetric::Count); i++)
+        values[i] += other.values[i];
+}
+
+bool FramePassStats::empty() const
+{
+    for (unsigned long value : values) {
+        if (value != 0)
+            return false;
+    }
+    return true;
+}
+
+FramePassStats RenderFrameStats::total() const
+{
+    FramePassStats sum;
+    for (const FramePassStats& stats : passes)
+        sum.add(stats);
+    return sum;
+}
+
+const char* RenderStats::PassName(FramePass pass)
+{
+    return pass < FramePass::Count ? PASS_NAMES[static_cast<size_t>(pass)] : "?";
+}
+
+const char* RenderStats::MetricName(RenderMetric metric)
+{
+    return metric < RenderMetric::Count ? METRIC_NAMES[static_cast<size_t>(metric)] : "?";
+}
+
+void RenderStats::flushCounters()
+{
+    CounterSnapshot now = readCounters();
+    FramePassStats& stats = currentFrame.passes[static_cast<size_t>(currentPass)];
+    stats[RenderMetric::ProgramBinds] += delta(now.programBinds, snapshot.programBinds);
+    stats[RenderMetric::TextureBinds] += delta(now.textureBinds, snapshot.textureBinds);
+    stats[RenderMetric::VaoBinds] += delta(now.vaoBinds, snapshot.vaoBinds);
+    stats[RenderMetric::FramebufferBinds] += delta(now.framebufferBinds, snapshot.framebufferBinds);
+    stats[RenderMetric::UniformCalls] += delta(now.uniformCalls, snapshot.uniformCalls);
+    snapshot = now;
+}
+
+void RenderStats::BeginFrame()
+{
+    uint64_t frame = currentFrame.frame;
+    currentFrame = RenderFrameStats();
+    currentFrame.frame = frame;
+    currentPass = FramePass::Other;
+    snapshot = readCounters();
+}
+
+void RenderStats::EndFrame()
+{
+    flushCounters();
+    lastFrame = currentFrame;
+    currentFrame.frame++;
+
+    FramePassStats total = lastFrame.total();
+    if (csv.is_open()) {
+        auto writeRow = [&](const char* pass, const FramePassStats& stats) {
+            csv << lastFrame.frame << ',' << pass;
+            for (unsigned long value : stats.values)
+                csv << ',' << value;
+            csv << '\n';
+        };
+        for (size_t i = 0; i < static_cast<size_t>(FramePass::Count); i++) {
+            if (!lastFrame.passes[i].empty())
+                writeRow(PASS_NAMES[i], lastFrame.passes[i]);
+        }
+        writeRow("total", total);
+    }
+
+    for (RenderBudget& budget : budgets) {
+        const FramePassStats& stats = budget.pass < 0 ? total : lastFrame.passes[budget.pass];
+        unsigned long value = stats.get(budget.metric);
+        if (value > budget.worst)
+            budget.worst = value;
+        if (value > budget.limit) {
+            if (budget.violations == 0) {
+                std::cout << "RenderStats: budget " << budget.text << " exceeded in frame " << lastFrame.frame
+                          << " (" << value << ")" << std::endl;
+            }
+            budget.violations++;
+        }
+    }
+}
+
+void RenderStats::SetPass(FramePass pass)
+{
+    if (pass == currentPass)
+        return;
+    flushCounters();
+    currentPass = pass;
+}
+
+void RenderStats::RecordDraw(GLenum mode, GLsizei vertexCount, GLsizei instanceCount)
+{
+    unsigned long primitives = 0;
+    switch (mode) {
+    case GL_TRIANGLES:
+        primitives = vertexCount / 3;
+        break;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+        primitives = vertexCount > 2 ? vertexCount - 2 : 0;
+        break;
+    default:
+        break; // points and lines have no triangles
+    }
+    FramePassStats& stats = currentFrame.passes[static_cast<size_t>(currentPass)];
+    stats[RenderMetric::DrawCalls]++;
+    stats[RenderMetric::Instances] += instanceCount;
+    stats[RenderMetric::Triangles] += primitives * instanceCount;
+}
+
+void RenderStats::RecordUpload(size_t bytes)
+{
+    currentFrame.passes[static_cast<size_t>(currentPass)][RenderMetric::BufferBytes] += bytes;
+}
+
+bool RenderStats::OpenCsv(const std::string& path)
+{
+    CloseCsv();
+    csv.open(path);
+    if (!csv) {
+        std::cout << "ERROR::RENDER_STATS: Could not open " << path << std::endl;
+        return false;
+    }
+    csv << "frame,pass";
+    for (const char* name : METRIC_NAMES)
+        csv << ',' << name;
+    csv << '\n';
+    return true;
+}
+
+void RenderStats::CloseCsv()
+{
+    if (csv.is_open())
+        csv.close();
+}
+
+bool RenderStats::AddBudget(const std::string& spec)
+{
+    RenderBudget budget;
+    budget.text = spec;
+    size_t op = spec.find("<=");
+    if (op == std::string::npos) {
+        std::cout << "ERROR::RENDER_STATS: Budget \"" << spec << "\" is not of the form [pass.]metric<=limit" << std::endl;
+        return false;
+    }
+
+    std::string name = spec.substr(0, op);
+    size_t dot = name.find('.');
+    if (dot != std::string::npos) {
+        std::string passName = name.substr(0, dot);
+        name = name.substr(dot + 1);
+        for (size_t i = 0; i < static_cast<size_t>(FramePass::Count); i++) {
+            if (passName == PASS_NAMES[i])
+                budget.pass = static_cast<int>(i);
+        }
+        if (budget.pass < 0) {
+            std::cout << "ERROR::RENDER_STATS: Unknown pass \"" << passName << "\" in budget " << spec << std::endl;
+            return false;
+        }
+    }
+
+    bool found = false;
+    for (size_t i = 0; i < static_cast<size_t>(RenderMetric::Count); i++) {
+        if (name == METRIC_NAMES[i]) {
+            budget.metric = static_cast<RenderMetric>(i);
+            found = true;
+        }
+    }
+    if (!found) {
+        std::cout << "ERROR::RENDER_STATS: Unknown metric \"" << name << "\" in budget " << spec << std::endl;
+        return false;
+    }
+
+    const char* limit = spec.c_str() + op + 2;
+    char* end = nullptr;
+    budget.limit = std::strtoul(limit, &end, 10);
+    if (end == limit || *end != '\0') {
+        std::cout << "ERROR::RENDER_STATS: Bad limit in budget " << spec << std::endl;
+        return false;
+    }
+
+    budgets.push_back(budget);
+    return true;
+}
+
+bool RenderStats::AddBudgets(const std::string& specs)
+{
+    bool ok = true;
+    size_t start = 0;
+    while (start <= specs.size()) {
+        size_t end = specs.find_first_of(",;", start);
+        if (end == std::string::npos)
+            end = specs.size();
+        std::string spec = specs.substr(start, end - start);
+        spec.erase(0, spec.find_first_not_of(" \t"));
+        spec.erase(spec.find_last_not_of(" \t") + 1);
+        if (!spec.empty())
+            ok = AddBudget(spec) && ok;
+        start = end + 1;
+    }
+    return ok;
+}
+
+bool RenderStats::BudgetsMet()
+{
+    for (const RenderBudget& budget : budgets) {
+        if (budget.violations > 0)
+            return false;
+    }
+    return true;
+}
+
+void RenderStats::PrintBudgetReport()
+{
+    for (const RenderBudget& budget : budgets) {
+        std::cout << "Budget " << budget.text << ": " << (budget.violations ? "FAILED" : "ok")
+                  << " (worst " << budget.worst << ", " << budget.violations << " frames over)" << std::endl;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// Passes of a Game3D frame; everything outside a FramePassScope counts as Other
+enum class FramePass : uint8_t {
+    Mirror,
+    Main,
+    Reflection,
+    Skybox,
+    PostProcess,
+    Gui,
+    Other,
+    Count
+};
+
+enum class RenderMetric : uint8_t {
+    DrawCalls,
+    Instances,
+    Triangles,
+    ProgramBinds,
+    TextureBinds,
+    VaoBinds,
+    BufferBytes,     // uploaded with glBufferData / glBufferSubData
+    UniformCalls,
+    FramebufferBinds,
+    Count
+};
+
+struct FramePassStats {
+    unsigned long values[static_cast<size_t>(RenderMetric::Count)] = {0};
+
+    unsigned long get(RenderMetric metric) const { return values[static_cast<size_t>(metric)]; }
+    unsigned long& operator[](RenderMetric metric) { return values[static_cast<size_t>(metric)]; }
+    void add(const FramePassStats& other);
+    bool empty() const;
+};
+
+struct RenderFrameStats {
+    uint64_t frame = 0;
+    FramePassStats passes[static_cast<size_t>(FramePass::Count)];
+
+    const FramePassStats& pass(FramePass p) const { return passes[static_cast<size_t>(p)]; }
+    FramePassStats total() const;
+};
+
+// "[pass.]metric<=limit", e.g. "draws<=2000" or "main.triangles<=5000000"
+struct RenderBudget {
+    std::string text;
+    int pass = -1;                 // FramePass index, -1 for the frame total
+    RenderMetric metric = RenderMetric::DrawCalls;
+    unsigned long limit = 0;
+    unsigned long violations = 0;  // frames over the limit
+    unsigned long worst = 0;       // highest value seen
+};
+
+// Hard per-frame counts, attributed to the pass that is current when they happen.
+// Draws and buffer uploads are reported by the code that issues them; program,
+// texture, VAO and framebuffer binds are taken from GLStateCache and uniform
+// calls from Shader::Counters, as differences between pass switches.
+//
+// Every finished frame can be streamed to a CSV file (one row per non-empty
+// pass plus the total) and checked against budgets; a budget that is exceeded
+// is reported once, and BudgetsMet() stays false for the rest of the run.
+class RenderStats
+{
+public:
+    static void BeginFrame();
+    static void EndFrame();
+
+    static void SetPass(FramePass pass);
+    static FramePass GetPass() { return currentPass; }
+
+    static void RecordDraw(GLenum mode, GLsizei vertexCount, GLsizei instanceCount = 1);
+    static void RecordUpload(size_t bytes);
+
+    static const RenderFrameStats& GetLastFrame() { return lastFrame; }
+
+    static bool OpenCsv(const std::string& path);
+    static void CloseCsv();
+
+    static bool AddBudget(const std::string& spec);
+    // several specs separated by ',' or ';'
+    static bool AddBudgets(const std::string& specs);
+    static const std::vector<RenderBudget>& GetBudgets() { return budgets; }
+    static bool BudgetsMet();
+    static void PrintBudgetReport();
+
+    static const char* PassName(FramePass pass);
+    static const char* MetricName(RenderMetric metric);
+
+private:
+    static void flushCounters();
+
+    static FramePass currentPass;
+    static RenderFrameStats currentFrame;
+    static RenderFrameStats lastFrame;
+    static std::vector<RenderBudget> budgets;
+};
+
+// Makes a pass current for the enclosing scope
+class FramePassScope
+{
+public:
+    explicit FramePassScope(FramePass pass) : previous(RenderStats::GetPass()) { RenderStats::SetPass(pass); }
+    ~FramePassScope() { RenderStats::SetPass(previous); }
+    FramePassScope(const FramePassScope&) = delete;
+    FramePassScope& operator=(const FramePassScope&) = delete;
+
+private:
+    FramePass previous;
+};
+
+#endif // RENDER_STATS_H
@@ -5,11 +5,32 @@
 #include "../ConfigManager.hpp"
 #include <memory>
 #include "EnhancedVertexBuffer.h"
-#include <cstddef> // for offsetof
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "GLStateCache.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MeshLod.h"
+#include "MaterialAtlas.h"
+#include "ShaderPreprocessor.h"
 
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
 
+// Texture units of the environment maps; a mesh with this many textures or more overlaps
+// them, which is why setLightingUniforms binds them again before each program's draws
+const GLuint SKYBOX_UNIT = 5;
+const GLuint PROBE_UNIT = 6;
+
+// pixels per unit of projected height in the viewport being drawn, for LodSelector::SetView;
+// custom renders into probes or mirrors go to targets of their own size
+static float lodViewScale(const glm::mat4& projection) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    return projection[1][1] * 0.5f * (float) viewport[3];
+}
+
 Renderer3D::Renderer3D()
     : dirLight {
         glm::vec3(-0.5f, -1.0f, -0.3f), // direction - adjusted for better angle
@@ -72,6 +93,68 @@ Renderer3D::Renderer3D()
 
 void Renderer3D::init() {
     setupGround();
+
+    // Shared uniform blocks consumed by the model, planet, primitive and outline shaders
+    frameConstantsBuffer.create(sizeof(FrameConstants), FRAME_CONSTANTS_BINDING);
+    lightBuffer.create(sizeof(LightBlock), LIGHT_BLOCK_BINDING);
+    clusterRangeBuffer.create(GL_RG32UI);
+    clusterIndexBuffer.create(GL_R16UI);
+    lightDataBuffer.create(GL_RGBA32F);
+    glGenVertexArrays(1, &fullscreenVAO);
+
+    // the 12 edges of a unit cube around the origin, as lines
+    std::vector<glm::vec3> edges;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int corner = 0; corner < 4; corner++) {
+            glm::vec3 start(0.0f);
+            start[(axis + 1) % 3] = (corner & 1) ? 0.5f : -0.5f;
+            start[(axis + 2) % 3] = (corner & 2) ? 0.5f : -0.5f;
+            glm::vec3 end = start;
+            start[axis] = -0.5f;
+            end[axis] = 0.5f;
+            edges.push_back(start);
+            edges.push_back(end);
+        }
+    }
+    glGenVertexArrays(1, &boundsVAO);
+    glGenBuffers(1, &boundsVBO);
+    GLStateCache::BindVertexArray(boundsVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, boundsVBO);
+    glBufferData(GL_ARRAY_BUFFER, edges.size() * sizeof(glm::vec3), edges.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    GLStateCache::BindVertexArray(0);
+
+    initMaterialAtlas();
+}
+
+void Renderer3D::initMaterialAtlas() {
+    if (!MaterialAtlas::IsEnabled()) {
+        return;
+    }
+    ShaderDefines defines = {{"MATERIAL_ATLAS", "1"}};
+    if (MaterialAtlas::IsBindless()) {
+        defines.emplace_back("MATERIAL_BINDLESS", "1");
+    }
+    auto build = [&](const char* vertexFile, const char* fragmentFile) -> std::unique_ptr<Shader> {
+        std::string vertexSource, fragmentSource;
+        auto shader = std::make_unique<Shader>();
+        if (!ShaderPreprocessor::ProcessFile(ResourceManager::GetShaderPath(vertexFile), defines, vertexSource) ||
+            !ShaderPreprocessor::ProcessFile(ResourceManager::GetShaderPath(fragmentFile), defines, fragmentSource) ||
+            !shader->Compile(vertexSource.c_str(), fragmentSource.c_str())) {
+            return nullptr;
+        }
+        MaterialAtlas::SetupProgram(*shader);
+        return shader;
+    };
+    atlasModelShader = build("3d.vs", "3d.fs");
+    atlasGBufferShader = build("gbuffer.vs", "gbuffer.fs");
+    if (!atlasModelShader || !atlasGBufferShader) {
+        std::cout << "ERROR::RENDERER: material atlas shaders failed to build, draws are not merged" << std::endl;
+        atlasModelShader.reset();
+        atlasGBufferShader.reset();
+        MaterialAtlas::SetEnabled(false, false);
+    }
 }
 
 Renderer3D::~Renderer3D() {
@@ -82,15 +165,25 @@ Renderer3D::~Renderer3D() {
 
     // Clean up legacy buffers
     if (groundVAO) {
-        glDeleteVertexArrays(1, &groundVAO);
+        GLStateCache::DeleteVertexArrays(1, &groundVAO);
     }
     if (groundVBO) {
         glDeleteBuffers(1, &groundVBO);
     }
+    if (fullscreenVAO) {
+        GLStateCache::DeleteVertexArrays(1, &fullscreenVAO);
+    }
+    if (boundsVAO) {
+        GLStateCache::DeleteVertexArrays(1, &boundsVAO);
+    }
+    if (boundsVBO) {
+        glDeleteBuffers(1, &boundsVBO);
+    }
 }
 void Renderer3D::renderWithCustomView(Scene& scene, Camera& camera, 
     const glm::mat4& customView, 
     const glm::mat4& projection) {
+    PROFILE_SCOPE("Renderer3D::renderWithCustomView");
 
     // Store original camera position
     glm::vec3 originalPosition = camera.Position;
@@ -106,30 +199,35 @@ void Renderer3D::renderWithCustomView(Scene& scene, Camera& camera,
     camera.Front = customCameraFront;
 
     // Use your existing render method but override matrices
-    Shader &shader = ResourceManager::GetShader("model");
-    shader.Use();
-    shader.SetMatrix4("view", customView);
-    shader.SetMatrix4("projection", projection);
+    frameIndex++;
+    updateFrameConstants(camera, projection, customView, 0.1f, 1000.0f);
+    // levels of detail for this view, leaving the selection of the main view alone
+    LodSelector::SetView(customCameraPos, lodViewScale(projection), false);
+    updateLightBlock();
 
+    Shader &shader = modelShader();
+    shader.Use();
     setLightingUniforms(shader, camera);
 
     // Render ground and scene
-    glStencilMask(0x00);
+    GLStateCache::StencilMask(0x00);
     renderGround(shader);
 
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glStencilMask(0xFF);
-    scene.draw(shader);
+    GLStateCache::StencilFunc(GL_ALWAYS, 1, 0xFF);
+    GLStateCache::StencilMask(0xFF);
+    cullingStats.reset();
+    scene.draw(shader, &frustum, &cullingStats);
 
     // Restore original camera state
     camera.Position = originalPosition;
     camera.Front = originalFront;
 
     // Reset OpenGL state
-    glStencilMask(0xFF);
-    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    GLStateCache::StencilMask(0xFF);
+    GLStateCache::StencilFunc(GL_ALWAYS, 0, 0xFF);
     }
 void Renderer3D::render(Scene& scene, Camera& camera) {
+    PROFILE_SCOPE("Renderer3D::render");
     // Temporarily disable dynamic environment mapping to troubleshoot crashes
     // if (useDynamicEnvironmentMapping && dynamicEnvMapping) {
     //     // Update probes that need updating
@@ -139,47 +237,115 @@ void Renderer3D::render(Scene& scene, Camera& camera) {
     //     // In a real implementation, you'd need to implement the rendering callback differently
     // }
 
-    // Configure shader for rendering
-    Shader &defaultShader = ResourceManager::GetShader("model");
+    // Configure shader for rendering; pick up "model" variants that finished compiling
+    auto permutations = ResourceManager::Permutations.find("model");
+    if (permutations != ResourceManager::Permutations.end()) {
+        permutations->second->Update();
+    }
+    Shader &defaultShader = modelShader();
 
     // Set camera uniforms
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
                                             0.1f, 1000.0f);
     glm::mat4 view = camera.GetViewMatrix();
 
+    // Camera and lights are shared by every shader through the uniform blocks
+    frameIndex++;
+    updateFrameConstants(camera, projection, view, 0.1f, 1000.0f);
+    updateLightBlock();
+
+    // Deferred: the "model" draws fill the G-buffer and are lit in one pass afterwards
+    const bool deferred = beginDeferred();
+    Shader &sceneShader = deferred ? ResourceManager::GetShader("gbuffer") : defaultShader;
+
+    // scene draws whose materials are packed merge into multi-draws of the atlas twin
+    MaterialAtlas::Update();
+    Shader* atlasShader = deferred ? atlasGBufferShader.get() : atlasModelShader.get();
+    renderQueue.setAtlasShader(&sceneShader, MaterialAtlas::IsEnabled() ? atlasShader : nullptr);
+
     // PHASE 1: Render regular objects and mark them in stencil buffer
-    glStencilMask(0x00); // make sure we don't update the stencil buffer while drawing the floor
+    GLStateCache::StencilMask(0x00); // make sure we don't update the stencil buffer while drawing the floor
     // Render the ground
-    defaultShader.Use();
-    defaultShader.SetMatrix4("projection", projection);
-    defaultShader.SetMatrix4("view", view);
-    setLightingUniforms(defaultShader, camera);
-    renderGround(defaultShader);
+    sceneShader.Use();
+    setLightingUniforms(sceneShader, camera);
+    renderGround(sceneShader);
 
     // 1st. render pass, draw objects as normal, writing to the stencil buffer
     // --------------------------------------------------------------------
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glStencilMask(0xFF);
+    GLStateCache::StencilFunc(GL_ALWAYS, 1, 0xFF);
+    GLStateCache::StencilMask(0xFF);
+
+    // Collect what can be queued, sort by program/material/mesh/depth and submit
+    renderQueue.begin(camera.Position, 1000.0f);
+    immediateObjects.clear();
+    immediateComponents.clear();
+    visibleObjects.clear();
+    visibleItems.clear();
+    forwardObjects.clear();
+    loadingBoxes.clear();
+    cullingStats.reset();
+
+    // The scene BVH returns what intersects the frustum
+    scene.refreshBounds();
+    scene.queryFrustum(frustum, visibleItems, &cullingStats);
+
+    for (const SceneItem& item : visibleItems) {
+        if (item.component) {
+            AABB box;
+            if (item.component->loadingBounds(box)) {
+                loadingBoxes.push_back(box);
+                continue;
+            }
+            if (!item.component->submit(renderQueue, sceneShader)) {
+                immediateComponents.push_back(item.component);
+            }
+            continue;
+        }
 
-    for (auto& object : scene.getObjects()) {
+        SceneObject* object = item.object;
+        visibleObjects.push_back(object);
         Shader* customShader = object->getShader();
-        Shader& activeShader = customShader ? *customShader : defaultShader;
+        if (deferred && customShader) {
+            forwardObjects.push_back(object);
+            continue;
+        }
+        Shader& activeShader = customShader ? *customShader : sceneShader;
+        if (!object->Submit(renderQueue, activeShader)) {
+            immediateObjects.push_back(object);
+        }
+    }
+
+    renderQueue.sort();
+    renderQueue.execute([&](Shader& shader) { setLightingUniforms(shader, camera); });
+
+    // Objects without a queue path are drawn in scene order as before
+    for (SceneObject* object : immediateObjects) {
+        Shader* customShader = object->getShader();
+        Shader& activeShader = customShader ? *customShader : sceneShader;
 
         activeShader.Use();
-        activeShader.SetMatrix4("projection", projection);
-        activeShader.SetMatrix4("view", view);
         setLightingUniforms(activeShader, camera);
 
         object->Draw(activeShader);
     }
 
-    for (auto& entity : scene.getEntities()) {
-        for (auto& component : entity->getComponents()) {
-            defaultShader.Use();
-            defaultShader.SetMatrix4("projection", projection);
-            defaultShader.SetMatrix4("view", view);
-            setLightingUniforms(defaultShader, camera);
-            component->draw(defaultShader);
+    for (Component* component : immediateComponents) {
+        sceneShader.Use();
+        setLightingUniforms(sceneShader, camera);
+        component->draw(sceneShader);
+    }
+
+    if (deferred) {
+        shadeDeferred(camera);
+
+        // Objects with their own shader are lit forward on top, with depth and stencil from the G-buffer
+        GLStateCache::StencilFunc(GL_ALWAYS, 1, 0xFF);
+        GLStateCache::StencilMask(0xFF);
+        for (SceneObject* object : forwardObjects) {
+            Shader& activeShader = *object->getShader();
+            activeShader.Use();
+            setLightingUniforms(activeShader, camera);
+            object->Draw(activeShader);
         }
     }
 
@@ -187,179 +353,370 @@ void Renderer3D::render(Scene& scene, Camera& camera) {
     // Because the stencil buffer is now filled with several 1s. The parts of the buffer that are 1 are not drawn, thus only drawing
     // the objects' size differences, making it look like borders.
     // -----------------------------------------------------------------------------------------------------------------------------
-    glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-    glStencilMask(0x00);
-    glDisable(GL_DEPTH_TEST);
+    GLStateCache::StencilFunc(GL_NOTEQUAL, 1, 0xFF);
+    GLStateCache::StencilMask(0x00);
+    GLStateCache::Disable(GL_DEPTH_TEST);
 
     // Get the outline shader
     Shader &outlineShader = ResourceManager::GetShader("outline");
 
     // Explicitly activate the shader before rendering
     outlineShader.Use();
-    outlineShader.SetMatrix4("view", camera.GetViewMatrix());
-    outlineShader.SetMatrix4("projection", projection);
+    const LightingUniforms& outlineUniforms = lightingUniformsFor(outlineShader);
     // Scale factor for outlines (slightly larger than original)
     const float outlineScale = 1.03f; // 5% larger
 
     // Render model outlines
-    for (auto& object : scene.getObjects()) {
+    for (SceneObject* object : visibleObjects) {
         // We need to set the model matrix for the outline shader
-        outlineShader.SetMatrix4("model", object->GetModelMatrix());
+        outlineShader.SetMatrix4(outlineUniforms.model, object->GetModelMatrix());
         object->Draw(outlineShader);
     }
 
     // restore state
-    glStencilMask(0xFF);
-    glStencilFunc(GL_ALWAYS, 0, 0xFF);
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::StencilMask(0xFF);
+    GLStateCache::StencilFunc(GL_ALWAYS, 0, 0xFF);
+    GLStateCache::Enable(GL_DEPTH_TEST);
+
+    renderLoadingBounds();
 }
 
-// Function to set lighting uniforms
-void Renderer3D::setLightingUniforms(Shader &shader, Camera& camera) {
-    // Set material properties
-    shader.SetFloat("shininess", shininess);
-    shader.SetInteger("useNormalMap", useNormalMap ? 1 : 0);
-    shader.SetInteger("useSpecularMap", useSpecularMap ? 1 : 0);
-    shader.SetInteger("useDetailMap", useDetailMap ? 1 : 0);
-    shader.SetInteger("useScatterMap", useScatterMap ? 1 : 0);
-    shader.SetInteger("useCelShading", useCelShading ? 1 : 0);
+void Renderer3D::renderLoadingBounds() {
+    if (loadingBoxes.empty() || !boundsVAO) {
+        return;
+    }
+    auto shader = ResourceManager::Shaders.find("bounds");
+    if (shader == ResourceManager::Shaders.end()) {
+        return;
+    }
+    Shader& boundsShader = *shader->second;
+    boundsShader.Use();
+    boundsShader.SetVector3f("color", glm::vec3(0.9f, 0.7f, 0.2f));
+    GLStateCache::BindVertexArray(boundsVAO);
+    for (const AABB& box : loadingBoxes) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), box.center());
+        model = glm::scale(model, glm::max(box.max - box.min, glm::vec3(1e-3f)));
+        boundsShader.SetMatrix4("model", model);
+        glDrawArrays(GL_LINES, 0, 24);
+        RenderStats::RecordDraw(GL_LINES, 24);
+    }
+}
+
+bool Renderer3D::beginDeferred() {
+    if (renderPath != RenderPath::Deferred) {
+        return false;
+    }
+    if (ResourceManager::Shaders.find("gbuffer") == ResourceManager::Shaders.end() ||
+        ResourceManager::Shaders.find("deferred_lighting") == ResourceManager::Shaders.end()) {
+        std::cout << "ERROR::RENDERER: deferred shaders not loaded, falling back to forward" << std::endl;
+        renderPath = RenderPath::Forward;
+        return false;
+    }
+
+    deferredTarget = GLStateCache::GetDrawFramebuffer();
+    glGetIntegerv(GL_VIEWPORT, deferredViewport);
+    if (gBuffer.getWidth() != deferredViewport[2] || gBuffer.getHeight() != deferredViewport[3]) {
+        // layout in shaders/include/gbuffer.glsl
+        if (!gBuffer.create(deferredViewport[2], deferredViewport[3], {GL_RGBA8, GL_RGBA16F, GL_RGBA8})) {
+            std::cout << "ERROR::RENDERER: G-buffer incomplete, falling back to forward" << std::endl;
+            renderPath = RenderPath::Forward;
+            return false;
+        }
+    }
+
+    gBuffer.bind();
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    return true;
+}
+
+void Renderer3D::shadeDeferred(Camera& camera) {
+    PROFILE_SCOPE("Renderer3D::shadeDeferred");
+
+    // forward passes after this one depth test and stencil against the G-buffer's geometry
+    gBuffer.blitDepthStencilTo(deferredTarget);
+    glViewport(deferredViewport[0], deferredViewport[1], deferredViewport[2], deferredViewport[3]);
+
+    Shader& lightingShader = ResourceManager::GetShader("deferred_lighting");
+    lightingShader.Use();
+    setLightingUniforms(lightingShader, camera);
+    const LightingUniforms& u = lightingUniformsFor(lightingShader);
+    gBuffer.bindColorTexture(0, 0);
+    gBuffer.bindColorTexture(1, 1);
+    gBuffer.bindColorTexture(2, 2);
+    gBuffer.bindDepthTexture(3);
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
+    lightingShader.SetInteger(u.gAlbedoSpec, 0);
+    lightingShader.SetInteger(u.gNormal, 1);
+    lightingShader.SetInteger(u.gEnvironment, 2);
+    lightingShader.SetInteger(u.gDepth, 3);
+    lightingShader.SetMatrix4(u.inverseViewProjection, glm::inverse(clusterProjection * clusterView));
+
+    // one full-screen triangle; pixels without geometry are discarded
+    GLStateCache::Disable(GL_DEPTH_TEST);
+    GLStateCache::StencilMask(0x00);
+    GLStateCache::StencilFunc(GL_ALWAYS, 0, 0xFF);
+    GLStateCache::BindVertexArray(fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::RecordDraw(GL_TRIANGLES, 3);
+    GLStateCache::Enable(GL_DEPTH_TEST);
+}
 
-    // Set light brightness adjustment uniforms
-    shader.SetFloat("pointLightBrightness", pointLightBrightness);
-    shader.SetFloat("dirLightBrightness", dirLightBrightness);
-    shader.SetFloat("spotLightBrightness", spotLightBrightness);
+const std::vector<std::string>& Renderer3D::ModelShaderFeatures() {
+    static const std::vector<std::string> features = {
+        "USE_NORMAL_MAP", "USE_SPECULAR_MAP", "USE_CEL_SHADING", "USE_REFLECTION", "USE_REFRACTION"
+    };
+    return features;
+}
+
+uint32_t Renderer3D::modelShaderMask() const {
+    uint32_t mask = 0;
+    if (useNormalMap) mask |= MODEL_FEATURE_NORMAL_MAP;
+    if (useSpecularMap) mask |= MODEL_FEATURE_SPECULAR_MAP;
+    if (useCelShading) mask |= MODEL_FEATURE_CEL_SHADING;
+    if (useModelReflection) mask |= MODEL_FEATURE_REFLECTION;
+    if (useModelRefraction) mask |= MODEL_FEATURE_REFRACTION;
+    return mask;
+}
+
+Shader& Renderer3D::modelShader() {
+    auto it = ResourceManager::Permutations.find("model");
+    if (it == ResourceManager::Permutations.end()) {
+        return ResourceManager::GetShader("model");
+    }
+    return it->second->Get(modelShaderMask());
+}
+
+void LightingUniforms::resolve(const Shader& shader) {
+    projection = shader.GetUniform("projection");
+    view = shader.GetUniform("view");
+    model = shader.GetUniform("model");
+
+    shininess = shader.GetUniform("shininess");
+    useNormalMap = shader.GetUniform("useNormalMap");
+    useSpecularMap = shader.GetUniform("useSpecularMap");
+    useDetailMap = shader.GetUniform("useDetailMap");
+    useScatterMap = shader.GetUniform("useScatterMap");
+    useCelShading = shader.GetUniform("useCelShading");
+    useBlinnPhong = shader.GetUniform("useBlinnPhong");
+
+    skybox = shader.GetUniform("skybox");
+    reflectivity = shader.GetUniform("reflectivity");
+    useReflection = shader.GetUniform("useReflection");
+    useRefraction = shader.GetUniform("useRefraction");
+    refractionRatio = shader.GetUniform("refractionRatio");
+    dynamicEnvironmentMap = shader.GetUniform("dynamicEnvironmentMap");
+    useDynamicEnvironmentMap = shader.GetUniform("useDynamicEnvironmentMap");
+
+    textureDiffuse1 = shader.GetUniform("texture_diffuse1");
+    textureNormal1 = shader.GetUniform("texture_normal1");
+
+    clusterRanges = shader.GetUniform("clusterRanges");
+    clusterIndices = shader.GetUniform("clusterIndices");
+    lightData = shader.GetUniform("lightData");
+
+    gAlbedoSpec = shader.GetUniform("gAlbedoSpec");
+    gNormal = shader.GetUniform("gNormal");
+    gEnvironment = shader.GetUniform("gEnvironment");
+    gDepth = shader.GetUniform("gDepth");
+    inverseViewProjection = shader.GetUniform("inverseViewProjection");
+}
+
+LightingUniforms& Renderer3D::lightingUniformsFor(Shader &shader) {
+    if (Shader::LegacyUniformLookup) {
+        // Re-resolve on every call so benchmarks see the old per-call lookup cost
+        legacyLightingUniforms.resolve(shader);
+        legacyLightingUniforms.configuredFrame = ~0ul;
+        return legacyLightingUniforms;
+    }
+    auto it = lightingUniformCache.find(shader.ID);
+    if (it == lightingUniformCache.end()) {
+        it = lightingUniformCache.emplace(shader.ID, LightingUniforms()).first;
+        it->second.resolve(shader);
+    }
+    return it->second;
+}
 
-    // Set camera position for lighting calculations
-    shader.SetVector3f("viewPos", camera.Position);
+static void packPointLight(GPUPointLight& out, const PointLight& light) {
+    out.position = light.position;
+    out.constant = light.constant;
+    out.linear = light.linear;
+    out.quadratic = light.quadratic;
+    out.ambient = light.ambient;
+    out.diffuse = light.diffuse;
+    out.specular = light.specular;
+}
+
+void Renderer3D::updateFrameConstants(const Camera& camera, const glm::mat4& projection, const glm::mat4& view,
+                                      float nearPlane, float farPlane) {
+    static const auto startTime = std::chrono::steady_clock::now();
 
     // Update spotlight position and direction to match camera
     spotLight.position = camera.Position;
     spotLight.direction = camera.Front;
 
-    // Set directional light properties
-    shader.SetVector3f("dirLight.direction", dirLight.direction);
-    shader.SetVector3f("dirLight.ambient", dirLight.ambient);
-    shader.SetVector3f("dirLight.diffuse", dirLight.diffuse);
-    shader.SetVector3f("dirLight.specular", dirLight.specular);
-    shader.SetInteger("useDirLight", dirLight.enabled ? 1 : 0);
-
-    // Set main point light properties
-    shader.SetVector3f("pointLight.position", pointLight.position);
-    shader.SetFloat("pointLight.constant", pointLight.constant);
-    shader.SetFloat("pointLight.linear", pointLight.linear);
-    shader.SetFloat("pointLight.quadratic", pointLight.quadratic);
-    shader.SetVector3f("pointLight.ambient", pointLight.ambient);
-    shader.SetVector3f("pointLight.diffuse", pointLight.diffuse);
-    shader.SetVector3f("pointLight.specular", pointLight.specular);
-    shader.SetInteger("usePointLight", pointLight.enabled ? 1 : 0);
-
-    // Set spotlight position and direction for tangent space calculations
-    shader.SetVector3f("spotLightPos", spotLight.position);
-    shader.SetVector3f("spotLightDir", spotLight.direction);
-
-    // Set spotlight uniforms (add these back)
-    shader.SetVector3f("spotLight.position", spotLight.position);
-    shader.SetVector3f("spotLight.direction", spotLight.direction);
-    shader.SetFloat("spotLight.cutOff", spotLight.cutOff);
-    shader.SetFloat("spotLight.outerCutOff", spotLight.outerCutOff);
-    shader.SetFloat("spotLight.constant", spotLight.constant);
-    shader.SetFloat("spotLight.linear", spotLight.linear);
-    shader.SetFloat("spotLight.quadratic", spotLight.quadratic);
-    shader.SetVector3f("spotLight.ambient", spotLight.ambient);
-    shader.SetVector3f("spotLight.diffuse", spotLight.diffuse);
-    shader.SetVector3f("spotLight.specular", spotLight.specular);
-    shader.SetInteger("useSpotLight", spotLight.enabled ? 1 : 0);
-
-    // Set random point lights
-    shader.SetInteger("numRandomPointLights", static_cast<int>(randomPointLights.size()));
-    shader.SetInteger("useRandomPointLights", useRandomPointLights ? 1 : 0);
-
-    for (size_t i = 0; i < randomPointLights.size() && i < MAX_POINT_LIGHTS; i++) {
-        std::string index = std::to_string(i);
-        shader.SetVector3f(("randomPointLights[" + index + "].position").c_str(), randomPointLights[i].position);
-        shader.SetFloat(("randomPointLights[" + index + "].constant").c_str(), randomPointLights[i].constant);
-        shader.SetFloat(("randomPointLights[" + index + "].linear").c_str(), randomPointLights[i].linear);
-        shader.SetFloat(("randomPointLights[" + index + "].quadratic").c_str(), randomPointLights[i].quadratic);
-        shader.SetVector3f(("randomPointLights[" + index + "].ambient").c_str(), randomPointLights[i].ambient);
-        shader.SetVector3f(("randomPointLights[" + index + "].diffuse").c_str(), randomPointLights[i].diffuse);
-        shader.SetVector3f(("randomPointLights[" + index + "].specular").c_str(), randomPointLights[i].specular);
+    FrameConstants constants;
+    constants.projection = projection;
+    constants.view = view;
+    constants.viewPos = camera.Position;
+    constants.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+    constants.spotLightPos = spotLight.position;
+    constants.nearPlane = nearPlane;
+    constants.spotLightDir = spotLight.direction;
+    constants.farPlane = farPlane;
+    frameConstantsBuffer.update(&constants, sizeof(constants));
+
+    frustum.extract(projection * view);
+    LodSelector::SetView(camera.Position, lodViewScale(projection));
+    clusterView = view;
+    clusterProjection = projection;
+    clusterNear = nearPlane;
+    clusterFar = farPlane;
+}
+
+void Renderer3D::updateLightBlock() {
+    lightBlock.dirLight.direction = dirLight.direction;
+    lightBlock.dirLight.ambient = dirLight.ambient;
+    lightBlock.dirLight.diffuse = dirLight.diffuse;
+    lightBlock.dirLight.specular = dirLight.specular;
+    lightBlock.useDirLight = dirLight.enabled ? 1 : 0;
+
+    packPointLight(lightBlock.pointLight, pointLight);
+    lightBlock.usePointLight = pointLight.enabled ? 1 : 0;
+
+    lightBlock.spotLight.position = spotLight.position;
+    lightBlock.spotLight.direction = spotLight.direction;
+    lightBlock.spotLight.cutOff = spotLight.cutOff;
+    lightBlock.spotLight.outerCutOff = spotLight.outerCutOff;
+    lightBlock.spotLight.constant = spotLight.constant;
+    lightBlock.spotLight.linear = spotLight.linear;
+    lightBlock.spotLight.quadratic = spotLight.quadratic;
+    lightBlock.spotLight.ambient = spotLight.ambient;
+    lightBlock.spotLight.diffuse = spotLight.diffuse;
+    lightBlock.spotLight.specular = spotLight.specular;
+    lightBlock.useSpotLight = spotLight.enabled ? 1 : 0;
+
+    lightBlock.pointLightBrightness = pointLightBrightness;
+    lightBlock.dirLightBrightness = dirLightBrightness;
+    lightBlock.spotLightBrightness = spotLightBrightness;
+
+    int count = static_cast<int>(std::min<size_t>(randomPointLights.size(), MAX_POINT_LIGHTS));
+    lightBlock.numRandomPointLights = count;
+    lightBlock.useRandomPointLights = useRandomPointLights ? 1 : 0;
+    if (useRandomPointLights) {
+        updateLightClusters(count);
+    }
+    lightBlock.clusterGrid = glm::ivec4(lightClusters.getTilesX(), lightClusters.getTilesY(),
+                                        lightClusters.getSlices(), 0);
+    lightBlock.clusterDepth = glm::vec4(lightClusters.getSliceScale(), lightClusters.getSliceBias(), 0.0f, 0.0f);
+
+    lightBuffer.update(&lightBlock, sizeof(lightBlock));
+}
+
+void Renderer3D::updateLightClusters(int count) {
+    PROFILE_SCOPE("Renderer3D::updateLightClusters");
+
+    clusterLightInputs.resize(count);
+    lightTexels.resize(static_cast<size_t>(count) * 4);
+    for (int i = 0; i < count; i++) {
+        const PointLight& light = randomPointLights[i];
+        clusterLightInputs[i].position = light.position;
+        clusterLightInputs[i].radius = POINT_LIGHT_RANGE;
+
+        // unpacked again by ClusterPointLight() in clustered_lights.glsl
+        glm::vec4* texels = &lightTexels[static_cast<size_t>(i) * 4];
+        texels[0] = glm::vec4(light.position, light.constant);
+        texels[1] = glm::vec4(light.ambient, light.linear);
+        texels[2] = glm::vec4(light.diffuse, light.quadratic);
+        texels[3] = glm::vec4(light.specular, POINT_LIGHT_RANGE);
+    }
+
+    lightClusters.setProjection(clusterProjection, clusterNear, clusterFar);
+    lightClusters.assign(clusterView, clusterLightInputs.data(), clusterLightInputs.size(), &lightClusterPool);
+
+    const std::vector<glm::uvec2>& ranges = lightClusters.getRanges();
+    const std::vector<uint16_t>& indices = lightClusters.getIndices();
+    clusterRangeBuffer.update(ranges.data(), ranges.size() * sizeof(glm::uvec2));
+    // with no visible light every range is empty, so stale indices are never read
+    clusterIndexBuffer.update(indices.data(), indices.size() * sizeof(uint16_t));
+    lightDataBuffer.update(lightTexels.data(), lightTexels.size() * sizeof(glm::vec4));
+
+    clusterRangeBuffer.bind(CLUSTER_RANGES_UNIT);
+    clusterIndexBuffer.bind(CLUSTER_INDICES_UNIT);
+    lightDataBuffer.bind(LIGHT_DATA_UNIT);
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
+}
+
+// Function to set lighting uniforms
+void Renderer3D::setLightingUniforms(Shader &shader, Camera& camera) {
+    LightingUniforms& u = lightingUniformsFor(shader);
+
+    // Texture units are context state that mesh materials may have rebound since
+    // the last call, so the environment maps are bound every time (skipped by GLStateCache)
+    bool reflection = useModelReflection && u.skybox.valid() && u.reflectivity.valid();
+    if (reflection) {
+        GLStateCache::BindTexture(SKYBOX_UNIT, GL_TEXTURE_CUBE_MAP, skyboxTexture);
     }
+    int closestProbe = -1;
+    if (useDynamicEnvironmentMapping) {
+        // Find the closest reflection probe to this object
+        closestProbe = dynamicEnvMapping->getClosestProbe(camera.Position);
+        if (closestProbe != -1) {
+            GLStateCache::BindTexture(PROBE_UNIT, GL_TEXTURE_CUBE_MAP, dynamicEnvMapping->getProbeCubemap(closestProbe));
+        }
+    }
+
+    // Uniforms are program state, so once per program per frame is enough
+    if (u.configuredFrame == frameIndex) {
+        return;
+    }
+    u.configuredFrame = frameIndex;
+
+    // Set material properties
+    shader.SetFloat(u.shininess, shininess);
+    shader.SetInteger(u.useNormalMap, useNormalMap ? 1 : 0);
+    shader.SetInteger(u.useSpecularMap, useSpecularMap ? 1 : 0);
+    shader.SetInteger(u.useDetailMap, useDetailMap ? 1 : 0);
+    shader.SetInteger(u.useScatterMap, useScatterMap ? 1 : 0);
+    shader.SetInteger(u.useCelShading, useCelShading ? 1 : 0);
+    shader.SetInteger(u.useBlinnPhong, useBlinnPhong ? 1 : 0);
+    shader.SetInteger(u.clusterRanges, static_cast<int>(CLUSTER_RANGES_UNIT));
+    shader.SetInteger(u.clusterIndices, static_cast<int>(CLUSTER_INDICES_UNIT));
+    shader.SetInteger(u.lightData, static_cast<int>(LIGHT_DATA_UNIT));
 
     // Optionally adjust material properties for reflective models in models scene
     if (useModelReflection) {
         // Increase shininess for more mirror-like reflections
-        // Check if the uniform exists before setting it to prevent GL_INVALID_OPERATION
-        GLint shininessLoc = glGetUniformLocation(shader.ID, "shininess");
-        if (shininessLoc != -1) {
-            shader.SetFloat("shininess", 128.0f);  // Higher shininess = sharper reflections
-        }
+        shader.SetFloat(u.shininess, 128.0f);  // Higher shininess = sharper reflections
 
-        // Only set reflection uniforms if they exist in this shader
-        GLint skyboxLoc = glGetUniformLocation(shader.ID, "skybox");
-        GLint reflectivityLoc = glGetUniformLocation(shader.ID, "reflectivity");
-        GLint useReflectionLoc = glGetUniformLocation(shader.ID, "useReflection");
-
-        if (skyboxLoc != -1 && reflectivityLoc != -1 && useReflectionLoc != -1) {
-            glUniform1i(useReflectionLoc, 1);
-            glUniform1f(reflectivityLoc, modelReflectivity);
-
-            // Bind skybox to a texture unit (e.g., unit 5 to avoid conflicts)
-            glActiveTexture(GL_TEXTURE5);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-            glUniform1i(skyboxLoc, 5);
+        // Only set reflection uniforms if they exist in this shader (variants have useReflection baked in)
+        if (reflection) {
+            shader.SetInteger(u.useReflection, 1);
+            shader.SetFloat(u.reflectivity, modelReflectivity);
+            shader.SetInteger(u.skybox, static_cast<int>(SKYBOX_UNIT));
         }
     } else {
         // Only set reflection uniforms if they exist in this shader
-        GLint skyboxLoc = glGetUniformLocation(shader.ID, "skybox");
-        GLint useReflectionLoc = glGetUniformLocation(shader.ID, "useReflection");
-        GLint reflectivityLoc = glGetUniformLocation(shader.ID, "reflectivity");
-
-        if (useReflectionLoc != -1 && reflectivityLoc != -1) {
-            glUniform1i(useReflectionLoc, 0);
-            glUniform1f(reflectivityLoc, 0.0f);
+        if (u.useReflection.valid() && u.reflectivity.valid()) {
+            shader.SetInteger(u.useReflection, 0);
+            shader.SetFloat(u.reflectivity, 0.0f);
         }
     }
 
     // Set refraction uniforms if they exist in this shader
-    GLint useRefractionLoc = glGetUniformLocation(shader.ID, "useRefraction");
-    GLint refractionRatioLoc = glGetUniformLocation(shader.ID, "refractionRatio");
-
-    if (useRefractionLoc != -1) {
-        glUniform1i(useRefractionLoc, useModelRefraction ? 1 : 0);
-    }
-    if (refractionRatioLoc != -1) {
-        glUniform1f(refractionRatioLoc, modelRefractionRatio);
-    }
+    shader.SetInteger(u.useRefraction, useModelRefraction ? 1 : 0);
+    shader.SetFloat(u.refractionRatio, modelRefractionRatio);
 
     // Dynamic environment mapping
     if (useDynamicEnvironmentMapping) {
-        // Find the closest reflection probe to this object
-        int closestProbe = dynamicEnvMapping->getClosestProbe(camera.Position);
         if (closestProbe != -1) {
-            unsigned int probeCubemap = dynamicEnvMapping->getProbeCubemap(closestProbe);
-
-            // Bind the dynamic cubemap to texture unit 6
-            glActiveTexture(GL_TEXTURE6);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, probeCubemap);
-
-            // Set the dynamic environment map uniform if it exists
-            GLint dynamicEnvMapLoc = glGetUniformLocation(shader.ID, "dynamicEnvironmentMap");
-            if (dynamicEnvMapLoc != -1) {
-                glUniform1i(dynamicEnvMapLoc, 6); // Texture unit 6
-            }
-
-            // Set the dynamic environment mapping flag
-            GLint useDynamicEnvMapLoc = glGetUniformLocation(shader.ID, "useDynamicEnvironmentMap");
-            if (useDynamicEnvMapLoc != -1) {
-                glUniform1i(useDynamicEnvMapLoc, 1);
-            }
+            // Set the dynamic environment map uniform and flag if they exist
+            shader.SetInteger(u.dynamicEnvironmentMap, static_cast<int>(PROBE_UNIT));
+            shader.SetInteger(u.useDynamicEnvironmentMap, 1);
         }
     } else {
         // Disable dynamic environment mapping
-        GLint useDynamicEnvMapLoc = glGetUniformLocation(shader.ID, "useDynamicEnvironmentMap");
-        if (useDynamicEnvMapLoc != -1) {
-            glUniform1i(useDynamicEnvMapLoc, 0);
-        }
+        shader.SetInteger(u.useDynamicEnvironmentMap, 0);
     }
 }
 
@@ -381,7 +738,7 @@ void Renderer3D::setupGround() {
     glGenVertexArrays(1, &groundVAO);
     glGenBuffers(1, &groundVBO);
 
-    glBindVertexArray(groundVAO);
+    GLStateCache::BindVertexArray(groundVAO);
     glBindBuffer(GL_ARRAY_BUFFER, groundVBO);
 
     // Convert to the format expected by the legacy system
@@ -414,6 +771,7 @@ void Renderer3D::setupGround() {
 
     glBufferData(GL_ARRAY_BUFFER, legacyVertices.size() * sizeof(float),
                  legacyVertices.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(legacyVertices.size() * sizeof(float));
 
     // Position attribute (location = 0)
     glEnableVertexAttribArray(0);
@@ -435,7 +793,7 @@ void Renderer3D::setupGround() {
     glEnableVertexAttribArray(4);
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void *) (11 * sizeof(float)));
 
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 
     // Create a larger, more detailed ground texture (4x4 grid instead of 2x2)
     unsigned char groundTextureData[] = {
@@ -466,7 +824,7 @@ void Renderer3D::setupGround() {
 
     // Generate and bind texture
     glGenTextures(1, &groundTexture);
-    glBindTexture(GL_TEXTURE_2D, groundTexture);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, groundTexture);
 
     // Set texture parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -490,7 +848,7 @@ void Renderer3D::setupGround() {
 
     // Generate and bind normal texture
     glGenTextures(1, &groundNormalTexture);
-    glBindTexture(GL_TEXTURE_2D, groundNormalTexture);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, groundNormalTexture);
 
     // Set texture parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -502,28 +860,30 @@ void Renderer3D::setupGround() {
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 16, 16, 0, GL_RGBA, GL_UNSIGNED_BYTE, normalMapData);
     glGenerateMipmap(GL_TEXTURE_2D);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Renderer3D::renderGround(Shader &shader) {
     // Set model matrix for ground
+    const LightingUniforms& u = lightingUniformsFor(shader);
     glm::mat4 model = glm::mat4(1.0f);
-    shader.SetMatrix4("model", model);
+    shader.SetMatrix4(u.model, model);
 
     // Bind ground diffuse texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, groundTexture);
-    shader.SetInteger("texture_diffuse1", 0);
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, groundTexture);
+    shader.SetInteger(u.textureDiffuse1, 0);
 
     // Bind ground normal texture
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, groundNormalTexture);
-    shader.SetInteger("texture_normal1", 1);
+    GLStateCache::ActiveTexture(GL_TEXTURE1);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, groundNormalTexture);
+    shader.SetInteger(u.textureNormal1, 1);
 
     // Use legacy rendering for now to avoid potential issues with EnhancedVertexBuffer
-    glBindVertexArray(groundVAO);
+    GLStateCache::BindVertexArray(groundVAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);  // Changed to use indices
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_TRIANGLES, 6);
+    GLStateCache::BindVertexArray(0);
 }
 
 // Add the missing closing brace for the render function
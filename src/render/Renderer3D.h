@@ -4,8 +4,15 @@
 #include "../scene/Scene.h"
 #include <glm/glm.hpp>
 #include <vector>
+#include <unordered_map>
 #include "../include/Camera.hpp"
 #include "DynamicEnvironmentMapping.h"
+#include "UniformBuffer.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "LightClusters.h"
+#include "Framebuffer.hpp"
+#include "../util/WorkerPool.h"
 // #include "EnhancedVertexBuffer.h"  // Commented out to troubleshoot crashes
 
 // Directional light
@@ -44,18 +51,136 @@ struct SpotLight {
     bool enabled;
 };
 
-const int MAX_POINT_LIGHTS = 20;
+// Random point lights are clustered per view (LightClusterGrid) and read from
+// buffer textures, so the cap is only there to bound the uploads
+const int MAX_POINT_LIGHTS = 4096;
+// Distance at which CalcPointLight in 3d.fs fades a point light out completely
+const float POINT_LIGHT_RANGE = 40.0f;
+
+// Feature bits of the "model" shader variants; bit i is ModelShaderFeatures()[i]
+enum ModelShaderFeature : uint32_t {
+    MODEL_FEATURE_NORMAL_MAP   = 1u << 0,
+    MODEL_FEATURE_SPECULAR_MAP = 1u << 1,
+    MODEL_FEATURE_CEL_SHADING  = 1u << 2,
+    MODEL_FEATURE_REFLECTION   = 1u << 3,
+    MODEL_FEATURE_REFRACTION   = 1u << 4
+};
+
+// How render() shades the "model" draws. Deferred writes them to a G-buffer
+// (see shaders/include/gbuffer.glsl) and lights every pixel once afterwards;
+// objects with their own shader, the outlines and everything drawn after
+// render() (reflections, skybox) are still forward and composite on top.
+enum class RenderPath {
+    Forward,
+    Deferred
+};
+
+// Per-program uniform handles used by Renderer3D, resolved once per shader program.
+// Camera and light data no longer go through here, see FrameConstants/LightBlock.
+struct LightingUniforms {
+    UniformHandle projection, view, model;
+    UniformHandle shininess, useNormalMap, useSpecularMap, useDetailMap, useScatterMap, useCelShading, useBlinnPhong;
+    UniformHandle skybox, reflectivity, useReflection;
+    UniformHandle useRefraction, refractionRatio;
+    UniformHandle dynamicEnvironmentMap, useDynamicEnvironmentMap;
+    UniformHandle textureDiffuse1, textureNormal1;
+    UniformHandle clusterRanges, clusterIndices, lightData;
+    UniformHandle gAlbedoSpec, gNormal, gEnvironment, gDepth, inverseViewProjection;
+    // frame in which setLightingUniforms last configured this program
+    unsigned long configuredFrame = ~0ul;
+
+    void resolve(const Shader& shader);
+};
 
 class Renderer3D {
 public:
     Renderer3D(); // Added constructor declaration
     void init();
     void render(Scene& scene, Camera& camera);
+    // per-program material and environment uniforms; a no-op after the first call per program each frame
     void setLightingUniforms(Shader &shader, Camera& camera);
+    // handles for the given program; cached unless Shader::LegacyUniformLookup is set
+    LightingUniforms& lightingUniformsFor(Shader &shader);
+    // write the shared FrameConstants/LightBlock buffers; call once per frame (or per view)
+    void updateFrameConstants(const Camera& camera, const glm::mat4& projection, const glm::mat4& view,
+                              float nearPlane, float farPlane);
+    void updateLightBlock();
+    // bind counters of the last sorted scene pass
+    const RenderQueueStats& getQueueStats() const { return renderQueue.getStats(); }
+    // frustum of the last updateFrameConstants() call and what render() culled against it
+    const Frustum& getFrustum() const { return frustum; }
+    const CullingStats& getCullingStats() const { return cullingStats; }
+    // light assignment of the last updateLightBlock() with random point lights on
+    const LightClusterStats& getLightClusterStats() const { return lightClusters.getStats(); }
+
+    // the #defines behind ModelShaderFeature, for ResourceManager::LoadShaderPermutations
+    static const std::vector<std::string>& ModelShaderFeatures();
+    // ModelShaderFeature bits for the current toggles
+    uint32_t modelShaderMask() const;
 
 private:
     void setupGround();
+    // the "model" variant for modelShaderMask(), or the uber-shader while it builds
+    Shader& modelShader();
     void renderGround(Shader &shader);
+    // assigns the random point lights to the clusters of the current view and uploads them
+    void updateLightClusters(int count);
+    // deferred path: binds the G-buffer, sized to the current viewport; false means render forward
+    bool beginDeferred();
+    // copies depth/stencil back to the target framebuffer and runs the lighting pass into it
+    void shadeDeferred(Camera& camera);
+    // wire boxes where models are still loading
+    void renderLoadingBounds();
+    // the MATERIAL_ATLAS twins of the model and G-buffer shaders; turns the atlas off if they fail
+    void initMaterialAtlas();
+
+    std::unordered_map<unsigned int, LightingUniforms> lightingUniformCache;
+    LightingUniforms legacyLightingUniforms;
+    unsigned long frameIndex = 0;
+
+    // Shared uniform blocks, see UniformBuffer.h for the layouts
+    UniformBuffer frameConstantsBuffer;
+    UniformBuffer lightBuffer;
+    LightBlock lightBlock{};
+
+    // Clustered random point lights, see clustered_lights.glsl
+    LightClusterGrid lightClusters;
+    WorkerPool lightClusterPool;
+    TextureBuffer clusterRangeBuffer;   // RG32UI: offset, count per cluster
+    TextureBuffer clusterIndexBuffer;   // R16UI: light indices
+    TextureBuffer lightDataBuffer;      // RGBA32F: four texels per light
+    std::vector<ClusterLight> clusterLightInputs;
+    std::vector<glm::vec4> lightTexels;
+    // view of the last updateFrameConstants() call, which the lights are clustered for
+    glm::mat4 clusterView = glm::mat4(1.0f);
+    glm::mat4 clusterProjection = glm::mat4(1.0f);
+    float clusterNear = 0.1f;
+    float clusterFar = 1000.0f;
+
+    // Deferred path state
+    MultitargetFramebuffer gBuffer;
+    GLuint fullscreenVAO = 0;           // empty, deferred_lighting.vs builds the triangle
+    GLuint deferredTarget = 0;          // framebuffer bound when render() started
+    GLint deferredViewport[4] = {0, 0, 0, 0};
+    // objects with a custom shader, lit forward after the lighting pass
+    std::vector<SceneObject*> forwardObjects;
+
+    // Scene draws are collected here and submitted sorted by state
+    RenderQueue renderQueue;
+    // uber-shaders reading the model matrix and textures per draw, for the queue's multi-draws
+    std::unique_ptr<Shader> atlasModelShader;
+    std::unique_ptr<Shader> atlasGBufferShader;
+    std::vector<SceneObject*> immediateObjects;
+    std::vector<Component*> immediateComponents;
+    // visible components that are still loading, and the unit cube edges they are drawn with
+    std::vector<AABB> loadingBoxes;
+    GLuint boundsVAO = 0;
+    GLuint boundsVBO = 0;
+    // objects that passed the frustum test, reused by the outline pass
+    std::vector<SceneObject*> visibleObjects;
+    std::vector<SceneItem> visibleItems;
+    Frustum frustum;
+    CullingStats cullingStats;
 
 public:
     DirLight dirLight;
@@ -67,6 +192,9 @@ public:
     bool useDetailMap;
     bool useScatterMap;
     bool useCelShading;
+    bool useBlinnPhong = true;
+    // the target framebuffer needs a GL_DEPTH24_STENCIL8 depth buffer for Deferred
+    RenderPath renderPath = RenderPath::Forward;
     float pointLightBrightness;
     float dirLightBrightness;
     float spotLightBrightness;
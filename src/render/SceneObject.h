@@ -5,6 +5,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Shader.h"
+#include "Frustum.h"
+
+class RenderQueue;
 
 // Base class for all scene objects
 class SceneObject {
@@ -29,18 +32,39 @@ public:
     // Virtual draw function to be implemented by derived classes
     virtual void Draw(Shader& shader) = 0;
 
+    // Queue the object's draws instead of drawing immediately; objects that
+    // return false are drawn through Draw() after the queue is flushed
+    virtual bool Submit(RenderQueue& queue, Shader& shader) { return false; }
+
     virtual Shader* getShader() const { return nullptr; }
+
+    // Model space bounds; an empty box means the object is never culled
+    virtual AABB GetLocalBounds() const { return AABB(); }
+    AABB GetWorldBounds() const { return GetLocalBounds().transformed(GetModelMatrix()); }
     
-    // Get model matrix based on position, rotation, and scale
-    glm::mat4 GetModelMatrix() const {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, position);
-        model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, scale);
-        return model;
+    // Get model matrix based on position, rotation, and scale.
+    // Rebuilt only when one of them changed since the last call.
+    const glm::mat4& GetModelMatrix() const {
+        if (matrixDirty || position != cachedPosition || rotation != cachedRotation || scale != cachedScale) {
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, position);
+            model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+            model = glm::scale(model, scale);
+            cachedModel = model;
+            cachedPosition = position;
+            cachedRotation = rotation;
+            cachedScale = scale;
+            matrixDirty = false;
+        }
+        return cachedModel;
     }
+
+private:
+    mutable glm::mat4 cachedModel = glm::mat4(1.0f);
+    mutable glm::vec3 cachedPosition, cachedRotation, cachedScale;
+    mutable bool matrixDirty = true;
 };
 
 #endif // SCENE_OBJECT_H 
\ No newline at end of file
@@ -1,186 +1,412 @@
 #include "Shader.h"
 #include "util/Util.h"
+#include "UniformBuffer.h"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include "GLStateCache.h"
+
+ShaderCallCounters Shader::Counters;
+bool Shader::LegacyUniformLookup = false;
 
 Shader &Shader::Use()
 {
     if (this->ID != 0) {
-        glUseProgram(this->ID);
+        // only the binds the state cache let through
+        if (GLStateCache::UseProgram(this->ID))
+            Counters.programBinds++;
     }
     return *this;
 }
-void Shader::Compile(const char* vertexSource, const char* fragmentSource, const char* geometrySource)
-{
-    unsigned int sVertex, sFragment, gShader;
-    
-    // vertex Shader
-    sVertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(sVertex, 1, &vertexSource, NULL);  // FIX: was &sVertex
-    glCompileShader(sVertex);
-    checkCompileErrors(sVertex, "VERTEX");
-    
-    // fragment Shader
-    sFragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(sFragment, 1, &fragmentSource, NULL);
-    glCompileShader(sFragment);
-    checkCompileErrors(sFragment, "FRAGMENT");
-    
-    // if geometry shader source code is given, also compile geometry shader
-    if (geometrySource != nullptr)
+// KHR_parallel_shader_compile is not in the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+bool Shader::parallelCompile = false;
+
+bool Shader::InitParallelCompile(GLADloadproc loader)
+{
+    parallelCompile = false;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    const char* entryPoint = nullptr;
+    for (GLint i = 0; i < count && !entryPoint; i++)
+    {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (!name)
+            continue;
+        if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0)
+            entryPoint = "glMaxShaderCompilerThreadsKHR";
+        else if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+            entryPoint = "glMaxShaderCompilerThreadsARB";
+    }
+    if (!entryPoint)
+        return false;
+    // completion queries work without it; it only asks the driver for as many threads as it likes
+    auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(loader(entryPoint));
+    if (maxThreads)
+        maxThreads(0xFFFFFFFFu);
+    parallelCompile = true;
+    return true;
+}
+
+bool Shader::Compile(const char* vertexSource, const char* fragmentSource, const char* geometrySource)
+{
+    return BeginCompile(vertexSource, fragmentSource, geometrySource) && FinishCompile();
+}
+
+bool Shader::BeginCompile(const char* vertexSource, const char* fragmentSource, const char* geometrySource)
+{
+    if (pendingProgram != 0)
+        return false;
+    const GLenum stages[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+    const char* sources[3] = { vertexSource, fragmentSource, geometrySource };
+
+    // nothing here waits for the compiler: status is only queried in FinishCompile
+    pendingProgram = glCreateProgram();
+    // ask for a binary the ShaderCache can store (GL 4.1 / ARB_get_program_binary)
+    if (glProgramParameteri)
+        glProgramParameteri(pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (int i = 0; i < 3; i++)
+    {
+        pendingShaders[i] = 0;
+        if (sources[i] == nullptr)  // note: geometry source code is optional
+            continue;
+        pendingShaders[i] = glCreateShader(stages[i]);
+        glShaderSource(pendingShaders[i], 1, &sources[i], NULL);
+        glCompileShader(pendingShaders[i]);
+        glAttachShader(pendingProgram, pendingShaders[i]);
+    }
+    glLinkProgram(pendingProgram);
+    return true;
+}
+
+bool Shader::IsCompileComplete() const
+{
+    if (pendingProgram == 0 || !parallelCompile)
+        return true;
+    GLint complete = GL_FALSE;
+    glGetProgramiv(pendingProgram, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+bool Shader::FinishCompile()
+{
+    if (pendingProgram == 0)
+        return false;
+    static const char* const stageNames[3] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+
+    bool compiled = true;
+    for (int i = 0; i < 3; i++)
     {
-        gShader = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(gShader, 1, &geometrySource, NULL);
-        glCompileShader(gShader);
-        checkCompileErrors(gShader, "GEOMETRY");
-    }
-    
-    // shader program
-    this->ID = glCreateProgram();
-    glAttachShader(this->ID, sVertex);
-    glAttachShader(this->ID, sFragment);
-    if (geometrySource != nullptr)
-        glAttachShader(this->ID, gShader);
-    glLinkProgram(this->ID);
-    checkCompileErrors(this->ID, "PROGRAM");
-    
+        if (pendingShaders[i] != 0)
+            compiled = checkCompileErrors(pendingShaders[i], stageNames[i]) && compiled;
+    }
+    // a failed stage always fails the link too; its log says nothing new
+    GLuint program = pendingProgram;
+    if (!compiled || !checkCompileErrors(program, "PROGRAM"))
+    {
+        glDeleteProgram(program);
+        program = 0;
+    }
+
     // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(sVertex);
-    glDeleteShader(sFragment);
-    if (geometrySource != nullptr)
-        glDeleteShader(gShader);
-    
-    std::cout << "Shader program ID: " << this->ID << std::endl;
+    for (unsigned int& shader : pendingShaders)
+    {
+        if (shader != 0)
+            glDeleteShader(shader);
+        shader = 0;
+    }
+    pendingProgram = 0;
+
+    if (program == 0)
+        return false;
+    this->ID = program;
+    introspectUniforms();
+    bindUniformBlocks();
+
+    std::cout << "Shader program ID: " << this->ID << " (" << uniformCount << " uniforms)" << std::endl;
+    return true;
 }
 
-void Shader::SetFloat(const char *name, float value, bool useShader)
+bool Shader::LoadBinary(GLenum format, const void* binary, GLsizei length)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
+    if (!glProgramBinary)
+        return false;
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, binary, length);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        // another driver or version: the caller compiles from source instead
+        glDeleteProgram(program);
+        return false;
     }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    this->ID = program;
+    introspectUniforms();
+    bindUniformBlocks();
+    return true;
+}
+
+std::vector<char> Shader::GetBinary(GLenum& format) const
+{
+    std::vector<char> binary;
+    GLint length = 0;
+    if (this->ID == 0 || !glGetProgramBinary)
+        return binary;
+    glGetProgramiv(this->ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return binary;
+    binary.resize(length);
+    GLsizei written = 0;
+    glGetProgramBinary(this->ID, length, &written, &format, binary.data());
+    binary.resize(written);
+    return binary;
+}
+
+void Shader::SetFloat(const char *name, float value, bool useShader)
+{
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform1f(location, value);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetInteger(const char *name, int value, bool useShader)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
-    }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform1i(location, value);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetVector2f(const char *name, float x, float y, bool useShader)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
-    }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform2f(location, x, y);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetVector2f(const char *name, const glm::vec2 &value, bool useShader)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
-    }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform2f(location, value.x, value.y);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetVector3f(const char *name, float x, float y, float z, bool useShader)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
-    }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform3f(location, x, y, z);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetVector3f(const char *name, const glm::vec3 &value, bool useShader)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
-    }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform3f(location, value.x, value.y, value.z);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetVector4f(const char *name, float x, float y, float z, float w, bool useShader)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
-    }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform4f(location, x, y, z, w);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetVector4f(const char *name, const glm::vec4 &value, bool useShader)
 {
-    if (this->ID == 0) {
-        std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
-    }
-    if (useShader)
-        this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
+    GLint location = locate(name, useShader);
     if (location != -1) {
         glUniform4f(location, value.x, value.y, value.z, value.w);
+        Counters.uniformUploads++;
     }
-    glCheckError(__FILE__, __LINE__);
 }
 void Shader::SetMatrix4(const char *name, const glm::mat4 &matrix, bool useShader)
+{
+    GLint location = locate(name, useShader);
+    if (location != -1) {
+        glUniformMatrix4fv(location, 1, false, glm::value_ptr(matrix));
+        Counters.uniformUploads++;
+    }
+}
+
+void Shader::SetFloat(UniformHandle handle, float value)
+{
+    if (!handle.valid()) return;
+    glUniform1f(handle.location, value);
+    Counters.uniformUploads++;
+}
+void Shader::SetInteger(UniformHandle handle, int value)
+{
+    if (!handle.valid()) return;
+    glUniform1i(handle.location, value);
+    Counters.uniformUploads++;
+}
+void Shader::SetVector2f(UniformHandle handle, const glm::vec2 &value)
+{
+    if (!handle.valid()) return;
+    glUniform2f(handle.location, value.x, value.y);
+    Counters.uniformUploads++;
+}
+void Shader::SetVector3f(UniformHandle handle, const glm::vec3 &value)
+{
+    if (!handle.valid()) return;
+    glUniform3f(handle.location, value.x, value.y, value.z);
+    Counters.uniformUploads++;
+}
+void Shader::SetVector4f(UniformHandle handle, const glm::vec4 &value)
+{
+    if (!handle.valid()) return;
+    glUniform4f(handle.location, value.x, value.y, value.z, value.w);
+    Counters.uniformUploads++;
+}
+void Shader::SetMatrix4(UniformHandle handle, const glm::mat4 &matrix)
+{
+    if (!handle.valid()) return;
+    glUniformMatrix4fv(handle.location, 1, false, glm::value_ptr(matrix));
+    Counters.uniformUploads++;
+}
+
+GLint Shader::locate(const char *name, bool useShader)
 {
     if (this->ID == 0) {
         std::cout << "Warning: Attempting to use uninitialized shader program" << std::endl;
-        return;
+        return -1;
     }
     if (useShader)
         this->Use();
-    GLint location = glGetUniformLocation(this->ID, name);
-    if (location != -1) {
-        glUniformMatrix4fv(location, 1, false, glm::value_ptr(matrix));
+    return GetUniform(name).location;
+}
+
+// FNV-1a, good enough for the few dozen names a program exposes
+static uint32_t hashUniformName(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char *c = name; *c; ++c) {
+        hash ^= static_cast<unsigned char>(*c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+UniformHandle Shader::GetUniform(const char *name) const
+{
+    UniformHandle handle;
+    if (LegacyUniformLookup) {
+        // old path: a driver round trip plus a glGetError sync point per uniform
+        Counters.locationQueries++;
+        Counters.errorChecks++;
+        handle.location = glGetUniformLocation(this->ID, name);
+        glCheckError(__FILE__, __LINE__);
+        return handle;
+    }
+    if (uniformTable.empty() || name == nullptr)
+        return handle;
+    uint32_t hash = hashUniformName(name);
+    size_t mask = uniformTable.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const UniformSlot &slot = uniformTable[i];
+        if (slot.location == -1)
+            return handle; // empty slot, not an active uniform
+        if (slot.hash == hash && slot.name == name) {
+            handle.location = slot.location;
+            return handle;
+        }
     }
-    glCheckError(__FILE__, __LINE__);
 }
 
+void Shader::insertUniform(const std::string &name, GLint location)
+{
+    uint32_t hash = hashUniformName(name.c_str());
+    size_t mask = uniformTable.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        UniformSlot &slot = uniformTable[i];
+        if (slot.location == -1) {
+            slot.hash = hash;
+            slot.location = location;
+            slot.name = name;
+            uniformCount++;
+            return;
+        }
+        if (slot.hash == hash && slot.name == name)
+            return;
+    }
+}
+
+void Shader::bindUniformBlocks()
+{
+    // Shared blocks live at fixed binding points so one buffer feeds every program
+    GLuint frameIndex = glGetUniformBlockIndex(this->ID, "FrameConstants");
+    if (frameIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(this->ID, frameIndex, FRAME_CONSTANTS_BINDING);
+    GLuint lightIndex = glGetUniformBlockIndex(this->ID, "LightBlock");
+    if (lightIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(this->ID, lightIndex, LIGHT_BLOCK_BINDING);
+}
+
+void Shader::introspectUniforms()
+{
+    static uint32_t nextUniformVersion = 0;
+    uniformVersion = ++nextUniformVersion;
+    uniformTable.clear();
+    uniformCount = 0;
+
+    GLint activeUniforms = 0, maxNameLength = 0;
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &activeUniforms);
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    if (activeUniforms <= 0)
+        return;
+
+    // gather every addressable name first; arrays expose "name[0]" only,
+    // so each element (and the bare array name) gets its own entry
+    std::vector<std::pair<std::string, GLint>> entries;
+    std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+    for (GLint i = 0; i < activeUniforms; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->ID, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+                           &length, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), length);
+        GLint location = glGetUniformLocation(this->ID, name.c_str());
+        if (location == -1)
+            continue; // uniform block member, not addressable by location
+
+        size_t bracket = name.find("[0]");
+        if (size > 1 || (bracket != std::string::npos && bracket + 3 == name.size())) {
+            std::string base = name.substr(0, bracket);
+            entries.emplace_back(base, location);
+            for (GLint element = 0; element < size; element++) {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                GLint elementLocation = glGetUniformLocation(this->ID, elementName.c_str());
+                if (elementLocation != -1)
+                    entries.emplace_back(elementName, elementLocation);
+            }
+        } else {
+            entries.emplace_back(name, location);
+        }
+    }
+
+    // keep the load factor under one half so probe chains stay short
+    size_t capacity = 16;
+    while (capacity < entries.size() * 2)
+        capacity <<= 1;
+    uniformTable.resize(capacity);
+    for (const auto &entry : entries)
+        insertUniform(entry.first, entry.second);
+}
 
-void Shader::checkCompileErrors(unsigned int object, std::string type)
+bool Shader::checkCompileErrors(unsigned int object, std::string type)
 {
     int success;
     char infoLog[1024];
@@ -193,8 +419,7 @@ void Shader::checkCompileErrors(unsigned int object, std::string type)
             std::cout << "| ERROR::SHADER: Compile-time error: Type: " << type << "\n"
                 << infoLog << "\n -- --------------------------------------------------- -- "
                 << std::endl;
-            exit(1);
-            //throw std::runtime_error("Shader compilation failed: " + type);
+            return false;
         }
         else
         {
@@ -210,12 +435,12 @@ void Shader::checkCompileErrors(unsigned int object, std::string type)
             std::cout << "| ERROR::Shader: Link-time error: Type: " << type << "\n"
                 << infoLog << "\n -- --------------------------------------------------- -- "
                 << std::endl;
-            exit(1);
-            //throw std::runtime_error("Shader linking failed");
+            return false;
         }
         else
         {
             std::cout << "Shader linking successful" << std::endl;
         }
     }
+    return true;
 }
\ No newline at end of file
@@ -2,12 +2,35 @@
 #define SHADER_H
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 
+// Pre-resolved uniform location. Resolve once with Shader::GetUniform and
+// pass it to the Set* overloads on hot paths; an invalid handle is a no-op.
+struct UniformHandle
+{
+    GLint location = -1;
+    bool  valid() const { return location != -1; }
+};
+
+// Counts the GL calls issued through Shader so that the uniform path can be
+// compared between the cached table and the legacy per-call lookup.
+struct ShaderCallCounters
+{
+    unsigned long locationQueries = 0; // glGetUniformLocation
+    unsigned long errorChecks     = 0; // glGetError
+    unsigned long uniformUploads  = 0; // glUniform*
+    unsigned long programBinds    = 0; // glUseProgram, not counting binds GLStateCache skipped
+
+    unsigned long total() const { return locationQueries + errorChecks + uniformUploads + programBinds; }
+    void reset() { *this = ShaderCallCounters(); }
+};
+
 // General purpose shader object. Compiles from file, generates
 // compile/link-time error messages and hosts several utility
 // functions for easy management.
@@ -15,13 +38,38 @@ class Shader
 {
 public:
     // state
-    unsigned int ID;
+    unsigned int ID = 0;
+    // call counters shared by every shader; reset per frame by the caller
+    static ShaderCallCounters Counters;
+    // when set, uniform lookups query GL on every call (old behaviour, kept for benchmarking)
+    static bool LegacyUniformLookup;
     // constructor
     Shader() { }
     // sets the current shader as active
     Shader  &Use();
-    // compiles the shader from given source code
-    void    Compile(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr); // note: geometry source code is optional
+    // compiles the shader from given source code; on failure the log is printed and ID stays 0
+    bool    Compile(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr); // note: geometry source code is optional
+    // Compile split in two: BeginCompile hands the sources to the driver without
+    // waiting for the result; FinishCompile checks it and fills in ID. With
+    // KHR_parallel_shader_compile the driver compiles on its own threads and
+    // IsCompileComplete says when FinishCompile will no longer block.
+    bool    BeginCompile(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr);
+    bool    IsCompiling() const { return pendingProgram != 0; }
+    bool    IsCompileComplete() const;
+    bool    FinishCompile();
+    // loads the KHR/ARB_parallel_shader_compile entry point with the context's loader
+    static bool InitParallelCompile(GLADloadproc loader);
+    static bool ParallelCompileSupported() { return parallelCompile; }
+    // creates the program from a glGetProgramBinary blob; fails quietly if the driver rejects it
+    bool    LoadBinary(GLenum format, const void *binary, GLsizei length);
+    // the linked program as a binary blob, empty if the driver cannot provide one
+    std::vector<char> GetBinary(GLenum &format) const;
+    // uniform introspection, filled once after linking
+    UniformHandle GetUniform(const char *name) const;
+    bool          HasUniform(const char *name) const { return GetUniform(name).valid(); }
+    size_t        UniformCount() const { return uniformCount; }
+    // unique to each link of each program, 0 before the first; what caches of resolved locations compare
+    uint32_t      UniformVersion() const { return uniformVersion; }
     // utility functions
     void    SetFloat    (const char *name, float value, bool useShader = false);
     void    SetInteger  (const char *name, int value, bool useShader = false);
@@ -32,9 +80,38 @@ public:
     void    SetVector4f (const char *name, float x, float y, float z, float w, bool useShader = false);
     void    SetVector4f (const char *name, const glm::vec4 &value, bool useShader = false);
     void    SetMatrix4  (const char *name, const glm::mat4 &matrix, bool useShader = false);
+    // handle based setters; the shader must already be in use
+    void    SetFloat    (UniformHandle handle, float value);
+    void    SetInteger  (UniformHandle handle, int value);
+    void    SetVector2f (UniformHandle handle, const glm::vec2 &value);
+    void    SetVector3f (UniformHandle handle, const glm::vec3 &value);
+    void    SetVector4f (UniformHandle handle, const glm::vec4 &value);
+    void    SetMatrix4  (UniformHandle handle, const glm::mat4 &matrix);
 private:
+    // flat open-addressing table of active uniforms, keyed by FNV-1a hash of the name
+    struct UniformSlot
+    {
+        uint32_t    hash = 0;
+        GLint       location = -1;
+        std::string name;
+    };
+    std::vector<UniformSlot> uniformTable;
+    size_t uniformCount = 0;
+    uint32_t uniformVersion = 0;
+    // program and shader objects between BeginCompile and FinishCompile
+    unsigned int pendingProgram = 0;
+    unsigned int pendingShaders[3] = { 0, 0, 0 };
+    static bool parallelCompile;
+
     // checks if compilation or linking failed and if so, print the error logs
-    void    checkCompileErrors(unsigned int object, std::string type);
+    bool    checkCompileErrors(unsigned int object, std::string type);
+    // queries the active uniforms of the linked program and fills the table
+    void    introspectUniforms();
+    void    insertUniform(const std::string &name, GLint location);
+    // attaches the shared FrameConstants/LightBlock blocks to their binding points
+    void    bindUniformBlocks();
+    // validates the program, optionally binds it and resolves the name
+    GLint   locate(const char *name, bool useShader);
 };
 
-#endif
\ No newline at end of file
+#endif
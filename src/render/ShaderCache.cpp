@@ -0,0 +1,192 @@
+#include "ShaderCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+bool ShaderCache::enabled = true;
+std::string ShaderCache::directory = "shader_cache";
+ShaderCacheStats ShaderCache::stats;
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'S', 'P', 'B', 'C' };
+const uint32_t CACHE_VERSION = 1;
+
+// Fixed-size file header, followed by `length` bytes of program binary
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;     // binaryFormat from glGetProgramBinary
+    uint32_t length;
+    double compileMs;    // what compiling from source cost, for the startup report
+};
+
+uint64_t fnv1a(uint64_t hash, const std::string& text)
+{
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    // separator, so that ("ab", "c") and ("a", "bc") hash differently
+    hash ^= 0xFF;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+std::string glString(GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+bool ShaderCache::IsSupported()
+{
+    if (!glGetProgramBinary || !glProgramBinary)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::string ShaderCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource,
+                                 const std::string* geometrySource)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, glString(GL_VENDOR));
+    hash = fnv1a(hash, glString(GL_RENDERER));
+    hash = fnv1a(hash, glString(GL_VERSION));
+    hash = fnv1a(hash, vertexSource);
+    hash = fnv1a(hash, fragmentSource);
+    hash = fnv1a(hash, geometrySource ? *geometrySource : std::string());
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
+
+std::string ShaderCache::pathFor(const std::string& vertexSource, const std::string& fragmentSource,
+                                 const std::string* geometrySource)
+{
+    return directory + "/" + makeKey(vertexSource, fragmentSource, geometrySource) + ".bin";
+}
+
+bool ShaderCache::LoadOrCompile(Shader& shader, const std::string& vertexSource, const std::string& fragmentSource,
+                                const std::string* geometrySource)
+{
+    if (Load(shader, vertexSource, fragmentSource, geometrySource))
+        return true;
+
+    auto start = std::chrono::steady_clock::now();
+    bool compiled = shader.Compile(vertexSource.c_str(), fragmentSource.c_str(),
+                                   geometrySource ? geometrySource->c_str() : nullptr);
+    if (compiled)
+        Store(shader, vertexSource, fragmentSource, geometrySource, elapsedMs(start));
+    return compiled;
+}
+
+bool ShaderCache::Load(Shader& shader, const std::string& vertexSource, const std::string& fragmentSource,
+                       const std::string* geometrySource)
+{
+    if (!enabled || !IsSupported())
+        return false;
+    return load(shader, pathFor(vertexSource, fragmentSource, geometrySource));
+}
+
+void ShaderCache::Store(const Shader& shader, const std::string& vertexSource, const std::string& fragmentSource,
+                        const std::string* geometrySource, double compileMs)
+{
+    stats.misses++;
+    stats.compileMs += compileMs;
+    if (enabled && IsSupported())
+        store(shader, pathFor(vertexSource, fragmentSource, geometrySource), compileMs);
+}
+
+bool ShaderCache::load(Shader& shader, const std::string& path)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    CacheHeader header;
+    std::vector<char> binary;
+    bool valid = static_cast<bool>(file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+                 && std::equal(header.magic, header.magic + 4, CACHE_MAGIC)
+                 && header.version == CACHE_VERSION;
+    if (valid) {
+        binary.resize(header.length);
+        valid = static_cast<bool>(file.read(binary.data(), header.length));
+    }
+    file.close();
+
+    if (!valid || !shader.LoadBinary(header.format, binary.data(), static_cast<GLsizei>(binary.size()))) {
+        std::cout << "Shader cache: discarding stale entry " << path << std::endl;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        stats.rejected++;
+        return false;
+    }
+
+    double loadMs = elapsedMs(start);
+    stats.hits++;
+    stats.loadMs += loadMs;
+    stats.savedMs += header.compileMs - loadMs;
+    std::cout << "Shader cache: loaded program " << shader.ID << " from " << path << std::endl;
+    return true;
+}
+
+void ShaderCache::store(const Shader& shader, const std::string& path, double compileMs)
+{
+    GLenum format = 0;
+    std::vector<char> binary = shader.GetBinary(format);
+    if (binary.empty())
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cout << "Shader cache: could not create " << directory << ": " << error.message() << std::endl;
+        return;
+    }
+
+    CacheHeader header;
+    std::copy(CACHE_MAGIC, CACHE_MAGIC + 4, header.magic);
+    header.version = CACHE_VERSION;
+    header.format = format;
+    header.length = static_cast<uint32_t>(binary.size());
+    header.compileMs = compileMs;
+
+    // write next to the final name and rename, so a crash never leaves half a file behind
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file) {
+            std::cout << "Shader cache: could not write " << temporary << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+        std::cout << "Shader cache: could not store " << path << ": " << error.message() << std::endl;
+}
+
+void ShaderCache::PrintReport()
+{
+    std::printf("Shader cache: %u hits, %u compiled (%u stale); %.1f ms loading binaries, %.1f ms compiling, "
+                "%.1f ms of startup saved\n",
+                stats.hits, stats.misses, stats.rejected, stats.loadMs, stats.compileMs, stats.savedMs);
+}
@@ -0,0 +1,63 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <string>
+#include "Shader.h"
+
+// What the cache did since startup
+struct ShaderCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;       // compiled from source (and stored if possible)
+    unsigned int rejected = 0;     // a cached binary the driver refused; compiled instead
+    double loadMs = 0.0;           // reading and creating programs from binaries
+    double compileMs = 0.0;        // compiling the misses
+    double savedMs = 0.0;          // compile time recorded for the hits, minus loadMs
+};
+
+// On-disk cache of linked programs (glGetProgramBinary blobs).
+//
+// Entries are keyed by a hash of the final shader sources together with the
+// GL vendor, renderer and version strings, so a driver update or any change
+// to a shader (or to what is injected into it) selects a different file.
+// A binary the driver rejects anyway is deleted and the program is compiled
+// from source. Needs GL 4.1 or ARB_get_program_binary; without it every
+// lookup is a miss and nothing is written.
+class ShaderCache
+{
+public:
+    static void SetEnabled(bool enabled) { ShaderCache::enabled = enabled; }
+    static void SetDirectory(const std::string& directory) { ShaderCache::directory = directory; }
+    static const std::string& GetDirectory() { return directory; }
+    // program binaries supported by the current context
+    static bool IsSupported();
+
+    // Builds the shader from the cache, or compiles it and stores the result.
+    // Returns false only if compiling from source failed.
+    static bool LoadOrCompile(Shader& shader, const std::string& vertexSource, const std::string& fragmentSource,
+                              const std::string* geometrySource = nullptr);
+
+    // The two halves of LoadOrCompile, for callers that compile asynchronously:
+    // Load builds the shader from a cached binary if there is one, Store saves
+    // a shader that was compiled from these sources (compileMs is what it cost).
+    static bool Load(Shader& shader, const std::string& vertexSource, const std::string& fragmentSource,
+                     const std::string* geometrySource = nullptr);
+    static void Store(const Shader& shader, const std::string& vertexSource, const std::string& fragmentSource,
+                      const std::string* geometrySource, double compileMs);
+
+    static const ShaderCacheStats& GetStats() { return stats; }
+    static void PrintReport();
+
+private:
+    static std::string makeKey(const std::string& vertexSource, const std::string& fragmentSource,
+                               const std::string* geometrySource);
+    static std::string pathFor(const std::string& vertexSource, const std::string& fragmentSource,
+                               const std::string* geometrySource);
+    static bool load(Shader& shader, const std::string& path);
+    static void store(const Shader& shader, const std::string& path, double compileMs);
+
+    static bool enabled;
+    static std::string directory;
+    static ShaderCacheStats stats;
+};
+
+#endif // SHADER_CACHE_H
@@ -0,0 +1,166 @@
+#include "ShaderPermutations.h"
+#include "GLStateCache.h"
+#include "ShaderCache.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+bool readFile(const std::string& path, std::string& text)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "ERROR::SHADER: Failed to open shader file: " << path << std::endl;
+        return false;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    text = stream.str();
+    return true;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+ShaderPermutations::ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath,
+                                       const std::vector<std::string>& features)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath), features(features), uber(std::make_shared<Shader>())
+{
+}
+
+bool ShaderPermutations::Load()
+{
+    if (!readFile(vertexPath, vertexSource) || !readFile(fragmentPath, fragmentSource))
+        return false;
+
+    std::string vertexCode, fragmentCode;
+    if (!ShaderPreprocessor::Process(vertexSource, vertexPath, ShaderDefines(), vertexCode) ||
+        !ShaderPreprocessor::Process(fragmentSource, fragmentPath, ShaderDefines(), fragmentCode))
+        return false;
+    return ShaderCache::LoadOrCompile(*uber, vertexCode, fragmentCode);
+}
+
+ShaderDefines ShaderPermutations::definesFor(uint32_t mask) const
+{
+    ShaderDefines defines;
+    defines.emplace_back("SHADER_VARIANT", "1");
+    for (size_t i = 0; i < features.size(); i++)
+        defines.emplace_back(features[i], (mask & (1u << i)) ? "1" : "0");
+    return defines;
+}
+
+void ShaderPermutations::Request(uint32_t mask)
+{
+    mask &= (1u << features.size()) - 1;
+    if (variants.count(mask))
+        return;
+
+    auto variant = std::make_unique<Variant>();
+    variant->started = std::chrono::steady_clock::now();
+    ShaderDefines defines = definesFor(mask);
+    if (!ShaderPreprocessor::Process(vertexSource, vertexPath, defines, variant->vertexSource) ||
+        !ShaderPreprocessor::Process(fragmentSource, fragmentPath, defines, variant->fragmentSource)) {
+        variant->state = VariantState::Failed;
+    } else if (ShaderCache::Load(variant->shader, variant->vertexSource, variant->fragmentSource)) {
+        variant->state = VariantState::Ready;
+    } else {
+        variant->shader.BeginCompile(variant->vertexSource.c_str(), variant->fragmentSource.c_str());
+    }
+    if (variant->state != VariantState::Pending) {
+        variant->vertexSource.clear();
+        variant->fragmentSource.clear();
+    }
+    variants.emplace(mask, std::move(variant));
+}
+
+Shader& ShaderPermutations::Get(uint32_t mask)
+{
+    if (!variantsEnabled)
+        return *uber;
+    mask &= (1u << features.size()) - 1;
+    auto it = variants.find(mask);
+    if (it == variants.end()) {
+        Request(mask);
+        it = variants.find(mask);
+    }
+    if (it->second->state == VariantState::Ready)
+        return it->second->shader;
+    if (it->second->state == VariantState::Pending)
+        fallbackDraws++;
+    return *uber;
+}
+
+void ShaderPermutations::Update()
+{
+    bool finishedBlocking = false;
+    for (auto& entry : variants) {
+        Variant& variant = *entry.second;
+        if (variant.state != VariantState::Pending)
+            continue;
+        if (Shader::ParallelCompileSupported()) {
+            if (!variant.shader.IsCompileComplete())
+                continue;
+        } else if (finishedBlocking) {
+            // FinishCompile waits for the driver; one of those per frame
+            continue;
+        } else {
+            finishedBlocking = true;
+        }
+        finish(entry.first, variant);
+    }
+}
+
+void ShaderPermutations::finish(uint32_t mask, Variant& variant)
+{
+    if (variant.shader.FinishCompile()) {
+        variant.state = VariantState::Ready;
+        ShaderCache::Store(variant.shader, variant.vertexSource, variant.fragmentSource, nullptr,
+                           elapsedMs(variant.started));
+        std::cout << "Shader variant 0x" << std::hex << mask << std::dec << " of " << fragmentPath << " ready: program "
+                  << variant.shader.ID << std::endl;
+    } else {
+        // keeps drawing with the uber-shader
+        variant.state = VariantState::Failed;
+        std::cout << "ERROR::SHADER: Variant 0x" << std::hex << mask << std::dec << " of " << fragmentPath
+                  << " failed to compile" << std::endl;
+    }
+    variant.vertexSource.clear();
+    variant.fragmentSource.clear();
+}
+
+ShaderPermutationStats ShaderPermutations::GetStats() const
+{
+    ShaderPermutationStats stats;
+    for (const auto& entry : variants) {
+        switch (entry.second->state) {
+        case VariantState::Ready:
+            stats.ready++;
+            break;
+        case VariantState::Pending:
+            stats.pending++;
+            break;
+        case VariantState::Failed:
+            stats.failed++;
+            break;
+        }
+    }
+    stats.fallbackDraws = fallbackDraws;
+    return stats;
+}
+
+void ShaderPermutations::Clear()
+{
+    for (auto& entry : variants) {
+        Variant& variant = *entry.second;
+        if (variant.shader.IsCompiling())
+            variant.shader.FinishCompile();
+        if (variant.shader.ID != 0)
+            GLStateCache::DeleteProgram(variant.shader.ID);
+    }
+    variants.clear();
+}
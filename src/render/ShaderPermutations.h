@@ -0,0 +1,86 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+
+struct ShaderPermutationStats {
+    unsigned int ready = 0;
+    unsigned int pending = 0;
+    unsigned int failed = 0;
+    unsigned long fallbackDraws = 0;  // Get() calls answered with the uber-shader while a variant was building
+};
+
+// One vertex/fragment pair built as an uber-shader plus specialised variants.
+//
+// Feature i of the list is bit i of a variant mask. A variant is compiled with
+// SHADER_VARIANT defined and every feature define set to 0 or 1 (see
+// shaders/include/features.glsl), so its toggles are constants instead of
+// uniforms and the branches on them fold away. The uber-shader is built
+// without those defines, reads the toggles from uniforms, and stands in for
+// any variant that is not ready yet.
+//
+// Variants are built on first use. They go through the ShaderCache first and
+// otherwise are handed to the driver with Shader::BeginCompile; Update()
+// picks up the finished ones. With KHR_parallel_shader_compile that never
+// blocks; without it Update() finishes one variant per call, so a burst of
+// new variants costs one compile per frame instead of a single long stall.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath,
+                       const std::vector<std::string>& features);
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    // reads the sources and builds the uber-shader (synchronously)
+    bool Load();
+
+    const std::shared_ptr<Shader>& GetUberShader() const { return uber; }
+    // the variant for mask if it is ready, otherwise the uber-shader (and the variant is requested)
+    Shader& Get(uint32_t mask);
+    // starts building a variant ahead of its first use
+    void Request(uint32_t mask);
+    // finishes variants whose compile is done; call once a frame
+    void Update();
+
+    // with variants disabled Get() always returns the uber-shader
+    void SetVariantsEnabled(bool enabled) { variantsEnabled = enabled; }
+    bool VariantsEnabled() const { return variantsEnabled; }
+
+    const std::vector<std::string>& GetFeatures() const { return features; }
+    ShaderPermutationStats GetStats() const;
+    // deletes the variant programs; the uber-shader is registered in ResourceManager::Shaders and deleted there
+    void Clear();
+
+private:
+    enum class VariantState { Pending, Ready, Failed };
+    struct Variant {
+        Shader shader;
+        VariantState state = VariantState::Pending;
+        std::string vertexSource;    // preprocessed, kept for the ShaderCache until the variant is done
+        std::string fragmentSource;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    ShaderDefines definesFor(uint32_t mask) const;
+    void finish(uint32_t mask, Variant& variant);
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string vertexSource;    // as read from disk
+    std::string fragmentSource;
+    std::vector<std::string> features;
+    std::shared_ptr<Shader> uber;
+    std::unordered_map<uint32_t, std::unique_ptr<Variant>> variants;
+    bool variantsEnabled = true;
+    unsigned long fallbackDraws = 0;
+};
+
+#endif // SHADER_PERMUTATIONS_H
@@ -0,0 +1,131 @@
+#include "ShaderPreprocessor.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+bool readFile(const std::string& path, std::string& text)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    text = stream.str();
+    return true;
+}
+
+// the word after a leading "#" (whitespace allowed around it), "" for any other line
+std::string directive(const std::string& line, size_t& end)
+{
+    size_t i = line.find_first_not_of(" \t");
+    if (i == std::string::npos || line[i] != '#')
+        return "";
+    i = line.find_first_not_of(" \t", i + 1);
+    if (i == std::string::npos)
+        return "";
+    end = i;
+    while (end < line.size() && (std::isalnum(static_cast<unsigned char>(line[end])) || line[end] == '_'))
+        end++;
+    return line.substr(i, end - i);
+}
+
+std::string lineDirective(int line, size_t file)
+{
+    return "#line " + std::to_string(line) + " " + std::to_string(file) + "\n";
+}
+
+} // namespace
+
+bool ShaderPreprocessor::Process(const std::string& source, const std::string& path, const ShaderDefines& defines,
+                                 std::string& output, std::vector<std::string>* files)
+{
+    std::vector<std::string> included;
+    included.push_back(std::filesystem::path(path).lexically_normal().string());
+    output.clear();
+    output.reserve(source.size());
+    bool ok = expand(source, path, &defines, included, output);
+    if (files)
+        *files = included;
+    return ok;
+}
+
+bool ShaderPreprocessor::ProcessFile(const std::string& path, const ShaderDefines& defines, std::string& output,
+                                     std::vector<std::string>* files)
+{
+    std::string source;
+    if (!readFile(path, source)) {
+        std::cout << "ERROR::SHADER: Failed to open shader file: " << path << std::endl;
+        return false;
+    }
+    return Process(source, path, defines, output, files);
+}
+
+bool ShaderPreprocessor::expand(const std::string& source, const std::string& path, const ShaderDefines* defines,
+                                std::vector<std::string>& files, std::string& output)
+{
+    const size_t fileIndex = files.size() - 1;
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::istringstream lines(source);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        size_t end = 0;
+        std::string word = directive(line, end);
+
+        if (word == "version") {
+            if (!defines) {
+                // only the top-level file may have one
+                output += "// " + line + "\n";
+                continue;
+            }
+            output += line + "\n";
+            for (const auto& define : *defines)
+                output += "#define " + define.first + " " + define.second + "\n";
+            if (!defines->empty())
+                output += lineDirective(lineNumber + 1, fileIndex);
+            continue;
+        }
+
+        if (word != "include") {
+            output += line + "\n";
+            continue;
+        }
+
+        size_t open = line.find('"', end);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            std::cout << "ERROR::SHADER: Malformed #include in " << path << ":" << lineNumber << std::endl;
+            return false;
+        }
+        std::string includePath = (directory / line.substr(open + 1, close - open - 1)).lexically_normal().string();
+
+        if (std::find(files.begin(), files.end(), includePath) != files.end()) {
+            // already pasted into this stage
+            output += "// " + line + "\n";
+            continue;
+        }
+
+        std::string included;
+        if (!readFile(includePath, included)) {
+            std::cout << "ERROR::SHADER: Failed to open " << includePath << " included from " << path << ":"
+                      << lineNumber << std::endl;
+            return false;
+        }
+        files.push_back(includePath);
+        output += lineDirective(1, files.size() - 1);
+        if (!expand(included, includePath, nullptr, files, output))
+            return false;
+        output += lineDirective(lineNumber + 1, fileIndex);
+    }
+    return true;
+}
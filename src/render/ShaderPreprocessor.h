@@ -0,0 +1,40 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// name/value pairs injected as "#define name value"
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+// The part of preprocessing GLSL does not do itself.
+//
+// - #include "file" is replaced by the file, resolved relative to the file
+//   that includes it. Every file is pasted at most once per stage, so shared
+//   headers need no guards and include cycles end quietly. Includes are
+//   expanded before the GLSL preprocessor runs, so an #include inside an
+//   #if block is expanded regardless of the condition.
+// - defines are inserted right after the #version line.
+//
+// #line directives are emitted around every pasted file so compile errors
+// keep pointing at the right line; the source string number in an error is
+// the index of the file in `files` (0 is the top-level file).
+class ShaderPreprocessor
+{
+public:
+    // source has already been read from path; returns false and logs if an include is missing
+    static bool Process(const std::string& source, const std::string& path, const ShaderDefines& defines,
+                        std::string& output, std::vector<std::string>* files = nullptr);
+
+    // reads and processes path
+    static bool ProcessFile(const std::string& path, const ShaderDefines& defines, std::string& output,
+                            std::vector<std::string>* files = nullptr);
+
+private:
+    // defines is only passed for the top-level file
+    static bool expand(const std::string& source, const std::string& path, const ShaderDefines* defines,
+                       std::vector<std::string>& files, std::string& output);
+};
+
+#endif // SHADER_PREPROCESSOR_H
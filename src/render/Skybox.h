@@ -7,6 +7,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
+#include "GLStateCache.h"
+#include "RenderStats.h"
 
 class Skybox {
 public:
@@ -22,7 +24,7 @@ public:
     ~Skybox() {
         // Only try to delete OpenGL objects if they were actually created
         if (VAO != 0) {
-            glDeleteVertexArrays(1, &VAO);
+            GLStateCache::DeleteVertexArrays(1, &VAO);
         }
         if (VBO != 0) {
             glDeleteBuffers(1, &VBO);
@@ -85,12 +87,13 @@ public:
         // Create and configure the VAO and VBO
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
-        glBindVertexArray(VAO);
+        GLStateCache::BindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+        RenderStats::RecordUpload(sizeof(skyboxVertices));
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glBindVertexArray(0);
+        GLStateCache::BindVertexArray(0);
     }
 
     void render(const glm::mat4& view, const glm::mat4& projection) {
@@ -98,16 +101,15 @@ public:
             return;
         }
 
-        // Save current depth function
-        GLint currentDepthFunc;
-        glGetIntegerv(GL_DEPTH_FUNC, &currentDepthFunc);
+        // Save current depth function (shadowed, so no glGet round trip)
+        GLenum currentDepthFunc = GLStateCache::GetDepthFunc();
 
         // Change depth function to GL_LEQUAL for skybox rendering
         // This allows the skybox to pass depth test when depth value is exactly equal to depth buffer
-        glDepthFunc(GL_LEQUAL);
+        GLStateCache::DepthFunc(GL_LEQUAL);
 
         // Disable depth writing but keep depth testing active (for early depth testing optimization)
-        glDepthMask(GL_FALSE);
+        GLStateCache::DepthMask(GL_FALSE);
 
         // Use the skybox shader
         skyboxShader->Use();
@@ -120,17 +122,18 @@ public:
         skyboxShader->SetMatrix4("projection", projection);
 
         // Bind the cubemap texture
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::ActiveTexture(GL_TEXTURE0);
         cubemap->Bind();
         skyboxShader->SetInteger("skybox", 0);
 
         // Render the skybox cube
-        glBindVertexArray(VAO);
+        GLStateCache::BindVertexArray(VAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+        RenderStats::RecordDraw(GL_TRIANGLES, 36);
+        GLStateCache::BindVertexArray(0);
 
         // Re-enable depth writing and restore previous depth function
-        glDepthMask(GL_TRUE);
-        glDepthFunc(currentDepthFunc); // Restore original depth function
+        GLStateCache::DepthMask(GL_TRUE);
+        GLStateCache::DepthFunc(currentDepthFunc); // Restore original depth function
     }
 };
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "util/common.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include "game/Camera.h"
+#include "GLStateCache.h"
+#include "RenderStats.h"
 
 glm::mat4 mat2To4(const glm::mat2& mat2){
     return glm::mat4(
@@ -20,7 +22,7 @@ SpriteRenderer::SpriteRenderer(const Shader &shader, const std::vector<float> &v
 
 SpriteRenderer::~SpriteRenderer()
 {
-    glDeleteVertexArrays(1, &this->quadVAO);
+    GLStateCache::DeleteVertexArrays(1, &this->quadVAO);
 }
 
 glm::mat4 SpriteRenderer::Transform(glm::vec2 position, glm::vec2 size, float rotate) {
@@ -55,12 +57,13 @@ void SpriteRenderer::DrawSprite(const Texture2D &texture, glm::vec2 position, gl
     this->shader.SetVector2f("textureSize", textureSize);
     this->shader.SetInteger("mirror", mirror ? 1 : 0);
 
-    glActiveTexture(GL_TEXTURE0);
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
     texture.Bind();
 
-    glBindVertexArray(this->quadVAO);
+    GLStateCache::BindVertexArray(this->quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_TRIANGLES, 6);
+    GLStateCache::BindVertexArray(0);
 }
 
 void SpriteRenderer::DrawSprite(const Texture2D &texture, glm::mat4 model, glm::vec3 color, glm::vec2 textureOffset, glm::vec2 textureSize, glm::mat4 view)
@@ -73,16 +76,17 @@ void SpriteRenderer::DrawSprite(const Texture2D &texture, glm::mat4 model, glm::
     this->shader.SetMatrix4("view", view);
     this->shader.SetInteger("mirror", 0);
 
-    glActiveTexture(GL_TEXTURE0);
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
     texture.Bind();
 
-    glBindVertexArray(this->quadVAO);
+    GLStateCache::BindVertexArray(this->quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_TRIANGLES, 6);
+    GLStateCache::BindVertexArray(0);
 }
 
 void SpriteRenderer::Bind() {
-    glBindVertexArray(this->quadVAO);
+    GLStateCache::BindVertexArray(this->quadVAO);
 }
 
 void SpriteRenderer::initRenderData(const std::vector<float> &vertices)
@@ -94,10 +98,11 @@ void SpriteRenderer::initRenderData(const std::vector<float> &vertices)
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(vertices.size() * sizeof(float));
 
-    glBindVertexArray(this->quadVAO);
+    GLStateCache::BindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
@@ -0,0 +1,402 @@
+#include "TextureBaker.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stb_image.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb/stb_image_resize2.h>
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+#include "../util/FileStamp.h"
+#include "../util/MappedFile.h"
+#include "../util/WorkerPool.h"
+
+bool TextureBaker::enabled = true;
+bool TextureBaker::supported = false;
+TextureBakerStats TextureBaker::stats;
+
+namespace {
+
+// Load and BakeFile run on the model loader and texture decode threads
+std::mutex statsMutex;
+
+const char BAKED_MAGIC[4] = { 'M', '3', 'D', 'T' };
+const uint32_t BAKED_VERSION = 1;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;       // BakedFormat
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+};
+
+struct FileLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+GLenum glFormat(BakedFormat format)
+{
+    switch (format) {
+        case BakedFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BakedFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        default: return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+size_t blockBytes(BakedFormat format)
+{
+    return format == BakedFormat::BC1 ? 8 : 16;
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// The 4x4 block at (blockX, blockY) of an RGBA level; levels that are not a
+// multiple of 4 repeat their last row and column
+void gatherBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, unsigned char block[64])
+{
+    for (int y = 0; y < 4; y++) {
+        int sourceY = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sourceX = std::min(blockX * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * 4, rgba + (size_t(sourceY) * width + sourceX) * 4, 4);
+        }
+    }
+}
+
+void compressLevel(const unsigned char* rgba, int width, int height, BakedFormat format, unsigned char* out)
+{
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    unsigned char block[64];
+    unsigned char rg[32];
+    for (int blockY = 0; blockY < blocksY; blockY++) {
+        for (int blockX = 0; blockX < blocksX; blockX++) {
+            gatherBlock(rgba, width, height, blockX, blockY, block);
+            if (format == BakedFormat::BC5) {
+                for (int i = 0; i < 16; i++) {
+                    rg[i * 2] = block[i * 4];
+                    rg[i * 2 + 1] = block[i * 4 + 1];
+                }
+                stb_compress_bc5_block(out, rg);
+            } else {
+                stb_compress_dxt_block(out, block, format == BakedFormat::BC3, STB_DXT_HIGHQUAL);
+            }
+            out += blockBytes(format);
+        }
+    }
+}
+
+// Averaging shortens normals; put them back on the unit sphere so the z the shaders rebuild stays right
+void renormalize(unsigned char* rgba, size_t texels)
+{
+    for (size_t i = 0; i < texels; i++) {
+        unsigned char* texel = rgba + i * 4;
+        float x = texel[0] / 127.5f - 1.0f, y = texel[1] / 127.5f - 1.0f, z = texel[2] / 127.5f - 1.0f;
+        float length = std::sqrt(x * x + y * y + z * z);
+        if (length < 1e-4f)
+            continue;
+        texel[0] = static_cast<unsigned char>(std::clamp((x / length + 1.0f) * 127.5f + 0.5f, 0.0f, 255.0f));
+        texel[1] = static_cast<unsigned char>(std::clamp((y / length + 1.0f) * 127.5f + 0.5f, 0.0f, 255.0f));
+        texel[2] = static_cast<unsigned char>(std::clamp((z / length + 1.0f) * 127.5f + 0.5f, 0.0f, 255.0f));
+    }
+}
+
+// the section [offset, offset + size) lies inside the file
+bool inside(uint64_t offset, uint64_t size, size_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+} // namespace
+
+void TextureBaker::DetectSupport()
+{
+    bool s3tc = false, srgb = false;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (!name)
+            continue;
+        s3tc = s3tc || std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+        srgb = srgb || std::strcmp(name, "GL_EXT_texture_sRGB") == 0;
+    }
+    supported = s3tc && srgb;
+    if (!supported)
+        std::cout << "Texture baker: S3TC not supported, textures upload uncompressed" << std::endl;
+}
+
+TextureUsage TextureBaker::UsageFor(const std::string& materialType)
+{
+    return materialType == "texture_normal" ? TextureUsage::Normal : TextureUsage::Color;
+}
+
+std::string TextureBaker::PathFor(const std::string& sourcePath, TextureUsage usage)
+{
+    // a normal map baked as colour would lose its z, so each use gets its own file
+    return sourcePath + (usage == TextureUsage::Normal ? ".normal.m3dtex" : ".m3dtex");
+}
+
+GLenum TextureBaker::InternalFormat(GLenum format, bool gamma)
+{
+    if (!gamma)
+        return format;
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+    if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    return format;
+}
+
+bool TextureBaker::Load(const std::string& sourcePath, TextureUsage usage, TextureImage& image)
+{
+    if (!IsEnabled())
+        return false;
+    return open(sourcePath, usage, image) || bake(sourcePath, usage, image);
+}
+
+bool TextureBaker::BakeFile(const std::string& sourcePath, TextureUsage usage)
+{
+    TextureImage image;
+    return open(sourcePath, usage, image) || bake(sourcePath, usage, image);
+}
+
+bool TextureBaker::open(const std::string& sourcePath, TextureUsage usage, TextureImage& image)
+{
+    auto start = std::chrono::steady_clock::now();
+    const std::string path = PathFor(sourcePath, usage);
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(path))
+        return false;
+
+    const unsigned char* data = mapping->data();
+    const size_t size = mapping->size();
+    FileHeader header;
+    uint64_t sourceSize = 0, sourceHash = 0;
+    int64_t sourceModified = 0;
+    bool valid = size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, data, sizeof(header));
+        valid = std::equal(header.magic, header.magic + 4, BAKED_MAGIC) && header.version == BAKED_VERSION &&
+                header.format <= uint32_t(BakedFormat::BC5) && header.fileSize == size && header.levelCount > 0 &&
+                inside(sizeof(header), uint64_t(header.levelCount) * sizeof(FileLevel), size) &&
+                GetFileStamp(sourcePath, sourceSize, sourceModified) && sourceSize == header.sourceSize &&
+                (sourceModified == header.sourceModified ||
+                 (HashFile(sourcePath, sourceHash) && sourceHash == header.sourceHash));
+    }
+
+    std::vector<TextureLevel> levels(valid ? header.levelCount : 0);
+    for (size_t i = 0; i < levels.size() && valid; i++) {
+        FileLevel entry;
+        std::memcpy(&entry, data + sizeof(header) + i * sizeof(FileLevel), sizeof(entry));
+        valid = inside(entry.offset, entry.size, size) && entry.offset >= levels[0].offset;
+        levels[i].width = static_cast<int>(entry.width);
+        levels[i].height = static_cast<int>(entry.height);
+        levels[i].offset = entry.offset;
+        levels[i].size = entry.size;
+    }
+    if (!valid) {
+        mapping.reset();
+        std::cout << "Texture baker: discarding stale " << path << std::endl;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.stale++;
+        return false;
+    }
+
+    // the levels are uploaded straight from the mapping, which lives as long as the image does
+    const size_t first = levels[0].offset;
+    for (TextureLevel& level : levels)
+        level.offset -= first;
+    image = TextureImage();
+    image.width = static_cast<int>(header.width);
+    image.height = static_cast<int>(header.height);
+    image.components = header.format == uint32_t(BakedFormat::BC1) ? 3 : (header.format == uint32_t(BakedFormat::BC3) ? 4 : 2);
+    image.compressedFormat = glFormat(static_cast<BakedFormat>(header.format));
+    image.levels = std::move(levels);
+    image.pixels = std::shared_ptr<unsigned char>(mapping, const_cast<unsigned char*>(data + first));
+
+    double loadMs = elapsedMs(start);
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.hits++;
+    stats.loadMs += loadMs;
+    stats.bakedBytes += image.size();
+    stats.uncompressedBytes += size_t(image.width) * image.height * (image.components == 4 ? 4 : 3) * 4 / 3;
+    return true;
+}
+
+bool TextureBaker::bake(const std::string& sourcePath, TextureUsage usage, TextureImage& image)
+{
+    auto start = std::chrono::steady_clock::now();
+    FileHeader header = {};
+    if (!GetFileStamp(sourcePath, header.sourceSize, header.sourceModified) || !HashFile(sourcePath, header.sourceHash)) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.failed++;
+        return false;
+    }
+
+    int width = 0, height = 0, components = 0;
+    stbi_set_flip_vertically_on_load_thread(false);
+    unsigned char* decoded = stbi_load(sourcePath.c_str(), &width, &height, &components, 4);
+    if (!decoded) {
+        std::cout << "Texture baker: could not decode " << sourcePath << ": " << stbi_failure_reason() << std::endl;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.failed++;
+        return false;
+    }
+    std::vector<unsigned char> level(decoded, decoded + size_t(width) * height * 4);
+    stbi_image_free(decoded);
+
+    BakedFormat format = BakedFormat::BC5;
+    if (usage == TextureUsage::Color) {
+        bool opaque = true;
+        for (size_t i = 3; i < level.size() && opaque; i += 4)
+            opaque = level[i] == 255;
+        format = opaque ? BakedFormat::BC1 : BakedFormat::BC3;
+    }
+
+    // the chain down to 1x1, each level resized from the one above
+    std::vector<FileLevel> table;
+    std::vector<unsigned char> blocks;
+    int levelWidth = width, levelHeight = height;
+    while (true) {
+        size_t levelSize = size_t((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes(format);
+        FileLevel entry = { uint32_t(levelWidth), uint32_t(levelHeight), alignUp(blocks.size(), LEVEL_ALIGNMENT), levelSize };
+        blocks.resize(entry.offset + levelSize);
+        compressLevel(level.data(), levelWidth, levelHeight, format, blocks.data() + entry.offset);
+        table.push_back(entry);
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+
+        int nextWidth = std::max(1, levelWidth / 2), nextHeight = std::max(1, levelHeight / 2);
+        std::vector<unsigned char> next(size_t(nextWidth) * nextHeight * 4);
+        if (usage == TextureUsage::Color) {
+            // colour maps are sRGB content; averaging them in linear space keeps mips from darkening
+            stbir_resize_uint8_srgb(level.data(), levelWidth, levelHeight, 0, next.data(), nextWidth, nextHeight, 0, STBIR_RGBA);
+        } else {
+            stbir_resize_uint8_linear(level.data(), levelWidth, levelHeight, 0, next.data(), nextWidth, nextHeight, 0, STBIR_4CHANNEL);
+            renormalize(next.data(), size_t(nextWidth) * nextHeight);
+        }
+        level.swap(next);
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+
+    std::copy(BAKED_MAGIC, BAKED_MAGIC + 4, header.magic);
+    header.version = BAKED_VERSION;
+    header.format = static_cast<uint32_t>(format);
+    header.width = uint32_t(width);
+    header.height = uint32_t(height);
+    header.levelCount = static_cast<uint32_t>(table.size());
+    const uint64_t first = alignUp(sizeof(FileHeader) + table.size() * sizeof(FileLevel), LEVEL_ALIGNMENT);
+    for (FileLevel& entry : table)
+        entry.offset += first;
+    header.fileSize = first + blocks.size();
+
+    // write next to the final name and rename, so a crash never leaves half a file behind;
+    // the temporary is per thread, as two models may bake the same image at once
+    const std::string path = PathFor(sourcePath, usage);
+    const std::string temporary = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        const std::vector<char> padding(first - sizeof(FileHeader) - table.size() * sizeof(FileLevel), 0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(FileLevel));
+        out.write(padding.data(), padding.size());
+        out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        // a read-only tree still gets the compressed image, just not the file
+        std::cout << "Texture baker: could not write " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(temporary, error);
+    }
+
+    image = TextureImage();
+    image.width = width;
+    image.height = height;
+    image.components = format == BakedFormat::BC1 ? 3 : (format == BakedFormat::BC3 ? 4 : 2);
+    image.compressedFormat = glFormat(format);
+    for (const FileLevel& entry : table)
+        image.levels.push_back({ int(entry.width), int(entry.height), size_t(entry.offset - first), size_t(entry.size) });
+    auto storage = std::make_shared<std::vector<unsigned char>>(std::move(blocks));
+    image.pixels = std::shared_ptr<unsigned char>(storage, storage->data());
+
+    double bakeMs = elapsedMs(start);
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.baked++;
+    stats.bakeMs += bakeMs;
+    stats.bakedBytes += image.size();
+    stats.uncompressedBytes += size_t(width) * height * (format == BakedFormat::BC3 ? 4 : 3) * 4 / 3;
+    std::cout << "Texture baker: baked " << sourcePath << " (" << width << "x" << height << ", "
+              << table.size() << " levels) in " << bakeMs << " ms" << std::endl;
+    return true;
+}
+
+unsigned int TextureBaker::BakeDirectory(const std::string& directory)
+{
+    std::vector<std::filesystem::path> sources;
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (it->is_regular_file() &&
+            (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp"))
+            sources.push_back(it->path());
+    }
+    if (error)
+        std::cout << "Texture baker: could not read " << directory << ": " << error.message() << std::endl;
+
+    std::atomic<unsigned int> done(0);
+    WorkerPool pool;
+    pool.run(sources.size(), [&](size_t i) {
+        std::string name = sources[i].filename().string();
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        TextureUsage usage = name.find("normal") != std::string::npos ? TextureUsage::Normal : TextureUsage::Color;
+        if (BakeFile(sources[i].string(), usage))
+            done++;
+    });
+    return done;
+}
+
+void TextureBaker::PrintReport()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (stats.hits + stats.baked + stats.failed == 0)
+        return;
+    double ratio = stats.bakedBytes ? double(stats.uncompressedBytes) / stats.bakedBytes : 0.0;
+    std::cout << "Texture baker: " << stats.hits << " hits, " << stats.baked << " baked (" << stats.stale
+              << " stale, " << stats.failed << " failed); " << stats.loadMs << " ms mapping, " << stats.bakeMs
+              << " ms baking; " << stats.bakedBytes / 1024 << " KB instead of " << stats.uncompressedBytes / 1024
+              << " KB (" << ratio << "x smaller)" << std::endl;
+}
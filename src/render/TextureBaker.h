@@ -0,0 +1,95 @@
+#ifndef TEXTURE_BAKER_H
+#define TEXTURE_BAKER_H
+
+#include <cstdint>
+#include <string>
+#include <glad/glad.h>
+#include "TextureStreamer.h"
+
+// S3TC comes from extensions the loader was not generated with; RGTC (BC5) is core
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// What a texture holds, which decides how it is compressed
+enum class TextureUsage {
+    Color,   // BC1, or BC3 if any texel is not opaque
+    Normal   // BC5: x and y only, shaders rebuild z (see shaders/include/normal_map.glsl)
+};
+
+enum class BakedFormat : uint32_t {
+    BC1 = 0,
+    BC3 = 1,
+    BC5 = 2
+};
+
+struct TextureBakerStats {
+    unsigned int hits = 0;
+    unsigned int baked = 0;
+    unsigned int stale = 0;        // the source changed since it was baked
+    unsigned int failed = 0;       // the source could not be decoded
+    double loadMs = 0.0;
+    double bakeMs = 0.0;
+    size_t bakedBytes = 0;         // every level of the hits and bakes
+    size_t uncompressedBytes = 0;  // what the same images and mips take as RGB/RGBA8
+};
+
+// Block-compressed copies of texture images, baked on first use (or ahead
+// of time with BakeFile) into a container next to the source: the image
+// and a full mip chain made with stb_image_resize2, each level compressed
+// with stb_dxt. Loading maps the file; its levels go to the GPU as they are
+// with glCompressedTexImage2D, 4-8x smaller than RGB/RGBA8 with mips.
+//
+// A baked file records the size, modification time and content hash of its
+// source and is baked again when the source changed. Load and BakeFile may
+// run on several threads at once.
+//
+// Layout: header | level table | levels, each aligned to LEVEL_ALIGNMENT
+class TextureBaker
+{
+public:
+    static const uint32_t LEVEL_ALIGNMENT = 16;
+
+    // render thread, with the context current: BC1/BC3 need S3TC and its sRGB variants
+    static void DetectSupport();
+    static bool IsSupported() { return supported; }
+    static void SetEnabled(bool enabled) { TextureBaker::enabled = enabled; }
+    static bool IsEnabled() { return enabled && supported; }
+
+    static TextureUsage UsageFor(const std::string& materialType);
+    static std::string PathFor(const std::string& sourcePath, TextureUsage usage);
+
+    // The baked image of sourcePath, baking it first if there is none or it
+    // is stale. false if disabled or the source cannot be decoded
+    static bool Load(const std::string& sourcePath, TextureUsage usage, TextureImage& image);
+    // Bakes sourcePath unless an up to date file exists
+    static bool BakeFile(const std::string& sourcePath, TextureUsage usage);
+    // Ahead of time: every image under directory, as a normal map if its name says so.
+    // Returns how many are baked and up to date
+    static unsigned int BakeDirectory(const std::string& directory);
+
+    // the GL internal format of a baked image, sRGB if gamma
+    static GLenum InternalFormat(GLenum format, bool gamma);
+
+    static const TextureBakerStats& GetStats() { return stats; }
+    static void PrintReport();
+
+private:
+    static bool open(const std::string& sourcePath, TextureUsage usage, TextureImage& image);
+    static bool bake(const std::string& sourcePath, TextureUsage usage, TextureImage& image);
+
+    static bool enabled;
+    static bool supported;
+    static TextureBakerStats stats;
+};
+
+#endif // TEXTURE_BAKER_H
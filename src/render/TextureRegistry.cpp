@@ -0,0 +1,133 @@
+#include "TextureRegistry.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include "GLStateCache.h"
+#include "MaterialAtlas.h"
+#include "TextureStreamer.h"
+#include "../util/FileStamp.h"
+
+namespace {
+
+struct Entry {
+    GLuint texture = 0;
+    unsigned int references = 0;
+    size_t bytes = 0;
+};
+
+// keys are looked up and added from the loader threads
+std::mutex mutex;
+std::unordered_map<TextureKey, Entry> entries;
+std::unordered_map<GLuint, TextureKey> keys;   // texture name -> key, for Release
+TextureRegistryStats stats;
+
+// 0 is reserved for "no key"
+TextureKey finish(uint64_t hash)
+{
+    return hash ? hash : 1;
+}
+
+} // namespace
+
+TextureKey TextureRegistry::KeyForBytes(const void* data, size_t size, uint64_t variant)
+{
+    return finish(Fnv1a(Fnv1a(FNV1A_BASIS, &variant, sizeof(variant)), data, size));
+}
+
+bool TextureRegistry::KeyForFile(const std::string& path, uint64_t variant, TextureKey& key)
+{
+    uint64_t hash = 0;
+    if (!HashFile(path, hash))
+        return false;
+    key = KeyForBytes(&hash, sizeof(hash), variant);
+    return true;
+}
+
+TextureKey TextureRegistry::KeyForColor(const glm::vec4& color, uint64_t variant)
+{
+    unsigned char texel[5] = { 'c' };
+    for (int i = 0; i < 4; i++)
+        texel[i + 1] = static_cast<unsigned char>(std::clamp(color[i], 0.0f, 1.0f) * 255.0f);
+    return KeyForBytes(texel, sizeof(texel), variant);
+}
+
+GLuint TextureRegistry::Acquire(TextureKey key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return 0;
+    it->second.references++;
+    stats.references++;
+    stats.hits++;
+    stats.savedBytes += it->second.bytes;
+    return it->second.texture;
+}
+
+void TextureRegistry::Add(TextureKey key, GLuint texture, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[key];
+    if (entry.texture != 0) {
+        // registered meanwhile; the caller's copy stays its own
+        std::cout << "Texture registry: key already registered, texture " << texture << " not shared" << std::endl;
+        return;
+    }
+    entry.texture = texture;
+    entry.references = 1;
+    entry.bytes = bytes;
+    keys[texture] = key;
+    stats.textures++;
+    stats.references++;
+    stats.misses++;
+    stats.residentBytes += bytes;
+}
+
+void TextureRegistry::SetBytes(GLuint texture, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto key = keys.find(texture);
+    if (key == keys.end())
+        return;
+    Entry& entry = entries[key->second];
+    stats.residentBytes = stats.residentBytes - entry.bytes + bytes;
+    entry.bytes = bytes;
+}
+
+void TextureRegistry::Release(GLuint texture)
+{
+    if (texture == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto key = keys.find(texture);
+        if (key != keys.end()) {
+            auto it = entries.find(key->second);
+            stats.references--;
+            if (--it->second.references > 0)
+                return;
+            stats.textures--;
+            stats.residentBytes -= it->second.bytes;
+            entries.erase(it);
+            keys.erase(key);
+        }
+    }
+    MaterialAtlas::Evict(texture);
+    TextureStreamer::Cancel(texture);
+    GLStateCache::DeleteTextures(1, &texture);
+}
+
+TextureRegistryStats TextureRegistry::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void TextureRegistry::PrintReport()
+{
+    TextureRegistryStats report = GetStats();
+    std::cout << "Texture registry: " << report.textures << " textures, " << report.references << " references; "
+              << report.hits << " hits, " << report.misses << " made; " << report.residentBytes / 1024 << " KB resident, "
+              << report.savedBytes / 1024 << " KB not uploaded again" << std::endl;
+}
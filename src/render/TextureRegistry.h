@@ -0,0 +1,54 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// What a texture is registered under: a hash of its content (the encoded
+// file or embedded bytes, or a solid colour's value) mixed with a variant,
+// the creation settings that make two textures of the same content differ
+// (usage, gamma, sampling). 0 is no key.
+typedef uint64_t TextureKey;
+
+struct TextureRegistryStats {
+    unsigned int textures = 0;     // registered and alive
+    unsigned int references = 0;   // held on them
+    unsigned int hits = 0;         // acquires that found a texture
+    unsigned int misses = 0;       // textures made and added
+    size_t residentBytes = 0;      // image bytes of the registered textures
+    size_t savedBytes = 0;         // image bytes the hits did not upload again
+};
+
+// Process-wide table of texture objects keyed by content, shared by every
+// model and ResourceManager. A texture holds a reference count: Acquire and
+// Add take one, Release drops one and deletes the texture with the last.
+// Lookups are hash map finds. Everything but Release is thread safe, so a
+// loader thread takes its reference before it would decode; Release deletes
+// the texture and is render thread only.
+class TextureRegistry
+{
+public:
+    // keys; false / 0 if the content cannot be read
+    static TextureKey KeyForBytes(const void* data, size_t size, uint64_t variant);
+    static bool KeyForFile(const std::string& path, uint64_t variant, TextureKey& key);
+    // a solid colour is registered by its value, as the texel it is stored as
+    static TextureKey KeyForColor(const glm::vec4& color, uint64_t variant);
+
+    // the texture registered under key with a reference taken, or 0
+    static GLuint Acquire(TextureKey key);
+    // registers a texture just made under key, with one reference; bytes is its image size
+    static void Add(TextureKey key, GLuint texture, size_t bytes);
+    // bytes is known only once a streamed image is decoded
+    static void SetBytes(GLuint texture, size_t bytes);
+    // drops a reference on texture, deleting it with the last; a texture that
+    // was never registered belongs to the caller alone and is deleted at once
+    static void Release(GLuint texture);
+
+    static TextureRegistryStats GetStats();
+    static void PrintReport();
+};
+
+#endif // TEXTURE_REGISTRY_H
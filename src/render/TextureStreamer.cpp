@@ -0,0 +1,589 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stb_image.h>
+#include "GLStateCache.h"
+#include "RenderStats.h"
+#include "TextureBaker.h"
+#include "../util/JobQueue.h"
+
+bool TextureStreamer::enabled = true;
+size_t TextureStreamer::frameBudget = 16u << 20;
+TextureStreamerStats TextureStreamer::stats;
+
+namespace
+{
+    struct Request {
+        GLuint texture = 0;
+        TextureImage image;
+        TextureStreamParams params;
+        uint64_t generation = 0;   // matches generations[texture] until a newer request or Cancel()
+    };
+
+    // A pixel buffer and the fence of the last upload read from it
+    struct RingSlot {
+        GLuint buffer = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+    };
+
+    struct Ring {
+        RingSlot slots[TextureStreamer::RING_SIZE];
+        int next = 0;
+    };
+
+    // uploaded by the upload thread, resident once its fence signalled
+    struct Landed {
+        Request request;
+        GLsync fence = nullptr;
+        bool live = true;          // not cancelled when it was taken off the landed list
+    };
+
+    std::unique_ptr<JobQueue> decoder;
+    Ring renderRing;               // Update()'s, in the render context
+
+    std::mutex mutex;              // guards everything below
+    std::condition_variable uploadWake;
+    std::condition_variable uploadIdle;
+    std::deque<Request> decoded;
+    // texture -> its latest request; a request whose generation no longer matches is dropped
+    std::unordered_map<GLuint, uint64_t> generations;
+    uint64_t nextGeneration = 0;
+    GLuint uploadingTexture = 0;   // the upload thread is writing into it
+    std::vector<Landed> landed;
+    size_t granted = 0;            // bytes the upload thread may still upload this frame
+    size_t uploadedBytes = 0;      // by the upload thread since the last Update()
+    unsigned int uploading = 0;    // popped by the upload thread, not landed yet
+    bool stopping = false;
+    std::thread uploadThread;
+    bool uploadThreadRunning = false;
+
+    GLenum formatFor(int components)
+    {
+        switch (components) {
+            case 1: return GL_RED;
+            case 2: return GL_RG;
+            case 3: return GL_RGB;
+            default: return GL_RGBA;
+        }
+    }
+
+    GLenum internalFormatFor(const TextureImage& image, const TextureStreamParams& params)
+    {
+        if (image.compressedFormat != 0)
+            return TextureBaker::InternalFormat(image.compressedFormat, params.gamma);
+        if (params.internalFormat != 0)
+            return params.internalFormat;
+        if (image.components == 3)
+            return params.gamma ? GL_SRGB : GL_RGB;
+        if (image.components == 4)
+            return params.gamma ? GL_SRGB_ALPHA : GL_RGBA;
+        return formatFor(image.components);
+    }
+
+    // On the render thread through GLStateCache; on the upload thread it
+    // must not touch the render context's shadowed bindings
+    void bindTexture(GLuint texture, bool renderThread)
+    {
+        if (renderThread)
+            GLStateCache::BindTexture(GL_TEXTURE_2D, texture);
+        else
+            glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    void setParameters(const TextureImage& image, const TextureStreamParams& params)
+    {
+        bool mipmapped = params.mipmaps && !image.placeholder;
+        GLint minFilter = params.minFilter;
+        if (!mipmapped && minFilter != GL_NEAREST)
+            minFilter = GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+
+#ifdef GL_MAX_TEXTURE_MAX_ANISOTROPY
+        if (mipmapped && params.anisotropic) {
+            float aniso = 0.0f;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &aniso);
+            if (aniso > 0.0f)
+                glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, aniso);
+        }
+#endif
+    }
+
+    void createPlaceholder(GLuint texture, const TextureStreamParams& params)
+    {
+        unsigned char texel[4];
+        for (int i = 0; i < 4; ++i)
+            texel[i] = static_cast<unsigned char>(std::clamp(params.placeholder[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+        GLStateCache::BindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, params.gamma ? GL_SRGB_ALPHA : GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    // Specifies the image into request.texture from data, or from the bound
+    // pixel unpack buffer if data is null
+    void specify(const Request& request, const void* data, bool renderThread)
+    {
+        const TextureImage& image = request.image;
+        bindTexture(request.texture, renderThread);
+        if (image.compressedFormat != 0) {
+            // baked with its mips; offsets are into data, or into the buffer when data is null
+            GLenum format = internalFormatFor(image, request.params);
+            for (size_t level = 0; level < image.levels.size(); ++level) {
+                const TextureLevel& mip = image.levels[level];
+                const void* pixels = reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(data) + mip.offset);
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, mip.width, mip.height, 0,
+                                       static_cast<GLsizei>(mip.size), pixels);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size()) - 1);
+            setParameters(image, request.params);
+            return;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormatFor(image, request.params), image.width, image.height, 0,
+                     formatFor(image.components), GL_UNSIGNED_BYTE, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (request.params.mipmaps && !image.placeholder)
+            glGenerateMipmap(GL_TEXTURE_2D);
+        setParameters(image, request.params);
+    }
+
+    // false if the texture was deleted meanwhile or the image could not be decoded
+    bool uploadable(const Request& request)
+    {
+        return request.image.pixels && request.image.size() > 0 && glIsTexture(request.texture);
+    }
+
+    // with mutex held: the request is the latest for its texture, which was not cancelled
+    bool current(const Request& request)
+    {
+        auto it = generations.find(request.texture);
+        return it != generations.end() && it->second == request.generation;
+    }
+
+    // with mutex held: a new request into texture
+    uint64_t beginRequest(GLuint texture)
+    {
+        return generations[texture] = ++nextGeneration;
+    }
+
+    // with mutex held: the request is done, uploaded or not
+    void retire(const Request& request)
+    {
+        if (current(request))
+            generations.erase(request.texture);
+    }
+
+    // Uploads through the ring's next buffer. If that is still being read by
+    // an earlier upload, waits for it when block is set and returns false
+    // otherwise
+    bool uploadThroughRing(Ring& ring, const Request& request, bool renderThread, bool block)
+    {
+        RingSlot& slot = ring.slots[ring.next];
+        if (slot.fence) {
+            GLenum state = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while (block && state == GL_TIMEOUT_EXPIRED)
+                state = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            if (state == GL_TIMEOUT_EXPIRED)
+                return false;
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+
+        size_t size = request.image.size();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        // orphaned either way, so the driver never waits for the last upload from it
+        slot.capacity = std::max(slot.capacity, size);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, nullptr, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            std::memcpy(mapped, request.image.pixels.get(), size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            specify(request, nullptr, renderThread);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            specify(request, request.image.pixels.get(), renderThread);
+        }
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ring.next = (ring.next + 1) % TextureStreamer::RING_SIZE;
+        return true;
+    }
+
+    void createRing(Ring& ring)
+    {
+        for (RingSlot& slot : ring.slots)
+            glGenBuffers(1, &slot.buffer);
+        ring.next = 0;
+    }
+
+    void deleteRing(Ring& ring)
+    {
+        for (RingSlot& slot : ring.slots) {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            if (slot.buffer)
+                glDeleteBuffers(1, &slot.buffer);
+            slot = RingSlot();
+        }
+    }
+
+    void uploadLoop(std::function<bool()> makeCurrent, std::function<void()> release, std::promise<bool> started)
+    {
+        if (!makeCurrent()) {
+            started.set_value(false);
+            return;
+        }
+        started.set_value(true);
+
+        Ring ring;
+        createRing(ring);
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                uploadWake.wait(lock, [] { return stopping || (!decoded.empty() && granted > 0); });
+                if (stopping)
+                    break;
+                request = std::move(decoded.front());
+                decoded.pop_front();
+                if (!current(request)) {
+                    uploadIdle.notify_all();
+                    continue;
+                }
+                size_t size = request.image.size();
+                granted = size >= granted ? 0 : granted - size;
+                uploading++;
+                uploadingTexture = request.texture;
+            }
+
+            GLsync fence = nullptr;
+            if (uploadable(request)) {
+                uploadThroughRing(ring, request, false, true);
+                fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                // so the render context sees the commands and the fence
+                glFlush();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            uploadedBytes += fence ? request.image.size() : 0;
+            landed.push_back({ std::move(request), fence });
+            uploading--;
+            uploadingTexture = 0;
+            uploadIdle.notify_all();
+        }
+
+        glFinish();
+        deleteRing(ring);
+        release();
+    }
+
+    // an image that could not be decoded keeps its placeholder
+    void finish(const Request& request, bool uploaded, TextureStreamerStats& stats)
+    {
+        if (!uploaded)
+            return;
+        stats.resident++;
+        if (request.params.onResident)
+            request.params.onResident(request.image);
+    }
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void TextureStreamer::Init(int decodeThreads)
+{
+    if (decoder)
+        return;
+    decoder = std::make_unique<JobQueue>(decodeThreads);
+    createRing(renderRing);
+}
+
+void TextureStreamer::Shutdown()
+{
+    if (uploadThreadRunning) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        uploadWake.notify_all();
+        uploadThread.join();
+        uploadThreadRunning = false;
+        stopping = false;
+    }
+    // decodes that have not started are dropped, running ones are waited for
+    decoder.reset();
+    deleteRing(renderRing);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Landed& upload : landed) {
+        if (upload.fence)
+            glDeleteSync(upload.fence);
+    }
+    landed.clear();
+    decoded.clear();
+    generations.clear();
+    granted = uploadedBytes = 0;
+}
+
+bool TextureStreamer::SetUploadContext(std::function<bool()> makeCurrent, std::function<void()> release)
+{
+    if (!decoder || uploadThreadRunning)
+        return false;
+
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+    uploadThread = std::thread(uploadLoop, std::move(makeCurrent), std::move(release), std::move(started));
+    if (!result.get()) {
+        uploadThread.join();
+        std::cout << "Texture streamer: no upload context, uploading on the render thread" << std::endl;
+        return false;
+    }
+    uploadThreadRunning = true;
+    return true;
+}
+
+GLuint TextureStreamer::Stream(std::function<TextureImage()> decode, TextureStreamParams params)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    StreamInto(texture, std::move(decode), std::move(params));
+    return texture;
+}
+
+GLuint TextureStreamer::StreamFile(const std::string& path, TextureStreamParams params)
+{
+    return Stream([path] {
+        TextureImage image;
+        unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+        if (data)
+            image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+        else
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+        return image;
+    }, std::move(params));
+}
+
+GLuint TextureStreamer::StreamImage(TextureImage image, TextureStreamParams params)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    stats.requested++;
+
+    Request request{ texture, std::move(image), std::move(params) };
+    if (!enabled || !decoder) {
+        bool uploaded = uploadable(request);
+        if (uploaded)
+            specify(request, request.image.pixels.get(), true);
+        finish(request, uploaded, stats);
+        return texture;
+    }
+
+    createPlaceholder(texture, request.params);
+    if (uploadThreadRunning)
+        glFlush(); // so the upload context sees the texture
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        request.generation = beginRequest(texture);
+        decoded.push_back(std::move(request));
+    }
+    uploadWake.notify_one();
+    return texture;
+}
+
+void TextureStreamer::StreamInto(GLuint texture, std::function<TextureImage()> decode, TextureStreamParams params)
+{
+    stats.requested++;
+
+    if (!enabled || !decoder) {
+        Request request{ texture, decode(), std::move(params) };
+        bool uploaded = uploadable(request);
+        if (uploaded)
+            specify(request, request.image.pixels.get(), true);
+        finish(request, uploaded, stats);
+        return;
+    }
+
+    createPlaceholder(texture, params);
+    if (uploadThreadRunning)
+        glFlush();
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation = beginRequest(texture);
+    }
+    decoder->push([texture, generation, decode = std::move(decode), params = std::move(params)]() mutable {
+        Request request{ texture, decode(), std::move(params), generation };
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(std::move(request));
+        }
+        uploadWake.notify_one();
+    });
+}
+
+void TextureStreamer::Cancel(GLuint texture)
+{
+    if (texture == 0)
+        return;
+    std::unique_lock<std::mutex> lock(mutex);
+    generations.erase(texture);
+    // the request may already be on the upload thread; once it lands it is dropped
+    uploadIdle.wait(lock, [texture] { return uploadingTexture != texture; });
+}
+
+void TextureStreamer::Update()
+{
+    auto start = std::chrono::steady_clock::now();
+    stats.frameBytes = 0;
+
+    if (uploadThreadRunning) {
+        std::vector<Landed> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            granted = frameBudget;
+            stats.frameBytes = uploadedBytes;
+            uploadedBytes = 0;
+            // the upload thread's commands are visible here once their fence signalled
+            for (size_t i = 0; i < landed.size();) {
+                GLsync fence = landed[i].fence;
+                if (fence && glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                    ++i;
+                    continue;
+                }
+                landed[i].live = current(landed[i].request);
+                retire(landed[i].request);
+                ready.push_back(std::move(landed[i]));
+                landed.erase(landed.begin() + i);
+            }
+        }
+        uploadWake.notify_one();
+
+        for (Landed& upload : ready) {
+            if (upload.fence && !upload.live) {
+                // the texture was released meanwhile; its name may be someone else's by now
+                glDeleteSync(upload.fence);
+                continue;
+            }
+            if (upload.fence) {
+                glDeleteSync(upload.fence);
+                // changes made in another context are seen once the texture is bound again here
+                GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
+                GLStateCache::BindTexture(GL_TEXTURE_2D, upload.request.texture);
+                RenderStats::RecordUpload(upload.request.image.size());
+            }
+            finish(upload.request, upload.fence != nullptr, stats);
+        }
+    } else {
+        while (true) {
+            Request request;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (decoded.empty())
+                    break;
+                // always at least one, so an image larger than the budget still goes
+                size_t size = decoded.front().image.size();
+                if (stats.frameBytes > 0 && stats.frameBytes + size > frameBudget)
+                    break;
+                request = std::move(decoded.front());
+                decoded.pop_front();
+                if (!current(request))
+                    continue;
+            }
+
+            bool uploaded = uploadable(request);
+            if (uploaded) {
+                if (!uploadThroughRing(renderRing, request, true, false)) {
+                    stats.ringStalls++;
+                    std::lock_guard<std::mutex> lock(mutex);
+                    decoded.push_front(std::move(request));
+                    break;
+                }
+                stats.frameBytes += request.image.size();
+                RenderStats::RecordUpload(request.image.size());
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                retire(request);
+            }
+            finish(request, uploaded, stats);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.waiting = static_cast<unsigned int>(decoded.size() + uploading + landed.size());
+    }
+    stats.decoding = decoder ? static_cast<unsigned int>(decoder->pending()) : 0;
+    stats.frameMs = elapsedMs(start);
+    stats.totalBytes += stats.frameBytes;
+    stats.worstFrameMs = std::max(stats.worstFrameMs, stats.frameMs);
+}
+
+void TextureStreamer::Flush()
+{
+    if (!decoder)
+        return;
+    decoder->wait();
+
+    if (uploadThreadRunning) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            granted = std::numeric_limits<size_t>::max();
+            uploadWake.notify_one();
+            uploadIdle.wait(lock, [] { return decoded.empty() && uploading == 0; });
+            for (Landed& upload : landed) {
+                if (upload.fence)
+                    glClientWaitSync(upload.fence, GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+            }
+        }
+        Update();
+        return;
+    }
+
+    size_t budget = frameBudget;
+    frameBudget = std::numeric_limits<size_t>::max();
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (decoded.empty())
+                break;
+        }
+        // waits for the buffer instead of putting the upload off
+        RingSlot& slot = renderRing.slots[renderRing.next];
+        if (slot.fence)
+            glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+        Update();
+    }
+    frameBudget = budget;
+}
+
+void TextureStreamer::PrintReport()
+{
+    std::cout << "Texture streamer: " << stats.resident << "/" << stats.requested << " textures resident, "
+              << stats.totalBytes / 1024 << " KB uploaded"
+              << (uploadThreadRunning ? " on the upload context" : "")
+              << ", worst frame " << stats.worstFrameMs << " ms, " << stats.ringStalls << " ring stalls" << std::endl;
+}
@@ -0,0 +1,113 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// One level of a block-compressed image, at offset into its pixels
+struct TextureLevel {
+    int width = 0, height = 0;
+    size_t offset = 0, size = 0;
+};
+
+// A decoded texture image, waiting for upload
+struct TextureImage {
+    int width = 0, height = 0, components = 0;
+    std::shared_ptr<unsigned char> pixels;
+    bool placeholder = false; // a 2x2 stand-in for an image that could not be read, sampled without mipmaps
+
+    // block-compressed (TextureBaker): the GL format, and every mip level back to back in pixels
+    GLenum compressedFormat = 0;
+    std::vector<TextureLevel> levels;
+
+    size_t size() const { return levels.empty() ? size_t(width) * height * components : levels.back().offset + levels.back().size; }
+};
+
+// How a streamed image is stored and sampled once it is resident
+struct TextureStreamParams {
+    bool gamma = false;            // sRGB internal format for 3 and 4 component images
+    GLenum internalFormat = 0;     // 0: from the components and gamma
+    GLint wrapS = GL_REPEAT;
+    GLint wrapT = GL_REPEAT;
+    GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLint magFilter = GL_LINEAR;
+    bool mipmaps = true;
+    bool anisotropic = true;
+    glm::vec4 placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f); // the texel shown until then
+    std::function<void(const TextureImage&)> onResident;      // render thread, after the upload
+};
+
+struct TextureStreamerStats {
+    unsigned int requested = 0;
+    unsigned int resident = 0;
+    unsigned int decoding = 0;     // queued or running on the decode threads
+    unsigned int waiting = 0;      // decoded, waiting for upload budget or a free buffer
+    unsigned int ringStalls = 0;   // uploads put off because the next buffer was still in flight
+    size_t frameBytes = 0;         // uploaded by the last Update()
+    double frameMs = 0.0;
+    size_t totalBytes = 0;
+    double worstFrameMs = 0.0;
+};
+
+// Streams textures in the background. A request returns a texture name at
+// once, holding a 1x1 placeholder texel; the image is decoded on the decode
+// threads and uploaded through a ring of pixel buffer objects, at most
+// SetFrameBudget() bytes per frame, into the same texture name - so whatever
+// holds the name shows the real image as soon as it is resident.
+//
+// Uploads run in Update() on the render thread, or on an upload thread with
+// its own context sharing objects with the render context if one is given to
+// SetUploadContext(). Each ring buffer is fenced after its upload and reused
+// only once the GPU has read it.
+//
+// Before Init() (or when disabled) requests decode and upload right away.
+// Requests, Cancel(), Update() and Flush() are render thread only. Only the
+// latest request into a texture name is uploaded.
+class TextureStreamer
+{
+public:
+    static const int RING_SIZE = 4;
+
+    // render thread, with the context current
+    static void Init(int decodeThreads = -1);
+    static void Shutdown();
+    static void SetEnabled(bool enabled) { TextureStreamer::enabled = enabled; }
+    static bool IsEnabled() { return enabled; }
+    static void SetFrameBudget(size_t bytes) { frameBudget = bytes; }
+
+    // makeCurrent runs on the upload thread and makes a context current there
+    // that shares objects with the render context; release runs when it stops.
+    // Call after Init(); false if makeCurrent failed, uploads stay in Update()
+    static bool SetUploadContext(std::function<bool()> makeCurrent, std::function<void()> release);
+
+    // decode runs on a decode thread
+    static GLuint Stream(std::function<TextureImage()> decode, TextureStreamParams params);
+    static GLuint StreamFile(const std::string& path, TextureStreamParams params);
+    // an image decoded elsewhere, such as by a model import
+    static GLuint StreamImage(TextureImage image, TextureStreamParams params);
+    // into a texture name the caller made
+    static void StreamInto(GLuint texture, std::function<TextureImage()> decode, TextureStreamParams params);
+    // texture is about to be deleted: what is still pending for it is dropped, since GL hands the name out
+    // again. Waits if the upload thread is writing into it right now
+    static void Cancel(GLuint texture);
+
+    // once per frame: uploads what was decoded, within the frame budget
+    static void Update();
+    // waits for every request so far and makes it resident
+    static void Flush();
+
+    static const TextureStreamerStats& GetStats() { return stats; }
+    static void PrintReport();
+
+private:
+    static bool enabled;
+    static size_t frameBudget;
+    static TextureStreamerStats stats;
+};
+
+#endif // TEXTURE_STREAMER_H
@@ -3,6 +3,7 @@
 #include <unordered_map>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "GLStateCache.h"
 
 class TransparencyRenderer {
 public:
@@ -221,9 +222,9 @@ public:
         render_opaque_objects();
         
         // Then render transparent objects in sorted order
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDepthMask(GL_FALSE); // Don't write to depth buffer
+        GLStateCache::Enable(GL_BLEND);
+        GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLStateCache::DepthMask(GL_FALSE); // Don't write to depth buffer
         
         const auto& render_order = transparency_renderer.get_render_order();
         for (int index : render_order) {
@@ -231,8 +232,8 @@ public:
             render_transparent_object(obj);
         }
         
-        glDepthMask(GL_TRUE);
-        glDisable(GL_BLEND);
+        GLStateCache::DepthMask(GL_TRUE);
+        GLStateCache::Disable(GL_BLEND);
     }
     
     void render_opaque_objects() { /* ... */ }
@@ -0,0 +1,93 @@
+#include "UniformBuffer.h"
+#include "RenderStats.h"
+#include "GLStateCache.h"
+
+UniformBuffer::~UniformBuffer() {
+    destroy();
+}
+
+void UniformBuffer::create(GLsizeiptr size, GLuint bindingPoint) {
+    destroy();
+    binding = bindingPoint;
+    capacity = size;
+
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // The range stays attached to the binding point for the lifetime of the buffer
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size) {
+    if (!id || size > capacity) {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    // Orphan the previous storage so the driver does not stall on in-flight draws
+    glBufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    RenderStats::RecordUpload(size);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::destroy() {
+    if (id) {
+        glDeleteBuffers(1, &id);
+        id = 0;
+    }
+    capacity = 0;
+}
+
+TextureBuffer::~TextureBuffer() {
+    destroy();
+}
+
+void TextureBuffer::create(GLenum internalFormat) {
+    destroy();
+    format = internalFormat;
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+    // a buffer texture needs storage before it is sampled, so start with a few zero texels
+    const char zeros[64] = {};
+    capacity = sizeof(zeros);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity, zeros, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    GLStateCache::BindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    GLStateCache::BindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void TextureBuffer::update(const void* data, GLsizeiptr size) {
+    if (!buffer || size <= 0) {
+        return;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    // grow by half again so a slowly rising light count does not reallocate every frame
+    if (size > capacity)
+        capacity = size + size / 2;
+    // Orphan the previous storage so the driver does not stall on in-flight draws
+    glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    RenderStats::RecordUpload(size);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void TextureBuffer::bind(GLuint unit) const {
+    GLStateCache::BindTexture(unit, GL_TEXTURE_BUFFER, texture);
+}
+
+void TextureBuffer::destroy() {
+    if (texture) {
+        GLStateCache::DeleteTextures(1, &texture);
+        texture = 0;
+    }
+    if (buffer) {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+    capacity = 0;
+}
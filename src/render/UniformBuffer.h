@@ -0,0 +1,130 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+
+// Fixed binding points shared by every shader that declares the blocks
+// (shaders/include/frame_constants.glsl and light_block.glsl).
+// Shader::Compile binds the blocks by name, Renderer3D owns the buffers.
+const GLuint FRAME_CONSTANTS_BINDING = 0;
+const GLuint LIGHT_BLOCK_BINDING = 1;
+
+// Texture units of the clustered light buffers (see clustered_lights.glsl)
+const GLuint CLUSTER_RANGES_UNIT = 7;
+const GLuint CLUSTER_INDICES_UNIT = 8;
+const GLuint LIGHT_DATA_UNIT = 9;
+
+// std140 mirror of the FrameConstants block
+struct FrameConstants {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float time;
+    glm::vec3 spotLightPos;
+    float nearPlane;
+    glm::vec3 spotLightDir;
+    float farPlane;
+};
+
+// std140 mirrors of the DirLight/PointLight/SpotLight GLSL structs.
+// vec3 members are aligned to 16 bytes, floats pack into the gaps.
+struct GPUDirLight {
+    glm::vec3 direction; float pad0;
+    glm::vec3 ambient;   float pad1;
+    glm::vec3 diffuse;   float pad2;
+    glm::vec3 specular;  float pad3;
+};
+
+struct GPUPointLight {
+    glm::vec3 position;  float constant;
+    float linear;        float quadratic; float pad0[2];
+    glm::vec3 ambient;   float pad1;
+    glm::vec3 diffuse;   float pad2;
+    glm::vec3 specular;  float pad3;
+};
+
+struct GPUSpotLight {
+    glm::vec3 position;  float pad0;
+    glm::vec3 direction; float cutOff;
+    float outerCutOff;   float constant; float linear; float quadratic;
+    glm::vec3 ambient;   float pad1;
+    glm::vec3 diffuse;   float pad2;
+    glm::vec3 specular;  float pad3;
+};
+
+// std140 mirror of the LightBlock block (bools are 4 byte ints in std140)
+struct LightBlock {
+    GPUDirLight dirLight;
+    GPUPointLight pointLight;
+    GPUSpotLight spotLight;
+    int useDirLight;
+    int usePointLight;
+    int useSpotLight;
+    int useRandomPointLights;
+    int numRandomPointLights;
+    float pointLightBrightness;
+    float dirLightBrightness;
+    float spotLightBrightness;
+    // the random point lights live in buffer textures, clustered per view
+    glm::ivec4 clusterGrid;   // tiles x, tiles y, depth slices
+    glm::vec4 clusterDepth;   // slice = log(depth) * x + y
+};
+
+static_assert(sizeof(FrameConstants) == 176, "FrameConstants must match the std140 layout");
+static_assert(sizeof(GPUDirLight) == 64, "DirLight must match the std140 layout");
+static_assert(sizeof(GPUPointLight) == 80, "PointLight must match the std140 layout");
+static_assert(sizeof(GPUSpotLight) == 96, "SpotLight must match the std140 layout");
+static_assert(offsetof(LightBlock, clusterGrid) == 272, "LightBlock must match the std140 layout");
+static_assert(sizeof(LightBlock) == 304, "LightBlock must match the std140 layout");
+
+// Thin wrapper around a GL_UNIFORM_BUFFER bound to a fixed binding point
+class UniformBuffer {
+public:
+    UniformBuffer() = default;
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+    ~UniformBuffer();
+
+    // allocates the buffer storage and attaches it to the binding point
+    void create(GLsizeiptr size, GLuint binding);
+    // replaces the first `size` bytes of the buffer (orphaning the old storage)
+    void update(const void* data, GLsizeiptr size);
+    void destroy();
+
+    bool isValid() const { return id != 0; }
+    GLuint getBinding() const { return binding; }
+
+private:
+    GLuint id = 0;
+    GLuint binding = 0;
+    GLsizeiptr capacity = 0;
+};
+
+// Buffer texture (GL_TEXTURE_BUFFER) for data too large for a uniform block;
+// shaders read it with texelFetch from a samplerBuffer / usamplerBuffer.
+class TextureBuffer {
+public:
+    TextureBuffer() = default;
+    TextureBuffer(const TextureBuffer&) = delete;
+    TextureBuffer& operator=(const TextureBuffer&) = delete;
+    ~TextureBuffer();
+
+    // internalFormat is the texel format, e.g. GL_RGBA32F or GL_R16UI
+    void create(GLenum internalFormat);
+    // replaces the contents, growing the storage when needed
+    void update(const void* data, GLsizeiptr size);
+    void bind(GLuint unit) const;
+    void destroy();
+
+    bool isValid() const { return texture != 0; }
+
+private:
+    GLuint buffer = 0;
+    GLuint texture = 0;
+    GLenum format = 0;
+    GLsizeiptr capacity = 0;
+};
+
+#endif // UNIFORM_BUFFER_H
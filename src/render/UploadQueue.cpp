@@ -0,0 +1,61 @@
+#include "UploadQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+void UploadQueue::push(Task task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+}
+
+void UploadQueue::push(std::vector<Task> batch)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Task& task : batch)
+        tasks.push_back(std::move(task));
+}
+
+bool UploadQueue::pop(Task& task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty())
+        return false;
+    task = std::move(tasks.front());
+    tasks.pop_front();
+    return true;
+}
+
+void UploadQueue::process(double budgetMs, size_t budgetBytes)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats.tasks = 0;
+    stats.bytes = 0;
+    stats.ms = 0.0;
+
+    Task task;
+    while (pop(task)) {
+        // tasks run without the lock, so loaders can push meanwhile
+        stats.bytes += task();
+        stats.tasks++;
+        stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (stats.ms >= budgetMs || stats.bytes >= budgetBytes)
+            break;
+    }
+
+    stats.pending = pending();
+    stats.totalTasks += stats.tasks;
+    stats.totalBytes += stats.bytes;
+    stats.worstMs = std::max(stats.worstMs, stats.ms);
+}
+
+void UploadQueue::flush()
+{
+    process(std::numeric_limits<double>::infinity(), std::numeric_limits<size_t>::max());
+}
+
+size_t UploadQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
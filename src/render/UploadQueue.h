@@ -0,0 +1,51 @@
+#ifndef UPLOAD_QUEUE_H
+#define UPLOAD_QUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+struct UploadQueueStats {
+    size_t tasks = 0;          // run by the last process()
+    size_t bytes = 0;
+    double ms = 0.0;
+    size_t pending = 0;        // left for later frames
+    size_t totalTasks = 0;
+    size_t totalBytes = 0;
+    double worstMs = 0.0;      // longest process() so far
+};
+
+// GL work handed to the render thread. Loader threads push tasks; the render
+// thread runs them in order with process(), at most a time and byte budget
+// per frame, so a model finishing its import does not stall the frame it
+// lands in. Tasks return the bytes they uploaded.
+class UploadQueue
+{
+public:
+    using Task = std::function<size_t()>;
+
+    // thread safe; the tasks of one push run in order with nothing in between
+    void push(Task task);
+    void push(std::vector<Task> tasks);
+
+    // Render thread: runs tasks until budgetMs or budgetBytes is spent, but
+    // always at least one, so a single upload larger than the budget still goes
+    void process(double budgetMs, size_t budgetBytes);
+    // Render thread: runs everything queued
+    void flush();
+
+    size_t pending() const;
+    bool empty() const { return pending() == 0; }
+    const UploadQueueStats& getStats() const { return stats; }
+
+private:
+    bool pop(Task& task);
+
+    mutable std::mutex mutex;
+    std::deque<Task> tasks;
+    UploadQueueStats stats;
+};
+
+#endif // UPLOAD_QUEUE_H
@@ -4,6 +4,8 @@
 #include <iostream>
 #include "Vertex.h"
 #include "util/Util.h"
+#include "GLStateCache.h"
+#include "RenderStats.h"
 
 namespace VO {
 
@@ -49,6 +51,7 @@ namespace VO {
     void VBO::setup(const GLfloat* vertices, GLsizeiptr size, GLenum usage) {
         glBindBuffer(GL_ARRAY_BUFFER, id);
         glBufferData(GL_ARRAY_BUFFER, size, vertices, usage);
+        RenderStats::RecordUpload(size);
         glCheckError(__FILE__, __LINE__);
     }
 
@@ -56,6 +59,7 @@ namespace VO {
     void VBO::setup(const T* vertices, GLsizeiptr size, GLenum usage) {
         glBindBuffer(GL_ARRAY_BUFFER, id);
         glBufferData(GL_ARRAY_BUFFER, size, vertices, usage);
+        RenderStats::RecordUpload(size);
         glCheckError(__FILE__, __LINE__);
     }
 
@@ -63,6 +67,7 @@ namespace VO {
     void VBO::setup(const std::vector<T>& vertices, GLenum usage) {
         glBindBuffer(GL_ARRAY_BUFFER, id);
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(T), vertices.data(), usage);
+        RenderStats::RecordUpload(vertices.size() * sizeof(T));
         glCheckError(__FILE__, __LINE__);
     }
 
@@ -70,6 +75,7 @@ namespace VO {
     void VBO::setupSubData(const T* vertices, GLsizeiptr size, GLintptr offset) {
         glBindBuffer(GL_ARRAY_BUFFER, id);
         glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
+        RenderStats::RecordUpload(size);
         glCheckError(__FILE__, __LINE__);
     }
 
@@ -77,6 +83,7 @@ namespace VO {
     void VBO::setupSubData(const std::vector<T>& vertices, GLintptr offset) {
         glBindBuffer(GL_ARRAY_BUFFER, id);
         glBufferSubData(GL_ARRAY_BUFFER, offset, vertices.size() * sizeof(T), vertices.data());
+        RenderStats::RecordUpload(vertices.size() * sizeof(T));
         glCheckError(__FILE__, __LINE__);
     }
 
@@ -119,7 +126,7 @@ namespace VO {
 
     VAO::~VAO() {
         if (id) {
-            glDeleteVertexArrays(1, &id);
+            GLStateCache::DeleteVertexArrays(1, &id);
         }
     }
 
@@ -133,7 +140,7 @@ namespace VO {
     VAO& VAO::operator=(VAO &&other) noexcept {
         if (this != &other) {
             if (id) {
-                glDeleteVertexArrays(1, &id);
+                GLStateCache::DeleteVertexArrays(1, &id);
             }
             id = std::exchange(other.id, 0);
             Positions = std::move(other.Positions);
@@ -151,7 +158,7 @@ namespace VO {
     }
 
     int VAO::bind() const {
-        glBindVertexArray(id);
+        GLStateCache::BindVertexArray(id);
         return Indices.size();
     }
 
@@ -191,7 +198,7 @@ namespace VO {
     }
 
     void VAO::unbind() const {
-        glBindVertexArray(0);
+        GLStateCache::BindVertexArray(0);
     }
 
     EBO::~EBO() {
@@ -219,11 +226,13 @@ namespace VO {
     void EBO::setup(const void* indices, GLsizei size) {
         bind();
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
+        RenderStats::RecordUpload(size);
         glCheckError(__FILE__, __LINE__);
     }
     void EBO::setup(const std::vector<uint32_t>& indices) {
         bind();
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        RenderStats::RecordUpload(indices.size() * sizeof(uint32_t));
         glCheckError(__FILE__, __LINE__);
     }
 
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <functional>
 #include <memory>
+#include "../GLStateCache.h"
 class Mirror {
 private:
     std::unique_ptr<Framebuffer> m_mirrorFramebuffer;
@@ -87,13 +88,13 @@ public:
         }
         
         // Save current state
-        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
-        GLboolean blend = glIsEnabled(GL_BLEND);
+        GLboolean depthTest = GLStateCache::IsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = GLStateCache::IsEnabled(GL_BLEND);
         
         // Set up for 2D rendering
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLStateCache::Disable(GL_DEPTH_TEST);
+        GLStateCache::Enable(GL_BLEND);
+        GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         
         // Use mirror shader
         m_mirrorShader.Use();
@@ -110,7 +111,7 @@ public:
         m_mirrorShader.SetVector2f("u_size", size);
         
         // Bind mirror texture to texture unit 0
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::ActiveTexture(GL_TEXTURE0);
         m_mirrorFramebuffer->bindColorTexture(0);
         m_mirrorShader.SetInteger("mirrorTexture", 0);
         
@@ -118,8 +119,8 @@ public:
         m_quad->draw();
         
         // Restore state
-        if (depthTest) glEnable(GL_DEPTH_TEST);
-        if (!blend) glDisable(GL_BLEND);
+        if (depthTest) GLStateCache::Enable(GL_DEPTH_TEST);
+        if (!blend) GLStateCache::Disable(GL_BLEND);
     }
     
 private:
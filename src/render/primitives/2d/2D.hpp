@@ -3,6 +3,7 @@
 
 #include "render/Vertex.h"
 #include <glm/glm.hpp>
+#include "render/RenderStats.h"
 
 namespace VO {
 class Quad {
@@ -51,6 +52,7 @@ public:
     void draw() {
         m_vao.bind();
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        RenderStats::RecordDraw(GL_TRIANGLES, 6);
         m_vao.unbind();
     }
 };
@@ -90,6 +92,7 @@ public:
     void draw() {
         m_vao.bind();
         glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::RecordDraw(GL_TRIANGLES, 3);
         m_vao.unbind();
     }
 };
@@ -131,6 +134,7 @@ public:
     void draw() {
         m_vao.bind();
         glDrawArrays(GL_LINES, 0, 2);
+        RenderStats::RecordDraw(GL_LINES, 2);
         m_vao.unbind();
     }
 };
@@ -3,6 +3,7 @@
 
 #include "PrimitiveShape.h"
 #include "../Shader.h"
+#include "../GLStateCache.h"
 
 namespace m3D {
 
@@ -10,7 +11,7 @@ namespace m3D {
 unsigned int createColorTexture(float r, float g, float b) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, textureID);
     
     // Create a simple 1x1 color texture
     unsigned char data[] = {
@@ -64,7 +65,7 @@ void PrimitiveShape::Draw(Shader& shader) {
         }
     }
     
-    mesh->Draw(shader);
+    mesh->Draw(shader, mesh->SelectLod(GetModelMatrix(), currentLod));
 }
 
 std::vector<Texture> PrimitiveShape::createColorTextures() {
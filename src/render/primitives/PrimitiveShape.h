@@ -27,6 +27,7 @@ protected:
     glm::vec3 color;
     std::map<std::string, float> materialProperties;
     Shader* customShader = nullptr;
+    uint8_t currentLod = 0; // level of detail drawn last frame
     std::map<std::string, glm::vec3> shaderVec3Params;
     std::map<std::string, float> shaderFloatParams;
     
@@ -59,6 +60,7 @@ public:
     // Shader management
     void setCustomShader(Shader* shader);
     Shader* getShader() const override;
+    AABB GetLocalBounds() const override { return mesh ? mesh->bounds : AABB(); }
     void setShaderVec3(const std::string& name, const glm::vec3& value);
     void setShaderFloat(const std::string& name, float value);
     
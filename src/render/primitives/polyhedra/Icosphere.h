@@ -121,8 +121,8 @@ public:
         std::cout << "Creating icosphere mesh with " << vertices.size() << " vertices and " 
                   << indices.size() << " indices" << std::endl;
         
-        // Create the mesh
-        mesh = std::make_shared<Mesh>(vertices, indices, textures);
+        // Create the mesh, with simplified levels for when it is small on screen
+        mesh = std::make_shared<Mesh>(vertices, indices, textures, Mesh::BuildLods(vertices, indices));
         std::cout << "Icosphere mesh created successfully" << std::endl;
     }
     
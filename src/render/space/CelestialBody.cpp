@@ -1,6 +1,7 @@
 #include "CelestialBody.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include "../GLStateCache.h"
 #define PI 3.14159265359f
 
 CelestialBody::CelestialBody(float mass, float radius, float rotationPeriod, float axialTilt, std::shared_ptr<m3D::Mesh> mesh)
@@ -15,7 +16,7 @@ CelestialBody::CelestialBody(float mass, float radius, float rotationPeriod, flo
 CelestialBody::~CelestialBody() {
     // Clean up OpenGL resources
     if (VAO) {
-        glDeleteVertexArrays(1, &VAO);
+        GLStateCache::DeleteVertexArrays(1, &VAO);
     }
     if (VBO) {
         glDeleteBuffers(1, &VBO);
@@ -32,36 +33,52 @@ void CelestialBody::Update(float deltaTime) {
     }
 }
 
-void CelestialBody::Draw(Shader &shader) {
-    // Save previous state
-    shader.Use();
+float CelestialBody::GetBoundingRadius() const {
+    // The sphere mesh is scaled by the radius; rotation keeps it around the centre
+    if (sphereMesh && sphereMesh->bounds.valid()) {
+        BoundingSphere local = BoundingSphere::fromAABB(sphereMesh->bounds);
+        return radius * (glm::length(local.center) + local.radius);
+    }
+    return radius;
+}
 
-    // Create model matrix
-    glm::mat4 model = glm::mat4(1.0f);
+glm::mat4 CelestialBody::GetModelMatrix() const {
+    // translate * rotateY(currentRotation) * rotateZ(axialTilt) * scale(radius),
+    // written out so the many small bodies skip the generic rotate chain
+    float sinSpin = sinf(currentRotation), cosSpin = cosf(currentRotation);
+    float sinTilt = sinf(axialTilt), cosTilt = cosf(axialTilt);
 
-    // Apply position
-    model = glm::translate(model, position);
+    glm::mat4 model;
+    model[0] = glm::vec4(cosSpin * cosTilt, sinTilt, -sinSpin * cosTilt, 0.0f) * radius;
+    model[1] = glm::vec4(-cosSpin * sinTilt, cosTilt, sinSpin * sinTilt, 0.0f) * radius;
+    model[2] = glm::vec4(sinSpin, 0.0f, cosSpin, 0.0f) * radius;
+    model[3] = glm::vec4(position, 1.0f);
+    return model;
+}
 
-    // Apply axial tilt and rotation
-    model = glm::rotate(model, currentRotation, glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate around Y
-    model = glm::rotate(model, axialTilt, glm::vec3(0.0f, 0.0f, 1.0f));       // Apply axial tilt
+void CelestialBody::GetInstanceData(CelestialInstance& instance) const {
+    instance.model = GetModelMatrix();
+    instance.color = glm::vec4(color, 0.0f);
+    instance.material = glm::vec4(50.0f, 0.0f, 0.5f, 1.0f);
+}
 
-    // Apply scale for radius
-    model = glm::scale(model, glm::vec3(radius));
+void CelestialBody::Draw(Shader &shader) {
+    // Save previous state
+    shader.Use();
 
     // Set model matrix in shader
-    shader.SetMatrix4("model", model);
+    shader.SetMatrix4("model", GetModelMatrix());
 
     // Apply material properties
     SetupMaterial(shader);
 
-    // Draw the sphere
+    // Draw the sphere, as coarse as its size on screen allows
     if (sphereMesh)
-        sphereMesh->Draw(shader);
+        sphereMesh->Draw(shader, SelectLod(*sphereMesh));
     else {
         // Fallback: Draw using VAO/VBO if no model is available
-        glBindVertexArray(VAO);
+        GLStateCache::BindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 0, GL_UNSIGNED_INT, 0); // This needs proper index count
-        glBindVertexArray(0);
+        GLStateCache::BindVertexArray(0);
     }
 }
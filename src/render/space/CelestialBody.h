@@ -8,6 +8,7 @@
 #include <memory>
 #include "render/Shader.h"
 #include "render/Model.h"
+#include "CelestialInstanceBatch.h"
 
 class CelestialBody {
 protected:
@@ -29,6 +30,7 @@ protected:
     // OpenGL rendering data
     unsigned int VAO, VBO;
     std::shared_ptr<m3D::Mesh> sphereMesh; // Shared mesh for rendering
+    uint8_t sphereLod = 0;                 // level of detail of sphereMesh drawn last frame
 
 public:
     CelestialBody(float mass, float radius, float rotationPeriod, float axialTilt, std::shared_ptr<m3D::Mesh> mesh);
@@ -39,6 +41,20 @@ public:
 
     virtual void SetupMaterial(Shader &shader) = 0;
 
+    // World space sphere enclosing everything Draw() renders, for frustum culling
+    virtual float GetBoundingRadius() const;
+
+    // Translation, spin about Y, axial tilt about Z and scale by the radius
+    glm::mat4 GetModelMatrix() const;
+
+    // True if the body is drawn as one instance of the shared sphere batch
+    // instead of through Draw(); bodies with extra geometry or textures are not
+    virtual bool IsInstanceable() const { return false; }
+    // Fills the per instance data equivalent to Draw() + SetupMaterial()
+    virtual void GetInstanceData(CelestialInstance& instance) const;
+    // Level of detail to draw mesh at for this body's size on screen (see LodSelector)
+    int SelectLod(const m3D::Mesh& mesh) { return mesh.SelectLod(GetModelMatrix(), sphereLod); }
+
     // Getters
     glm::vec3 GetPosition() const { return position; }
     glm::vec3 GetVelocity() const { return velocity; }
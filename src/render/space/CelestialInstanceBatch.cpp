@@ -0,0 +1,95 @@
+#include "CelestialInstanceBatch.h"
+#include <cstddef>
+#include "../GLStateCache.h"
+#include "../RenderStats.h"
+
+CelestialInstanceBatch::CelestialInstanceBatch(std::shared_ptr<m3D::Mesh> mesh)
+    : mesh(mesh), vao(0), instanceVBO(0), capacity(1) {
+    if (!mesh || mesh->geometry == INVALID_GEOMETRY)
+        return;
+
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(CelestialInstance), nullptr, GL_STREAM_DRAW);
+
+    // The mesh VAO is shared by the whole GeometryPool page, so the instance
+    // attributes go on a VAO of our own over the same vertex and index buffers
+    vao = GeometryPool::CreateVertexArray(mesh->geometry);
+    GLStateCache::BindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (GLuint location = FIRST_INSTANCE_ATTRIBUTE; location < FIRST_INSTANCE_ATTRIBUTE + 6; location++) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    setInstanceAttributes(0);
+    GLStateCache::BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void CelestialInstanceBatch::setInstanceAttributes(size_t first) {
+    // without base instance (GL 4.2), drawing a later group means moving the pointers
+    const GLsizei stride = sizeof(CelestialInstance);
+    const size_t base = first * sizeof(CelestialInstance);
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribPointer(FIRST_INSTANCE_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void*)(base + offsetof(CelestialInstance, model) + column * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(FIRST_INSTANCE_ATTRIBUTE + 4, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(base + offsetof(CelestialInstance, color)));
+    glVertexAttribPointer(FIRST_INSTANCE_ATTRIBUTE + 5, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(base + offsetof(CelestialInstance, material)));
+}
+
+size_t CelestialInstanceBatch::Size() const {
+    size_t size = 0;
+    for (const auto& level : instances)
+        size += level.size();
+    return size;
+}
+
+CelestialInstanceBatch::~CelestialInstanceBatch() {
+    if (vao) {
+        GLStateCache::DeleteVertexArrays(1, &vao);
+    }
+    if (instanceVBO) {
+        glDeleteBuffers(1, &instanceVBO);
+    }
+}
+
+void CelestialInstanceBatch::Draw(Shader &shader) {
+    const size_t total = Size();
+    if (total == 0 || !vao)
+        return;
+
+    shader.Use();
+
+    // Orphan the old storage so the driver does not stall on last frame's draw,
+    // growing geometrically to avoid reallocating every frame
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    while (capacity < total)
+        capacity *= 2;
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(CelestialInstance), nullptr, GL_STREAM_DRAW);
+    size_t offset = 0;
+    for (const auto& level : instances) {
+        if (level.empty())
+            continue;
+        glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(CelestialInstance), level.size() * sizeof(CelestialInstance),
+                        level.data());
+        offset += level.size();
+    }
+    RenderStats::RecordUpload(total * sizeof(CelestialInstance));
+
+    // one draw per level in use, each from its part of the buffer
+    GLStateCache::BindVertexArray(vao);
+    size_t first = 0;
+    for (int lod = 0; lod < MeshSimplifier::MAX_LODS; lod++) {
+        const size_t count = instances[lod].size();
+        if (count == 0)
+            continue;
+        setInstanceAttributes(first);
+        mesh->DrawElementsInstanced(static_cast<GLsizei>(count), lod);
+        first += count;
+    }
+    GLStateCache::BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
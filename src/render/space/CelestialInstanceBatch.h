@@ -0,0 +1,52 @@
+#ifndef CELESTIAL_INSTANCE_BATCH_H
+#define CELESTIAL_INSTANCE_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include "render/Shader.h"
+#include "render/Model.h"
+
+// Per instance vertex data, read by planet_instanced.vs at locations 7-12
+struct CelestialInstance {
+    glm::mat4 model;     // locations 7-10
+    glm::vec4 color;     // rgb: base colour, a: emission (0 lit, 1 self luminous)
+    glm::vec4 material;  // x: shininess, y: gradient factor, z: specular, w: secondary colour scale
+};
+
+// Draws many celestial bodies that share one sphere mesh with one
+// glDrawElementsInstanced call per level of detail. Bodies are appended every
+// frame, then the whole batch is streamed into the instance buffer, grouped
+// by level, and drawn.
+class CelestialInstanceBatch {
+public:
+    static const GLuint FIRST_INSTANCE_ATTRIBUTE = 7; // after the Mesh vertex attributes
+
+    explicit CelestialInstanceBatch(std::shared_ptr<m3D::Mesh> mesh);
+    ~CelestialInstanceBatch();
+
+    CelestialInstanceBatch(const CelestialInstanceBatch&) = delete;
+    CelestialInstanceBatch& operator=(const CelestialInstanceBatch&) = delete;
+
+    void Clear() { for (auto& level : instances) level.clear(); }
+    // returns the slot for the next instance, drawn with the given level of detail of the mesh
+    CelestialInstance& Add(int lod = 0) { instances[lod].emplace_back(); return instances[lod].back(); }
+    size_t Size() const;
+    const m3D::Mesh& GetMesh() const { return *mesh; }
+
+    // upload the instances and draw them all; the shader must read the instance attributes
+    void Draw(Shader &shader);
+
+private:
+    // points the instance attributes at the instance buffer, starting at instance `first`
+    void setInstanceAttributes(size_t first);
+
+    std::shared_ptr<m3D::Mesh> mesh;
+    std::vector<CelestialInstance> instances[MeshSimplifier::MAX_LODS];
+    unsigned int vao;          // mesh vertex layout plus the instance attributes
+    unsigned int instanceVBO;
+    size_t capacity; // instances the buffer storage can hold
+};
+
+#endif // CELESTIAL_INSTANCE_BATCH_H
@@ -3,6 +3,8 @@
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include "../GLStateCache.h"
+#include "../RenderStats.h"
 
 #define PI 3.14159265359f
 
@@ -21,6 +23,7 @@ Planet::Planet(float mass, float radius, float rotationPeriod, float axialTilt,
       argumentOfPeriapsis(argumentOfPeriapsis), 
       longitudeAscendingNode(longitudeAscendingNode),
       meanAnomalyAtEpoch(meanAnomalyAtEpoch),
+      currentEccentricAnomaly(0.0f),
       totalTime(0.0f),
       hasRings(false), 
       ringTexture(0), 
@@ -41,11 +44,12 @@ Planet::Planet(float mass, float radius, float rotationPeriod, float axialTilt,
     perturbation.relativisticFactor = 0.0f;
     perturbation.externalForce = glm::vec3(0.0f);
     
-    // Set random initial orbital position
-    float randomFactor = static_cast<float>(std::rand()) / RAND_MAX;
-    float meanAnomaly = randomFactor * 2.0f * PI;
-    float eccentricAnomaly = SolveKeplersEquation(meanAnomaly, eccentricity);
-    currentOrbitalAngle = EccentricToTrueAnomaly(eccentricAnomaly, eccentricity);
+    // The elements are fixed, so the orientation is built once: the columns are the
+    // orbital plane axes after the periapsis, ascending node and inclination rotations
+    orbitOrientation = glm::mat3(
+        ApplyFullOrbitalOrientation(RotateAroundY(glm::vec3(1.0f, 0.0f, 0.0f), argumentOfPeriapsis), inclination, longitudeAscendingNode),
+        ApplyFullOrbitalOrientation(RotateAroundY(glm::vec3(0.0f, 1.0f, 0.0f), argumentOfPeriapsis), inclination, longitudeAscendingNode),
+        ApplyFullOrbitalOrientation(RotateAroundY(glm::vec3(0.0f, 0.0f, 1.0f), argumentOfPeriapsis), inclination, longitudeAscendingNode));
     
     // Calculate initial position
     Update(0.0f);
@@ -54,7 +58,7 @@ Planet::Planet(float mass, float radius, float rotationPeriod, float axialTilt,
 Planet::~Planet() {
     // Clean up ring resources
     if (ringVAO) {
-        glDeleteVertexArrays(1, &ringVAO);
+        GLStateCache::DeleteVertexArrays(1, &ringVAO);
     }
     if (ringVBO) {
         glDeleteBuffers(1, &ringVBO);
@@ -63,21 +67,21 @@ Planet::~Planet() {
     // Note: We don't delete satellites because they might be managed elsewhere
 }
 
-float Planet::SolveKeplersEquation(float M, float e, int maxIterations) const {
+float Planet::SolveKeplersEquation(float M, float e, float& sinE, float& cosE, int maxIterations) const {
     // Normalize M to [0, 2π]
     M = fmodf(M, 2.0f * PI);
     if (M < 0) M += 2.0f * PI;
     
-    // Initial guess (improved for high eccentricity)
-    float E = (e < 0.8f) ? M : PI;
+    // Initial guess (improved for high eccentricity); M + e sin M saves Newton steps
+    float E = (e < 0.8f) ? M + e * sinf(M) : PI;
     
     for (int i = 0; i < maxIterations; i++) {
-        float sinE = sinf(E);
-        float cosE = cosf(E);
+        sinE = sinf(E);
+        cosE = cosf(E);
         float f = E - e * sinE - M;
         
-        // Check for convergence
-        if (fabsf(f) < 1e-6f) break;
+        // Check for convergence; E is unchanged, so sinE and cosE are already its own
+        if (fabsf(f) < 1e-6f) return E;
         
         // Newton-Raphson step
         float df = 1.0f - e * cosE;
@@ -87,6 +91,9 @@ float Planet::SolveKeplersEquation(float M, float e, int maxIterations) const {
         E -= (fabsf(dE) > 1.0f) ? copysignf(1.0f, dE) : dE;
     }
     
+    // out of iterations, so the last step moved E past the values computed
+    sinE = sinf(E);
+    cosE = cosf(E);
     return E;
 }
 
@@ -132,28 +139,19 @@ void Planet::Update(float deltaTime) {
     }
     
     // Solve Kepler's equation for eccentric anomaly
-    float eccentricAnomaly = SolveKeplersEquation(meanAnomaly, eccentricity);
+    float sinE, cosE;
+    currentEccentricAnomaly = SolveKeplersEquation(meanAnomaly, eccentricity, sinE, cosE);
     
-    // Convert to true anomaly (current orbital angle)
-    currentOrbitalAngle = EccentricToTrueAnomaly(eccentricAnomaly, eccentricity);
-    
-    // Calculate distance from focus using eccentric anomaly
-    float distance = semiMajorAxis * (1.0f - eccentricity * cosf(eccentricAnomaly));
-    
-    // Position in orbital plane (in the 2D plane of the orbit)
+    // Position in orbital plane straight from the eccentric anomaly: r cos ν = a (cos E - e),
+    // r sin ν = a sqrt(1 - e²) sin E, so the true anomaly is never needed
     glm::vec3 orbitPosition = glm::vec3(
-        distance * cosf(currentOrbitalAngle),
+        semiMajorAxis * (cosE - eccentricity),
         0.0f,
-        distance * sinf(currentOrbitalAngle)
+        semiMajorAxis * sqrtf(1.0f - eccentricity * eccentricity) * sinE
     );
     
-    // Apply argument of periapsis (rotation of ellipse in orbital plane)
-    orbitPosition = RotateAroundY(orbitPosition, argumentOfPeriapsis);
-    
-    // Apply full 3D orientation (inclination + longitude of ascending node)
-    glm::vec3 orientedPosition = ApplyFullOrbitalOrientation(
-        orbitPosition, inclination, longitudeAscendingNode
-    );
+    // Apply periapsis, ascending node and inclination at once
+    glm::vec3 orientedPosition = orbitOrientation * orbitPosition;
     
     // Apply J2 perturbation (oblateness effect) if enabled
     if (perturbation.j2Factor > 0.0f && parent) {
@@ -222,15 +220,34 @@ void Planet::SetupMaterial(Shader &shader) {
     // Planets don't emit light on their own
     shader.SetVector3f("material.emission", glm::vec3(0.0f));
     shader.SetInteger("material.useEmission", 0);
+
+    // Surface gradient used by planet.fs; must match GetInstanceData
+    shader.SetVector3f("baseColor1", color);
+    shader.SetVector3f("baseColor2", color * 0.6f);
+    shader.SetVector3f("highlightColor", glm::vec3(0.5f));
+    shader.SetFloat("shininess", 50.0f);
+    shader.SetFloat("gradientFactor", 0.5f);
+    shader.SetFloat("emission", 0.0f);
     
     // Bind texture if available
     if (texture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        GLStateCache::ActiveTexture(GL_TEXTURE0);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, texture);
         shader.SetInteger("texture_diffuse1", 0);
     }
 }
 
+bool Planet::IsInstanceable() const {
+    // Rings, moons and textures need their own draw calls
+    return !hasRings && satellites.empty() && texture == 0;
+}
+
+void Planet::GetInstanceData(CelestialInstance& instance) const {
+    instance.model = GetModelMatrix();
+    instance.color = glm::vec4(color, 0.0f);
+    instance.material = glm::vec4(50.0f, 0.5f, 0.5f, 0.6f);
+}
+
 void Planet::AddSatellite(CelestialBody* satellite) {
     if (satellite) {
         satellites.push_back(satellite);
@@ -362,12 +379,13 @@ void Planet::SetupRings() {
     glGenVertexArrays(1, &ringVAO);
     glGenBuffers(1, &ringVBO);
     
-    glBindVertexArray(ringVAO);
+    GLStateCache::BindVertexArray(ringVAO);
     glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
     glBufferData(GL_ARRAY_BUFFER, 
                  ringVertices.size() * sizeof(float), 
                  ringVertices.data(), 
                  GL_STATIC_DRAW);
+    RenderStats::RecordUpload(ringVertices.size() * sizeof(float));
     
     // Position attribute
     glEnableVertexAttribArray(0);
@@ -378,7 +396,7 @@ void Planet::SetupRings() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 
                          (void*)(3 * sizeof(float)));
     
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void Planet::RenderRings(Shader &shader) {
@@ -403,26 +421,27 @@ void Planet::RenderRings(Shader &shader) {
     
     // Bind ring texture
     if (ringTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ringTexture);
+        GLStateCache::ActiveTexture(GL_TEXTURE0);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, ringTexture);
         shader.SetInteger("texture_diffuse1", 0);
     }
     
     // Enable alpha blending for rings
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLStateCache::Enable(GL_BLEND);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     // Disable depth writing but keep depth testing
     // (allows rings to be semi-transparent)
-    glDepthMask(GL_FALSE);
+    GLStateCache::DepthMask(GL_FALSE);
     
     // Draw rings
-    glBindVertexArray(ringVAO);
+    GLStateCache::BindVertexArray(ringVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6 * 64); // 6 vertices per segment, 64 segments
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_TRIANGLES, 6 * 64);
+    GLStateCache::BindVertexArray(0);
     
     // Reset OpenGL state
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    GLStateCache::DepthMask(GL_TRUE);
+    GLStateCache::Disable(GL_BLEND);
     shader.SetInteger("isRing", 0);
 }
\ No newline at end of file
@@ -15,7 +15,8 @@ private:
     float argumentOfPeriapsis;       // ω - rotation of ellipse in orbital plane (radians)
     float longitudeAscendingNode;    // Ω - longitude of ascending node (radians)
     float meanAnomalyAtEpoch;        // M₀ - mean anomaly at epoch (radians)
-    float currentOrbitalAngle;       // Current position in orbit (true anomaly, radians)
+    float currentEccentricAnomaly;   // Current position in orbit (eccentric anomaly, radians)
+    glm::mat3 orbitOrientation;      // ω, Ω and i combined, orbital plane to parent space
     
     // Time tracking
     float totalTime;                 // Accumulated time for orbit calculations
@@ -51,6 +52,8 @@ public:
     void Update(float deltaTime) override;
     void Draw(Shader &shader) override;
     void SetupMaterial(Shader &shader) override;
+    bool IsInstanceable() const override;
+    void GetInstanceData(CelestialInstance& instance) const override;
     
     // Planet-specific methods
     void AddSatellite(CelestialBody* satellite);
@@ -65,7 +68,8 @@ public:
     float GetOrbitalPeriod() const { return orbitalPeriod; }
     float GetSemiMajorAxis() const { return semiMajorAxis; }
     float GetEccentricity() const { return eccentricity; }
-    float GetCurrentOrbitalAngle() const { return currentOrbitalAngle; }
+    // true anomaly, derived on demand since Update() only needs the eccentric anomaly
+    float GetCurrentOrbitalAngle() const { return EccentricToTrueAnomaly(currentEccentricAnomaly, eccentricity); }
     
 private:
     // Helper methods
@@ -75,7 +79,8 @@ private:
                                           float longitudeAscendingNode) const;
     
     // Orbital mechanics helpers
-    float SolveKeplersEquation(float M, float e, int iterations = 10) const;
+    // sinE and cosE are left at those of the returned E
+    float SolveKeplersEquation(float M, float e, float& sinE, float& cosE, int iterations = 10) const;
     float EccentricToTrueAnomaly(float E, float e) const;
     
     // Ring rendering
@@ -4,7 +4,10 @@
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <limits>
 #include "asset/ResourceManager.h"
+#include "../GLStateCache.h"
+#include "../RenderStats.h"
 
 // Forward declaration
 static void RenderQuad();
@@ -24,7 +27,8 @@ Star::Star(float mass, float radius, float rotationPeriod, float axialTilt,
       glowVBO(0),
       glowShader(nullptr),
       coronaShader(nullptr),
-      limbDarkeningShader(nullptr) {
+      limbDarkeningShader(nullptr),
+      distant(false) {
     
     // Initialize random seed
     static bool seeded = false;
@@ -55,29 +59,29 @@ Star::Star(float mass, float radius, float rotationPeriod, float axialTilt,
 
 Star::~Star() {
     // Clean up glow effect
-    if (glowVAO) glDeleteVertexArrays(1, &glowVAO);
+    if (glowVAO) GLStateCache::DeleteVertexArrays(1, &glowVAO);
     if (glowVBO) glDeleteBuffers(1, &glowVBO);
     
     // Clean up corona
-    if (corona.coronaVAO) glDeleteVertexArrays(1, &corona.coronaVAO);
+    if (corona.coronaVAO) GLStateCache::DeleteVertexArrays(1, &corona.coronaVAO);
     if (corona.coronaVBO) glDeleteBuffers(1, &corona.coronaVBO);
     
     // Clean up solar wind
-    if (solarWind.particleVAO) glDeleteVertexArrays(1, &solarWind.particleVAO);
+    if (solarWind.particleVAO) GLStateCache::DeleteVertexArrays(1, &solarWind.particleVAO);
     if (solarWind.particleVBO) glDeleteBuffers(1, &solarWind.particleVBO);
     
     // Clean up HDR buffers
-    if (hdrBuffer.FBO) glDeleteFramebuffers(1, &hdrBuffer.FBO);
-    if (hdrBuffer.colorBuffer) glDeleteTextures(1, &hdrBuffer.colorBuffer);
-    if (hdrBuffer.brightBuffer) glDeleteTextures(1, &hdrBuffer.brightBuffer);
+    if (hdrBuffer.FBO) GLStateCache::DeleteFramebuffers(1, &hdrBuffer.FBO);
+    if (hdrBuffer.colorBuffer) GLStateCache::DeleteTextures(1, &hdrBuffer.colorBuffer);
+    if (hdrBuffer.brightBuffer) GLStateCache::DeleteTextures(1, &hdrBuffer.brightBuffer);
     if (hdrBuffer.depthBuffer) glDeleteRenderbuffers(1, &hdrBuffer.depthBuffer);
     
     // Clean up bloom buffers
-    if (bloom.pingpongFBO[0]) glDeleteFramebuffers(2, bloom.pingpongFBO);
-    if (bloom.pingpongBuffer[0]) glDeleteTextures(2, bloom.pingpongBuffer);
+    if (bloom.pingpongFBO[0]) GLStateCache::DeleteFramebuffers(2, bloom.pingpongFBO);
+    if (bloom.pingpongBuffer[0]) GLStateCache::DeleteTextures(2, bloom.pingpongBuffer);
     
     // Clean up textures
-    if (surface.granulationTexture) glDeleteTextures(1, &surface.granulationTexture);
+    if (surface.granulationTexture) GLStateCache::DeleteTextures(1, &surface.granulationTexture);
     
     // Clean up shaders (if owned by this class)
     if (glowShader) delete glowShader;
@@ -242,9 +246,11 @@ void Star::Update(float deltaTime) {
     // Update granulation animation
     surface.granulationTime += deltaTime * surface.granulationSpeed;
     
-    // Update solar wind
-    EmitSolarWind(deltaTime);
-    UpdateSolarWind(deltaTime);
+    // Update solar wind (never rendered for distant stars)
+    if (!distant) {
+        EmitSolarWind(deltaTime);
+        UpdateSolarWind(deltaTime);
+    }
 }
 
 void Star::UpdateSunspots(float deltaTime) {
@@ -410,15 +416,15 @@ void Star::SetupMaterial(Shader &shader) {
     
     // Bind surface texture (if available)
     if (texture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        GLStateCache::ActiveTexture(GL_TEXTURE0);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, texture);
         shader.SetInteger("texture_diffuse1", 0);
     }
     
     // Bind granulation texture
     if (surface.granulationTexture) {
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, surface.granulationTexture);
+        GLStateCache::ActiveTexture(GL_TEXTURE1);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, surface.granulationTexture);
         shader.SetInteger("granulationMap", 1);
         shader.SetFloat("granulationTime", surface.granulationTime);
     }
@@ -433,11 +439,26 @@ void Star::SetupMaterial(Shader &shader) {
     }
 }
 
+float Star::GetBoundingRadius() const {
+    if (distant)
+        return CelestialBody::GetBoundingRadius();
+    // Solar wind particles fly arbitrarily far, so a star with wind is never culled
+    if (!solarWind.particles.empty())
+        return std::numeric_limits<float>::infinity();
+    // the glow is a camera facing quad, its corners reach sqrt(2) * scale
+    float glowScale = radius * (2.5f + luminosity * 0.5f) * 1.4142f;
+    return glm::max(CelestialBody::GetBoundingRadius(), glm::max(glowScale, corona.outerRadius));
+}
+
 void Star::Draw(Shader &shader) {
     // Simplified rendering to prevent GPU overload
     // Draw the star with limb darkening
     RenderLimbDarkening(shader);
 
+    if (distant) {
+        return;
+    }
+
     // Draw glow effect
     if (glowShader && glowVAO != 0) {
         RenderGlowEffect(shader);
@@ -454,16 +475,23 @@ void Star::Draw(Shader &shader) {
     // ApplyBloom();
 }
 
+void Star::GetInstanceData(CelestialInstance& instance) const {
+    // Self luminous: the shader outputs the colour without lighting
+    instance.model = GetModelMatrix();
+    instance.color = glm::vec4(color, 1.0f);
+    instance.material = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+}
+
 void Star::RenderWithHDR(Shader &shader) {
     // Bind HDR framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrBuffer.FBO);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, hdrBuffer.FBO);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     // Render star to HDR buffer
     // (actual rendering happens in other methods)
     
     // Unbind
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void Star::RenderLimbDarkening(Shader &shader) {
@@ -499,9 +527,10 @@ void Star::SetupGlowEffect() {
     glGenVertexArrays(1, &glowVAO);
     glGenBuffers(1, &glowVBO);
     
-    glBindVertexArray(glowVAO);
+    GLStateCache::BindVertexArray(glowVAO);
     glBindBuffer(GL_ARRAY_BUFFER, glowVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(glowVertices), glowVertices, GL_STATIC_DRAW);
+    RenderStats::RecordUpload(sizeof(glowVertices));
     
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
@@ -510,7 +539,7 @@ void Star::SetupGlowEffect() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 
                          (void*)(3 * sizeof(float)));
     
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
     
     // Load shader
     try {
@@ -553,15 +582,16 @@ void Star::SetupCorona() {
     glGenVertexArrays(1, &corona.coronaVAO);
     glGenBuffers(1, &corona.coronaVBO);
     
-    glBindVertexArray(corona.coronaVAO);
+    GLStateCache::BindVertexArray(corona.coronaVAO);
     glBindBuffer(GL_ARRAY_BUFFER, corona.coronaVBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), 
                  vertices.data(), GL_STATIC_DRAW);
+    RenderStats::RecordUpload(vertices.size() * sizeof(float));
     
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
     
     // Load corona shader
     try {
@@ -580,7 +610,7 @@ void Star::SetupSolarWind() {
     glGenVertexArrays(1, &solarWind.particleVAO);
     glGenBuffers(1, &solarWind.particleVBO);
     
-    glBindVertexArray(solarWind.particleVAO);
+    GLStateCache::BindVertexArray(solarWind.particleVAO);
     glBindBuffer(GL_ARRAY_BUFFER, solarWind.particleVBO);
     
     // Allocate buffer for max particles (position + color)
@@ -596,7 +626,7 @@ void Star::SetupSolarWind() {
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(float), 
                          (void*)(3 * sizeof(float)));
     
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
 }
 
 void Star::SetupHDR(int width, int height) {
@@ -605,11 +635,11 @@ void Star::SetupHDR(int width, int height) {
     
     // Create framebuffer
     glGenFramebuffers(1, &hdrBuffer.FBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrBuffer.FBO);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, hdrBuffer.FBO);
     
     // HDR color buffer
     glGenTextures(1, &hdrBuffer.colorBuffer);
-    glBindTexture(GL_TEXTURE_2D, hdrBuffer.colorBuffer);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, hdrBuffer.colorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 
                  0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -621,7 +651,7 @@ void Star::SetupHDR(int width, int height) {
     
     // Bright areas buffer (for bloom extraction)
     glGenTextures(1, &hdrBuffer.brightBuffer);
-    glBindTexture(GL_TEXTURE_2D, hdrBuffer.brightBuffer);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, hdrBuffer.brightBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 
                  0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -647,7 +677,7 @@ void Star::SetupHDR(int width, int height) {
         // Handle error
     }
     
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void Star::SetupBloom(int width, int height) {
@@ -656,8 +686,8 @@ void Star::SetupBloom(int width, int height) {
     glGenTextures(2, bloom.pingpongBuffer);
     
     for (int i = 0; i < 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, bloom.pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, bloom.pingpongBuffer[i]);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, bloom.pingpongFBO[i]);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, bloom.pingpongBuffer[i]);
         
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 
                      0, GL_RGBA, GL_FLOAT, NULL);
@@ -670,7 +700,7 @@ void Star::SetupBloom(int width, int height) {
                               GL_TEXTURE_2D, bloom.pingpongBuffer[i], 0);
     }
     
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
     
     // Load blur shader
     try {
@@ -728,7 +758,7 @@ void Star::GenerateGranulation() {
     
     // Create OpenGL texture
     glGenTextures(1, &surface.granulationTexture);
-    glBindTexture(GL_TEXTURE_2D, surface.granulationTexture);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, surface.granulationTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureSize, textureSize, 
                  0, GL_RGB, GL_FLOAT, pixels.data());
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -742,9 +772,9 @@ void Star::RenderGlowEffect(Shader &mainShader) {
     if (!glowShader || glowVAO == 0) return;
     
     // Enable additive blending
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    glDepthMask(GL_FALSE);
+    GLStateCache::Enable(GL_BLEND);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    GLStateCache::DepthMask(GL_FALSE);
     
     glowShader->Use();
     
@@ -761,23 +791,24 @@ void Star::RenderGlowEffect(Shader &mainShader) {
     glowShader->SetFloat("glowIntensity", luminosity);
     
     // Draw glow quad
-    glBindVertexArray(glowVAO);
+    GLStateCache::BindVertexArray(glowVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_TRIANGLES, 6);
+    GLStateCache::BindVertexArray(0);
     
     // Restore state
-    glDepthMask(GL_TRUE);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_BLEND);
+    GLStateCache::DepthMask(GL_TRUE);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLStateCache::Disable(GL_BLEND);
 }
 
 void Star::RenderCorona(Shader &mainShader) {
     if (!coronaShader || corona.coronaVAO == 0) return;
     
     // Enable additive blending for corona
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    glDepthMask(GL_FALSE);
+    GLStateCache::Enable(GL_BLEND);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    GLStateCache::DepthMask(GL_FALSE);
     
     coronaShader->Use();
     
@@ -797,14 +828,15 @@ void Star::RenderCorona(Shader &mainShader) {
         coronaShader->SetFloat("coronaTemperature", corona.temperature);
         
         // Draw sphere
-        glBindVertexArray(corona.coronaVAO);
+        GLStateCache::BindVertexArray(corona.coronaVAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, (36 + 1) * (18 + 1));
-        glBindVertexArray(0);
+        RenderStats::RecordDraw(GL_TRIANGLE_STRIP, (36 + 1) * (18 + 1));
+        GLStateCache::BindVertexArray(0);
     }
     
     // Restore state
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    GLStateCache::DepthMask(GL_TRUE);
+    GLStateCache::Disable(GL_BLEND);
 }
 
 void Star::RenderSolarWind(Shader &mainShader) {
@@ -833,27 +865,29 @@ void Star::RenderSolarWind(Shader &mainShader) {
     glBufferSubData(GL_ARRAY_BUFFER, 0, 
                     particleData.size() * sizeof(float), 
                     particleData.data());
+    RenderStats::RecordUpload(particleData.size() * sizeof(float));
     
     // Enable additive blending for particles
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    glDepthMask(GL_FALSE);
+    GLStateCache::Enable(GL_BLEND);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    GLStateCache::DepthMask(GL_FALSE);
     
     // Enable point sprites
-    glEnable(GL_PROGRAM_POINT_SIZE);
+    GLStateCache::Enable(GL_PROGRAM_POINT_SIZE);
     
     mainShader.Use();
     mainShader.SetMatrix4("model", glm::mat4(1.0f)); // Identity for world space
     
     // Draw particles
-    glBindVertexArray(solarWind.particleVAO);
+    GLStateCache::BindVertexArray(solarWind.particleVAO);
     glDrawArrays(GL_POINTS, 0, (GLsizei)solarWind.particles.size());
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_POINTS, (GLsizei)solarWind.particles.size());
+    GLStateCache::BindVertexArray(0);
     
     // Restore state
-    glDisable(GL_PROGRAM_POINT_SIZE);
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    GLStateCache::Disable(GL_PROGRAM_POINT_SIZE);
+    GLStateCache::DepthMask(GL_TRUE);
+    GLStateCache::Disable(GL_BLEND);
 }
 
 void Star::ApplyBloom() {
@@ -866,12 +900,12 @@ void Star::ApplyBloom() {
     bloom.blurShader->Use();
     
     for (int i = 0; i < bloom.blurPasses * 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, bloom.pingpongFBO[horizontal]);
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, bloom.pingpongFBO[horizontal]);
         bloom.blurShader->SetInteger("horizontal", horizontal);
         
         // Bind texture from previous pass
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, firstIteration ? 
+        GLStateCache::ActiveTexture(GL_TEXTURE0);
+        GLStateCache::BindTexture(GL_TEXTURE_2D, firstIteration ? 
                      hdrBuffer.brightBuffer : bloom.pingpongBuffer[!horizontal]);
         
         // Render full-screen quad
@@ -881,17 +915,17 @@ void Star::ApplyBloom() {
         if (firstIteration) firstIteration = false;
     }
     
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
     
     // Second pass: Combine original HDR scene with blurred bloom
     bloom.bloomShader->Use();
     
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrBuffer.colorBuffer);
+    GLStateCache::ActiveTexture(GL_TEXTURE0);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, hdrBuffer.colorBuffer);
     bloom.bloomShader->SetInteger("hdrScene", 0);
     
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, bloom.pingpongBuffer[!horizontal]);
+    GLStateCache::ActiveTexture(GL_TEXTURE1);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, bloom.pingpongBuffer[!horizontal]);
     bloom.bloomShader->SetInteger("bloomBlur", 1);
     
     bloom.bloomShader->SetFloat("exposure", 1.0f);
@@ -920,9 +954,10 @@ static void RenderQuad() {
         
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        GLStateCache::BindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+        RenderStats::RecordUpload(sizeof(quadVertices));
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
         glEnableVertexAttribArray(1);
@@ -930,9 +965,10 @@ static void RenderQuad() {
                              (void*)(2 * sizeof(float)));
     }
     
-    glBindVertexArray(quadVAO);
+    GLStateCache::BindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    RenderStats::RecordDraw(GL_TRIANGLES, 6);
+    GLStateCache::BindVertexArray(0);
 }
 
 float Star::PerlinNoise(float x, float y) const {
@@ -122,6 +122,9 @@ private:
     Shader* coronaShader;
     Shader* limbDarkeningShader;
 
+    // Distant stars are drawn as plain emissive spheres, without glow, corona or wind
+    bool distant;
+
 public:
     Star(float mass, float radius, float rotationPeriod, float axialTilt, 
          float luminosity, float temperature, std::shared_ptr<m3D::Mesh> mesh);
@@ -131,6 +134,12 @@ public:
     void Update(float deltaTime) override;
     void SetupMaterial(Shader &shader) override;
     void Draw(Shader &shader) override;
+    float GetBoundingRadius() const override;
+    bool IsInstanceable() const override { return distant; }
+    void GetInstanceData(CelestialInstance& instance) const override;
+
+    void SetDistant(bool value) { distant = value; }
+    bool IsDistant() const { return distant; }
     
     // Getters
     float GetLuminosity() const { return luminosity; }
@@ -0,0 +1,413 @@
+#include "BVH.h"
+#include <algorithm>
+#include <queue>
+#include <cmath>
+
+namespace {
+    AABB merged(const AABB& a, const AABB& b) {
+        AABB result;
+        result.min = glm::min(a.min, b.min);
+        result.max = glm::max(a.max, b.max);
+        return result;
+    }
+
+    // surface area heuristic cost of a box
+    float area(const AABB& box) {
+        glm::vec3 d = box.max - box.min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool contains(const AABB& outer, const AABB& inner) {
+        return glm::all(glm::lessThanEqual(outer.min, inner.min)) &&
+               glm::all(glm::lessThanEqual(inner.max, outer.max));
+    }
+
+    bool overlaps(const AABB& a, const AABB& b) {
+        return glm::all(glm::lessThanEqual(a.min, b.max)) &&
+               glm::all(glm::lessThanEqual(b.min, a.max));
+    }
+
+    float distanceSquared(const AABB& box, const glm::vec3& point) {
+        glm::vec3 d = glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    // slab test; returns the entry distance or a negative value on a miss
+    float rayDistance(const AABB& box, const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance) {
+        glm::vec3 t1 = (box.min - origin) * invDirection;
+        glm::vec3 t2 = (box.max - origin) * invDirection;
+        glm::vec3 tNear = glm::min(t1, t2);
+        glm::vec3 tFar = glm::max(t1, t2);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        return enter <= exit ? enter : -1.0f;
+    }
+}
+
+BVH::BVH(float margin) : margin(margin) { }
+
+int BVH::allocateNode() {
+    if (freeList == NULL_NODE) {
+        nodes.emplace_back();
+        nodes.back().height = 0;
+        return static_cast<int>(nodes.size() - 1);
+    }
+    // free nodes are chained through their parent index
+    int node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node] = Node();
+    nodes[node].height = 0;
+    return node;
+}
+
+void BVH::freeNode(int node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+int BVH::insert(const AABB& box, uint32_t userData) {
+    int proxy = allocateNode();
+    nodes[proxy].tight = box;
+    nodes[proxy].box.min = box.min - glm::vec3(margin);
+    nodes[proxy].box.max = box.max + glm::vec3(margin);
+    nodes[proxy].userData = userData;
+    insertLeaf(proxy);
+    leafCount++;
+    return proxy;
+}
+
+void BVH::remove(int proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    leafCount--;
+}
+
+bool BVH::move(int proxy, const AABB& box) {
+    nodes[proxy].tight = box;
+    if (contains(nodes[proxy].box, box)) {
+        return false;
+    }
+    removeLeaf(proxy);
+    nodes[proxy].box.min = box.min - glm::vec3(margin);
+    nodes[proxy].box.max = box.max + glm::vec3(margin);
+    insertLeaf(proxy);
+    return true;
+}
+
+void BVH::clear() {
+    nodes.clear();
+    root = NULL_NODE;
+    freeList = NULL_NODE;
+    leafCount = 0;
+}
+
+void BVH::insertLeaf(int leaf) {
+    if (root == NULL_NODE) {
+        root = leaf;
+        nodes[root].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down towards the cheapest sibling for the new leaf
+    const AABB leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].isLeaf()) {
+        const Node& node = nodes[index];
+        float nodeArea = area(node.box);
+        float combinedArea = area(merged(node.box, leafBox));
+
+        // cost of making a new parent for this node and the leaf
+        float cost = 2.0f * combinedArea;
+        // minimum cost of pushing the leaf further down
+        float inheritance = 2.0f * (combinedArea - nodeArea);
+
+        float childCost[2];
+        int children[2] = { node.child1, node.child2 };
+        for (int i = 0; i < 2; i++) {
+            const Node& child = nodes[children[i]];
+            float enlarged = area(merged(leafBox, child.box));
+            childCost[i] = (child.isLeaf() ? enlarged : enlarged - area(child.box)) + inheritance;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1]) {
+            break;
+        }
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = merged(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE) {
+        if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        } else {
+            nodes[oldParent].child2 = newParent;
+        }
+    } else {
+        root = newParent;
+    }
+
+    refitAncestors(nodes[leaf].parent);
+}
+
+void BVH::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = NULL_NODE;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent != NULL_NODE) {
+        // Replace the parent by the sibling and shrink the ancestors
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        } else {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refitAncestors(grandParent);
+    } else {
+        root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        freeNode(parent);
+    }
+}
+
+void BVH::refitAncestors(int index) {
+    while (index != NULL_NODE) {
+        index = balance(index);
+        Node& node = nodes[index];
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        node.box = merged(nodes[node.child1].box, nodes[node.child2].box);
+        index = node.parent;
+    }
+}
+
+// Rotates the taller grandchild up if the subtrees of iA differ by more than one level
+int BVH::balance(int iA) {
+    Node* A = &nodes[iA];
+    if (A->isLeaf() || A->height < 2) {
+        return iA;
+    }
+
+    int iB = A->child1;
+    int iC = A->child2;
+    Node* B = &nodes[iB];
+    Node* C = &nodes[iC];
+    int difference = C->height - B->height;
+
+    if (difference > 1) {
+        // Rotate C up
+        int iF = C->child1;
+        int iG = C->child2;
+        Node* F = &nodes[iF];
+        Node* G = &nodes[iG];
+
+        C->child1 = iA;
+        C->parent = A->parent;
+        A->parent = iC;
+        if (C->parent != NULL_NODE) {
+            if (nodes[C->parent].child1 == iA) {
+                nodes[C->parent].child1 = iC;
+            } else {
+                nodes[C->parent].child2 = iC;
+            }
+        } else {
+            root = iC;
+        }
+
+        if (F->height > G->height) {
+            C->child2 = iF;
+            A->child2 = iG;
+            G->parent = iA;
+            A->box = merged(B->box, G->box);
+            C->box = merged(A->box, F->box);
+            A->height = 1 + std::max(B->height, G->height);
+            C->height = 1 + std::max(A->height, F->height);
+        } else {
+            C->child2 = iG;
+            A->child2 = iF;
+            F->parent = iA;
+            A->box = merged(B->box, F->box);
+            C->box = merged(A->box, G->box);
+            A->height = 1 + std::max(B->height, F->height);
+            C->height = 1 + std::max(A->height, G->height);
+        }
+        return iC;
+    }
+
+    if (difference < -1) {
+        // Rotate B up
+        int iD = B->child1;
+        int iE = B->child2;
+        Node* D = &nodes[iD];
+        Node* E = &nodes[iE];
+
+        B->child1 = iA;
+        B->parent = A->parent;
+        A->parent = iB;
+        if (B->parent != NULL_NODE) {
+            if (nodes[B->parent].child1 == iA) {
+                nodes[B->parent].child1 = iB;
+            } else {
+                nodes[B->parent].child2 = iB;
+            }
+        } else {
+            root = iB;
+        }
+
+        if (D->height > E->height) {
+            B->child2 = iD;
+            A->child1 = iE;
+            E->parent = iA;
+            A->box = merged(C->box, E->box);
+            B->box = merged(A->box, D->box);
+            A->height = 1 + std::max(C->height, E->height);
+            B->height = 1 + std::max(A->height, D->height);
+        } else {
+            B->child2 = iE;
+            A->child1 = iD;
+            D->parent = iA;
+            A->box = merged(C->box, D->box);
+            B->box = merged(A->box, E->box);
+            A->height = 1 + std::max(C->height, D->height);
+            B->height = 1 + std::max(A->height, E->height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const {
+    if (root == NULL_NODE) return;
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.isLeaf()) {
+            if (frustum.intersects(node.tight)) out.push_back(node.userData);
+        } else if (frustum.intersects(node.box)) {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+void BVH::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const {
+    if (root == NULL_NODE) return;
+    const float radiusSquared = radius * radius;
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.isLeaf()) {
+            if (distanceSquared(node.tight, center) <= radiusSquared) out.push_back(node.userData);
+        } else if (distanceSquared(node.box, center) <= radiusSquared) {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+void BVH::queryAABB(const AABB& box, std::vector<uint32_t>& out) const {
+    if (root == NULL_NODE) return;
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.isLeaf()) {
+            if (overlaps(node.tight, box)) out.push_back(node.userData);
+        } else if (overlaps(node.box, box)) {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+bool BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BVHHit& hit) const {
+    float length = glm::length(direction);
+    if (root == NULL_NODE || length <= 0.0f) return false;
+
+    // Distances are measured along the normalized direction; a zero component
+    // gives an infinite inverse, which the slab test handles
+    glm::vec3 invDirection = glm::vec3(length) / direction;
+    float best = maxDistance;
+    bool found = false;
+
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.isLeaf()) {
+            float t = rayDistance(node.tight, origin, invDirection, best);
+            if (t >= 0.0f) {
+                best = t;
+                hit.userData = node.userData;
+                hit.distance = t;
+                found = true;
+            }
+        } else if (rayDistance(node.box, origin, invDirection, best) >= 0.0f) {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+    return found;
+}
+
+void BVH::nearest(const glm::vec3& point, size_t k, std::vector<BVHHit>& out) const {
+    if (root == NULL_NODE || k == 0) return;
+
+    using Entry = std::pair<float, int>; // squared distance, node
+    // nodes to visit, closest first
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    // best leaves so far, farthest on top so it can be replaced
+    std::priority_queue<Entry> best;
+
+    open.push({distanceSquared(nodes[root].box, point), root});
+    while (!open.empty()) {
+        Entry entry = open.top();
+        open.pop();
+        if (best.size() == k && entry.first > best.top().first) {
+            break; // nothing left can beat the current k-th candidate
+        }
+        const Node& node = nodes[entry.second];
+        if (node.isLeaf()) {
+            float d = distanceSquared(node.tight, point);
+            if (best.size() < k) {
+                best.push({d, entry.second});
+            } else if (d < best.top().first) {
+                best.pop();
+                best.push({d, entry.second});
+            }
+        } else {
+            open.push({distanceSquared(nodes[node.child1].box, point), node.child1});
+            open.push({distanceSquared(nodes[node.child2].box, point), node.child2});
+        }
+    }
+
+    size_t first = out.size();
+    out.resize(first + best.size());
+    for (size_t i = out.size(); i-- > first; best.pop()) {
+        out[i].userData = nodes[best.top().second].userData;
+        out[i].distance = std::sqrt(best.top().first);
+    }
+}
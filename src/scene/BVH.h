@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../render/Frustum.h"
+
+// Leaf reported by the distance based queries
+struct BVHHit {
+    uint32_t userData = 0;
+    float distance = 0.0f; // along the ray, or from the query point to the box
+};
+
+// Dynamic AABB tree. Leaves keep the exact box of their item and a fattened
+// copy used by the tree, so small moves refit without touching the tree;
+// larger moves remove and reinsert the leaf. Insertion picks the sibling with
+// the lowest surface area cost and the tree is rebalanced with rotations on
+// the way back up, so it stays shallow under incremental updates.
+class BVH {
+public:
+    static const int NULL_NODE = -1;
+
+    // margin: how far (in world units) leaf boxes are fattened on each side
+    explicit BVH(float margin = 0.1f);
+
+    int  insert(const AABB& box, uint32_t userData);
+    void remove(int proxy);
+    // returns true if the leaf left its fat box and was reinserted
+    bool move(int proxy, const AABB& box);
+    void clear();
+
+    uint32_t    getUserData(int proxy) const { return nodes[proxy].userData; }
+    const AABB& getBounds(int proxy) const { return nodes[proxy].tight; }
+    size_t      size() const { return leafCount; }
+    int         height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+    // Queries append the user data of every matching leaf
+    void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+    void queryAABB(const AABB& box, std::vector<uint32_t>& out) const;
+    // closest leaf box hit by the ray; direction does not need to be normalized
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BVHHit& hit) const;
+    // the k leaves closest to the point, nearest first
+    void nearest(const glm::vec3& point, size_t k, std::vector<BVHHit>& out) const;
+
+private:
+    struct Node {
+        AABB box;             // fat box for leaves, union of the children otherwise
+        AABB tight;           // leaves only
+        int parent = NULL_NODE;
+        int child1 = NULL_NODE;
+        int child2 = NULL_NODE;
+        int height = -1;      // 0 for leaves, -1 for free nodes
+        uint32_t userData = 0;
+
+        bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    int  allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int  balance(int node);
+    void refitAncestors(int node);
+
+    std::vector<Node> nodes;
+    int root = NULL_NODE;
+    int freeList = NULL_NODE;
+    size_t leafCount = 0;
+    float margin;
+
+    // traversal stack reused between queries
+    mutable std::vector<int> stack;
+};
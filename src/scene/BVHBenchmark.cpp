@@ -0,0 +1,130 @@
+#include "BVHBenchmark.h"
+#include "BVH.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    AABB boxAround(const glm::vec3& center, float halfSize) {
+        AABB box;
+        box.min = center - glm::vec3(halfSize);
+        box.max = center + glm::vec3(halfSize);
+        return box;
+    }
+}
+
+int runBVHBenchmark() {
+    const size_t counts[] = { 10000, 50000, 100000 };
+    const float worldHalfSize = 1000.0f;
+    const int queries = 1000;
+
+    // fixed seed so runs are comparable
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coordinate(-worldHalfSize, worldHalfSize);
+    std::uniform_real_distribution<float> size(0.5f, 4.0f);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::printf("%8s %9s %9s %9s %9s %9s %9s %9s %9s %7s\n", "objects", "build ms", "refit ms", "frustum", "linear",
+                "ray", "sphere", "knn(8)", "visible", "height");
+
+    for (size_t count : counts) {
+        std::vector<AABB> boxes(count);
+        std::vector<float> halfSizes(count);
+        for (size_t i = 0; i < count; i++) {
+            halfSizes[i] = size(rng);
+            boxes[i] = boxAround(glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng)), halfSizes[i]);
+        }
+
+        BVH tree(0.5f);
+        std::vector<int> proxies(count);
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            proxies[i] = tree.insert(boxes[i], static_cast<uint32_t>(i));
+        }
+        double buildMs = millisecondsSince(start);
+
+        // Everything jitters a little, one in ten objects jumps somewhere else
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 center = boxes[i].center() + glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+            if (i % 10 == 0) {
+                center = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+            }
+            boxes[i] = boxAround(center, halfSizes[i]);
+        }
+        start = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            tree.move(proxies[i], boxes[i]);
+        }
+        double refitMs = millisecondsSince(start);
+
+        // Frusta from random cameras looking into the world
+        std::vector<Frustum> frusta(queries);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+        for (Frustum& frustum : frusta) {
+            glm::vec3 eye(coordinate(rng), coordinate(rng), coordinate(rng));
+            glm::vec3 forward(unit(rng), unit(rng), unit(rng));
+            if (glm::length(forward) < 0.01f) forward = glm::vec3(0.0f, 0.0f, -1.0f);
+            frustum.extract(projection * glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+
+        std::vector<uint32_t> results;
+        size_t visible = 0;
+        start = Clock::now();
+        for (const Frustum& frustum : frusta) {
+            results.clear();
+            tree.queryFrustum(frustum, results);
+            visible += results.size();
+        }
+        double frustumMs = millisecondsSince(start) / queries;
+
+        size_t linearVisible = 0;
+        start = Clock::now();
+        for (const Frustum& frustum : frusta) {
+            for (const AABB& box : boxes) {
+                linearVisible += frustum.intersects(box) ? 1 : 0;
+            }
+        }
+        double linearMs = millisecondsSince(start) / queries;
+        if (linearVisible != visible) {
+            std::printf("BVH frustum query mismatch: %zu vs %zu linear\n", visible, linearVisible);
+            return 1;
+        }
+
+        BVHHit hit;
+        start = Clock::now();
+        for (int q = 0; q < queries; q++) {
+            glm::vec3 origin(coordinate(rng), coordinate(rng), coordinate(rng));
+            tree.raycast(origin, glm::vec3(unit(rng), unit(rng), unit(rng)), 2.0f * worldHalfSize, hit);
+        }
+        double rayMs = millisecondsSince(start) / queries;
+
+        start = Clock::now();
+        for (int q = 0; q < queries; q++) {
+            results.clear();
+            tree.querySphere(glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng)), 50.0f, results);
+        }
+        double sphereMs = millisecondsSince(start) / queries;
+
+        std::vector<BVHHit> nearest;
+        start = Clock::now();
+        for (int q = 0; q < queries; q++) {
+            nearest.clear();
+            tree.nearest(glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng)), 8, nearest);
+        }
+        double nearestMs = millisecondsSince(start) / queries;
+
+        std::printf("%8zu %9.2f %9.2f %9.4f %9.4f %9.4f %9.4f %9.4f %9zu %7d\n", count, buildMs, refitMs,
+                    frustumMs, linearMs, rayMs, sphereMs, nearestMs, visible / queries, tree.height());
+    }
+    std::printf("query columns are ms per query\n");
+    return 0;
+}
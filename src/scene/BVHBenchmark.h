@@ -0,0 +1,6 @@
+#pragma once
+
+// CPU-only benchmark of the scene BVH (--bvh-bench): builds trees of 10k-100k
+// random boxes and times refits and frustum, ray, sphere and k-nearest queries
+// against a linear scan. Needs no GL context. Returns the process exit code.
+int runBVHBenchmark();
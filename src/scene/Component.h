@@ -2,6 +2,8 @@
 
 class Entity;
 class Shader;
+class RenderQueue;
+struct AABB;
 
 class Component {
 public:
@@ -10,4 +12,11 @@ public:
     virtual void init() {}
     virtual void update(float dt) {}
     virtual void draw(Shader& shader) {}
+    // returns false if the component has to be drawn immediately with draw()
+    virtual bool submit(RenderQueue& queue, Shader& shader) { return false; }
+    // world space bounds for culling; false if the component has none
+    virtual bool worldBounds(AABB& out) { return false; }
+    // world space box the renderer outlines in place of the component while its content
+    // loads in the background; false once there is something to draw
+    virtual bool loadingBounds(AABB& out) { return false; }
 };
\ No newline at end of file
@@ -4,15 +4,45 @@
 #include "../render/Model.h"
 #include "TransformComponent.h"
 #include "../scene/Entity.h"
+#include "../render/RenderQueue.h"
 
 class ModelComponent : public Component {
 public:
     m3D::Model* model;
+    LodSelection lods; // level of detail per mesh, kept between frames
     ModelComponent(m3D::Model* model) : model(model) {}
 
     void draw(Shader& shader) override {
+        if (model->IsLoading()) {
+            return;
+        }
         TransformComponent& transform = entity->getComponent<TransformComponent>();
         shader.SetMatrix4("model", transform.transform.GetModelMatrix());
-        model->Draw(shader);
+        model->Draw(shader, transform.transform.GetModelMatrix(), lods);
+    }
+
+    bool worldBounds(AABB& out) override {
+        TransformComponent& transform = entity->getComponent<TransformComponent>();
+        if (!model->bounds.valid() && model->IsLoading()) {
+            // the import has not told how big the model is yet: a unit box where it will appear
+            out.min = transform.transform.position - glm::vec3(0.5f);
+            out.max = transform.transform.position + glm::vec3(0.5f);
+            return true;
+        }
+        out = model->bounds.transformed(transform.transform.GetModelMatrix());
+        return out.valid();
+    }
+
+    bool loadingBounds(AABB& out) override {
+        return model->IsLoading() && worldBounds(out);
+    }
+
+    bool submit(RenderQueue& queue, Shader& shader) override {
+        if (model->IsLoading()) {
+            return true; // the renderer draws loadingBounds() instead
+        }
+        TransformComponent& transform = entity->getComponent<TransformComponent>();
+        model->Submit(queue, shader, transform.transform.GetModelMatrix(), &lods);
+        return true;
     }
 };
\ No newline at end of file
@@ -11,4 +11,9 @@ public:
     void draw(Shader& shader) override {
         shape->Draw(shader);
     }
+
+    bool worldBounds(AABB& out) override {
+        out = shape->GetWorldBounds();
+        return out.valid();
+    }
 };
@@ -1,6 +1,7 @@
 #include "Scene.h"
 #include "Component.h"
 #include "../render/SceneObject.h"
+#include <algorithm>
 
 void Scene::addEntity(std::unique_ptr<Entity> entity) {
     entities.emplace_back(std::move(entity));
@@ -18,7 +19,21 @@ void Scene::update(float dt) {
     }
 }
 
-void Scene::draw(Shader& shader) {
+void Scene::draw(Shader& shader, const Frustum* frustum, CullingStats* stats) {
+    if (frustum) {
+        refreshBounds();
+        std::vector<SceneItem> visible;
+        queryFrustum(*frustum, visible, stats);
+        for (const SceneItem& item : visible) {
+            if (item.component) {
+                item.component->draw(shader);
+            } else {
+                item.object->Draw(shader);
+            }
+        }
+        return;
+    }
+
     for (auto& entity : entities) {
         for (auto& component : entity->getComponents()) {
             component->draw(shader);
@@ -29,10 +44,101 @@ void Scene::draw(Shader& shader) {
     }
 }
 
+void Scene::refreshBounds() {
+    // getObjects() hands out the vector, so new objects are picked up here
+    // rather than in AddObject
+    for (; registeredObjects < objects.size(); registeredObjects++) {
+        SpatialEntry entry;
+        entry.item.object = objects[registeredObjects].get();
+        spatialEntries.push_back(entry);
+    }
+    registeredComponents.resize(entities.size(), 0);
+    for (size_t e = 0; e < entities.size(); e++) {
+        const auto& components = entities[e]->getComponents();
+        for (; registeredComponents[e] < components.size(); registeredComponents[e]++) {
+            SpatialEntry entry;
+            entry.item.component = components[registeredComponents[e]].get();
+            spatialEntries.push_back(entry);
+        }
+    }
+
+    unboundedEntries.clear();
+    for (size_t i = 0; i < spatialEntries.size(); i++) {
+        SpatialEntry& entry = spatialEntries[i];
+        AABB bounds;
+        bool hasBounds;
+        if (entry.item.component) {
+            hasBounds = entry.item.component->worldBounds(bounds);
+        } else {
+            bounds = entry.item.object->GetWorldBounds();
+            hasBounds = bounds.valid();
+        }
+
+        if (!hasBounds) {
+            if (entry.proxy != BVH::NULL_NODE) {
+                bvh.remove(entry.proxy);
+                entry.proxy = BVH::NULL_NODE;
+            }
+            unboundedEntries.push_back(static_cast<uint32_t>(i));
+        } else if (entry.proxy == BVH::NULL_NODE) {
+            entry.proxy = bvh.insert(bounds, static_cast<uint32_t>(i));
+        } else {
+            const AABB& previous = bvh.getBounds(entry.proxy);
+            if (previous.min != bounds.min || previous.max != bounds.max) {
+                bvh.move(entry.proxy, bounds);
+            }
+        }
+    }
+}
+
+void Scene::queryFrustum(const Frustum& frustum, std::vector<SceneItem>& out, CullingStats* stats) const {
+    queryScratch.clear();
+    bvh.queryFrustum(frustum, queryScratch);
+    if (stats) {
+        stats->visible += static_cast<unsigned int>(queryScratch.size());
+        stats->culled += static_cast<unsigned int>(bvh.size() - queryScratch.size());
+    }
+    queryScratch.insert(queryScratch.end(), unboundedEntries.begin(), unboundedEntries.end());
+    // keep the draw order independent of the tree layout
+    std::sort(queryScratch.begin(), queryScratch.end());
+    for (uint32_t index : queryScratch) {
+        out.push_back(spatialEntries[index].item);
+    }
+}
+
+bool Scene::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, SceneHit& hit) const {
+    BVHHit bvhHit;
+    if (!bvh.raycast(origin, direction, maxDistance, bvhHit)) {
+        return false;
+    }
+    hit.item = spatialEntries[bvhHit.userData].item;
+    hit.distance = bvhHit.distance;
+    return true;
+}
+
+void Scene::querySphere(const glm::vec3& center, float radius, std::vector<SceneItem>& out) const {
+    queryScratch.clear();
+    bvh.querySphere(center, radius, queryScratch);
+    for (uint32_t index : queryScratch) {
+        out.push_back(spatialEntries[index].item);
+    }
+}
+
+void Scene::queryNearest(const glm::vec3& point, size_t k, std::vector<SceneHit>& out) const {
+    hitScratch.clear();
+    bvh.nearest(point, k, hitScratch);
+    for (const BVHHit& bvhHit : hitScratch) {
+        SceneHit hit;
+        hit.item = spatialEntries[bvhHit.userData].item;
+        hit.distance = bvhHit.distance;
+        out.push_back(hit);
+    }
+}
+
 std::vector<std::shared_ptr<SceneObject>>& Scene::getObjects() {
     return objects;
 }
 
 const std::vector<std::unique_ptr<Entity>>& Scene::getEntities() const {
     return entities;
-}
\ No newline at end of file
+}
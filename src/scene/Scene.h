@@ -3,21 +3,58 @@
 #include <vector>
 #include <memory>
 #include "Entity.h"
+#include "BVH.h"
 #include "../render/SceneObject.h"
 
 class Shader;
 
+// Something the scene can draw: exactly one of object/component is set
+struct SceneItem {
+    SceneObject* object = nullptr;
+    Component* component = nullptr;
+};
+
+struct SceneHit {
+    SceneItem item;
+    float distance = 0.0f;
+};
+
 class Scene {
 public:
     void addEntity(std::unique_ptr<Entity> entity);
     void AddObject(std::shared_ptr<SceneObject> object);
     void update(float dt);
-    void draw(Shader& shader);
+    // draws everything; with a frustum, components and objects outside it are skipped
+    void draw(Shader& shader, const Frustum* frustum = nullptr, CullingStats* stats = nullptr);
 
     std::vector<std::shared_ptr<SceneObject>>& getObjects();
     const std::vector<std::unique_ptr<Entity>>& getEntities() const;
 
+    // Registers new objects/components in the BVH and refits the ones that moved.
+    // The queries below see the scene as of the last call.
+    void refreshBounds();
+
+    // Items inside the frustum in registration order, plus every item without bounds
+    void queryFrustum(const Frustum& frustum, std::vector<SceneItem>& out, CullingStats* stats = nullptr) const;
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, SceneHit& hit) const;
+    void querySphere(const glm::vec3& center, float radius, std::vector<SceneItem>& out) const;
+    void queryNearest(const glm::vec3& point, size_t k, std::vector<SceneHit>& out) const;
+
 private:
+    struct SpatialEntry {
+        SceneItem item;
+        int proxy = BVH::NULL_NODE;
+    };
+
     std::vector<std::unique_ptr<Entity>> entities;
     std::vector<std::shared_ptr<SceneObject>> objects;
-};
\ No newline at end of file
+
+    // Objects and components are never removed, so entries only grow
+    std::vector<SpatialEntry> spatialEntries;
+    std::vector<uint32_t> unboundedEntries;
+    size_t registeredObjects = 0;
+    std::vector<size_t> registeredComponents; // per entity
+    BVH bvh;
+    mutable std::vector<uint32_t> queryScratch;
+    mutable std::vector<BVHHit> hitScratch;
+};
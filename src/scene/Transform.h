@@ -12,13 +12,26 @@ public:
     Transform(const glm::vec3& pos = glm::vec3(0.0f), const glm::vec3& rot = glm::vec3(0.0f), const glm::vec3& scl = glm::vec3(1.0f))
         : position(pos), rotation(rot), scale(scl) {}
 
-    glm::mat4 GetModelMatrix() const {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, position);
-        model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, scale);
-        return model;
+    // rebuilt only when position, rotation or scale changed since the last call
+    const glm::mat4& GetModelMatrix() const {
+        if (dirty || position != cachedPosition || rotation != cachedRotation || scale != cachedScale) {
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, position);
+            model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+            model = glm::scale(model, scale);
+            cachedModel = model;
+            cachedPosition = position;
+            cachedRotation = rotation;
+            cachedScale = scale;
+            dirty = false;
+        }
+        return cachedModel;
     }
+
+private:
+    mutable glm::mat4 cachedModel = glm::mat4(1.0f);
+    mutable glm::vec3 cachedPosition, cachedRotation, cachedScale;
+    mutable bool dirty = true;
 };
@@ -0,0 +1,105 @@
+#include "ProfilerPanel.h"
+#include <imgui/imgui.h>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cstdio>
+#include <set>
+#include <string>
+
+bool ProfilerPanel::frozen = false;
+ProfileFrame ProfilerPanel::frozenFrame;
+
+// Stable colour per zone name, so a zone keeps its colour between frames
+static ImU32 zoneColor(const char* name)
+{
+    unsigned int hash = 2166136261u;
+    for (const char* c = name; *c; c++)
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    return ImColor::HSV((hash % 360) / 360.0f, 0.45f, 0.75f);
+}
+
+void ProfilerPanel::Draw()
+{
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "avg %.2f ms", Profiler::GetAverageFrameTime());
+    ImGui::PlotLines("Frame ms", Profiler::GetFrameTimes(), Profiler::HISTORY_FRAMES,
+                     Profiler::GetFrameTimeOffset(), overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 50.0f));
+
+    if (ImGui::Checkbox("Freeze", &frozen) && frozen) {
+        if (const ProfileFrame* last = Profiler::GetLastResolvedFrame())
+            frozenFrame = *last;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Save Chrome trace")) {
+        auto now = std::chrono::system_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        Profiler::WriteChromeTrace("trace_" + std::to_string(ms) + ".json");
+    }
+    if (Profiler::GetDroppedEvents() > 0) {
+        ImGui::SameLine();
+        ImGui::Text("(%lu zones dropped)", Profiler::GetDroppedEvents());
+    }
+
+    const ProfileFrame* frame = frozen ? &frozenFrame : Profiler::GetLastResolvedFrame();
+    if (!frame)
+        return;
+
+    ImGui::Text("Frame %llu: %.2f ms", static_cast<unsigned long long>(frame->index),
+                (frame->endNs - frame->startNs) / 1.0e6);
+    std::set<uint32_t> threads;
+    for (const ProfileEvent& event : frame->cpuEvents)
+        threads.insert(event.threadId);
+    for (uint32_t thread : threads) {
+        std::string label = "CPU thread " + std::to_string(thread);
+        DrawFlameGraph(label.c_str(), frame->cpuEvents, thread, frame->startNs, frame->endNs);
+    }
+
+    if (!frame->gpuEvents.empty()) {
+        // the GPU runs behind the CPU, so its graph spans its own zones
+        uint64_t gpuStart = UINT64_MAX, gpuEnd = 0;
+        for (const ProfileEvent& event : frame->gpuEvents) {
+            gpuStart = std::min(gpuStart, event.startNs);
+            gpuEnd = std::max(gpuEnd, event.startNs + event.durationNs);
+        }
+        DrawFlameGraph("GPU", frame->gpuEvents, Profiler::GPU_THREAD_ID, gpuStart, gpuEnd);
+    }
+}
+
+void ProfilerPanel::DrawFlameGraph(const char* label, const std::vector<ProfileEvent>& events, uint32_t threadId,
+                                   uint64_t startNs, uint64_t endNs)
+{
+    uint16_t maxDepth = 0;
+    for (const ProfileEvent& event : events) {
+        if (event.threadId == threadId)
+            maxDepth = std::max(maxDepth, event.depth);
+    }
+
+    ImGui::Text("%s", label);
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    const float height = rowHeight * (maxDepth + 1);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const double scale = endNs > startNs ? width / static_cast<double>(endNs - startNs) : 0.0;
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(30, 30, 30, 200));
+    for (const ProfileEvent& event : events) {
+        if (event.threadId != threadId)
+            continue;
+        float x0 = origin.x + static_cast<float>((static_cast<double>(event.startNs) - startNs) * scale);
+        float x1 = x0 + std::max(static_cast<float>(event.durationNs * scale), 1.0f);
+        float y0 = origin.y + event.depth * rowHeight;
+        ImVec2 min(x0, y0), max(x1, y0 + rowHeight - 1.0f);
+
+        drawList->AddRectFilled(min, max, zoneColor(event.name));
+        if (x1 - x0 > ImGui::CalcTextSize(event.name).x + 4.0f) {
+            drawList->PushClipRect(min, max, true);
+            drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), event.name);
+            drawList->PopClipRect();
+        }
+        if (ImGui::IsMouseHoveringRect(min, max))
+            ImGui::SetTooltip("%s: %.3f ms", event.name, event.durationNs / 1.0e6);
+    }
+    ImGui::Dummy(ImVec2(width, height));
+}
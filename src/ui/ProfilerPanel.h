@@ -0,0 +1,23 @@
+#ifndef PROFILER_PANEL_H
+#define PROFILER_PANEL_H
+
+#include <vector>
+#include <cstdint>
+#include "../render/Profiler.h"
+
+// ImGui view of the Profiler: frame time history, one flame graph per CPU
+// thread plus one for the GPU, and Chrome trace export. Call between
+// ImGui::Begin and ImGui::End.
+class ProfilerPanel {
+public:
+    static void Draw();
+
+private:
+    static void DrawFlameGraph(const char* label, const std::vector<ProfileEvent>& events, uint32_t threadId,
+                               uint64_t startNs, uint64_t endNs);
+
+    static bool frozen;           // keep showing the same frame
+    static ProfileFrame frozenFrame;
+};
+
+#endif // PROFILER_PANEL_H
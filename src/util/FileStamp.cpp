@@ -0,0 +1,40 @@
+#include "FileStamp.h"
+#include <filesystem>
+#include "MappedFile.h"
+
+uint64_t Fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t HashString(const std::string& text)
+{
+    return Fnv1a(FNV1A_BASIS, text.data(), text.size());
+}
+
+bool HashFile(const std::string& path, uint64_t& hash)
+{
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    hash = Fnv1a(FNV1A_BASIS, file.data(), file.size());
+    return true;
+}
+
+bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& modified)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(path, error);
+    if (error)
+        return false;
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error)
+        return false;
+    modified = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef FILE_STAMP_H
+#define FILE_STAMP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Change detection for files that caches are built from: a cheap stamp (size
+// and modification time) checked first, and a content hash for when only
+// the time moved. FNV-1a; fine for telling versions apart, not cryptographic.
+
+const uint64_t FNV1A_BASIS = 14695981039346656037ull;
+
+uint64_t Fnv1a(uint64_t hash, const void* data, size_t size);
+uint64_t HashString(const std::string& text);
+// false if the file cannot be read
+bool HashFile(const std::string& path, uint64_t& hash);
+bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& modified);
+
+#endif // FILE_STAMP_H
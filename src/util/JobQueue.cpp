@@ -0,0 +1,65 @@
+#include "JobQueue.h"
+
+JobQueue::JobQueue(int threads)
+{
+    if (threads < 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threads = hardware > 1 ? static_cast<int>(hardware) - 1 : 1;
+    }
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&JobQueue::workerLoop, this);
+}
+
+JobQueue::~JobQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void JobQueue::push(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void JobQueue::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return jobs.empty() && running == 0; });
+}
+
+size_t JobQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + running;
+}
+
+void JobQueue::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+        if (stopping)
+            return;
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        running++;
+
+        lock.unlock();
+        job();
+        lock.lock();
+
+        running--;
+        if (jobs.empty() && running == 0)
+            done.notify_all();
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Background threads that run queued jobs in the order they were pushed,
+// several at a time. Unlike WorkerPool, push() returns at once; it is for
+// work that outlives the frame that asked for it, such as loading assets.
+class JobQueue
+{
+public:
+    // threads -1 picks hardware_concurrency - 1, at least one
+    explicit JobQueue(int threads = -1);
+    // jobs that have not started are dropped, running ones are waited for
+    ~JobQueue();
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    void push(std::function<void()> job);
+    // blocks until every job pushed so far has run
+    void wait();
+    // jobs queued or running
+    size_t pending() const;
+    unsigned int threads() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::deque<std::function<void()>> jobs;
+    unsigned int running = 0;
+    bool stopping = false;
+};
+
+#endif // JOB_QUEUE_H
@@ -0,0 +1,98 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE view = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!view) {
+        CloseHandle(handle);
+        return false;
+    }
+    const void* address = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+    if (!address) {
+        CloseHandle(view);
+        CloseHandle(handle);
+        return false;
+    }
+
+    file = handle;
+    mapping = view;
+    bytes = static_cast<const unsigned char*>(address);
+    length = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    bytes = nullptr;
+    length = 0;
+    mapping = nullptr;
+    file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        ::close(descriptor);
+        return false;
+    }
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // the mapping keeps the file alive on its own
+    ::close(descriptor);
+    if (address == MAP_FAILED)
+        return false;
+
+    bytes = static_cast<const unsigned char*>(address);
+    length = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap(const_cast<unsigned char*>(bytes), length);
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped read-only into memory; pages are read in by the OS as
+// they are touched instead of being copied through a stream buffer.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if the file cannot be opened or is empty
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,85 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads)
+{
+    if (threads < 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threads = hardware > 1 ? static_cast<int>(hardware) - 1 : 0;
+    }
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& job)
+{
+    if (count == 0)
+        return;
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentJob = &job;
+        jobCount = count;
+        nextJob = 0;
+        finishedJobs = 0;
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(job, count);
+
+    // a worker that is still inside drain() may hold the old job, so wait for it too
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return finishedJobs == count && busyWorkers == 0; });
+    currentJob = nullptr;
+}
+
+void WorkerPool::drain(const std::function<void(size_t)>& job, size_t count)
+{
+    size_t index;
+    while ((index = nextJob.fetch_add(1)) < count) {
+        job(index);
+        if (finishedJobs.fetch_add(1) + 1 == count) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+void WorkerPool::workerLoop()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || (generation != seen && currentJob); });
+        if (stopping)
+            return;
+        seen = generation;
+        const std::function<void(size_t)>* job = currentJob;
+        size_t count = jobCount;
+        busyWorkers++;
+        lock.unlock();
+
+        drain(*job, count);
+
+        lock.lock();
+        busyWorkers--;
+        if (busyWorkers == 0)
+            done.notify_all();
+    }
+}
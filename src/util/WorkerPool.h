@@ -0,0 +1,49 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads for data-parallel loops. run() hands out the job
+// indices [0, count) to the workers and the calling thread and returns when
+// every job is done, so the threads are reused from frame to frame instead of
+// being created per call. One run() at a time per pool.
+class WorkerPool
+{
+public:
+    // threads workers besides the caller; -1 picks hardware_concurrency - 1
+    explicit WorkerPool(int threads = -1);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // threads that take part in run(), the caller included
+    unsigned int concurrency() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    void run(size_t count, const std::function<void(size_t)>& job);
+
+private:
+    void workerLoop();
+    // takes jobs until none are left
+    void drain(const std::function<void(size_t)>& job, size_t count);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* currentJob = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextJob{0};
+    std::atomic<size_t> finishedJobs{0};
+    unsigned int busyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+#endif // WORKER_POOL_H